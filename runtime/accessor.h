@@ -30,6 +30,8 @@
 
 // for fprintf
 #include <stdio.h>
+// for memcpy
+#include <string.h>
 
 using namespace LegionRuntime::Arrays;
 
@@ -196,9 +198,9 @@ namespace LegionRuntime {
       struct Generic {
 	struct Untyped {
           CUDAPREFIX
-	  Untyped() : internal(0), field_offset(0) {}
+	  Untyped() : internal(0), field_offset(0), fast_dim(-1) {}
           CUDAPREFIX
-	  Untyped(void *_internal, off_t _field_offset = 0) : internal(_internal), field_offset(_field_offset) {}
+	  Untyped(void *_internal, off_t _field_offset = 0) : internal(_internal), field_offset(_field_offset), fast_dim(-1) {}
 
 	  template <typename ET>
 	  RegionAccessor<Generic, ET, ET> typeify(void) const {
@@ -212,9 +214,37 @@ namespace LegionRuntime {
             return result;
 	  }
 
-	  void read_untyped(ptr_t ptr, void *dst, size_t bytes, off_t offset = 0) const;
-	  void write_untyped(ptr_t ptr, const void *src, size_t bytes, off_t offset = 0) const;
+	  // if the instance is directly accessible and has an affine layout, reads
+	  //  and writes by ptr_t are just pointer arithmetic - otherwise (or when
+	  //  privilege/bounds checks are enabled) they go through the instance
+	  inline void read_untyped(ptr_t ptr, void *dst, size_t bytes, off_t offset = 0) const
+	  {
+#if !defined(PRIVILEGE_CHECKS) && !defined(BOUNDS_CHECKS)
+	    if(fast_dim < 0)
+	      init_fast_path();
+	    if((fast_dim == 1) && fast_path_ok(offset, bytes)) {
+	      memcpy(dst, fast_base + (ptr.value * fast_strides[0]) + offset, bytes);
+	      return;
+	    }
+#endif
+	    read_untyped_slow(ptr, dst, bytes, offset);
+	  }
+
+	  inline void write_untyped(ptr_t ptr, const void *src, size_t bytes, off_t offset = 0) const
+	  {
+#if !defined(PRIVILEGE_CHECKS) && !defined(BOUNDS_CHECKS)
+	    if(fast_dim < 0)
+	      init_fast_path();
+	    if((fast_dim == 1) && fast_path_ok(offset, bytes)) {
+	      memcpy(fast_base + (ptr.value * fast_strides[0]) + offset, src, bytes);
+	      return;
+	    }
+#endif
+	    write_untyped_slow(ptr, src, bytes, offset);
+	  }
 
+	  // DomainPoint isn't a complete type here, so these are out of line, but
+	  //  use the same cached layout when they can
 	  void read_untyped(const Realm::DomainPoint& dp, void *dst, size_t bytes, off_t offset = 0) const;
 	  void write_untyped(const Realm::DomainPoint& dp, const void *src, size_t bytes, off_t offset = 0) const;
 
@@ -248,6 +278,27 @@ namespace LegionRuntime {
 
 	  void *internal;
 	  off_t field_offset;
+	protected:
+	  // layout information for the fast path, computed on first use: the
+	  //  element at coordinates x is at fast_base + sum(x[i] * fast_strides[i]),
+	  //  and an access at 'offset' (relative to field_offset) must fall within
+	  //  [fast_min_offset, fast_max_offset) - i.e. the same field for SOA layouts
+	  mutable int fast_dim;  // -1 = not computed yet, 0 = no fast path
+	  mutable char *fast_base;
+	  mutable off_t fast_strides[3];
+	  mutable off_t fast_min_offset, fast_max_offset;
+
+	  void init_fast_path(void) const;
+
+	  inline bool fast_path_ok(off_t offset, size_t bytes) const
+	  {
+	    return ((offset >= fast_min_offset) &&
+		    ((off_t)(offset + bytes) <= fast_max_offset));
+	  }
+
+	  void read_untyped_slow(ptr_t ptr, void *dst, size_t bytes, off_t offset) const;
+	  void write_untyped_slow(ptr_t ptr, const void *src, size_t bytes, off_t offset) const;
+	public:
 #if defined(PRIVILEGE_CHECKS) || defined(BOUNDS_CHECKS) 
         protected:
           void *region;
@@ -52,12 +52,12 @@ void record_am_handler(int handler_id, const char *description, bool reply)
 
 #ifdef REALM_PROFILE_AM_HANDLERS
 /*extern*/ ActiveMsgHandlerStats handler_stats[256];
+/*extern*/ ActiveMsgHandlerStats queue_stats[256];
 #endif
 
 static const int DEFERRED_FREE_COUNT = 128;
-gasnet_hsl_t deferred_free_mutex;
-int deferred_free_pos;
-void *deferred_frees[DEFERRED_FREE_COUNT];
+unsigned deferred_free_pos;
+void *volatile deferred_frees[DEFERRED_FREE_COUNT];
 
 gasnet_seginfo_t *segment_info = 0;
 
@@ -69,37 +69,67 @@ static bool is_registered(void *ptr)
   return false;
 }
 
+// incoming messages are spread over one queue per handler thread - a sender
+//  sticks to one queue while any of its messages are queued or being handled
+//  (which preserves the ordering of its messages without a global lock), and
+//  moves to the least loaded queue once they have all been handled
 class IncomingMessageManager {
 public:
-  IncomingMessageManager(int _nodes, Realm::CoreReservationSet& crs);
+  IncomingMessageManager(int _nodes, int _num_queues,
+			 Realm::CoreReservationSet& crs);
   ~IncomingMessageManager(void);
 
   void add_incoming_message(int sender, IncomingMessage *msg);
 
-  void start_handler_threads(int count, size_t stack_size);
+  void start_handler_threads(size_t stack_size);
+
+  Realm::CoreReservation *get_core_reservation(void) { return core_rsrv; }
 
   void shutdown(void);
 
-  IncomingMessage *get_messages(int &sender, bool wait = true);
+  // returns everything currently in the given queue, in arrival order
+  IncomingMessage *get_messages(int queue_idx, bool wait = true);
 
   void handler_thread_loop(void);
 
 protected:
+  // a multi-producer, single-consumer queue - producers push onto a lock-free
+  //  stack and the consumer takes the whole stack at once, so the mutex and
+  //  condvar are only touched when the consumer has gone to sleep
+  struct MessageQueue {
+    IncomingMessage *volatile stack;
+    volatile int sleeping;
+    volatile int pending; // messages queued or being handled
+    gasnet_hsl_t mutex;
+    gasnett_cond_t condvar;
+  };
+
+  // the queue a sender is currently assigned to, which can only change when
+  //  none of the sender's messages are in flight - the queue index (upper 32
+  //  bits) and the in-flight count (lower 32 bits) share a word so that a
+  //  new assignment is published by the same atomic update as the 0->1
+  //  transition of the count
+  struct SenderState {
+    volatile uint64_t state;
+
+    static const uint64_t COUNT_MASK = 0xFFFFFFFFULL;
+    static const int QUEUE_SHIFT = 32;
+  };
+
+  int choose_queue(void) const;
+
   int nodes;
-  int shutdown_flag;
-  IncomingMessage **heads;
-  IncomingMessage ***tails;
-  int *todo_list; // list of nodes with non-empty message lists
-  int todo_oldest, todo_newest;
-  gasnet_hsl_t mutex;
-  gasnett_cond_t condvar;
+  int num_queues;
+  volatile int shutdown_flag;
+  MessageQueue *queues;
+  SenderState *senders;
+  int next_queue; // used to hand out queues to handler threads
   Realm::CoreReservation *core_rsrv;
   std::vector<Realm::Thread *> handler_threads;
 };
 
 void init_deferred_frees(void)
 {
-  gasnet_hsl_init(&deferred_free_mutex);
   deferred_free_pos = 0;
   for(int i = 0; i < DEFERRED_FREE_COUNT; i++)
     deferred_frees[i] = 0;
@@ -110,11 +140,9 @@ void deferred_free(void *ptr)
 #ifdef DEBUG_MEM_REUSE
   printf("%d: deferring free of %p\n", gasnet_mynode(), ptr);
 #endif
-  gasnet_hsl_lock(&deferred_free_mutex);
-  void *oldptr = deferred_frees[deferred_free_pos];
-  deferred_frees[deferred_free_pos] = ptr;
-  deferred_free_pos = (deferred_free_pos + 1) % DEFERRED_FREE_COUNT;
-  gasnet_hsl_unlock(&deferred_free_mutex);
+  // claim a slot and swap our pointer into it - no lock needed
+  unsigned pos = __sync_fetch_and_add(&deferred_free_pos, 1) % DEFERRED_FREE_COUNT;
+  void *oldptr = __sync_lock_test_and_set(&deferred_frees[pos], ptr);
   if(oldptr) {
 #ifdef DEBUG_MEM_REUSE
     printf("%d: actual free of %p\n", gasnet_mynode(), oldptr);
@@ -205,41 +233,69 @@ struct OutgoingMessage {
 
 LegionRuntime::Logger::Category log_sdp("srcdatapool");
 
+// the srcdata pool is split into several ring buffers so that threads sending
+//  messages don't all serialize on a single allocator - each sending thread
+//  has a preferred ring, allocations are carved off the head of a ring, and
+//  releases (which come back in arbitrary order from the acks) just mark the
+//  allocation as freed without taking any lock - the tail of a ring is then
+//  advanced past freed allocations by the next allocator to look at it
 class SrcDataPool {
 public:
-  SrcDataPool(void *base, size_t size);
+  SrcDataPool(void *base, size_t size, int _num_rings);
   ~SrcDataPool(void);
 
-  class Lock {
-  public:
-    Lock(SrcDataPool& _sdp) : sdp(_sdp) { gasnet_hsl_lock(&sdp.mutex); }
-    ~Lock(void) { gasnet_hsl_unlock(&sdp.mutex); }
-  protected:
-    SrcDataPool& sdp;
-  };
+  // the largest payload that can ever be held by the pool - larger payloads
+  //  have to bypass it
+  size_t max_alloc_size(void) const;
 
-  // allocators must already hold the lock - prove it by passing a reference
-  void *alloc_srcptr(size_t size_needed, Lock& held_lock);
+  // attempts to allocate space for a payload without waiting - fails if
+  //  there are already pending allocations ahead of this one
+  void *alloc_srcptr(size_t size_needed);
 
-  // enqueuing a pending message must also hold the lock
-  void add_pending(OutgoingMessage *msg, Lock& held_lock);
+  // allocates space for a message's payload, or queues the message until
+  //  enough space has been released (in which case 0 is returned)
+  void *alloc_or_add_pending(OutgoingMessage *msg);
 
-  // releasing memory will take the lock itself
+  // lock-free unless there are pending allocations that may now be satisfied
   void release_srcptr(void *srcptr);
 
+  void report_status(FILE *f);
+
   static void release_srcptr_handler(gasnet_token_t token, gasnet_handlerarg_t arg0, gasnet_handlerarg_t arg1);
 
 protected:
-  size_t round_up_size(size_t size);
+  struct Ring {
+    gasnet_hsl_t mutex;  // held by allocators only
+    size_t first_block;
+    size_t head, tail;   // in blocks, relative to first_block
+  };
 
-  friend class SrcDataPool::Lock;
-  gasnet_hsl_t mutex;
+  static const size_t BLOCK_SIZE = 64;
+  static const unsigned BLOCK_FREED = 0x80000000U;
+
+  static size_t blocks_needed(size_t size);
+
+  void *try_alloc(size_t blocks);
+  void *ring_alloc(Ring& r, size_t blocks);
+  void reclaim(Ring& r);
+  void satisfy_pending(void);
+
+  char *pool_base;
   size_t total_size;
-  std::map<char *, size_t> free_list;
+  int num_rings;
+  size_t ring_blocks;
+  Ring *rings;
+  int next_ring;
+  // for the first block of each allocation, the allocation's length in
+  //  blocks, with BLOCK_FREED or'd in once it has been released
+  volatile unsigned *block_info;
+
+  gasnet_hsl_t pending_mutex;
   std::queue<OutgoingMessage *> pending_allocations;
-  // debug
-  std::map<char *, size_t> in_use;
-  std::map<void *, off_t> alloc_counts;
+  volatile int pending_count;
+
+  // statistics on allocations that had to wait for space
+  size_t stall_count, stall_bytes, max_pending;
 };
 
 static SrcDataPool *srcdatapool = 0;
@@ -251,212 +307,196 @@ void release_srcptr(void *srcptr)
   srcdatapool->release_srcptr(srcptr);
 }
 
-SrcDataPool::SrcDataPool(void *base, size_t size)
+SrcDataPool::SrcDataPool(void *base, size_t size, int _num_rings)
+  : pool_base((char *)base), total_size(size), num_rings(_num_rings),
+    next_ring(0), pending_count(0),
+    stall_count(0), stall_bytes(0), max_pending(0)
 {
-  gasnet_hsl_init(&mutex);
-  free_list[(char *)base] = size;
-  total_size = size;
+  assert(num_rings > 0);
+  ring_blocks = (size / BLOCK_SIZE) / num_rings;
+  assert(ring_blocks > 0);
+  rings = new Ring[num_rings];
+  for(int i = 0; i < num_rings; i++) {
+    gasnet_hsl_init(&rings[i].mutex);
+    rings[i].first_block = i * ring_blocks;
+    rings[i].head = rings[i].tail = 0;
+  }
+  block_info = new unsigned[ring_blocks * num_rings];
+  for(size_t i = 0; i < ring_blocks * num_rings; i++)
+    block_info[i] = 0;
+  gasnet_hsl_init(&pending_mutex);
 }
 
 SrcDataPool::~SrcDataPool(void)
 {
-  size_t total = 0;
-  size_t nonzero = 0;
-  for(std::map<void *, off_t>::const_iterator it = alloc_counts.begin(); it != alloc_counts.end(); it++) {
-    total++;
-    if(it->second != 0) {
-      printf("HELP!  srcptr %p on node %d has final count of %zd\n", it->first, gasnet_mynode(), it->second);
-      nonzero++;
-    }
-  }
-  printf("SrcDataPool:  node %d: %zd total srcptrs, %zd nonzero\n", gasnet_mynode(), total, nonzero);
+  delete[] rings;
+  delete[] block_info;
+}
+
+/*static*/ size_t SrcDataPool::blocks_needed(size_t size)
+{
+  return (size + BLOCK_SIZE - 1) / BLOCK_SIZE;
 }
 
-size_t SrcDataPool::round_up_size(size_t size)
+size_t SrcDataPool::max_alloc_size(void) const
 {
-  const size_t BLOCK_SIZE = 64;
-  size_t remainder = size % BLOCK_SIZE;
-  if(remainder)
-    return size + (BLOCK_SIZE - remainder);
-  else
-    return size;
+  return ring_blocks * BLOCK_SIZE;
 }
 
-void *SrcDataPool::alloc_srcptr(size_t size_needed, Lock& held_lock)
+void *SrcDataPool::alloc_srcptr(size_t size_needed)
 {
   // sanity check - if the requested size is larger than will ever fit, fail
-  if(size_needed > total_size)
+  if(size_needed > max_alloc_size())
     assert(0);
 
   // early out - if our pending allocation queue is non-empty, they're
   //  first in line, so fail this allocation
-  if(!pending_allocations.empty())
+  if(pending_count > 0)
     return 0;
 
-  // round up size to something reasonable
-  size_needed = round_up_size(size_needed);
-
-  // walk the free list until we find something big enough
-  // only use the a bigger chunk if we absolutely have to 
-  // in order to avoid segmentation problems.
-  std::map<char *, size_t>::iterator it = free_list.begin();
-  char *smallest_upper_bound = 0;
-  size_t smallest_upper_size = 0;
-  while(it != free_list.end()) {
-    if(it->second == size_needed) {
-      // exact match
-      log_sdp.debug("found %p + %zd - exact", it->first, it->second);
-
-      char *srcptr = it->first;
-      free_list.erase(it);
-      in_use[srcptr] = size_needed;
-
-      return srcptr;
-    }
+  return try_alloc(blocks_needed(size_needed));
+}
 
-    if(it->second > size_needed) {
-      // match with some left over
-      // Check to see if it is smaller
-      // than the largest upper bound
-      if (smallest_upper_bound == 0) {
-        smallest_upper_bound = it->first;
-        smallest_upper_size = it->second;
-      } else if (it->second < smallest_upper_size) {
-        smallest_upper_bound = it->first;
-        smallest_upper_size = it->second;
-      }
-    }
+void *SrcDataPool::alloc_or_add_pending(OutgoingMessage *msg)
+{
+  void *srcptr = alloc_srcptr(msg->payload_size);
+  if(srcptr)
+    return srcptr;
+
+  gasnet_hsl_lock(&pending_mutex);
+  // count ourselves as pending before trying once more - a release that
+  //  raced with the attempt above either sees the count or has already
+  //  marked its space as freed for us to find
+  __sync_fetch_and_add(&pending_count, 1);
+  if(pending_allocations.empty())
+    srcptr = try_alloc(blocks_needed(msg->payload_size));
+  if(srcptr) {
+    __sync_fetch_and_sub(&pending_count, 1);
+  } else {
+    log_sdp.debug("pending allocation: %zd for %p", msg->payload_size, msg);
+    pending_allocations.push(msg);
+    stall_count++;
+    stall_bytes += msg->payload_size;
+    if(pending_allocations.size() > max_pending)
+      max_pending = pending_allocations.size();
+  }
+  gasnet_hsl_unlock(&pending_mutex);
+  return srcptr;
+}
 
-    // not big enough - keep looking
-    it++;
+void *SrcDataPool::try_alloc(size_t blocks)
+{
+  // each thread starts with its own ring, but will use any ring with space
+  static __thread int preferred_ring = -1;
+  if(preferred_ring < 0)
+    preferred_ring = __sync_fetch_and_add(&next_ring, 1) % num_rings;
+
+  for(int i = 0; i < num_rings; i++) {
+    void *ptr = ring_alloc(rings[(preferred_ring + i) % num_rings], blocks);
+    if(ptr)
+      return ptr;
   }
-  if (smallest_upper_bound != 0) {
-    it = free_list.find(smallest_upper_bound);
-    char *srcptr = it->first + (it->second - size_needed);
-    it->second -= size_needed;
-    in_use[srcptr] = size_needed;
+  return 0;
+}
 
-    log_sdp.debug("found %p + %zd > %zd", it->first, it->second, size_needed);
+void *SrcDataPool::ring_alloc(Ring& r, size_t blocks)
+{
+  gasnet_hsl_lock(&r.mutex);
+  reclaim(r);
+
+  size_t pos = r.head % ring_blocks;
+  size_t contig = ring_blocks - pos;
+  // an allocation can't wrap around the end of the ring, so any space before
+  //  the end is given up in that case
+  size_t consumed = ((contig < blocks) ? (contig + blocks) : blocks);
+  if(((r.head - r.tail) + consumed) > ring_blocks) {
+    gasnet_hsl_unlock(&r.mutex);
+    return 0;
+  }
 
-    return srcptr;
+  if(contig < blocks) {
+    // record the skipped space as an already-freed allocation
+    block_info[r.first_block + pos] = contig | BLOCK_FREED;
+    r.head += contig;
+    pos = 0;
   }
+  block_info[r.first_block + pos] = blocks;
+  r.head += blocks;
+  gasnet_hsl_unlock(&r.mutex);
 
-  // allocation failed - let caller decide what to do (probably add it as a
-  //   pending allocation after maybe moving data)
-  return 0;
+  char *srcptr = pool_base + (r.first_block + pos) * BLOCK_SIZE;
+  log_sdp.debug("found %p + %zd", srcptr, blocks * BLOCK_SIZE);
+  return srcptr;
 }
 
-void SrcDataPool::add_pending(OutgoingMessage *msg, Lock& held_lock)
+// advances the tail of the ring past released allocations - caller must hold
+//  the ring's mutex
+void SrcDataPool::reclaim(Ring& r)
 {
-  // simple - just add to our queue
-  log_sdp.debug("pending allocation: %zd for %p", msg->payload_size, msg);
-
-  // sanity check - if the requested size is larger than will ever fit, 
-  //  we're just dead
-  if(msg->payload_size > total_size) {
-    log_sdp.error("allocation of %zd can never be satisfied! (max = %zd)",
-		  msg->payload_size, total_size);
-    assert(0);
+  while(r.tail < r.head) {
+    size_t idx = r.first_block + (r.tail % ring_blocks);
+    unsigned info = block_info[idx];
+    if(!(info & BLOCK_FREED))
+      break;
+    block_info[idx] = 0;
+    r.tail += (info & ~BLOCK_FREED);
   }
-
-  pending_allocations.push(msg);
+  // an empty ring can start over at the beginning
+  if(r.tail == r.head)
+    r.head = r.tail = 0;
 }
 
 void SrcDataPool::release_srcptr(void *srcptr)
 {
-  char *srcptr_c = (char *)srcptr;
-
   log_sdp.debug("releasing srcptr = %p", srcptr);
 
+  size_t idx = (((char *)srcptr) - pool_base) / BLOCK_SIZE;
+  assert(idx < (ring_blocks * num_rings));
+  // this is a full barrier, so if an allocator has counted itself as pending
+  //  after we mark the space as freed, it will find the space itself
+  unsigned old_info = __sync_fetch_and_or(&block_info[idx], BLOCK_FREED);
+  assert((old_info != 0) && !(old_info & BLOCK_FREED));
+
+  if(pending_count > 0)
+    satisfy_pending();
+}
+
+void SrcDataPool::satisfy_pending(void)
+{
   // releasing a srcptr span may result in some pending allocations being
   //   satisfied - keep a list so their actual copies can happen without
-  //   holding the SDP lock
+  //   holding the pending lock
   std::vector<std::pair<OutgoingMessage *, void *> > satisfied;
-  {
-    Lock held_lock(*this);
-
-    // look up the pointer to find its size
-    std::map<char *, size_t>::iterator it = in_use.find(srcptr_c);
-    assert(it != in_use.end());
-    size_t size = it->second;
-    in_use.erase(it);  // remove from in use list
-
-    // we'd better not be in the free list ourselves
-    assert(free_list.find(srcptr_c) == free_list.end());
-
-    // see if we can absorb any adjacent ranges
-    if(!free_list.empty()) {
-      std::map<char *, size_t>::iterator above = free_list.lower_bound(srcptr_c);
-      
-      // look below first
-      while(above != free_list.begin()) {
-	std::map<char *, size_t>::iterator below = above;  below--;
-	
-	log_sdp.spew("merge?  %p+%zd %p+%zd NONE", below->first, below->second, srcptr_c, size);
-
-	if((below->first + below->second) != srcptr_c)
-	  break;
-
-	srcptr_c = below->first;
-	size += below->second;
-	free_list.erase(below);
-      }
-
-      // now look above
-      while(above != free_list.end()) {
-	log_sdp.spew("merge?  NONE %p+%zd %p+%zd", srcptr_c, size, above->first, above->second);
-
-	if((srcptr_c + size) != above->first)
-	  break;
-
-	size += above->second;
-	std::map<char *, size_t>::iterator to_nuke(above++);
-	free_list.erase(to_nuke);
-      }
-    }
-
-    // is this possibly-merged span large enough to satisfy the first pending
-    //  allocation (if any)?
-    if(!pending_allocations.empty() && 
-       (size >= pending_allocations.front()->payload_size)) {
-      OutgoingMessage *msg = pending_allocations.front();
-      pending_allocations.pop();
-      size_t act_size = round_up_size(msg->payload_size);
-      in_use[srcptr_c] = act_size;
-      satisfied.push_back(std::make_pair(msg, srcptr_c));
-
-      // was anything left?  if so, add it to the list of free spans
-      if(size > act_size)
-	free_list[srcptr_c + act_size] = size - act_size;
-
-      // now see if we can satisfy any other pending allocations - use the
-      //  normal allocator routine here because there might be better choices
-      //  to use than the span we just freed (assuming any of it is left)
-      while(!pending_allocations.empty()) {
-	OutgoingMessage *msg = pending_allocations.front();
-	void *ptr = alloc_srcptr(msg->payload_size, held_lock);
-	if(!ptr) break;
-
-	satisfied.push_back(std::make_pair(msg, ptr));
-	pending_allocations.pop();
-      }
-    } else {
-      // no?  then no other span will either, so just add this to the free list
-      //  and return
-      free_list[srcptr_c] = size;
-    }
+  gasnet_hsl_lock(&pending_mutex);
+  while(!pending_allocations.empty()) {
+    OutgoingMessage *msg = pending_allocations.front();
+    void *ptr = try_alloc(blocks_needed(msg->payload_size));
+    if(!ptr) break;
+
+    satisfied.push_back(std::make_pair(msg, ptr));
+    pending_allocations.pop();
+    __sync_fetch_and_sub(&pending_count, 1);
   }
+  gasnet_hsl_unlock(&pending_mutex);
 
   // with the lock released, tell any messages that got srcptr's so they can
   //   do their copies
-  if(!satisfied.empty())
-    for(std::vector<std::pair<OutgoingMessage *, void *> >::iterator it = satisfied.begin();
-	it != satisfied.end();
-	it++) {
-      log_sdp.debug("satisfying pending allocation: %p for %p",
-		    it->second, it->first);
-      it->first->assign_srcdata_pointer(it->second);
-    }
+  for(std::vector<std::pair<OutgoingMessage *, void *> >::iterator it = satisfied.begin();
+      it != satisfied.end();
+      it++) {
+    log_sdp.debug("satisfying pending allocation: %p for %p",
+		  it->second, it->first);
+    it->first->assign_srcdata_pointer(it->second);
+  }
+}
+
+void SrcDataPool::report_status(FILE *f)
+{
+  gasnet_hsl_lock(&pending_mutex);
+  fprintf(f, "SDP: %d: size=%zd rings=%d stalls=%zd (%zd bytes) max_pending=%zd pending=%zd\n",
+	  gasnet_mynode(), total_size, num_rings,
+	  stall_count, stall_bytes, max_pending, pending_allocations.size());
+  gasnet_hsl_unlock(&pending_mutex);
 }
 
 #ifdef TRACK_ACTIVEMSG_SPILL_ALLOCS
@@ -696,19 +736,22 @@ protected:
 static DetailedMessageTiming detailed_message_timing;
 #endif
 
-IncomingMessageManager::IncomingMessageManager(int _nodes, Realm::CoreReservationSet& crs)
-  : nodes(_nodes), shutdown_flag(0)
+IncomingMessageManager::IncomingMessageManager(int _nodes, int _num_queues,
+					       Realm::CoreReservationSet& crs)
+  : nodes(_nodes), num_queues(_num_queues), shutdown_flag(0), next_queue(0)
 {
-  heads = new IncomingMessage *[nodes];
-  tails = new IncomingMessage **[nodes];
-  for(int i = 0; i < nodes; i++) {
-    heads[i] = 0;
-    tails[i] = 0;
+  assert(num_queues > 0);
+  queues = new MessageQueue[num_queues];
+  for(int i = 0; i < num_queues; i++) {
+    queues[i].stack = 0;
+    queues[i].sleeping = 0;
+    queues[i].pending = 0;
+    gasnet_hsl_init(&queues[i].mutex);
+    gasnett_cond_init(&queues[i].condvar);
   }
-  todo_list = new int[nodes + 1];  // an extra entry to distinguish full from empty
-  todo_oldest = todo_newest = 0;
-  gasnet_hsl_init(&mutex);
-  gasnett_cond_init(&condvar);
+  senders = new SenderState[nodes];
+  for(int i = 0; i < nodes; i++)
+    senders[i].state = ((uint64_t)(i % num_queues)) << SenderState::QUEUE_SHIFT;
 
   core_rsrv = new Realm::CoreReservation("AM handlers", crs,
 					 Realm::CoreReservationParameters());
@@ -716,9 +759,19 @@ IncomingMessageManager::IncomingMessageManager(int _nodes, Realm::CoreReservatio
 
 IncomingMessageManager::~IncomingMessageManager(void)
 {
-  delete[] heads;
-  delete[] tails;
-  delete[] todo_list;
+  delete[] queues;
+  delete[] senders;
+}
+
+int IncomingMessageManager::choose_queue(void) const
+{
+  // the counts can be stale by the time we use them, but this is only a
+  //  load-balancing hint
+  int best = 0;
+  for(int i = 1; i < num_queues; i++)
+    if(queues[i].pending < queues[best].pending)
+      best = i;
+  return best;
 }
 
 void IncomingMessageManager::add_incoming_message(int sender, IncomingMessage *msg)
@@ -726,34 +779,51 @@ void IncomingMessageManager::add_incoming_message(int sender, IncomingMessage *m
 #ifdef DEBUG_INCOMING
   printf("adding incoming message from %d\n", sender);
 #endif
-  gasnet_hsl_lock(&mutex);
-  if(heads[sender]) {
-    // tack this on to the existing list
-    assert(tails[sender]);
-    *(tails[sender]) = msg;
-    tails[sender] = &(msg->next_msg);
-  } else {
-    // this starts a list, and the node needs to be added to the todo list
-    heads[sender] = msg;
-    tails[sender] = &(msg->next_msg);
-    todo_list[todo_newest] = sender;
-    todo_newest++;
-    if(todo_newest > nodes)
-      todo_newest = 0;
-    assert(todo_newest != todo_oldest);  // should never wrap around
-    gasnett_cond_broadcast(&condvar);  // wake up any sleepers
+#ifdef REALM_PROFILE_AM_HANDLERS
+  clock_gettime(CLOCK_MONOTONIC, &msg->enqueue_time);
+#endif
+  // a sender with nothing in flight can be moved to whichever queue is the
+  //  least busy - otherwise it has to stay where its earlier messages are
+  SenderState& s = senders[sender];
+  int queue_idx;
+  while(true) {
+    uint64_t old_state = s.state;
+    uint64_t new_state;
+    if((old_state & SenderState::COUNT_MASK) == 0) {
+      queue_idx = choose_queue();
+      new_state = ((((uint64_t)queue_idx) << SenderState::QUEUE_SHIFT) | 1);
+    } else {
+      queue_idx = (int)(old_state >> SenderState::QUEUE_SHIFT);
+      new_state = old_state + 1;
+    }
+    if(__sync_bool_compare_and_swap(&s.state, old_state, new_state))
+      break;
+  }
+  MessageQueue& q = queues[queue_idx];
+  __sync_fetch_and_add(&q.pending, 1);
+  while(true) {
+    IncomingMessage *old_top = q.stack;
+    msg->next_msg = old_top;
+    if(__sync_bool_compare_and_swap(&q.stack, old_top, msg))
+      break;
+  }
+  // the compare-and-swap above is a full barrier, so either we see the
+  //  consumer's sleeping flag here or it sees our message before it waits
+  if(q.sleeping) {
+    gasnet_hsl_lock(&q.mutex);
+    gasnett_cond_broadcast(&q.condvar);
+    gasnet_hsl_unlock(&q.mutex);
   }
-  gasnet_hsl_unlock(&mutex);
 }
 
-void IncomingMessageManager::start_handler_threads(int count, size_t stack_size)
+void IncomingMessageManager::start_handler_threads(size_t stack_size)
 {
-  handler_threads.resize(count);
+  handler_threads.resize(num_queues);
 
   Realm::ThreadLaunchParameters tlp;
   tlp.set_stack_size(stack_size);
 
-  for(int i = 0; i < count; i++)
+  for(int i = 0; i < num_queues; i++)
     handler_threads[i] = Realm::Thread::create_kernel_thread<IncomingMessageManager, 
 							     &IncomingMessageManager::handler_thread_loop>(this,
 													   tlp,
@@ -762,12 +832,13 @@ void IncomingMessageManager::start_handler_threads(int count, size_t stack_size)
 
 void IncomingMessageManager::shutdown(void)
 {
-  gasnet_hsl_lock(&mutex);
-  if(!shutdown_flag) {
-    shutdown_flag = true;
-    gasnett_cond_broadcast(&condvar);  // wake up any sleepers
+  shutdown_flag = 1;
+  __sync_synchronize();
+  for(int i = 0; i < num_queues; i++) {
+    gasnet_hsl_lock(&queues[i].mutex);
+    gasnett_cond_broadcast(&queues[i].condvar);  // wake up any sleepers
+    gasnet_hsl_unlock(&queues[i].mutex);
   }
-  gasnet_hsl_unlock(&mutex);
 
   for(std::vector<Realm::Thread *>::iterator it = handler_threads.begin();
       it != handler_threads.end();
@@ -778,40 +849,35 @@ void IncomingMessageManager::shutdown(void)
   handler_threads.clear();
 }
 
-IncomingMessage *IncomingMessageManager::get_messages(int &sender, bool wait)
+IncomingMessage *IncomingMessageManager::get_messages(int queue_idx, bool wait)
 {
-  gasnet_hsl_lock(&mutex);
-  while(todo_oldest == todo_newest) {
-    // todo list is empty
-    if(shutdown_flag || !wait)
-      break;
+  MessageQueue& q = queues[queue_idx];
+  IncomingMessage *stack = __sync_lock_test_and_set(&q.stack, (IncomingMessage *)0);
+  while(!stack && wait && !shutdown_flag) {
 #ifdef DEBUG_INCOMING
-    printf("incoming message list is empty - sleeping\n");
-#endif
-    gasnett_cond_wait(&condvar, &mutex.lock);
+    printf("incoming message queue %d is empty - sleeping\n", queue_idx);
+#endif
+    gasnet_hsl_lock(&q.mutex);
+    q.sleeping = 1;
+    __sync_synchronize();
+    if(!q.stack && !shutdown_flag)
+      gasnett_cond_wait(&q.condvar, &q.mutex.lock);
+    q.sleeping = 0;
+    gasnet_hsl_unlock(&q.mutex);
+    stack = __sync_lock_test_and_set(&q.stack, (IncomingMessage *)0);
+  }
+  // the stack has the newest message first - reverse it to get arrival order
+  IncomingMessage *retval = 0;
+  while(stack) {
+    IncomingMessage *next = stack->next_msg;
+    stack->next_msg = retval;
+    retval = stack;
+    stack = next;
   }
-  IncomingMessage *retval;
-  if(todo_oldest == todo_newest) {
-    // still empty
-    sender = -1;
-    retval = 0;
-#ifdef DEBUG_INCOMING
-    printf("incoming message list is still empty!\n");
-#endif
-  } else {
-    // pop the oldest entry off the todo list
-    sender = todo_list[todo_oldest];
-    todo_oldest++;
-    if(todo_oldest > nodes)
-      todo_oldest = 0;
-    retval = heads[sender];
-    heads[sender] = 0;
-    tails[sender] = 0;
 #ifdef DEBUG_INCOMING
-    printf("handling incoming messages from %d\n", sender);
+  if(!retval)
+    printf("incoming message queue %d is still empty!\n", queue_idx);
 #endif
-  }
-  gasnet_hsl_unlock(&mutex);
   return retval;
 }    
 
@@ -825,9 +891,12 @@ extern void enqueue_incoming(gasnet_node_t sender, IncomingMessage *msg)
 
 void IncomingMessageManager::handler_thread_loop(void)
 {
+  // each handler thread owns one queue (and therefore whichever senders are
+  //  currently assigned to it)
+  int queue_idx = __sync_fetch_and_add(&next_queue, 1);
+  assert(queue_idx < num_queues);
   while (true) {
-    int sender = -1;
-    IncomingMessage *current_msg = get_messages(sender);
+    IncomingMessage *current_msg = get_messages(queue_idx);
     if(!current_msg) {
 #ifdef DEBUG_INCOMING
       printf("received empty list - assuming shutdown!\n");
@@ -843,7 +912,19 @@ void IncomingMessageManager::handler_thread_loop(void)
       int timing_idx = detailed_message_timing.get_next_index(); // grab this while we still hold the lock
       CurrentTime start_time;
 #endif
+#ifdef REALM_PROFILE_AM_HANDLERS
+      {
+	struct timespec ts_now;
+	clock_gettime(CLOCK_MONOTONIC, &ts_now);
+	queue_stats[current_msg->get_msgid()].record(current_msg->enqueue_time,
+						     ts_now);
+      }
+#endif
+      int sender = current_msg->get_peer();
       current_msg->run_handler();
+      // only once the handler is done can the sender move to another queue
+      __sync_fetch_and_sub(&queues[queue_idx].pending, 1);
+      __sync_fetch_and_sub(&senders[sender].state, 1);
 #ifdef DETAILED_MESSAGE_TIMING
       detailed_message_timing.record(timing_idx, 
 				     current_msg->get_peer(),
@@ -1768,27 +1849,24 @@ void OutgoingMessage::reserve_srcdata(void)
   }
 
   // do we need to place this data in the srcdata pool?
-  // for now, yes, unless we don't have a srcdata pool at all
-  bool need_srcdata = (srcdatapool != 0);
+  // for now, yes, unless we don't have a srcdata pool at all or the payload
+  //  is too large to ever fit in it
+  bool need_srcdata = ((srcdatapool != 0) &&
+		       (payload_size <= srcdatapool->max_alloc_size()));
   
   if(need_srcdata) {
     // try to get the needed space in the srcdata pool
     assert(srcdatapool);
 
-    void *srcptr = 0;
-    {
-      // take the SDP lock
-      SrcDataPool::Lock held_lock(*srcdatapool);
-
-      srcptr = srcdatapool->alloc_srcptr(payload_size, held_lock);
-      log_sdp.info("got %p (%d)", srcptr, payload_mode);
+    void *srcptr = srcdatapool->alloc_srcptr(payload_size);
+    log_sdp.info("got %p (%d)", srcptr, payload_mode);
 
-      if(srcptr != 0) {
-	// allocation succeeded - update state, but do copy below, after
-	//  we've released the lock
-	payload_mode = PAYLOAD_SRCPTR;
-	payload = srcptr;
-      } else {
+    if(srcptr != 0) {
+      // allocation succeeded - update state and do the copy below
+      payload_mode = PAYLOAD_SRCPTR;
+      payload = srcptr;
+    } else {
+      {
 	// if the allocation fails, we have to queue ourselves up
 
 #ifdef TRACK_ACTIVEMSG_SPILL_ALLOCS
@@ -1809,7 +1887,14 @@ void OutgoingMessage::reserve_srcdata(void)
 	}
 
 	payload_mode = PAYLOAD_PENDING;
-	srcdatapool->add_pending(this, held_lock);
+      }
+
+      // the pool makes one more attempt before queueing us - if that works,
+      //  the payload still has to be copied
+      srcptr = srcdatapool->alloc_or_add_pending(this);
+      if(srcptr != 0) {
+	payload_mode = PAYLOAD_SRCPTR;
+	payload = srcptr;
       }
     }
 
@@ -2031,6 +2116,8 @@ public:
 
   void start_polling_threads(int count);
 
+  Realm::CoreReservation *get_core_reservation(void) { return core_rsrv; }
+
   void stop_threads(void);
 
 protected:
@@ -2078,6 +2165,7 @@ void init_endpoints(gasnet_handlerentry_t *handlers, int hcount,
 		    int argc, const char *argv[])
 {
   size_t srcdatapool_size = 64 << 20;
+  int srcdatapool_rings = 4;
 
   for(int i = 1; i < argc; i++) {
     if(!strcmp(argv[i], "-ll:numlmbs")) {
@@ -2100,6 +2188,11 @@ void init_endpoints(gasnet_handlerentry_t *handlers, int hcount,
       continue;
     }
 
+    if(!strcmp(argv[i], "-ll:sdprings")) {
+      srcdatapool_rings = atoi(argv[++i]);
+      continue;
+    }
+
     if(!strcmp(argv[1], "-ll:maxsend")) {
       max_msgs_to_send = atoi(argv[++i]);
       continue;
@@ -2186,7 +2279,8 @@ void init_endpoints(gasnet_handlerentry_t *handlers, int hcount,
 
 #ifndef NO_SRCDATAPOOL
   if(srcdatapool_size > 0)
-    srcdatapool = new SrcDataPool(srcdatapool_base, srcdatapool_size);
+    srcdatapool = new SrcDataPool(srcdatapool_base, srcdatapool_size,
+				  srcdatapool_rings);
 #endif
 
   endpoint_manager = new EndpointManager(gasnet_nodes(), crs);
@@ -2286,9 +2380,15 @@ void start_polling_threads(int count)
 
 void start_handler_threads(int count, Realm::CoreReservationSet& crs, size_t stack_size)
 {
-  incoming_message_manager = new IncomingMessageManager(gasnet_nodes(), crs);
+  incoming_message_manager = new IncomingMessageManager(gasnet_nodes(), count,
+							 crs);
+
+  // the handler threads aren't tied to any one processor (a message can be for
+  //  anybody), but every message they run was just pulled off the network by a
+  //  polling thread, so prefer cores that share a last-level cache with those
+  incoming_message_manager->get_core_reservation()->params.add_share_llc_with(endpoint_manager->get_core_reservation());
 
-  incoming_message_manager->start_handler_threads(count, stack_size);
+  incoming_message_manager->start_handler_threads(stack_size);
 }
 
 void stop_activemsg_threads(void)
@@ -2308,6 +2408,15 @@ void stop_activemsg_threads(void)
            gasnet_mynode(), i,
            handler_stats[i].count, avg, stddev, handler_stats[i].minval, handler_stats[i].maxval);
   }
+  for(int i = 0; i < 256; i++) {
+    if(!queue_stats[i].count) continue;
+    double avg = ((double)queue_stats[i].sum) / ((double)queue_stats[i].count);
+    double stddev = sqrt((((double)queue_stats[i].sum2) / ((double)queue_stats[i].count)) -
+                         avg * avg);
+    printf("AM queueing: node %d, msg %d: count = %10zd, avg = %8.2f, dev = %8.2f, min = %8zd, max = %8zd\n",
+           gasnet_mynode(), i,
+           queue_stats[i].count, avg, stddev, queue_stats[i].minval, queue_stats[i].maxval);
+  }
 #endif
 
 #ifdef DETAILED_MESSAGE_TIMING
@@ -2489,6 +2598,8 @@ extern bool adjust_long_msgsize(gasnet_node_t source, void *&ptr, size_t &buffer
 extern void report_activemsg_status(FILE *f)
 {
   endpoint_manager->report_activemsg_status(f); 
+  if(srcdatapool)
+    srcdatapool->report_status(f);
 }
 
 extern void record_message(gasnet_node_t source, bool sent_reply)
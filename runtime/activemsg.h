@@ -66,6 +66,8 @@
       METADATA_INVALIDATE_ACK_MSGID,
       REGISTER_TASK_MSGID,
       REGISTER_TASK_COMPLETE_MSGID,
+      METADATA_BATCH_REQUEST_MSGID,
+      METADATA_BATCH_RESPONSE_MSGID,
     };
 
 
@@ -272,6 +274,9 @@ struct ActiveMsgHandlerStats {
 };
 
 extern ActiveMsgHandlerStats handler_stats[256];
+// time between a message being queued for a handler thread and its handler
+//  starting, by message ID
+extern ActiveMsgHandlerStats queue_stats[256];
 
 // have to define this two different ways because we can't put ifdefs in the macros below
 template <int MSGID>
@@ -320,6 +325,9 @@ class IncomingMessage {
   virtual size_t get_msgsize(void) = 0;
 
   IncomingMessage *next_msg;
+#ifdef REALM_PROFILE_AM_HANDLERS
+  struct timespec enqueue_time;
+#endif
 };
 
 template <class MSGTYPE, int MSGID,
@@ -1291,6 +1291,13 @@ namespace Legion {
       assert(count != 0);
       assert(registered_with_runtime);
 #endif
+      // Removals are buffered and sent in batches, adds can cancel out
+      // removals that we haven't sent yet
+      if (add ? runtime->elide_remote_reference_add(target, did, 
+                                                    VALID_REF_KIND, count) :
+          runtime->defer_remote_reference_removal(target, did, 
+                                                  VALID_REF_KIND, count))
+        return;
       int signed_count = count;
       RtUserEvent done_event = RtUserEvent::NO_RT_USER_EVENT;
       if (!add)
@@ -1319,6 +1326,13 @@ namespace Legion {
       assert(count != 0);
       assert(registered_with_runtime);
 #endif
+      // Removals are buffered and sent in batches, adds can cancel out
+      // removals that we haven't sent yet
+      if (add ? runtime->elide_remote_reference_add(target, did, 
+                                                    GC_REF_KIND, count) :
+          runtime->defer_remote_reference_removal(target, did, 
+                                                  GC_REF_KIND, count))
+        return;
       int signed_count = count;
       RtUserEvent done_event = RtUserEvent::NO_RT_USER_EVENT;
       if (!add)
@@ -1347,6 +1361,11 @@ namespace Legion {
       assert(count != 0);
       assert(registered_with_runtime);
 #endif
+      if (add ? runtime->elide_remote_reference_add(target, did, 
+                                                    RESOURCE_REF_KIND, count) :
+          runtime->defer_remote_reference_removal(target, did, 
+                                                  RESOURCE_REF_KIND, count))
+        return;
       int signed_count = count;
       if (!add)
         signed_count = -signed_count;
@@ -1520,6 +1539,53 @@ namespace Legion {
         delete target;
     }
 
+    //--------------------------------------------------------------------------
+    /*static*/ void DistributedCollectable::handle_did_remote_batch_update(
+                                         Runtime *runtime, Deserializer &derez)
+    //--------------------------------------------------------------------------
+    {
+      DerezCheck z(derez);
+      size_t num_updates;
+      derez.deserialize(num_updates);
+      // The removals come in the order the sender made them, which
+      // is the order that they have to be applied in for each did
+      for (unsigned idx = 0; idx < num_updates; idx++)
+      {
+        DistributedID did;
+        derez.deserialize(did);
+        ReferenceKind kind;
+        derez.deserialize(kind);
+        unsigned count;
+        derez.deserialize(count);
+        DistributedCollectable *target = 
+          runtime->find_distributed_collectable(did);
+        bool remove = false;
+        switch (kind)
+        {
+          case GC_REF_KIND:
+            {
+              remove = target->remove_base_gc_ref(REMOTE_DID_REF, NULL, count);
+              break;
+            }
+          case VALID_REF_KIND:
+            {
+              remove = 
+                target->remove_base_valid_ref(REMOTE_DID_REF, NULL, count);
+              break;
+            }
+          case RESOURCE_REF_KIND:
+            {
+              remove = target->remove_base_resource_ref(REMOTE_DID_REF, count);
+              break;
+            }
+          default:
+            assert(false);
+        }
+        if (remove)
+          delete target;
+      }
+    }
+
     //--------------------------------------------------------------------------
     /*static*/ void DistributedCollectable::handle_did_add_create(
                                          Runtime *runtime, Deserializer &derez)
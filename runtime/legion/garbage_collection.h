@@ -376,6 +376,8 @@ namespace Legion {
                                               Deserializer &derez);
       static void handle_did_remote_resource_update(Runtime *runtime,
                                                     Deserializer &derez);
+      static void handle_did_remote_batch_update(Runtime *runtime,
+                                                 Deserializer &derez);
     public:
       static void handle_did_add_create(Runtime *runtime, 
                                         Deserializer &derez);
@@ -1728,6 +1728,18 @@ namespace Legion {
         impl->wait_all_results();
     }
 
+    //--------------------------------------------------------------------------
+    const void* FutureMap::get_all_untyped_results(size_t &value_size,
+                                                   size_t &num_points)
+    //--------------------------------------------------------------------------
+    {
+      value_size = 0;
+      num_points = 0;
+      if (impl == NULL)
+        return NULL;
+      return impl->get_all_untyped_results(value_size, num_points);
+    }
+
     /////////////////////////////////////////////////////////////
     // Physical Region 
     /////////////////////////////////////////////////////////////
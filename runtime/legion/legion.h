@@ -1080,6 +1080,31 @@ namespace Legion {
        * tasks to complete before returning.
        */
       void wait_all_results(void); 
+    public:
+      /**
+       * Wait for all the tasks in the index space launch to
+       * complete and then return a pointer to all of their 
+       * return values stored contiguously in the order that
+       * the points of the launch domain are enumerated. This
+       * is only possible if the launch domain is a rectangle
+       * and all the points returned values of the same size,
+       * otherwise NULL is returned. The pointer is valid as
+       * long as the future map is.
+       * @param value_size the size in bytes of each value
+       * @param num_points the number of values
+       * @return a pointer to the values or NULL
+       */
+      const void* get_all_untyped_results(size_t &value_size,
+                                          size_t &num_points);
+      /**
+       * Typed version of get_all_untyped_results that copies
+       * the values into a vector. The type must be a plain
+       * old data type of the same size as the returned values.
+       * @param results vector to hold the values
+       * @return true if the values could be read in bulk
+       */
+      template<typename T>
+        inline bool get_all_results(std::vector<T> &results);
     }; 
 
 
@@ -4606,6 +4631,12 @@ namespace Legion {
        *              all nodes are disabled. Zero will disable all
        *              profiling while each number greater than zero will
        *              profile on that number of nodes.
+       * -hl:prof_logfile <file> Write the profiling records to the given
+       *              file instead of the legion_prof logger, a '%' in the
+       *              name is replaced by the node number.  These files
+       *              end with an index of their chunks so that
+       *              legion_prof.py only has to read the chunks that
+       *              overlap the requested time window.
        *
        * @param argc the number of input arguments
        * @param argv pointer to an array of string arguments of size argc
@@ -1332,6 +1332,23 @@ namespace Legion {
       return get_future(dp);
     }
 
+    //--------------------------------------------------------------------------
+    template<typename T>
+    inline bool FutureMap::get_all_results(std::vector<T> &results)
+    //--------------------------------------------------------------------------
+    {
+      size_t value_size, num_points;
+      const void *values = get_all_untyped_results(value_size, num_points);
+      if ((values == NULL) || (value_size != sizeof(T)))
+      {
+        results.clear();
+        return false;
+      }
+      const T *typed_values = static_cast<const T*>(values);
+      results.assign(typed_values, typed_values + num_points);
+      return true;
+    }
+
     //--------------------------------------------------------------------------
     template<typename PT, unsigned DIM>
     inline void FutureMap::get_void_result(const PT point[DIM])
@@ -100,6 +100,16 @@
 #ifndef DEFAULT_SUPERSCALAR_WIDTH
 #define DEFAULT_SUPERSCALAR_WIDTH       4
 #endif
+// Maximum number of point tasks from the same slice
+// to hand to the mapper in a single map_tasks call
+#ifndef DEFAULT_MAPPING_BATCH_SIZE
+#define DEFAULT_MAPPING_BATCH_SIZE      64
+#endif
+// Maximum number of distinct remote reference removals to
+// buffer for a node before sending them all in one message
+#ifndef DEFAULT_REFERENCE_BATCH_SIZE
+#define DEFAULT_REFERENCE_BATCH_SIZE    256
+#endif
 // The maximum size of active messages sent by the runtime in bytes
 // Note this value was picked based on making a tradeoff between
 // latency and bandwidth numbers on both Cray and Infiniband
@@ -121,6 +131,12 @@
 #ifndef DEFAULT_GC_EPOCH_SIZE
 #define DEFAULT_GC_EPOCH_SIZE           64
 #endif
+// Number of timed records in each chunk of the profiling
+// logs, every chunk is preceded by a header with the time
+// range that it covers so tools can skip over it entirely
+#ifndef DEFAULT_PROF_CHUNK_SIZE
+#define DEFAULT_PROF_CHUNK_SIZE         4096
+#endif
 
 // Used for debugging memory leaks
 // How often tracing information is dumped
@@ -157,6 +173,13 @@
 #define LEGION_SHUTDOWN_RADIX             8
 #endif
 
+// The number of partial accumulators that the futures
+// of an index space task launch with a reduction are
+// folded into before being combined. Must be a power of 2.
+#ifndef LEGION_REDUCTION_STRIPES
+#define LEGION_REDUCTION_STRIPES          8
+#endif
+
 // Some helper macros
 
 // This statically computes an integer log base 2 for a number
@@ -348,6 +371,7 @@ typedef enum legion_error_t {
   ERROR_UNRESTRICTED_ACQUIRE = 156,
   ERROR_UNACQUIRED_RELEASE = 157,
   ERROR_UNATTACHED_DETACH = 158,
+  ERROR_INVALID_PROFILER_FILE = 159,
 }  legion_error_t;
 
 // enum and namepsaces don't really get along well
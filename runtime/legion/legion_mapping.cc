@@ -238,6 +238,17 @@ namespace Legion {
     {
     }
 
+    //--------------------------------------------------------------------------
+    void Mapper::map_tasks(const MapperContext                  ctx,
+                           const std::vector<const Task*>&      tasks,
+                           const std::vector<MapTaskInput>&     inputs,
+                                 std::vector<MapTaskOutput>&    outputs)
+    //--------------------------------------------------------------------------
+    {
+      for (unsigned idx = 0; idx < tasks.size(); idx++)
+        map_task(ctx, *tasks[idx], inputs[idx], outputs[idx]);
+    }
+
     /////////////////////////////////////////////////////////////
     // MapperRuntime
     /////////////////////////////////////////////////////////////
@@ -413,6 +413,36 @@ namespace Legion {
                                   MapTaskOutput&     output) = 0;
       //------------------------------------------------------------------------
 
+      /**
+       * ----------------------------------------------------------------------
+       *  Map Tasks 
+       * ----------------------------------------------------------------------
+       * The batched version of map_task. When mapping the point tasks of
+       * a slice the runtime will hand a group of them to the mapper in a
+       * single call with one input and one output structure per task
+       * (initialized the same way as for map_task). All the tasks come
+       * from the same index space launch and have the same target
+       * processor. The default implementation simply invokes map_task
+       * for each task, mappers can override it to amortize any queries
+       * over the whole batch.
+       *
+       * Note that the valid instances in each input are a snapshot taken
+       * before any task in the batch is mapped: they will not include
+       * instances made or selected for other tasks in the same batch.
+       * To keep this from hiding instances a mapper would want to reuse,
+       * the runtime starts a new batch whenever a task names the same
+       * logical region (with overlapping fields) as an earlier task in
+       * the batch. Instances made for different but overlapping regions
+       * (e.g. the ghost regions of neighboring points) are still only
+       * visible to the tasks of later batches.
+       */
+      //------------------------------------------------------------------------
+      virtual void map_tasks(const MapperContext                  ctx,
+                             const std::vector<const Task*>&      tasks,
+                             const std::vector<MapTaskInput>&     inputs,
+                                   std::vector<MapTaskOutput>&    outputs);
+      //------------------------------------------------------------------------
+
       /**
        * ----------------------------------------------------------------------
        *  Select Task Variant 
@@ -138,6 +138,13 @@ namespace Legion {
       return 0;
     }
 
+    //--------------------------------------------------------------------------
+    bool Operation::find_dependence_trees(std::set<RegionTreeID> &trees) const
+    //--------------------------------------------------------------------------
+    {
+      return false;
+    }
+
     //--------------------------------------------------------------------------
     Mappable* Operation::get_mappable(void)
     //--------------------------------------------------------------------------
@@ -1929,6 +1936,14 @@ namespace Legion {
       return 1;
     }
 
+    //--------------------------------------------------------------------------
+    bool MapOp::find_dependence_trees(std::set<RegionTreeID> &trees) const
+    //--------------------------------------------------------------------------
+    {
+      trees.insert(requirement.parent.get_tree_id());
+      return true;
+    }
+
     //--------------------------------------------------------------------------
     Mappable* MapOp::get_mappable(void)
     //--------------------------------------------------------------------------
@@ -3025,6 +3040,17 @@ namespace Legion {
       return src_requirements.size() + dst_requirements.size();
     }
 
+    //--------------------------------------------------------------------------
+    bool CopyOp::find_dependence_trees(std::set<RegionTreeID> &trees) const
+    //--------------------------------------------------------------------------
+    {
+      for (unsigned idx = 0; idx < src_requirements.size(); idx++)
+        trees.insert(src_requirements[idx].parent.get_tree_id());
+      for (unsigned idx = 0; idx < dst_requirements.size(); idx++)
+        trees.insert(dst_requirements[idx].parent.get_tree_id());
+      return true;
+    }
+
     //--------------------------------------------------------------------------
     Mappable* CopyOp::get_mappable(void)
     //--------------------------------------------------------------------------
@@ -173,6 +173,11 @@ namespace Legion {
       virtual OpKind get_operation_kind(void) const  = 0;
       virtual size_t get_region_count(void) const;
       virtual Mappable* get_mappable(void);
+      // Record the region trees whose logical state this operation's
+      // dependence analysis will touch. Returning false means the 
+      // analysis has to be ordered with respect to all other operations
+      // in the context, which is the safe default.
+      virtual bool find_dependence_trees(std::set<RegionTreeID> &trees) const;
     protected:
       // Base call
       void activate_operation(void);
@@ -622,6 +627,7 @@ namespace Legion {
       virtual OpKind get_operation_kind(void) const;
       virtual size_t get_region_count(void) const;
       virtual Mappable* get_mappable(void);
+      virtual bool find_dependence_trees(std::set<RegionTreeID> &trees) const;
     public:
       virtual void trigger_dependence_analysis(void);
       virtual void trigger_remote_state_analysis(RtUserEvent ready_event);
@@ -693,6 +699,7 @@ namespace Legion {
       virtual OpKind get_operation_kind(void) const;
       virtual size_t get_region_count(void) const;
       virtual Mappable* get_mappable(void);
+      virtual bool find_dependence_trees(std::set<RegionTreeID> &trees) const;
     public:
       virtual void trigger_dependence_analysis(void);
       virtual void trigger_remote_state_analysis(RtUserEvent ready_event);
@@ -19,6 +19,7 @@
 
 #include <cstring>
 #include <cstdlib>
+#include <cstdarg>
 
 namespace Legion {
   namespace Internal {
@@ -145,7 +146,8 @@ namespace Legion {
     void LegionProfInstance::process_task(VariantID variant_id, UniqueID op_id,
                   Realm::ProfilingMeasurements::OperationTimeline *timeline,
                   Realm::ProfilingMeasurements::OperationProcessorUsage *usage,
-                  Realm::ProfilingMeasurements::OperationEventWaits *waits)
+                  Realm::ProfilingMeasurements::OperationEventWaits *waits,
+                  Realm::ProfilingMeasurements::OperationHardwareCounters *hw)
     //--------------------------------------------------------------------------
     {
 #ifdef DEBUG_LEGION
@@ -173,6 +175,17 @@ namespace Legion {
           wait_info.wait_end = waits->intervals[idx].wait_end;
         }
       }
+      // hardware counters are only present if they were requested and
+      // the platform was able to provide them
+      info.has_hw_counters = (hw != NULL);
+      if (hw != NULL)
+      {
+        info.hw_counters.cycles = hw->cycles;
+        info.hw_counters.instructions = hw->instructions;
+        info.hw_counters.llc_references = hw->llc_references;
+        info.hw_counters.llc_misses = hw->llc_misses;
+        info.hw_counters.stalled_cycles = hw->stalled_cycles;
+      }
     }
 
     //--------------------------------------------------------------------------
@@ -331,6 +344,30 @@ namespace Legion {
       info.proc = proc;
     }
 
+    //--------------------------------------------------------------------------
+    void LegionProfInstance::record_eviction(Memory mem, size_t bytes,
+                                             unsigned long long time)
+    //--------------------------------------------------------------------------
+    {
+      eviction_infos.push_back(EvictionInfo());
+      EvictionInfo &info = eviction_infos.back();
+      info.mem = mem;
+      info.bytes = bytes;
+      info.time = time;
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfInstance::record_alloc_failure(Memory mem, size_t bytes,
+                                                  unsigned long long time)
+    //--------------------------------------------------------------------------
+    {
+      alloc_failure_infos.push_back(AllocFailureInfo());
+      AllocFailureInfo &info = alloc_failure_infos.back();
+      info.mem = mem;
+      info.bytes = bytes;
+      info.time = time;
+    }
+
 #ifdef LEGION_PROF_SELF_PROFILE
     //--------------------------------------------------------------------------
     void LegionProfInstance::record_proftask(Processor proc, UniqueID op_id,
@@ -347,6 +384,33 @@ namespace Legion {
     }
 #endif
 
+    //--------------------------------------------------------------------------
+    template<typename T>
+    void LegionProfInstance::dump_chunk_header(const std::deque<T> &infos,
+                                   typename std::deque<T>::const_iterator it,
+                                   unsigned long long T::*first,
+                                   unsigned long long T::*last) const
+    //--------------------------------------------------------------------------
+    {
+      // Only the first record of every chunk gets a header
+      const size_t index = it - infos.begin();
+      if ((index % DEFAULT_PROF_CHUNK_SIZE) != 0)
+        return;
+      unsigned long long chunk_start = (*it).*first;
+      unsigned long long chunk_stop = (*it).*last;
+      for (unsigned idx = 1; (idx < DEFAULT_PROF_CHUNK_SIZE) && 
+            (++it != infos.end()); idx++)
+      {
+        if ((*it).*first < chunk_start)
+          chunk_start = (*it).*first;
+        if ((*it).*last > chunk_stop)
+          chunk_stop = (*it).*last;
+      }
+      owner->open_chunk(chunk_start, chunk_stop);
+      owner->log_record("Prof Chunk Info %u %llu %llu", 
+                        owner->address_space, chunk_start, chunk_stop);
+    }
+
     //--------------------------------------------------------------------------
     void LegionProfInstance::dump_state(void)
     //--------------------------------------------------------------------------
@@ -354,55 +418,76 @@ namespace Legion {
       for (std::deque<TaskKind>::const_iterator it = task_kinds.begin();
             it != task_kinds.end(); it++)
       {
-        log_prof.print("Prof Task Kind %u %s", it->task_id, it->task_name);
+        owner->log_record("Prof Task Kind %u %s", it->task_id, it->task_name);
         free(const_cast<char*>(it->task_name));
       }
       for (std::deque<TaskVariant>::const_iterator it = task_variants.begin();
             it != task_variants.end(); it++)
       {
-        log_prof.print("Prof Task Variant %u %lu %s", it->task_id,
+        owner->log_record("Prof Task Variant %u %lu %s", it->task_id,
 		       it->variant_id, it->variant_name);
         free(const_cast<char*>(it->variant_name));
       }
       for (std::deque<OperationInstance>::const_iterator it = 
             operation_instances.begin(); it != operation_instances.end(); it++)
       {
-        log_prof.print("Prof Operation %llu %u", it->op_id, it->op_kind);
+        owner->log_record("Prof Operation %llu %u", it->op_id, it->op_kind);
       }
       for (std::deque<MultiTask>::const_iterator it = 
             multi_tasks.begin(); it != multi_tasks.end(); it++)
       {
-        log_prof.print("Prof Multi %llu %u", it->op_id, it->task_id);
+        owner->log_record("Prof Multi %llu %u", it->op_id, it->task_id);
       }
       for (std::deque<SliceOwner>::const_iterator it = 
             slice_owners.begin(); it != slice_owners.end(); it++)
       {
-        log_prof.print("Prof Slice Owner %llu %llu", it->parent_id, it->op_id);
+        owner->log_record("Prof Slice Owner %llu %llu", it->parent_id, it->op_id);
+      }
+      for (std::deque<InstCreateInfo>::const_iterator it = inst_create_infos.begin();
+            it != inst_create_infos.end(); it++)
+      {
+        owner->log_record("Prof Inst Create %llu " IDFMT " %llu",
+		       it->op_id, it->inst.id, it->create);
+      }
+      for (std::deque<InstUsageInfo>::const_iterator it = inst_usage_infos.begin();
+            it != inst_usage_infos.end(); it++)
+      {
+        owner->log_record("Prof Inst Usage %llu " IDFMT " " IDFMT " %lu",
+		       it->op_id, it->inst.id, it->mem.id, it->total_bytes);
       }
       for (std::deque<TaskInfo>::const_iterator it = task_infos.begin();
             it != task_infos.end(); it++)
       {
-        log_prof.print("Prof Task Info %llu %lu " IDFMT " %llu %llu %llu %llu",
+        dump_chunk_header(task_infos, it, &TaskInfo::create, &TaskInfo::stop);
+        owner->log_record("Prof Task Info %llu %lu " IDFMT " %llu %llu %llu %llu",
 		       it->op_id, it->variant_id, it->proc.id, 
 		       it->create, it->ready, it->start, it->stop);
         for (std::deque<WaitInfo>::const_iterator wit =
              it->wait_intervals.begin(); wit != it->wait_intervals.end(); wit++)
         {
-          log_prof.print("Prof Task Wait Info %llu %lu %llu %llu %llu",
+          owner->log_record("Prof Task Wait Info %llu %lu %llu %llu %llu",
 			 it->op_id, it->variant_id, wit->wait_start, wit->wait_ready,
 			 wit->wait_end);
         }
+        if (it->has_hw_counters)
+          owner->log_record("Prof Task HW Counters %llu %lu %lld %lld %lld %lld "
+                         "%lld", it->op_id, it->variant_id,
+                         it->hw_counters.cycles, it->hw_counters.instructions,
+                         it->hw_counters.llc_references,
+                         it->hw_counters.llc_misses,
+                         it->hw_counters.stalled_cycles);
       }
       for (std::deque<MetaInfo>::const_iterator it = meta_infos.begin();
             it != meta_infos.end(); it++)
       {
-        log_prof.print("Prof Meta Info %llu %u " IDFMT " %llu %llu %llu %llu",
+        dump_chunk_header(meta_infos, it, &MetaInfo::create, &MetaInfo::stop);
+        owner->log_record("Prof Meta Info %llu %u " IDFMT " %llu %llu %llu %llu",
 		       it->op_id, it->hlr_id, it->proc.id,
 		       it->create, it->ready, it->start, it->stop);
         for (std::deque<WaitInfo>::const_iterator wit =
              it->wait_intervals.begin(); wit != it->wait_intervals.end(); wit++)
         {
-          log_prof.print("Prof Meta Wait Info %llu %u %llu %llu %llu",
+          owner->log_record("Prof Meta Wait Info %llu %u %llu %llu %llu",
 			 it->op_id, it->hlr_id, wit->wait_start, wit->wait_ready,
 			 wit->wait_end);
         }
@@ -410,7 +495,8 @@ namespace Legion {
       for (std::deque<CopyInfo>::const_iterator it = copy_infos.begin();
             it != copy_infos.end(); it++)
       {
-        log_prof.print("Prof Copy Info %llu " IDFMT " " IDFMT " %llu"
+        dump_chunk_header(copy_infos, it, &CopyInfo::create, &CopyInfo::stop);
+        owner->log_record("Prof Copy Info %llu " IDFMT " " IDFMT " %llu"
 		       " %llu %llu %llu %llu", it->op_id, it->source.id,
 		       it->target.id, it->size, it->create, it->ready, it->start,
 		       it->stop);
@@ -418,54 +504,65 @@ namespace Legion {
       for (std::deque<FillInfo>::const_iterator it = fill_infos.begin();
             it != fill_infos.end(); it++)
       {
-        log_prof.print("Prof Fill Info %llu " IDFMT 
+        dump_chunk_header(fill_infos, it, &FillInfo::create, &FillInfo::stop);
+        owner->log_record("Prof Fill Info %llu " IDFMT 
 		       " %llu %llu %llu %llu", it->op_id, it->target.id, 
 		       it->create, it->ready, it->start, it->stop);
       }
-      for (std::deque<InstCreateInfo>::const_iterator it = inst_create_infos.begin();
-            it != inst_create_infos.end(); it++)
-      {
-        log_prof.print("Prof Inst Create %llu " IDFMT " %llu",
-		       it->op_id, it->inst.id, it->create);
-      }
-      for (std::deque<InstUsageInfo>::const_iterator it = inst_usage_infos.begin();
-            it != inst_usage_infos.end(); it++)
-      {
-        log_prof.print("Prof Inst Usage %llu " IDFMT " " IDFMT " %lu",
-		       it->op_id, it->inst.id, it->mem.id, it->total_bytes);
-      }
       for (std::deque<InstTimelineInfo>::const_iterator it = inst_timeline_infos.begin();
             it != inst_timeline_infos.end(); it++)
       {
-        log_prof.print("Prof Inst Timeline %llu " IDFMT " %llu %llu",
+        dump_chunk_header(inst_timeline_infos, it, &InstTimelineInfo::create, &InstTimelineInfo::destroy);
+        owner->log_record("Prof Inst Timeline %llu " IDFMT " %llu %llu",
 		       it->op_id, it->inst.id, it->create, it->destroy);
       }
       for (std::deque<MessageInfo>::const_iterator it = message_infos.begin();
             it != message_infos.end(); it++)
       {
-        log_prof.print("Prof Message Info %u " IDFMT " %llu %llu",
+        dump_chunk_header(message_infos, it, &MessageInfo::start, &MessageInfo::stop);
+        owner->log_record("Prof Message Info %u " IDFMT " %llu %llu",
 		       it->kind, it->proc.id, it->start, it->stop);
       }
       for (std::deque<MapperCallInfo>::const_iterator it = 
             mapper_call_infos.begin(); it != mapper_call_infos.end(); it++)
       {
-        log_prof.print("Prof Mapper Call Info %u " IDFMT " %llu %llu %llu",
+        dump_chunk_header(mapper_call_infos, it, &MapperCallInfo::start, &MapperCallInfo::stop);
+        owner->log_record("Prof Mapper Call Info %u " IDFMT " %llu %llu %llu",
 		       it->kind, it->proc.id, it->op_id, it->start, it->stop);
       }
       for (std::deque<RuntimeCallInfo>::const_iterator it = 
             runtime_call_infos.begin(); it != runtime_call_infos.end(); it++)
       {
-        log_prof.print("Prof Runtime Call Info %u " IDFMT " %llu %llu",
+        dump_chunk_header(runtime_call_infos, it, &RuntimeCallInfo::start, &RuntimeCallInfo::stop);
+        owner->log_record("Prof Runtime Call Info %u " IDFMT " %llu %llu",
 		       it->kind, it->proc.id, it->start, it->stop);
       }
+      for (std::deque<EvictionInfo>::const_iterator it = 
+            eviction_infos.begin(); it != eviction_infos.end(); it++)
+      {
+        dump_chunk_header(eviction_infos, it, &EvictionInfo::time, &EvictionInfo::time);
+        owner->log_record("Prof Eviction Info " IDFMT " %lu %llu",
+		       it->mem.id, it->bytes, it->time);
+      }
+      for (std::deque<AllocFailureInfo>::const_iterator it = 
+            alloc_failure_infos.begin(); it != alloc_failure_infos.end(); it++)
+      {
+        dump_chunk_header(alloc_failure_infos, it, &AllocFailureInfo::time, &AllocFailureInfo::time);
+        owner->log_record("Prof Alloc Failure Info " IDFMT " %lu %llu",
+		       it->mem.id, it->bytes, it->time);
+      }
 #ifdef LEGION_PROF_SELF_PROFILE
       for (std::deque<ProfTaskInfo>::const_iterator it = prof_task_infos.begin();
             it != prof_task_infos.end(); it++)
       {
-        log_prof.print("Prof ProfTask Info " IDFMT " %llu %llu %llu",
+        dump_chunk_header(prof_task_infos, it, &ProfTaskInfo::start, &ProfTaskInfo::stop);
+        owner->log_record("Prof ProfTask Info " IDFMT " %llu %llu %llu",
 		       it->proc.id, it->op_id, it->start, it->stop);
       }
 #endif
+      // Mark the end of the chunked records from this instance
+      owner->close_chunk();
+      owner->log_record("Prof Chunk End %u", owner->address_space);
       task_kinds.clear();
       task_variants.clear();
       operation_instances.clear();
@@ -478,26 +575,52 @@ namespace Legion {
       inst_timeline_infos.clear();
       message_infos.clear();
       mapper_call_infos.clear();
+      eviction_infos.clear();
+      alloc_failure_infos.clear();
     }
 
     //--------------------------------------------------------------------------
-    LegionProfiler::LegionProfiler(Processor target, const Machine &machine,
+    LegionProfiler::LegionProfiler(Processor target, AddressSpaceID local,
+                                   const Machine &machine,
                                    unsigned num_meta_tasks,
                                    const char *const *const task_descriptions,
                                    unsigned num_operation_kinds,
                                    const char *const *const 
                                                   operation_kind_descriptions)
-      : target_proc(target), total_outstanding_requests(0)
+      : target_proc(target), address_space(local), 
+        total_outstanding_requests(0), prof_file(NULL), file_offset(0),
+        span_offset(0), span_is_chunk(false), span_start(0), span_stop(0)
     //--------------------------------------------------------------------------
     {
       profiler_lock = Reservation::create_reservation();
+      if (Runtime::prof_logfile != NULL)
+      {
+        // Replace a '%' in the file name with our node number
+        const char *pct = strchr(Runtime::prof_logfile, '%');
+        char filename[256];
+        if (pct != NULL)
+          snprintf(filename, sizeof(filename), "%.*s%d%s",
+                   int(pct - Runtime::prof_logfile), Runtime::prof_logfile,
+                   address_space, pct + 1);
+        else
+          snprintf(filename, sizeof(filename), "%s", Runtime::prof_logfile);
+        prof_file = fopen(filename, "w");
+        if (prof_file == NULL)
+        {
+          log_prof.error("Unable to open profiling log file %s", filename);
+#ifdef DEBUG_LEGION
+          assert(false);
+#endif
+          exit(ERROR_INVALID_PROFILER_FILE);
+        }
+      }
       for (unsigned idx = 0; idx < num_meta_tasks; idx++)
       {
-        log_prof.print("Prof Meta Desc %u %s", idx, task_descriptions[idx]);
+        log_record("Prof Meta Desc %u %s", idx, task_descriptions[idx]);
       }
       for (unsigned idx = 0; idx < num_operation_kinds; idx++)
       {
-        log_prof.print("Prof Op Desc %u %s", 
+        log_record("Prof Op Desc %u %s", 
 		       idx, operation_kind_descriptions[idx]);
       }
       // Log all the processors and memories
@@ -506,21 +629,21 @@ namespace Legion {
       for (std::set<Processor>::const_iterator it = all_procs.begin();
             it != all_procs.end(); it++)
       {
-        log_prof.print("Prof Proc Desc " IDFMT " %d", it->id, it->kind());
+        log_record("Prof Proc Desc " IDFMT " %d", it->id, it->kind());
       }
       std::set<Memory> all_mems;
       machine.get_all_memories(all_mems);
       for (std::set<Memory>::const_iterator it = all_mems.begin();
             it != all_mems.end(); it++)
       {
-        log_prof.print("Prof Mem Desc " IDFMT " %d %ld", 
+        log_record("Prof Mem Desc " IDFMT " %d %ld", 
 		       it->id, it->kind(), it->capacity());
       }
     }
 
     //--------------------------------------------------------------------------
     LegionProfiler::LegionProfiler(const LegionProfiler &rhs)
-      : target_proc(rhs.target_proc)
+      : target_proc(rhs.target_proc), address_space(rhs.address_space)
     //--------------------------------------------------------------------------
     {
       // should never be called
@@ -537,6 +660,8 @@ namespace Legion {
       for (std::vector<LegionProfInstance*>::const_iterator it = 
             instances.begin(); it != instances.end(); it++)
         delete (*it);
+      if (prof_file != NULL)
+        fclose(prof_file);
     }
 
     //--------------------------------------------------------------------------
@@ -615,6 +740,9 @@ namespace Legion {
                 Realm::ProfilingMeasurements::OperationProcessorUsage>();
       req.add_measurement<
                 Realm::ProfilingMeasurements::OperationEventWaits>();
+      if (Runtime::profile_hardware_counters)
+        req.add_measurement<
+                Realm::ProfilingMeasurements::OperationHardwareCounters>();
     }
 
     //--------------------------------------------------------------------------
@@ -709,6 +837,9 @@ namespace Legion {
                 Realm::ProfilingMeasurements::OperationProcessorUsage>();
       req.add_measurement<
                 Realm::ProfilingMeasurements::OperationEventWaits>();
+      if (Runtime::profile_hardware_counters)
+        req.add_measurement<
+                Realm::ProfilingMeasurements::OperationHardwareCounters>();
     }
 
     //--------------------------------------------------------------------------
@@ -824,10 +955,16 @@ namespace Legion {
             Realm::ProfilingMeasurements::OperationEventWaits *waits = 
               response.get_measurement<
                     Realm::ProfilingMeasurements::OperationEventWaits>();
+            // NULL if counters were not requested or are unavailable
+            Realm::ProfilingMeasurements::OperationHardwareCounters *hw = 
+              response.get_measurement<
+                    Realm::ProfilingMeasurements::OperationHardwareCounters>();
             thread_local_profiling_instance->process_task(info->id, info->op_id,
-                                                timeline, usage, waits);
+                                                timeline, usage, waits, hw);
             delete timeline;
             delete usage;
+            if (hw != NULL)
+              delete hw;
             decrement_total_outstanding_requests();
             break;
           }
@@ -941,6 +1078,90 @@ namespace Legion {
       for (std::vector<LegionProfInstance*>::const_iterator it = 
             instances.begin(); it != instances.end(); it++)
         (*it)->dump_state();
+      if (prof_file != NULL)
+        dump_chunk_index();
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfiler::log_record(const char *fmt, ...)
+    //--------------------------------------------------------------------------
+    {
+      va_list args;
+      va_start(args, fmt);
+      if (prof_file != NULL)
+      {
+        // Use the same prefix as the logger so the records parse the
+        // same way no matter which way they were written
+        int prefix = fprintf(prof_file, "[%d - 0] {2}{legion_prof}: ",
+                             address_space);
+        int record = vfprintf(prof_file, fmt, args);
+        fputc('\n', prof_file);
+#ifdef DEBUG_LEGION
+        assert((prefix >= 0) && (record >= 0));
+#endif
+        file_offset += prefix + record + 1;
+      }
+      else
+        log_prof.print().vprintf(fmt, args);
+      va_end(args);
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfiler::open_chunk(unsigned long long start,
+                                    unsigned long long stop)
+    //--------------------------------------------------------------------------
+    {
+      close_span();
+      span_is_chunk = true;
+      span_start = start;
+      span_stop = stop;
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfiler::close_chunk(void)
+    //--------------------------------------------------------------------------
+    {
+      close_span();
+      span_is_chunk = false;
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfiler::close_span(void)
+    //--------------------------------------------------------------------------
+    {
+      if ((prof_file == NULL) || (file_offset == span_offset))
+        return;
+      chunk_index.push_back(ChunkIndexEntry());
+      ChunkIndexEntry &entry = chunk_index.back();
+      entry.chunk = span_is_chunk;
+      entry.start = span_start;
+      entry.stop = span_stop;
+      entry.offset = span_offset;
+      entry.length = file_offset - span_offset;
+      span_offset = file_offset;
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfiler::dump_chunk_index(void)
+    //--------------------------------------------------------------------------
+    {
+      // Everything after the last chunk still has to be read
+      close_chunk();
+      const unsigned long long index_offset = file_offset;
+      for (std::vector<ChunkIndexEntry>::const_iterator it = 
+            chunk_index.begin(); it != chunk_index.end(); it++)
+      {
+        if (it->chunk)
+          fprintf(prof_file, "Prof Chunk Index %u %llu %llu %llu %llu\n",
+                  address_space, it->start, it->stop, it->offset, it->length);
+        else
+          fprintf(prof_file, "Prof Header Index %u %llu %llu\n",
+                  address_space, it->offset, it->length);
+      }
+      // Fixed width so the reader can find it at the end of the file
+      fprintf(prof_file, "Prof Index Offset %020llu\n", index_offset);
+      fflush(prof_file);
+      chunk_index.clear();
     }
 
     //--------------------------------------------------------------------------
@@ -960,7 +1181,7 @@ namespace Legion {
     {
       for (unsigned idx = 0; idx < num_message_kinds; idx++)
       {
-        log_prof.print("Prof Message Desc %u %s", idx, message_names[idx]);
+        log_record("Prof Message Desc %u %s", idx, message_names[idx]);
       }
     }
 
@@ -984,7 +1205,7 @@ namespace Legion {
     {
       for (unsigned idx = 0; idx < num_mapper_calls; idx++)
       {
-        log_prof.print("Prof Mapper Call Desc %u %s",idx,mapper_call_names[idx]);
+        log_record("Prof Mapper Call Desc %u %s",idx,mapper_call_names[idx]);
       }
     }
 
@@ -1007,7 +1228,7 @@ namespace Legion {
     {
       for (unsigned idx = 0; idx < num_runtime_calls; idx++)
       {
-        log_prof.print("Prof Runtime Call Desc %u %s", 
+        log_record("Prof Runtime Call Desc %u %s", 
 		       idx, runtime_call_names[idx]);
       }
     }
@@ -1024,6 +1245,26 @@ namespace Legion {
                                                            start, stop);
     }
 
+    //--------------------------------------------------------------------------
+    void LegionProfiler::record_eviction(Memory mem, size_t bytes)
+    //--------------------------------------------------------------------------
+    {
+      if (thread_local_profiling_instance == NULL)
+        create_thread_local_profiling_instance();
+      thread_local_profiling_instance->record_eviction(mem, bytes,
+                              Realm::Clock::current_time_in_nanoseconds());
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfiler::record_alloc_failure(Memory mem, size_t bytes)
+    //--------------------------------------------------------------------------
+    {
+      if (thread_local_profiling_instance == NULL)
+        create_thread_local_profiling_instance();
+      thread_local_profiling_instance->record_alloc_failure(mem, bytes,
+                              Realm::Clock::current_time_in_nanoseconds());
+    }
+
     //--------------------------------------------------------------------------
     void LegionProfiler::create_thread_local_profiling_instance(void)
     //--------------------------------------------------------------------------
@@ -23,6 +23,7 @@
 #include "realm/profiling.h"
 
 #include <cassert>
+#include <cstdio>
 #include <deque>
 #include <algorithm>
 
@@ -81,6 +82,12 @@ namespace Legion {
       public:
         unsigned long long wait_start, wait_ready, wait_end;
       };
+      struct HWCounterInfo {
+      public:
+        long long cycles, instructions;
+        long long llc_references, llc_misses;
+        long long stalled_cycles;
+      };
       struct TaskInfo {
       public:
         UniqueID op_id;
@@ -88,6 +95,8 @@ namespace Legion {
         Processor proc;
         unsigned long long create, ready, start, stop;
         std::deque<WaitInfo> wait_intervals;
+        bool has_hw_counters;
+        HWCounterInfo hw_counters;
       };
       struct MetaInfo {
       public:
@@ -148,6 +157,18 @@ namespace Legion {
         unsigned long long start, stop;
         Processor proc;
       };
+      struct EvictionInfo {
+      public:
+        Memory mem;
+        size_t bytes;
+        unsigned long long time;
+      };
+      struct AllocFailureInfo {
+      public:
+        Memory mem;
+        size_t bytes;
+        unsigned long long time;
+      };
 #ifdef LEGION_PROF_SELF_PROFILE
       struct ProfTaskInfo {
       public:
@@ -174,7 +195,8 @@ namespace Legion {
       void process_task(size_t id, UniqueID op_id, 
                   Realm::ProfilingMeasurements::OperationTimeline *timeline,
                   Realm::ProfilingMeasurements::OperationProcessorUsage *usage,
-                  Realm::ProfilingMeasurements::OperationEventWaits *waits);
+                  Realm::ProfilingMeasurements::OperationEventWaits *waits,
+                  Realm::ProfilingMeasurements::OperationHardwareCounters *hw);
       void process_meta(size_t id, UniqueID op_id,
                   Realm::ProfilingMeasurements::OperationTimeline *timeline,
                   Realm::ProfilingMeasurements::OperationProcessorUsage *usage,
@@ -200,6 +222,9 @@ namespace Legion {
                           unsigned long long stop);
       void record_runtime_call(Processor proc, RuntimeCallKind kind,
                           unsigned long long start, unsigned long long stop);
+      void record_eviction(Memory mem, size_t bytes, unsigned long long time);
+      void record_alloc_failure(Memory mem, size_t bytes, 
+                                unsigned long long time);
 #ifdef LEGION_PROF_SELF_PROFILE
     public:
       void record_proftask(Processor p, UniqueID op_id,
@@ -208,6 +233,12 @@ namespace Legion {
 #endif
     public:
       void dump_state(void);
+    private:
+      template<typename T>
+      void dump_chunk_header(const std::deque<T> &infos,
+                             typename std::deque<T>::const_iterator it,
+                             unsigned long long T::*first,
+                             unsigned long long T::*last) const;
     private:
       LegionProfiler *const owner;
       std::deque<TaskKind>          task_kinds;
@@ -227,6 +258,8 @@ namespace Legion {
       std::deque<MessageInfo> message_infos;
       std::deque<MapperCallInfo> mapper_call_infos;
       std::deque<RuntimeCallInfo> runtime_call_infos;
+      std::deque<EvictionInfo> eviction_infos;
+      std::deque<AllocFailureInfo> alloc_failure_infos;
 #ifdef LEGION_PROF_SELF_PROFILE
     private:
       std::deque<ProfTaskInfo> prof_task_infos;
@@ -251,11 +284,19 @@ namespace Legion {
         size_t id;
         UniqueID op_id;
       };
+      // A contiguous range of bytes in the profiling log file, either a
+      // chunk of timed records or the untimed records between chunks
+      struct ChunkIndexEntry {
+      public:
+        bool chunk;
+        unsigned long long start, stop;
+        unsigned long long offset, length;
+      };
     public:
       // Statically known information passed through the constructor
       // so that it can be deduplicated
-      LegionProfiler(Processor target_proc, const Machine &machine,
-                     unsigned num_meta_tasks,
+      LegionProfiler(Processor target_proc, AddressSpaceID address_space,
+                     const Machine &machine, unsigned num_meta_tasks,
                      const char *const *const meta_task_descriptions,
                      unsigned num_operation_kinds,
                      const char *const *const operation_kind_descriptions);
@@ -321,8 +362,23 @@ namespace Legion {
                                      unsigned int num_runtime_call_kinds);
       void record_runtime_call(RuntimeCallKind kind,
                            unsigned long long start, unsigned long long stop);
+    public:
+      // Memory pressure in the memory managers
+      void record_eviction(Memory mem, size_t bytes);
+      void record_alloc_failure(Memory mem, size_t bytes);
+    public:
+      // All profiling records are written through here so that we
+      // can track their offsets when writing to our own log file
+      void log_record(const char *fmt, ...)
+        __attribute__((format (printf, 2, 3)));
+      void open_chunk(unsigned long long start, unsigned long long stop);
+      void close_chunk(void);
+    private:
+      void close_span(void);
+      void dump_chunk_index(void);
     public:
       const Processor target_proc;
+      const AddressSpaceID address_space;
       inline bool has_outstanding_requests(void)
         { return total_outstanding_requests != 0; }
     private:
@@ -336,6 +392,14 @@ namespace Legion {
       Reservation profiler_lock;
       std::vector<LegionProfInstance*> instances;
       unsigned total_outstanding_requests;
+    private:
+      // Only used with -hl:prof_logfile
+      FILE *prof_file;
+      unsigned long long file_offset;
+      unsigned long long span_offset;
+      bool span_is_chunk;
+      unsigned long long span_start, span_stop;
+      std::vector<ChunkIndexEntry> chunk_index;
     };
 
     class DetailedProfiler {
@@ -540,6 +540,15 @@ namespace Legion {
       return regions.size();
     }
 
+    //--------------------------------------------------------------------------
+    bool TaskOp::find_dependence_trees(std::set<RegionTreeID> &trees) const
+    //--------------------------------------------------------------------------
+    {
+      for (unsigned idx = 0; idx < regions.size(); idx++)
+        trees.insert(regions[idx].parent.get_tree_id());
+      return true;
+    }
+
     //--------------------------------------------------------------------------
     Mappable* TaskOp::get_mappable(void)
     //--------------------------------------------------------------------------
@@ -2646,6 +2655,7 @@ namespace Legion {
       pending_done = RtEvent::NO_RT_EVENT;
       last_registration = RtEvent::NO_RT_EVENT;
       dependence_precondition = RtEvent::NO_RT_EVENT;
+      treeless_dependence_precondition = RtEvent::NO_RT_EVENT;
       profiling_done = RtEvent::NO_RT_EVENT;
       current_trace = NULL;
       task_executed = false;
@@ -2695,6 +2705,7 @@ namespace Legion {
       executing_children.clear();
       executed_children.clear();
       complete_children.clear();
+      tree_dependence_preconditions.clear();
       safe_cast_domains.clear();
       coherence_restrictions.clear();
       frame_events.clear();
@@ -3216,7 +3227,11 @@ namespace Legion {
           wait_done.wait();
         }
         else // we can do the wait inline
-          perform_window_wait();
+        {
+          RtEvent wait_on = perform_window_wait();
+          if (!wait_on.has_triggered())
+            wait_on.wait();
+        }
       }
       if (Runtime::legion_spy_enabled)
         LegionSpy::log_child_operation_index(unique_op_id, result, 
@@ -3228,8 +3243,10 @@ namespace Legion {
     unsigned SingleTask::register_new_close_operation(CloseOp *op)
     //--------------------------------------------------------------------------
     {
-      // For now we just bump our counter
-      unsigned result = total_close_count++;
+      // For now we just bump our counter, atomically since close 
+      // operations for different region trees can be created
+      // concurrently when doing concurrent dependence analysis
+      unsigned result = __sync_fetch_and_add(&total_close_count, 1);
       if (Runtime::legion_spy_enabled)
         LegionSpy::log_close_operation_index(unique_op_id, result, 
                                              op->get_unique_op_id());
@@ -3237,7 +3254,7 @@ namespace Legion {
     }
 
     //--------------------------------------------------------------------------
-    void SingleTask::perform_window_wait(void)
+    RtEvent SingleTask::perform_window_wait(void)
     //--------------------------------------------------------------------------
     {
       RtEvent wait_event;
@@ -3253,8 +3270,8 @@ namespace Legion {
       }
       // Release our lock now
       op_lock.release();
-      if (wait_event.exists() && !wait_event.has_triggered())
-        wait_event.wait();
+      // The caller does the waiting
+      return wait_event;
     }
 
     //--------------------------------------------------------------------------
@@ -3293,26 +3310,76 @@ namespace Legion {
       DeferredDependenceArgs args;
       args.hlr_id = HLR_TRIGGER_DEPENDENCE_ID;
       args.op = op;
+      // Normally the analysis for each operation waits for the one before
+      // it, but with concurrent analysis enabled, operations that can tell
+      // us which region trees they touch only have to wait for the last
+      // analysis on each of those trees (and the last ordered analysis).
+      // Traced operations have to register with the trace in program 
+      // order so they are always ordered with respect to everything.
+      std::set<RegionTreeID> trees;
+      const bool concurrent = Runtime::concurrent_dependence_analysis &&
+                              (op->get_trace() == NULL) &&
+                              op->find_dependence_trees(trees);
+      RtEvent precondition = dependence_precondition;
+      if (concurrent)
+      {
+        if (!trees.empty())
+        {
+          std::set<RtEvent> preconditions;
+          if (dependence_precondition.exists())
+            preconditions.insert(dependence_precondition);
+          for (std::set<RegionTreeID>::const_iterator it = trees.begin();
+                it != trees.end(); it++)
+          {
+            std::map<RegionTreeID,RtEvent>::const_iterator finder = 
+              tree_dependence_preconditions.find(*it);
+            if (finder != tree_dependence_preconditions.end())
+              preconditions.insert(finder->second);
+          }
+          if (!preconditions.empty())
+            precondition = Runtime::merge_events(preconditions);
+        }
+      }
+      else if (!tree_dependence_preconditions.empty() ||
+               treeless_dependence_precondition.exists())
+      {
+        std::set<RtEvent> preconditions;
+        if (dependence_precondition.exists())
+          preconditions.insert(dependence_precondition);
+        if (treeless_dependence_precondition.exists())
+          preconditions.insert(treeless_dependence_precondition);
+        for (std::map<RegionTreeID,RtEvent>::const_iterator it = 
+              tree_dependence_preconditions.begin(); it !=
+              tree_dependence_preconditions.end(); it++)
+          preconditions.insert(it->second);
+        precondition = Runtime::merge_events(preconditions);
+        tree_dependence_preconditions.clear();
+        treeless_dependence_precondition = RtEvent::NO_RT_EVENT;
+      }
       // If we're ahead we give extra priority to the logical analysis
       // since it is on the critical path, but if not we give it the 
       // normal priority so that we can balance doing logical analysis
       // and actually mapping and running tasks
-      if (currently_active_context)
-      {
-        RtEvent next = runtime->issue_runtime_meta_task(&args, sizeof(args),
-                                        HLR_TRIGGER_DEPENDENCE_ID, 
-                                        HLR_THROUGHPUT_PRIORITY, op,
-                                        dependence_precondition);
-        dependence_precondition = next;
+      RtEvent next = runtime->issue_runtime_meta_task(&args, sizeof(args),
+                                      HLR_TRIGGER_DEPENDENCE_ID, 
+                                      currently_active_context ? 
+                                        HLR_THROUGHPUT_PRIORITY :
+                                        HLR_LATENCY_PRIORITY, op,
+                                      precondition);
+      if (concurrent)
+      {
+        for (std::set<RegionTreeID>::const_iterator it = trees.begin();
+              it != trees.end(); it++)
+          tree_dependence_preconditions[*it] = next;
+        // Operations without regions don't order anything on a tree
+        // but the next ordered operation (e.g. a fence) still has to
+        // wait for them so they see the fences in program order
+        if (trees.empty())
+          treeless_dependence_precondition = 
+            Runtime::merge_events(treeless_dependence_precondition, next);
       }
       else
-      {
-        RtEvent next = runtime->issue_runtime_meta_task(&args, sizeof(args),
-                                        HLR_TRIGGER_DEPENDENCE_ID, 
-                                        HLR_LATENCY_PRIORITY, op,
-                                        dependence_precondition);
         dependence_precondition = next;
-      }
       // Now we can release the lock
       op_lock.release();
     }
@@ -3493,6 +3560,9 @@ namespace Legion {
     void SingleTask::register_fence_dependence(Operation *op)
     //--------------------------------------------------------------------------
     {
+      // Operations on different region trees can be doing this
+      // concurrently so we need the lock to look at the fence
+      AutoLock o_lock(op_lock);
       if (current_fence != NULL)
       {
 #ifdef LEGION_SPY
@@ -3553,14 +3623,21 @@ namespace Legion {
     void SingleTask::update_current_fence(FenceOp *op)
     //--------------------------------------------------------------------------
     {
-      if (current_fence != NULL)
-        current_fence->remove_mapping_reference(fence_gen);
-      current_fence = op;
-      fence_gen = op->get_generation();
-      current_fence->add_mapping_reference(fence_gen);
+      FenceOp *old_fence;
+      GenerationID old_gen;
+      {
+        AutoLock o_lock(op_lock);
+        old_fence = current_fence;
+        old_gen = fence_gen;
+        current_fence = op;
+        fence_gen = op->get_generation();
+        current_fence->add_mapping_reference(fence_gen);
 #ifdef LEGION_SPY
-      current_fence_uid = op->get_unique_op_id();
+        current_fence_uid = op->get_unique_op_id();
 #endif
+      }
+      if (old_fence != NULL)
+        old_fence->remove_mapping_reference(old_gen);
     }
 
     //--------------------------------------------------------------------------
@@ -3652,8 +3729,8 @@ namespace Legion {
     }
 
     //--------------------------------------------------------------------------
-    void SingleTask::perform_frame_issue(FrameOp *frame,
-                                         ApEvent frame_termination)
+    RtEvent SingleTask::perform_frame_issue(FrameOp *frame,
+                                            ApEvent frame_termination)
     //--------------------------------------------------------------------------
     {
       ApEvent wait_on, previous;
@@ -3669,8 +3746,10 @@ namespace Legion {
         frame_events.push_back(frame_termination); 
       }
       frame->set_previous(previous);
-      if (!wait_on.has_triggered())
-        wait_on.wait();
+      // The caller does the waiting
+      if (wait_on.has_triggered())
+        return RtEvent::NO_RT_EVENT;
+      return Runtime::protect_event(wait_on);
     }
 
     //--------------------------------------------------------------------------
@@ -5448,7 +5527,8 @@ namespace Legion {
                                                Mapper::MapTaskOutput &output,
                                                MustEpochOp *must_epoch_owner,
                                 const std::vector<RegionTreeContext> &enclosing,
-                                      std::vector<InstanceSet> &valid)
+                                      std::vector<InstanceSet> &valid,
+                                const std::set<Memory> *visible /*= NULL*/)
     //--------------------------------------------------------------------------
     {
       DETAILED_PROFILER(runtime, INITIALIZE_MAP_TASK_CALL);
@@ -5464,8 +5544,14 @@ namespace Legion {
       // constrained mappings which must be heeded
       if (must_epoch_owner != NULL)
         must_epoch_owner->must_epoch_map_task_callback(this, input, output);
-      std::set<Memory> visible_memories;
-      runtime->machine.get_visible_memories(target_proc, visible_memories);
+      // Batched callers have already found the visible memories
+      std::set<Memory> local_visible;
+      if (visible == NULL)
+      {
+        runtime->machine.get_visible_memories(target_proc, local_visible);
+        visible = &local_visible;
+      }
+      const std::set<Memory> &visible_memories = *visible;
       for (unsigned idx = 0; idx < regions.size(); idx++)
       {
         // Skip any early mapped regions
@@ -6170,6 +6256,20 @@ namespace Legion {
     //--------------------------------------------------------------------------
     {
       DETAILED_PROFILER(runtime, MAP_ALL_REGIONS_CALL);
+      std::vector<RegionTreeContext> enclosing_contexts(regions.size());
+      for (unsigned idx = 0; idx < regions.size(); idx++)
+        enclosing_contexts[idx] = get_parent_context(idx);
+      // Now do the mapping call
+      invoke_mapper(must_epoch_op, enclosing_contexts);
+      return register_mapped_regions(local_termination_event, 
+                                     enclosing_contexts);
+    }
+
+    //--------------------------------------------------------------------------
+    bool SingleTask::register_mapped_regions(ApEvent local_termination_event,
+                       const std::vector<RegionTreeContext> &enclosing_contexts)
+    //--------------------------------------------------------------------------
+    {
 #ifdef LEGION_SPY
       {
         ApEvent local_completion = get_completion_event();
@@ -6180,11 +6280,6 @@ namespace Legion {
                                           local_termination_event);
       }
 #endif
-      std::vector<RegionTreeContext> enclosing_contexts(regions.size());
-      for (unsigned idx = 0; idx < regions.size(); idx++)
-        enclosing_contexts[idx] = get_parent_context(idx);
-      // Now do the mapping call
-      invoke_mapper(must_epoch_op, enclosing_contexts);
       // After we've got our results, apply the state to the region tree
       for (unsigned idx = 0; idx < regions.size(); idx++)
       {
@@ -7513,6 +7608,8 @@ namespace Legion {
       serdez_redop_fns = NULL;
       reduction_state_size = 0;
       reduction_state = NULL;
+      reduction_stripe_stride = 0;
+      reduction_stripes = NULL;
     }
 
     //--------------------------------------------------------------------------
@@ -7529,6 +7626,13 @@ namespace Legion {
         reduction_state = NULL;
         reduction_state_size = 0;
       }
+      if (reduction_stripes != NULL)
+      {
+        legion_free(REDUCTION_ALLOC, reduction_stripes, 
+                    LEGION_REDUCTION_STRIPES * reduction_stripe_stride);
+        reduction_stripes = NULL;
+        reduction_stripe_stride = 0;
+      }
       for (std::map<DomainPoint,MinimalPoint*>::const_iterator it = 
             minimal_points.begin(); it != minimal_points.end(); it++)
       {
@@ -7955,7 +8059,19 @@ namespace Legion {
         (*(serdez_redop_fns->init_fn))(reduction_op, reduction_state, 
                                        reduction_state_size);
       else
+      {
         reduction_op->init(reduction_state, 1);
+        // Give each stripe its own cache line(s) so that folds
+        // coming from different processors do not contend
+        const size_t line = 64;
+        reduction_stripe_stride = 
+          ((reduction_state_size + line - 1) / line) * line;
+        reduction_stripes = legion_malloc(REDUCTION_ALLOC,
+                          LEGION_REDUCTION_STRIPES * reduction_stripe_stride);
+        for (unsigned idx = 0; idx < LEGION_REDUCTION_STRIPES; idx++)
+          reduction_op->init((char*)reduction_stripes + 
+                             idx * reduction_stripe_stride, 1);
+      }
     }
 
     //--------------------------------------------------------------------------
@@ -7979,14 +8095,51 @@ namespace Legion {
         (*(serdez_redop_fns->fold_fn))(reduction_op, reduction_state,
                                        reduction_state_size, result);
       }
+      else if (exclusive)
+        reduction_op->fold(reduction_state, result, 1, true/*exclusive*/);
       else
-        reduction_op->fold(reduction_state, result, 1, exclusive);
+      {
+        // Fold into the stripe for the processor we are running on,
+        // these are still atomic folds but will rarely contend.
+        // Threads that are not running on a processor use stripe 0.
+        const unsigned stripe = 
+          Processor::get_executing_processor().id & 
+            (LEGION_REDUCTION_STRIPES - 1);
+        reduction_op->fold((char*)reduction_stripes + 
+                           stripe * reduction_stripe_stride, result, 
+                           1, false/*exclusive*/);
+      }
 
       // If we're the owner, then free the memory
       if (owner)
         free(const_cast<void*>(result));
     } 
 
+    //--------------------------------------------------------------------------
+    void MultiTask::combine_reduction_stripes(void)
+    //--------------------------------------------------------------------------
+    {
+      // Serdez reductions fold straight into the reduction state
+      if (reduction_stripes == NULL)
+        return;
+#ifdef DEBUG_LEGION
+      assert(reduction_op != NULL);
+      assert(reduction_state != NULL);
+#endif
+      // Pairwise tree combine of the stripes using batch folds, the
+      // result ends up in the first stripe. All folds must have been
+      // applied by the time this is called so these can be exclusive.
+      char *stripes = (char*)reduction_stripes;
+      const off_t stride = reduction_stripe_stride;
+      for (unsigned half = LEGION_REDUCTION_STRIPES/2; half > 0; half >>= 1)
+        reduction_op->fold_strided(stripes, stripes + half * stride,
+                                   stride, stride, half, true/*exclusive*/);
+      reduction_op->fold(reduction_state, stripes, 1, true/*exclusive*/);
+      // Reset the stripes in case anything else gets folded in
+      for (unsigned idx = 0; idx < LEGION_REDUCTION_STRIPES; idx++)
+        reduction_op->init(stripes + idx * stride, 1);
+    }
+
     //--------------------------------------------------------------------------
     VersionInfo& MultiTask::get_version_info(unsigned idx)
     //--------------------------------------------------------------------------
@@ -9469,6 +9622,48 @@ namespace Legion {
       // the completion event is therefore not guaranteed to survive
       // the length of the task's execution
       bool map_success = map_all_regions(point_termination, must_epoch_owner);
+      complete_point_mapping(map_success);
+      return map_success;
+    }
+
+    //--------------------------------------------------------------------------
+    void PointTask::prepare_batched_mapping(Mapper::MapTaskInput &input,
+                                            Mapper::MapTaskOutput &output,
+                          std::vector<RegionTreeContext> &enclosing_contexts,
+                                     std::vector<InstanceSet> &valid_instances,
+                                     const std::set<Memory> &visible_memories)
+    //--------------------------------------------------------------------------
+    {
+      enclosing_contexts.resize(regions.size());
+      for (unsigned idx = 0; idx < regions.size(); idx++)
+        enclosing_contexts[idx] = get_parent_context(idx);
+      initialize_map_task_input(input, output, NULL/*must epoch*/,
+                                enclosing_contexts, valid_instances,
+                                &visible_memories);
+      // Finalizing the output needs our mapper
+      if (mapper == NULL)
+        mapper = runtime->find_mapper(current_proc, map_id);
+    }
+
+    //--------------------------------------------------------------------------
+    bool PointTask::finish_batched_mapping(Mapper::MapTaskInput &input,
+                                           Mapper::MapTaskOutput &output,
+                    const std::vector<RegionTreeContext> &enclosing_contexts,
+                                     std::vector<InstanceSet> &valid_instances)
+    //--------------------------------------------------------------------------
+    {
+      finalize_map_task_output(input, output, NULL/*must epoch*/,
+                               enclosing_contexts, valid_instances);
+      bool map_success = register_mapped_regions(point_termination, 
+                                                 enclosing_contexts);
+      complete_point_mapping(map_success);
+      return map_success;
+    }
+
+    //--------------------------------------------------------------------------
+    void PointTask::complete_point_mapping(bool map_success)
+    //--------------------------------------------------------------------------
+    {
       // If we succeeded in mapping and had no virtual mappings
       // then we are done mapping
       if (map_success && is_leaf()) 
@@ -9487,7 +9682,6 @@ namespace Legion {
           complete_mapping();
         }
       }
-      return map_success;
     }
 
     //--------------------------------------------------------------------------
@@ -10680,6 +10874,7 @@ namespace Legion {
       initialize_paths();
       annotate_early_mapped_regions();
       future_map = FutureMap(legion_new<FutureMapImpl>(ctx, this, runtime));
+      future_map.impl->initialize_dense_storage(index_domain);
 #ifdef DEBUG_LEGION
       future_map.impl->add_valid_domain(index_domain);
 #endif
@@ -10809,6 +11004,7 @@ namespace Legion {
       initialize_paths();
       annotate_early_mapped_regions();
       future_map = FutureMap(legion_new<FutureMapImpl>(ctx, this, runtime));
+      future_map.impl->initialize_dense_storage(index_domain);
 #ifdef DEBUG_LEGION
       future_map.impl->add_valid_domain(index_domain);
 #endif
@@ -11245,11 +11441,11 @@ namespace Legion {
               check_future_size(predicate_false_future.impl);
             const void *result = 
               predicate_false_future.impl->get_untyped_result();
-            for (Domain::DomainPointIterator itr(index_domain); itr; itr++)
+            if (result_size > 0)
             {
-              Future f = future_map.get_future(itr.p);
-              if (result_size > 0)
-                f.impl->set_result(result, result_size, false/*own*/);
+              for (Domain::DomainPointIterator itr(index_domain); itr; itr++)
+                future_map.impl->set_point_result(itr.p, result, 
+                                                  result_size, false/*own*/);
             }
           }
           else
@@ -11273,12 +11469,11 @@ namespace Legion {
         }
         else
         {
-          for (Domain::DomainPointIterator itr(index_domain); itr; itr++)
+          if (predicate_false_size > 0)
           {
-            Future f = future_map.get_future(itr.p);
-            if (predicate_false_size > 0)
-              f.impl->set_result(predicate_false_result,
-                                 predicate_false_size, false/*own*/);
+            for (Domain::DomainPointIterator itr(index_domain); itr; itr++)
+              future_map.impl->set_point_result(itr.p, predicate_false_result,
+                                          predicate_false_size, false/*own*/);
           }
         }
       }
@@ -11490,6 +11685,7 @@ namespace Legion {
       // and then trigger it
       if (redop != 0)
       {
+        combine_reduction_stripes();
         if (speculation_state != RESOLVE_FALSE_STATE)
           reduction_future.impl->set_result(reduction_state,
                                             reduction_state_size, 
@@ -11632,10 +11828,7 @@ namespace Legion {
     //--------------------------------------------------------------------------
     {
       if (redop == 0)
-      {
-        Future f = future_map.impl->get_future(index_point);
-        f.impl->set_result(res, res_size, owned);
-      }
+        future_map.impl->set_point_result(index_point, res, res_size, owned);
       else
         fold_reduction_future(res, res_size, owned, true/*exclusive*/);
     }
@@ -11691,10 +11884,7 @@ namespace Legion {
       else
       {
         if (must_epoch == NULL)
-        {
-          Future f = future_map.get_future(point);
-          f.impl->set_result(result, result_size, owner);
-        }
+          future_map.impl->set_point_result(point, result, result_size, owner);
         else
           must_epoch->set_future(point, result, result_size, owner);
       }
@@ -12013,17 +12203,48 @@ namespace Legion {
       }
       else
       {
-        for (unsigned idx = 0; idx < points; idx++)
+        bool dense;
+        derez.deserialize(dense);
+        if (dense)
         {
-          DomainPoint p;
-          unpack_point(derez, p);
+          // All the values for the slice in one block
+          Domain slice_domain;
+          derez.deserialize(slice_domain);
+          size_t value_size;
+          derez.deserialize(value_size);
+          const void *values = derez.get_current_pointer();
           if (must_epoch == NULL)
+            future_map.impl->set_dense_results(slice_domain, 
+                                               values, value_size);
+          else
           {
-            Future f = future_map.impl->get_future(p);
-            f.impl->unpack_future(derez);
+            const char *ptr = (const char*)values;
+            for (Domain::DomainPointIterator itr(slice_domain); itr; itr++)
+            {
+              must_epoch->set_future(itr.p, ptr, value_size, false/*owner*/);
+              ptr += value_size;
+            }
+          }
+          derez.advance_pointer(value_size * points);
+        }
+        else
+        {
+          for (unsigned idx = 0; idx < points; idx++)
+          {
+            DomainPoint p;
+            unpack_point(derez, p);
+            if (must_epoch == NULL)
+            {
+              DerezCheck z2(derez);
+              size_t result_size;
+              derez.deserialize(result_size);
+              future_map.impl->set_point_result(p, 
+                  derez.get_current_pointer(), result_size, false/*owner*/);
+              derez.advance_pointer(result_size);
+            }
+            else
+              must_epoch->unpack_future(p, derez);
           }
-          else
-            must_epoch->unpack_future(p, derez);
         }
       }
       return_slice_complete(points);
@@ -12299,15 +12520,32 @@ namespace Legion {
         // not then do so now
         if (points.empty())
           enumerate_points();
-        for (unsigned idx = 0; idx < points.size(); idx++)
+        // Must epoch mappings are done one point at a time
+        if ((epoch_owner == NULL) && (Runtime::mapping_batch_size > 1))
+        {
+          const std::vector<PointTask*> local_points(points.begin(),
+                                                     points.end());
+          for (unsigned idx = 0; idx < local_points.size(); )
+          {
+            const unsigned end = find_batch_end(local_points, idx);
+            std::vector<PointTask*> batch(local_points.begin() + idx,
+                                          local_points.begin() + end);
+            map_point_batch(batch);
+            idx = end;
+          }
+        }
+        else
         {
+          for (unsigned idx = 0; idx < points.size(); idx++)
+          {
 #ifdef DEBUG_LEGION
-          bool point_success = 
+            bool point_success = 
 #endif
-            points[idx]->perform_mapping(epoch_owner);
+              points[idx]->perform_mapping(epoch_owner);
 #ifdef DEBUG_LEGION
-          assert(point_success);
+            assert(point_success);
 #endif
+          }
         }
         // If we succeeded in mapping we are no longer stealable
         stealable = false;
@@ -12400,6 +12638,30 @@ namespace Legion {
       std::vector<PointTask*> local_points(points.size()-mapping_index);
       for (unsigned idx = mapping_index; idx < points.size(); idx++)
         local_points[idx-mapping_index] = points[idx];
+      if (Runtime::mapping_batch_size > 1)
+      {
+        // Map the points in batches and launch each batch
+        // before we start mapping the next one
+        for (unsigned idx = 0; idx < local_points.size(); )
+        {
+          const unsigned end = find_batch_end(local_points, idx);
+          std::vector<PointTask*> batch(local_points.begin() + idx,
+                                        local_points.begin() + end);
+          idx = end;
+          map_point_batch(batch);
+          for (std::vector<PointTask*>::const_iterator it = batch.begin();
+                it != batch.end(); it++)
+          {
+            // Update the mapping index and then launch
+            // the point (it is imperative that these happen in this order!)
+            mapping_index++;
+            // Once we call this function on the last point it
+            // is possible that this slice task object can be recycled
+            (*it)->launch_task();
+          }
+        }
+        return true;
+      }
       for (std::vector<PointTask*>::const_iterator it = local_points.begin();
             it != local_points.end(); it++)
       {
@@ -12421,6 +12683,89 @@ namespace Legion {
       return true;
     }
 
+    //--------------------------------------------------------------------------
+    unsigned SliceTask::find_batch_end(const std::vector<PointTask*> &pts,
+                                       unsigned start) const
+    //--------------------------------------------------------------------------
+    {
+      // The valid instances handed to the mapper for a batch are all
+      // computed before any point in the batch is mapped, so a point
+      // that names the same logical region (and some of the same fields)
+      // as an earlier point in the batch would not see any instances
+      // made for that earlier point. Start a new batch for it instead
+      // so that the valid instances are refreshed.
+      const unsigned limit = 
+        std::min<size_t>(start + Runtime::mapping_batch_size, pts.size());
+      for (unsigned end = start + 1; end < limit; end++)
+      {
+        const std::vector<RegionRequirement> &next_regions = 
+          pts[end]->regions;
+        for (unsigned idx = 0; idx < next_regions.size(); idx++)
+        {
+          const RegionRequirement &next = next_regions[idx];
+          if (next.privilege == NO_ACCESS)
+            continue;
+          for (unsigned prev = start; prev < end; prev++)
+          {
+            const std::vector<RegionRequirement> &prev_regions = 
+              pts[prev]->regions;
+            for (unsigned idx2 = 0; idx2 < prev_regions.size(); idx2++)
+            {
+              const RegionRequirement &req = prev_regions[idx2];
+              if ((req.privilege == NO_ACCESS) || (req.region != next.region))
+                continue;
+              for (std::set<FieldID>::const_iterator it = 
+                    next.privilege_fields.begin(); it !=
+                    next.privilege_fields.end(); it++)
+              {
+                if (req.privilege_fields.find(*it) != 
+                    req.privilege_fields.end())
+                  return end;
+              }
+            }
+          }
+        }
+      }
+      return limit;
+    }
+
+    //--------------------------------------------------------------------------
+    void SliceTask::map_point_batch(const std::vector<PointTask*> &batch)
+    //--------------------------------------------------------------------------
+    {
+#ifdef DEBUG_LEGION
+      assert(!batch.empty());
+#endif
+      const size_t num_points = batch.size();
+      std::vector<Mapper::MapTaskInput> inputs(num_points);
+      std::vector<Mapper::MapTaskOutput> outputs(num_points);
+      std::vector<std::vector<RegionTreeContext> > enclosing(num_points);
+      std::vector<std::vector<InstanceSet> > valid(num_points);
+      // All our points have the same target processor so we
+      // only need to find its visible memories once
+      std::set<Memory> visible_memories;
+      runtime->machine.get_visible_memories(target_proc, visible_memories);
+      for (unsigned idx = 0; idx < num_points; idx++)
+        batch[idx]->prepare_batched_mapping(inputs[idx], outputs[idx],
+                                  enclosing[idx], valid[idx], visible_memories);
+      // One mapper call for the whole batch
+      if (mapper == NULL)
+        mapper = runtime->find_mapper(current_proc, map_id);
+      std::vector<TaskOp*> tasks(batch.begin(), batch.end());
+      mapper->invoke_map_tasks(&tasks, &inputs, &outputs);
+      for (unsigned idx = 0; idx < num_points; idx++)
+      {
+#ifdef DEBUG_LEGION
+        bool point_success = 
+#endif
+          batch[idx]->finish_batched_mapping(inputs[idx], outputs[idx],
+                                             enclosing[idx], valid[idx]);
+#ifdef DEBUG_LEGION
+        assert(point_success);
+#endif
+      }
+    }
+
     //--------------------------------------------------------------------------
     ApEvent SliceTask::get_task_completion(void) const
     //--------------------------------------------------------------------------
@@ -12594,34 +12939,34 @@ namespace Legion {
     //--------------------------------------------------------------------------
     {
       DETAILED_PROFILER(runtime, SLICE_HANDLE_FUTURE_CALL);
-      // If we're remote, just handle it ourselves, otherwise pass
-      // it back to the enclosing index owner
-      if (is_remote())
+      // Reductions are folded into our partial state first and then
+      // combined into the index owner once when we complete. Serdez
+      // reductions only do this when we're remote. Otherwise if we're 
+      // remote, just handle it ourselves, or pass it back to the 
+      // enclosing index owner
+      if ((redop != 0) && (is_remote() || (serdez_redop_fns == NULL)))
+        fold_reduction_future(result, result_size, owner, false/*exclusive*/);
+      else if (is_remote())
       {
-        if (redop != 0)
-          fold_reduction_future(result, result_size, owner, false/*exclusive*/);
-        else
-        {
-          // Store it in our temporary futures
+        // Store it in our temporary futures
 #ifdef DEBUG_LEGION
-          assert(temporary_futures.find(point) == temporary_futures.end());
+        assert(temporary_futures.find(point) == temporary_futures.end());
 #endif
-          if (owner)
-          {
-            // Hold the lock to protect the data structure
-            AutoLock o_lock(op_lock);
-            temporary_futures[point] = 
-              std::pair<void*,size_t>(const_cast<void*>(result),result_size);
-          }
-          else
-          {
-            void *copy = legion_malloc(FUTURE_RESULT_ALLOC, result_size);
-            memcpy(copy,result,result_size);
-            // Hold the lock to protect the data structure
-            AutoLock o_lock(op_lock);
-            temporary_futures[point] = 
-              std::pair<void*,size_t>(copy,result_size);
-          }
+        if (owner)
+        {
+          // Hold the lock to protect the data structure
+          AutoLock o_lock(op_lock);
+          temporary_futures[point] = 
+            std::pair<void*,size_t>(const_cast<void*>(result),result_size);
+        }
+        else
+        {
+          void *copy = legion_malloc(FUTURE_RESULT_ALLOC, result_size);
+          memcpy(copy,result,result_size);
+          // Hold the lock to protect the data structure
+          AutoLock o_lock(op_lock);
+          temporary_futures[point] = 
+            std::pair<void*,size_t>(copy,result_size);
         }
       }
       else
@@ -12902,6 +13247,9 @@ namespace Legion {
     //--------------------------------------------------------------------------
     {
       DETAILED_PROFILER(runtime, SLICE_COMPLETE_CALL);
+      // All our points are done so combine our partial reduction
+      if (redop != 0)
+        combine_reduction_stripes();
       // For remote cases we have to keep track of the events for
       // returning any created logical state, we can't commit until
       // it is returned or we might prematurely release the references
@@ -12915,6 +13263,9 @@ namespace Legion {
       }
       else
       {
+        if ((redop != 0) && (serdez_redop_fns == NULL))
+          index_owner->fold_reduction_future(reduction_state, 
+              reduction_state_size, false/*owner*/, false/*exclusive*/);
         index_owner->return_slice_complete(points.size());
       }
       complete_operation();
@@ -12999,13 +13350,51 @@ namespace Legion {
 #ifdef DEBUG_LEGION
         assert(temporary_futures.size() == points.size());
 #endif
-        for (std::map<DomainPoint,std::pair<void*,size_t> >::const_iterator it =
-              temporary_futures.begin(); it != temporary_futures.end(); it++)
+        // If our domain is a rectangle and all the values are the same
+        // size then send them as one block in the order of the domain
+        bool dense = (index_domain.get_dim() > 0) && 
+                     (index_domain.get_volume() == temporary_futures.size());
+        size_t value_size = 0;
+        if (dense && !temporary_futures.empty())
+        {
+          value_size = temporary_futures.begin()->second.second;
+          for (std::map<DomainPoint,std::pair<void*,size_t> >::const_iterator
+                it = temporary_futures.begin(); 
+                it != temporary_futures.end(); it++)
+          {
+            if (it->second.second != value_size)
+            {
+              dense = false;
+              break;
+            }
+          }
+        }
+        rez.serialize(dense);
+        if (dense)
+        {
+          rez.serialize(index_domain);
+          rez.serialize(value_size);
+          for (Domain::DomainPointIterator itr(index_domain); itr; itr++)
+          {
+            std::map<DomainPoint,std::pair<void*,size_t> >::const_iterator
+              finder = temporary_futures.find(itr.p);
+#ifdef DEBUG_LEGION
+            assert(finder != temporary_futures.end());
+#endif
+            rez.serialize(finder->second.first, value_size);
+          }
+        }
+        else
         {
-          pack_point(rez, it->first);
-          RezCheck z2(rez);
-          rez.serialize(it->second.second);
-          rez.serialize(it->second.first,it->second.second);
+          for (std::map<DomainPoint,std::pair<void*,size_t> >::const_iterator
+                it = temporary_futures.begin(); 
+                it != temporary_futures.end(); it++)
+          {
+            pack_point(rez, it->first);
+            RezCheck z2(rez);
+            rez.serialize(it->second.second);
+            rez.serialize(it->second.first,it->second.second);
+          }
         }
       }
     }
@@ -86,6 +86,7 @@ namespace Legion {
       virtual const char* get_logging_name(void) const;
       virtual OpKind get_operation_kind(void) const;
       virtual size_t get_region_count(void) const;
+      virtual bool find_dependence_trees(std::set<RegionTreeID> &trees) const;
       virtual Mappable* get_mappable(void);
     public:
       virtual void trigger_dependence_analysis(void) = 0;
@@ -417,7 +418,7 @@ namespace Legion {
       bool has_executing_operation(Operation *op);
       bool has_executed_operation(Operation *op);
       void print_children(void);
-      void perform_window_wait(void);
+      RtEvent perform_window_wait(void);
     public:
       void perform_fence_analysis(FenceOp *op);
       virtual void update_current_fence(FenceOp *op);
@@ -426,7 +427,7 @@ namespace Legion {
       void end_trace(TraceID tid);
     public:
       void issue_frame(FrameOp *frame, ApEvent frame_termination);
-      void perform_frame_issue(FrameOp *frame, ApEvent frame_termination);
+      RtEvent perform_frame_issue(FrameOp *frame, ApEvent frame_termination);
       void finish_frame(ApEvent frame_termination);
     public:
       void increment_outstanding(void);
@@ -536,7 +537,8 @@ namespace Legion {
                                      Mapper::MapTaskOutput &output,
                                      MustEpochOp *must_epoch_owner,
                                const std::vector<RegionTreeContext> &enclosing,
-                                     std::vector<InstanceSet> &valid_instances);
+                                     std::vector<InstanceSet> &valid_instances,
+                               const std::set<Memory> *visible_memories = NULL);
       void finalize_map_task_output(Mapper::MapTaskInput &input,
                                     Mapper::MapTaskOutput &output,
                                     MustEpochOp *must_epoch_owner,
@@ -551,6 +553,8 @@ namespace Legion {
           const std::vector<RegionTreeContext> &enclosing_contexts);
       bool map_all_regions(ApEvent user_event,
                            MustEpochOp *must_epoch_owner = NULL); 
+      bool register_mapped_regions(ApEvent user_event,
+          const std::vector<RegionTreeContext> &enclosing_contexts);
       void perform_post_mapping(void);
       void initialize_region_tree_contexts(
           const std::vector<RegionRequirement> &clone_requirements,
@@ -696,6 +700,13 @@ namespace Legion {
       RtEvent pending_done;
       RtEvent last_registration;
       RtEvent dependence_precondition;
+      // With concurrent dependence analysis, the most recent analysis
+      // for each region tree; analyses that must be ordered with respect
+      // to everything fold these back into dependence_precondition
+      std::map<RegionTreeID,RtEvent> tree_dependence_preconditions;
+      // Concurrent analyses that touch no region trees at all, these
+      // still have to finish before the next ordered analysis starts
+      RtEvent treeless_dependence_precondition;
       RtEvent profiling_done; 
     protected:
       mutable bool leaf_cached, is_leaf_result;
@@ -808,6 +819,7 @@ namespace Legion {
       void initialize_reduction_state(void);
       void fold_reduction_future(const void *result, size_t result_size,
                                  bool owner, bool exclusive); 
+      void combine_reduction_stripes(void);
     protected:
       std::list<SliceTask*> slices;
       std::vector<VersionInfo> version_infos;
@@ -822,6 +834,9 @@ namespace Legion {
       const SerdezRedopFns *serdez_redop_fns;
       size_t reduction_state_size;
       void *reduction_state; 
+      // Cache-line padded partial accumulators for non-exclusive folds
+      size_t reduction_stripe_stride;
+      void *reduction_stripes;
     };
 
     /**
@@ -992,6 +1007,19 @@ namespace Legion {
       virtual const std::vector<RestrictInfo>* get_restrict_infos(void);
       virtual void recapture_version_info(unsigned idx);
       virtual bool is_inline_task(void) const;
+    public:
+      // For mapping the points of a slice with one map_tasks call
+      void prepare_batched_mapping(Mapper::MapTaskInput &input,
+                                   Mapper::MapTaskOutput &output,
+                          std::vector<RegionTreeContext> &enclosing_contexts,
+                                   std::vector<InstanceSet> &valid_instances,
+                                   const std::set<Memory> &visible_memories);
+      bool finish_batched_mapping(Mapper::MapTaskInput &input,
+                                  Mapper::MapTaskOutput &output,
+                    const std::vector<RegionTreeContext> &enclosing_contexts,
+                                  std::vector<InstanceSet> &valid_instances);
+    protected:
+      void complete_point_mapping(bool map_success);
     public:
       virtual ApEvent get_task_completion(void) const;
       virtual TaskKind get_task_kind(void) const;
@@ -1405,6 +1433,9 @@ namespace Legion {
                                      MinimalPoint *mp);
       void enumerate_points(void);
       void prewalk_slice(void);
+      unsigned find_batch_end(const std::vector<PointTask*> &pts,
+                              unsigned start) const;
+      void map_point_batch(const std::vector<PointTask*> &batch);
       void apply_local_version_infos(std::set<RtEvent> &map_conditions);
       std::map<PhysicalManager*,std::pair<unsigned,bool> >* 
                                      get_acquired_instances_ref(void);
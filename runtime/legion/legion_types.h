@@ -278,6 +278,8 @@ namespace Legion {
       HLR_REMOVE_VERSION_STATE_REF_TASK_ID,
       HLR_DEFER_RESTRICTED_MANAGER_TASK_ID,
       HLR_REMOTE_VIEW_CREATION_TASK_ID,
+      HLR_FLUSH_REFERENCE_UPDATES_TASK_ID,
+      HLR_DEFERRED_WAIT_TASK_ID,
       HLR_MESSAGE_ID, // These two must be the last two
       HLR_RETRY_SHUTDOWN_TASK_ID,
       HLR_LAST_TASK_ID, // This one should always be last
@@ -346,6 +348,8 @@ namespace Legion {
         "Deferred Remove Version State Valid Ref",                \
         "Deferred Restricted Manager GC Ref",                     \
         "Remote View Creation",                                   \
+        "Flush Remote Reference Updates",                         \
+        "Deferred Meta-Task Wait",                                \
         "Remote Message",                                         \
         "Retry Shutdown",                                         \
       };
@@ -357,6 +361,7 @@ namespace Legion {
       PREMAP_TASK_CALL,
       SLICE_TASK_CALL,
       MAP_TASK_CALL,
+      MAP_TASKS_CALL,
       SELECT_VARIANT_CALL,
       POSTMAP_TASK_CALL,
       TASK_SELECT_SOURCES_CALL,
@@ -404,6 +409,7 @@ namespace Legion {
       "premap_task",                                \
       "slice_task",                                 \
       "map_task",                                   \
+      "map_tasks",                                  \
       "select_task_variant",                        \
       "postmap_task",                               \
       "select_task_sources",                        \
@@ -506,6 +512,7 @@ namespace Legion {
       DISTRIBUTED_VALID_UPDATE,
       DISTRIBUTED_GC_UPDATE,
       DISTRIBUTED_RESOURCE_UPDATE,
+      DISTRIBUTED_BATCH_UPDATE,
       DISTRIBUTED_CREATE_ADD,
       DISTRIBUTED_CREATE_REMOVE,
       DISTRIBUTED_UNREGISTER,
@@ -616,6 +623,7 @@ namespace Legion {
         "Distributed Valid Update",                                   \
         "Distributed GC Update",                                      \
         "Distributed Resource Update",                                \
+        "Distributed Batch Update",                                   \
         "Distributed Create Add",                                     \
         "Distributed Create Remove",                                  \
         "Distributed Unregister",                                     \
@@ -24,6 +24,11 @@
 #include "legion_views.h"
 #include "legion_analysis.h"
 
+#include <sys/time.h>
+static unsigned long long instr_ns = 0, instr_calls = 0;
+static unsigned long long instr_now(void) { struct timespec ts; clock_gettime(CLOCK_MONOTONIC, &ts); return ts.tv_sec*1000000000ULL + ts.tv_nsec; }
+struct InstrReport { ~InstrReport(void) { fprintf(stderr, "INSTR composite copies %llu time %.3f ms\n", instr_calls, instr_ns/1e6); } };
+static InstrReport instr_report;
 namespace Legion {
   namespace Internal {
 
@@ -3805,10 +3810,13 @@ namespace Legion {
       DETAILED_PROFILER(context->runtime, 
                         COMPOSITE_VIEW_ISSUE_DEFERRED_COPIES_CALL);
       LegionMap<ApEvent,FieldMask>::aligned postreductions;
+      unsigned long long instr_start = instr_now();
       root->issue_deferred_copies(info, dst, copy_mask, 
                                   version_info->get_version_info(), 
                                   preconditions, postconditions, 
                                   postreductions, across_helper);
+      __sync_fetch_and_add(&instr_ns, instr_now() - instr_start);
+      __sync_fetch_and_add(&instr_calls, 1);
       if (!postreductions.empty())
       {
         // We need to merge the two post sets
@@ -3969,7 +3977,8 @@ namespace Legion {
 
     //--------------------------------------------------------------------------
     CompositeNode::CompositeNode(RegionTreeNode* node, CompositeNode *p)
-      : logical_node(node), parent(p), owner_did(0)
+      : logical_node(node), parent(p), owner_did(0),
+        summary_state(SUMMARY_NONE), all_children_present(false)
     //--------------------------------------------------------------------------
     {
       if (parent != NULL)
@@ -3978,7 +3987,8 @@ namespace Legion {
 
     //--------------------------------------------------------------------------
     CompositeNode::CompositeNode(const CompositeNode &rhs)
-      : logical_node(NULL), parent(NULL)
+      : logical_node(NULL), parent(NULL), summary_state(SUMMARY_NONE),
+        all_children_present(false)
     //--------------------------------------------------------------------------
     {
       // should never be called
@@ -4695,6 +4705,12 @@ namespace Legion {
       // Region domination tests are always sound
       if (logical_node->is_region())
         return true;
+      if (summary_state == SUMMARY_READY)
+      {
+        // Make sure we see the summary that was published with the state
+        __sync_synchronize();
+        return (all_children_present && !(children_mask - mask));
+      }
       // Partition domination tests are only sound if have all the
       // children for all the fields
       if (logical_node->get_num_children() != children.size())
@@ -4710,9 +4726,44 @@ namespace Legion {
 
     //--------------------------------------------------------------------------
     void CompositeNode::find_valid_views(const FieldMask &search_mask,
-                        LegionMap<LogicalView*,FieldMask>::aligned &valid) const
+                        LegionMap<LogicalView*,FieldMask>::aligned &valid,
+                        bool use_summary) const
     //--------------------------------------------------------------------------
     {
+      // If we've been summarized for these fields there is no need
+      // to walk back up the tree
+      if (use_summary && ensure_summary() && !(search_mask - summary_mask))
+      {
+#ifdef DEBUG_LEGION
+        LegionMap<LogicalView*,FieldMask>::aligned flat, walked;
+        LegionMap<LogicalView*,FieldMask>::aligned &result = flat;
+#else
+        LegionMap<LogicalView*,FieldMask>::aligned &result = valid;
+#endif
+        for (LegionMap<LogicalView*,FieldMask>::aligned::const_iterator it = 
+              flattened_views.begin(); it != flattened_views.end(); it++)
+        {
+          FieldMask overlap = search_mask & it->second;
+          if (!overlap)
+            continue;
+          result[it->first] |= overlap;
+        }
+#ifdef DEBUG_LEGION
+        // The summary had better say the same thing as the walk
+        find_valid_views(search_mask, walked, false/*use summary*/);
+        assert(flat.size() == walked.size());
+        for (LegionMap<LogicalView*,FieldMask>::aligned::const_iterator it = 
+              flat.begin(); it != flat.end(); it++)
+        {
+          LegionMap<LogicalView*,FieldMask>::aligned::const_iterator finder =
+            walked.find(it->first);
+          assert(finder != walked.end());
+          assert(finder->second == it->second);
+          valid[it->first] |= it->second;
+        }
+#endif
+        return;
+      }
       bool need_check = false;
       if (parent != NULL)
       {
@@ -4720,7 +4771,7 @@ namespace Legion {
         if (!!up_mask)
         {
           LegionMap<LogicalView*,FieldMask>::aligned valid_up;
-          parent->find_valid_views(up_mask, valid_up);
+          parent->find_valid_views(up_mask, valid_up, use_summary);
           if (!valid_up.empty())
           {
             need_check = true;
@@ -4890,6 +4941,92 @@ namespace Legion {
       }
     }
 
+    //--------------------------------------------------------------------------
+    bool CompositeNode::ensure_summary(void) const
+    //--------------------------------------------------------------------------
+    {
+      if (summary_state == SUMMARY_READY)
+      {
+        // Pairs with the barrier before we publish the summary below
+        __sync_synchronize();
+        return true;
+      }
+      // We flatten from our parent's summary so it has to be built first
+      if ((parent != NULL) && !parent->ensure_summary())
+        return false;
+      // If someone else is already building it then don't wait for them,
+      // the caller can just walk the tree this time
+      if (!__sync_bool_compare_and_swap(&summary_state, 
+                                        SUMMARY_NONE, SUMMARY_BUILDING))
+      {
+        if (summary_state != SUMMARY_READY)
+          return false;
+        __sync_synchronize();
+        return true;
+      }
+      build_summary();
+      // Make sure everything is visible before we publish the summary
+      __sync_synchronize();
+      summary_state = SUMMARY_READY;
+      return true;
+    }
+
+    //--------------------------------------------------------------------------
+    void CompositeNode::build_summary(void) const
+    //--------------------------------------------------------------------------
+    {
+      // Our parent has already been summarized, so we can flatten our
+      // valid views from its views without going any further up the tree
+      if (parent != NULL)
+      {
+#ifdef DEBUG_LEGION
+        assert(parent->summary_state == SUMMARY_READY);
+#endif
+        LegionMap<CompositeNode*,FieldMask>::aligned::const_iterator finder = 
+          parent->children.find(const_cast<CompositeNode*>(this));
+#ifdef DEBUG_LEGION
+        assert(finder != parent->children.end());
+#endif
+        // Only summarize the fields our parent says we have so that
+        // we don't make subviews for anything no one will ask about
+        summary_mask = finder->second & parent->summary_mask;
+        FieldMask up_mask = summary_mask - dirty_mask;
+        if (!!up_mask)
+        {
+          const ColorPoint &local_color = logical_node->get_color();
+          for (LegionMap<LogicalView*,FieldMask>::aligned::const_iterator it =
+                parent->flattened_views.begin(); it != 
+                parent->flattened_views.end(); it++)
+          {
+            FieldMask overlap = up_mask & it->second;
+            if (!overlap)
+              continue;
+            LogicalView *local_view = it->first->get_subview(local_color);
+            flattened_views[local_view] |= overlap;
+          }
+        }
+      }
+      else
+        summary_mask = FieldMask(LEGION_FIELD_MASK_FIELD_ALL_ONES);
+      for (LegionMap<LogicalView*,FieldMask>::aligned::const_iterator it = 
+            valid_views.begin(); it != valid_views.end(); it++)
+      {
+        FieldMask overlap = summary_mask & it->second;
+        if (!overlap)
+          continue;
+        flattened_views[it->first] |= overlap;
+      }
+      // Also cache what we need for partition domination tests
+      if (!logical_node->is_region())
+      {
+        all_children_present = 
+          (logical_node->get_num_children() == children.size());
+        for (LegionMap<CompositeNode*,FieldMask>::aligned::const_iterator it =
+              children.begin(); it != children.end(); it++)
+          children_mask |= it->second;
+      }
+    }
+
     //--------------------------------------------------------------------------
     void CompositeNode::pack_composite_tree(Serializer &rez, 
                                             AddressSpaceID target)
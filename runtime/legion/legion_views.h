@@ -987,7 +987,8 @@ namespace Legion {
                                     const FieldMask &mask) const;
       bool are_domination_tests_sound(const FieldMask &mask) const;
       void find_valid_views(const FieldMask &search_mask,
-                      LegionMap<LogicalView*,FieldMask>::aligned &valid) const;
+                      LegionMap<LogicalView*,FieldMask>::aligned &valid,
+                      bool use_summary = true) const;
       void issue_update_copies(const TraversalInfo &info, MaterializedView *dst,
                        FieldMask copy_mask, const VersionInfo &src_version_info,
                     const LegionMap<ApEvent,FieldMask>::aligned &preconditions,
@@ -1001,6 +1002,9 @@ namespace Legion {
                     const LegionMap<ApEvent,FieldMask>::aligned &preconditions,
                           LegionMap<ApEvent,FieldMask>::aligned &postconditions,
                           CopyAcrossHelper *helper) const;
+    protected:
+      bool ensure_summary(void) const;
+      void build_summary(void) const;
     public:
       void pack_composite_tree(Serializer &rez, AddressSpaceID target);
       void unpack_composite_tree(Deserializer &derez, AddressSpaceID source,
@@ -1020,6 +1024,21 @@ namespace Legion {
       LegionMap<CompositeNode*,FieldMask/*valid fields*/>::aligned children;
       LegionMap<LogicalView*,FieldMask>::aligned valid_views;
       LegionMap<ReductionView*,FieldMask>::aligned reduction_views;
+    protected:
+      enum SummaryState {
+        SUMMARY_NONE,
+        SUMMARY_BUILDING,
+        SUMMARY_READY,
+      };
+      // Flattened summary of this node, built the first time the node
+      // is queried and only read once the state is SUMMARY_READY.
+      // The flattened views are everything find_valid_views would return
+      // for any fields in the summary mask.
+      mutable volatile int summary_state;
+      mutable bool all_children_present;
+      mutable FieldMask summary_mask;
+      mutable FieldMask children_mask;
+      mutable LegionMap<LogicalView*,FieldMask>::aligned flattened_views;
     };
 
     /**
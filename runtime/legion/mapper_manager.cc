@@ -175,6 +175,44 @@ namespace Legion {
       finish_mapper_call(info);
     }
 
+    //--------------------------------------------------------------------------
+    void MapperManager::invoke_map_tasks(std::vector<TaskOp*> *tasks,
+                                     std::vector<Mapper::MapTaskInput> *inputs,
+                                     std::vector<Mapper::MapTaskOutput> *outputs,
+                                     bool first_invocation,
+                                     MappingCallInfo *info)
+    //--------------------------------------------------------------------------
+    {
+#ifdef DEBUG_LEGION
+      assert(!tasks->empty());
+      assert(tasks->size() == inputs->size());
+      assert(tasks->size() == outputs->size());
+#endif
+      if (info == NULL)
+      {
+        RtEvent continuation_precondition;
+        // All the tasks in a batch come from the same slice and share
+        // its acquired instances so we can use the first one here
+        info = begin_mapper_call(MAP_TASKS_CALL, tasks->front(),
+                                 first_invocation, continuation_precondition);
+        // Build a continuation if necessary
+        if (continuation_precondition.exists())
+        {
+          MapperContinuation3<std::vector<TaskOp*>,
+                              std::vector<Mapper::MapTaskInput>,
+                              std::vector<Mapper::MapTaskOutput>,
+                              &MapperManager::invoke_map_tasks>
+                                continuation(this, tasks, inputs, outputs, info);
+          continuation.defer(runtime, continuation_precondition, 
+                             tasks->front());
+          return;
+        }
+      }
+      std::vector<const Task*> mapper_tasks(tasks->begin(), tasks->end());
+      mapper->map_tasks(info, mapper_tasks, *inputs, *outputs);
+      finish_mapper_call(info);
+    }
+
     //--------------------------------------------------------------------------
     void MapperManager::invoke_select_task_variant(TaskOp *task,
                                             Mapper::SelectVariantInput *input,
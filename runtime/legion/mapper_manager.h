@@ -95,6 +95,11 @@ namespace Legion {
                            Mapper::MapTaskOutput *output, 
                            bool first_invocation = true,
                            MappingCallInfo *info = NULL);
+      void invoke_map_tasks(std::vector<TaskOp*> *tasks,
+                            std::vector<Mapper::MapTaskInput> *inputs,
+                            std::vector<Mapper::MapTaskOutput> *outputs,
+                            bool first_invocation = true,
+                            MappingCallInfo *info = NULL);
       void invoke_select_task_variant(TaskOp *task, 
                                       Mapper::SelectVariantInput *input,
                                       Mapper::SelectVariantOutput *output,
@@ -1510,7 +1510,8 @@ namespace Legion {
 #endif
       // Finally do the traversal, note that we don't need to hold the
       // context lock since the runtime guarantees that all dependence
-      // analysis for a single context are performed in order
+      // analysis for a single region tree in a context are performed 
+      // in order
       parent_node->register_logical_user(ctx.get_id(), user, path, 
                                          version_info, trace_info, 
                                          (req.handle_type != SINGULAR),
@@ -823,6 +823,8 @@ namespace Legion {
     FutureMapImpl::FutureMapImpl(SingleTask *ctx, TaskOp *t, Runtime *rt)
       : Collectable(), context(ctx), task(t), task_gen(t->get_generation()),
         valid(true), runtime(rt), ready_event(t->get_completion_event()),
+        futures_complete(false), dense_volume(0), dense_size_known(false),
+        dense_value_size(0), dense_values(NULL), dense_count(0),
         lock(Reservation::create_reservation()) 
     //--------------------------------------------------------------------------
     {
@@ -832,6 +834,8 @@ namespace Legion {
     FutureMapImpl::FutureMapImpl(SingleTask *ctx,ApEvent comp_event,Runtime *rt)
       : Collectable(), context(ctx), task(NULL), task_gen(0),
         valid(true), runtime(rt), ready_event(comp_event),
+        futures_complete(false), dense_volume(0), dense_size_known(false),
+        dense_value_size(0), dense_values(NULL), dense_count(0),
         lock(Reservation::create_reservation())
     //--------------------------------------------------------------------------
     {
@@ -841,6 +845,8 @@ namespace Legion {
     FutureMapImpl::FutureMapImpl(SingleTask *ctx, Runtime *rt)
       : Collectable(), context(ctx), task(NULL), task_gen(0),
         valid(false), runtime(rt), ready_event(ApEvent::NO_AP_EVENT), 
+        futures_complete(false), dense_volume(0), dense_size_known(false),
+        dense_value_size(0), dense_values(NULL), dense_count(0),
         lock(Reservation::NO_RESERVATION)
     //--------------------------------------------------------------------------
     {
@@ -861,6 +867,12 @@ namespace Legion {
     //--------------------------------------------------------------------------
     {
       futures.clear();
+      if (dense_values != NULL)
+        free(dense_values);
+      for (std::map<DomainPoint,std::pair<void*,size_t> >::const_iterator it =
+            sparse_values.begin(); it != sparse_values.end(); it++)
+        free(it->second.first);
+      sparse_values.clear();
       if (lock.exists())
       {
         lock.destroy_reservation();
@@ -915,9 +927,15 @@ namespace Legion {
           return result;
         }
         // Otherwise we need a future from the context to use for
-        // the point that we will fill in later
+        // the point, fill it in now if we already have the result
         Future result = runtime->help_create_future(task);
         futures[point] = result;
+        const void *value;
+        size_t value_size;
+        if (find_point_result(point, value, value_size))
+          runtime->help_set_future_result(result, value, value_size);
+        if (futures_complete)
+          runtime->help_complete_future(result);
         Runtime::release_reservation(lock);
         return result;
       }
@@ -950,6 +968,7 @@ namespace Legion {
       assert(valid);
 #endif
       AutoLock l_lock(lock);
+      futures_complete = true;
       for (std::map<DomainPoint,Future>::const_iterator it = 
             futures.begin(); it != futures.end(); it++)
       {
@@ -966,6 +985,17 @@ namespace Legion {
 #endif
       bool result = false;
       AutoLock l_lock(lock);
+      futures_complete = false;
+      // Throw away any results that we have
+      if (dense_count > 0)
+      {
+        dense_present.assign(dense_volume, false);
+        dense_count = 0;
+      }
+      for (std::map<DomainPoint,std::pair<void*,size_t> >::const_iterator it =
+            sparse_values.begin(); it != sparse_values.end(); it++)
+        free(it->second.first);
+      sparse_values.clear();
       for (std::map<DomainPoint,Future>::const_iterator it = 
             futures.begin(); it != futures.end(); it++)
       {
@@ -976,6 +1006,205 @@ namespace Legion {
       return result;
     }
 
+    //--------------------------------------------------------------------------
+    void FutureMapImpl::initialize_dense_storage(const Domain &launch_domain)
+    //--------------------------------------------------------------------------
+    {
+#ifdef DEBUG_LEGION
+      assert(valid);
+      assert(dense_count == 0);
+#endif
+      // Only rectangular domains can be stored densely
+      if (launch_domain.get_dim() == 0)
+        return;
+      dense_domain = launch_domain;
+      dense_volume = launch_domain.get_volume();
+      dense_present.resize(dense_volume, false);
+    }
+
+    //--------------------------------------------------------------------------
+    void FutureMapImpl::set_point_result(const DomainPoint &point,
+                                         const void *result, 
+                                         size_t result_size, bool owner)
+    //--------------------------------------------------------------------------
+    {
+#ifdef DEBUG_LEGION
+      assert(valid);
+#endif
+      AutoLock l_lock(lock);
+      record_point_result(point, result, result_size, owner);
+      // If someone already asked for a future for this point then
+      // give it a copy of the result too
+      if (!futures.empty())
+      {
+        std::map<DomainPoint,Future>::const_iterator finder = 
+          futures.find(point);
+        if (finder != futures.end())
+        {
+          const void *value;
+          size_t value_size;
+#ifdef DEBUG_LEGION
+          bool found = 
+#endif
+          find_point_result(point, value, value_size);
+#ifdef DEBUG_LEGION
+          assert(found);
+#endif
+          runtime->help_set_future_result(finder->second, value, value_size);
+        }
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    void FutureMapImpl::set_dense_results(const Domain &domain,
+                                          const void *values, 
+                                          size_t value_size)
+    //--------------------------------------------------------------------------
+    {
+#ifdef DEBUG_LEGION
+      assert(valid);
+#endif
+      // The values are packed in the order that the points 
+      // of the domain are enumerated
+      const char *ptr = (const char*)values;
+      AutoLock l_lock(lock);
+      for (Domain::DomainPointIterator itr(domain); itr; itr++)
+      {
+        record_point_result(itr.p, ptr, value_size, false/*owner*/);
+        if (!futures.empty())
+        {
+          std::map<DomainPoint,Future>::const_iterator finder = 
+            futures.find(itr.p);
+          if (finder != futures.end())
+            runtime->help_set_future_result(finder->second, ptr, value_size);
+        }
+        ptr += value_size;
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    const void* FutureMapImpl::get_all_untyped_results(size_t &value_size,
+                                                       size_t &num_points)
+    //--------------------------------------------------------------------------
+    {
+      value_size = 0;
+      num_points = 0;
+      if (!valid)
+        return NULL;
+      wait_all_results();
+      AutoLock l_lock(lock);
+      // We can only hand back the buffer if every point is in it
+      if (!dense_size_known || (dense_count < dense_volume) || 
+          !sparse_values.empty())
+        return NULL;
+      value_size = dense_value_size;
+      num_points = dense_volume;
+      return dense_values;
+    }
+
+    //--------------------------------------------------------------------------
+    void FutureMapImpl::record_point_result(const DomainPoint &point,
+                                            const void *result,
+                                            size_t result_size, bool owner)
+    //--------------------------------------------------------------------------
+    {
+      size_t index;
+      const bool dense = linearize_point(point, index);
+      if (dense)
+      {
+        // The first result decides the size of the dense values
+        if (!dense_size_known)
+        {
+          dense_size_known = true;
+          dense_value_size = result_size;
+          if (dense_value_size > 0)
+            dense_values = (char*)malloc(dense_volume * dense_value_size);
+        }
+        if (result_size == dense_value_size)
+        {
+          if (result_size > 0)
+            memcpy(dense_values + index * dense_value_size, 
+                   result, result_size);
+          if (!dense_present[index])
+          {
+            dense_present[index] = true;
+            dense_count++;
+          }
+          if (owner)
+            free(const_cast<void*>(result));
+          return;
+        }
+        // Otherwise it doesn't fit so it goes in the sparse values
+        if (dense_present[index])
+        {
+          dense_present[index] = false;
+          dense_count--;
+        }
+      }
+      void *value = const_cast<void*>(result);
+      if (!owner)
+      {
+        value = malloc(result_size);
+        memcpy(value, result, result_size);
+      }
+      std::map<DomainPoint,std::pair<void*,size_t> >::iterator finder = 
+        sparse_values.find(point);
+      if (finder != sparse_values.end())
+      {
+        free(finder->second.first);
+        finder->second = std::pair<void*,size_t>(value, result_size);
+      }
+      else
+        sparse_values[point] = std::pair<void*,size_t>(value, result_size);
+    }
+
+    //--------------------------------------------------------------------------
+    bool FutureMapImpl::find_point_result(const DomainPoint &point,
+                                          const void *&result,
+                                          size_t &result_size) const
+    //--------------------------------------------------------------------------
+    {
+      size_t index;
+      if (linearize_point(point, index) && dense_present[index])
+      {
+        result = (dense_value_size > 0) ? 
+          dense_values + index * dense_value_size : NULL;
+        result_size = dense_value_size;
+        return true;
+      }
+      std::map<DomainPoint,std::pair<void*,size_t> >::const_iterator finder =
+        sparse_values.find(point);
+      if (finder == sparse_values.end())
+        return false;
+      result = finder->second.first;
+      result_size = finder->second.second;
+      return true;
+    }
+
+    //--------------------------------------------------------------------------
+    bool FutureMapImpl::linearize_point(const DomainPoint &point,
+                                        size_t &index) const
+    //--------------------------------------------------------------------------
+    {
+      if ((dense_volume == 0) || (point.get_dim() != dense_domain.get_dim()))
+        return false;
+      // Same order as the domain point iterator, first dimension fastest
+      const int dim = dense_domain.get_dim();
+      index = 0;
+      size_t stride = 1;
+      for (int idx = 0; idx < dim; idx++)
+      {
+        const coord_t lo = dense_domain.rect_data[idx];
+        const coord_t hi = dense_domain.rect_data[dim + idx];
+        const coord_t p = point.point_data[idx];
+        if ((p < lo) || (p > hi))
+          return false;
+        index += (p - lo) * stride;
+        stride *= (hi - lo + 1);
+      }
+      return true;
+    }
+
 #ifdef DEBUG_LEGION
     //--------------------------------------------------------------------------
     void FutureMapImpl::add_valid_domain(const Domain &d)
@@ -2253,7 +2482,7 @@ namespace Legion {
       : memory(m), owner_space(m.address_space()), 
         is_owner(m.address_space() == rt->address_space),
         capacity(m.capacity()), remaining_capacity(capacity), runtime(rt), 
-        manager_lock(Reservation::create_reservation())
+        manager_lock(Reservation::create_reservation()), use_clock(0)
     //--------------------------------------------------------------------------
     {
     }
@@ -2332,6 +2561,7 @@ namespace Legion {
       // that we were made valid to begin with
       InstanceInfo &info = current_instances[manager];
       info.instance_size = inst_size;
+      add_instance_index(manager);
     }
 
     //--------------------------------------------------------------------------
@@ -2343,6 +2573,7 @@ namespace Legion {
       assert(current_instances.find(manager) != current_instances.end());
 #endif     
       current_instances.erase(manager);
+      remove_instance_index(manager);
     }
 
     //--------------------------------------------------------------------------
@@ -2359,6 +2590,7 @@ namespace Legion {
 #endif
       if (finder->second.current_state != VALID_STATE)
         finder->second.current_state = ACTIVE_STATE;
+      update_eviction_index(manager, finder->second, true/*used*/);
     }
 
     //--------------------------------------------------------------------------
@@ -2387,12 +2619,17 @@ namespace Legion {
 #endif
           Runtime::trigger_event(info.deferred_collect);
           // Now we can delete our entry because it has been deleted
+          remove_eviction_index(info);
           current_instances.erase(finder);
+          remove_instance_index(manager);
           if (is_owner)
             remove_reference = true;
         }
         else // didn't collect it yet
+        {
           info.current_state = COLLECTABLE_STATE;
+          update_eviction_index(manager, info);
+        }
       }
       // If we are the owner and this is a reduction instance
       // then let's just delete it now
@@ -2419,6 +2656,7 @@ namespace Legion {
         assert(finder->second.current_state == ACTIVE_STATE);
 #endif
       finder->second.current_state = VALID_STATE;
+      update_eviction_index(manager, finder->second, true/*used*/);
     }
 
     //--------------------------------------------------------------------------
@@ -2433,6 +2671,7 @@ namespace Legion {
       assert(finder->second.current_state == VALID_STATE);
 #endif
       finder->second.current_state = ACTIVE_STATE;
+      update_eviction_index(manager, finder->second);
     }
 
     //--------------------------------------------------------------------------
@@ -2809,13 +3048,19 @@ namespace Legion {
       std::map<PhysicalManager*,bool> to_release;
       {
         AutoLock m_lock(manager_lock);
-        for (std::map<PhysicalManager*,InstanceInfo>::iterator it = 
-              current_instances.begin(); it != current_instances.end(); it++)
+        std::map<RegionTreeID,std::set<PhysicalManager*> >::const_iterator
+          tree_finder = tree_instances.find(tree_id);
+        if (tree_finder == tree_instances.end())
+          return;
+        for (std::set<PhysicalManager*>::const_iterator tit = 
+              tree_finder->second.begin(); tit != tree_finder->second.end();
+              tit++)
         {
-          // If the region for the instance is not for the tree then
-          // we get to skip it
-          if (it->first->region_node->handle.get_tree_id() != tree_id)
-            continue;
+          std::map<PhysicalManager*,InstanceInfo>::iterator it = 
+            current_instances.find(*tit);
+#ifdef DEBUG_LEGION
+          assert(it != current_instances.end());
+#endif
           // If it's already been deleted, then there is nothing to do
           if (it->second.current_state == ACTIVE_COLLECTED_STATE)
             continue;
@@ -2831,6 +3076,7 @@ namespace Legion {
 #endif
           it->second.mapper_priorities.clear();
           it->second.min_priority = GC_MAX_PRIORITY;
+          update_eviction_index(it->first, it->second);
         }
       }
       for (std::map<PhysicalManager*,bool>::const_iterator it = 
@@ -3016,6 +3262,7 @@ namespace Legion {
             if (priority < finder->second.min_priority)
               finder->second.min_priority = priority;
           }
+          update_eviction_index(manager, finder->second);
         }
       }
       if (remove_min_reference && 
@@ -3425,7 +3672,10 @@ namespace Legion {
           std::map<PhysicalManager*,InstanceInfo>::const_iterator finder = 
             current_instances.find(manager);
           if (finder == current_instances.end())
+          {
             current_instances[manager] = InstanceInfo();
+            add_instance_index(manager);
+          }
           if (created && min_priority)
           {
             std::pair<MapperID,Processor> key(mapper_id,processor);
@@ -3462,7 +3712,10 @@ namespace Legion {
           std::map<PhysicalManager*,InstanceInfo>::const_iterator finder = 
             current_instances.find(manager);
           if (finder == current_instances.end())
+          {
             current_instances[manager] = InstanceInfo();
+            add_instance_index(manager);
+          }
           if (min_priority)
           {
             InstanceInfo &info = current_instances[manager];
@@ -3669,20 +3922,14 @@ namespace Legion {
                                 bool tight_region_bounds, bool remote)
     //--------------------------------------------------------------------------
     {
+      std::vector<LogicalRegion> ancestors;
+      find_ancestor_regions(regions, ancestors);
       // Hold the lock while iterating here
       std::deque<PhysicalManager*> candidates;
       {
         AutoLock m_lock(manager_lock, 1, false/*exclusive*/);
-        for (std::map<PhysicalManager*,InstanceInfo>::const_iterator it = 
-              current_instances.begin(); it != current_instances.end(); it++)
-        {
-          // Skip it if has already been collected
-          if (it->second.current_state == ACTIVE_COLLECTED_STATE)
-            continue;
-          if (!it->first->meets_region_tree(regions))
-            continue;
-          candidates.push_back(it->first);
-        }
+        find_region_candidates(regions, ancestors, 
+                               false/*valid only*/, candidates);
       }
       // If we have any candidates check their constraints
       if (!candidates.empty())
@@ -3719,20 +3966,38 @@ namespace Legion {
                                       bool tight_region_bounds, bool remote)
     //--------------------------------------------------------------------------
     {
+      std::vector<LogicalRegion> ancestors;
+      find_ancestor_regions(regions, ancestors);
       // Hold the lock while iterating here
       std::deque<PhysicalManager*> candidates;
+      PhysicalManager *recent = NULL;
       {
         AutoLock m_lock(manager_lock, 1, false/*exclusive*/);
-        for (std::map<PhysicalManager*,InstanceInfo>::const_iterator it = 
-              current_instances.begin(); it != current_instances.end(); it++)
+        // Try the last instance that satisfied these constraints first,
+        // it will show up again below but only gets checked twice if
+        // it no longer satisfies the constraints
+        if (!regions.empty())
         {
-          // Skip it if has already been collected
-          if (it->second.current_state == ACTIVE_COLLECTED_STATE)
-            continue;
-          if (!it->first->meets_region_tree(regions))
-            continue;
-          candidates.push_back(it->first);
+          std::map<std::pair<LogicalRegion,LayoutConstraintID>,
+                   PhysicalManager*>::const_iterator finder = 
+            recent_hits.find(std::pair<LogicalRegion,LayoutConstraintID>(
+                                          regions[0], constraints->layout_id));
+          if (finder != recent_hits.end())
+          {
+            std::map<PhysicalManager*,InstanceInfo>::const_iterator 
+              state_finder = current_instances.find(finder->second);
+#ifdef DEBUG_LEGION
+            assert(state_finder != current_instances.end());
+#endif
+            if (state_finder->second.current_state != ACTIVE_COLLECTED_STATE)
+            {
+              recent = finder->second;
+              candidates.push_back(recent);
+            }
+          }
         }
+        find_region_candidates(regions, ancestors, 
+                               false/*valid only*/, candidates);
       }
       // If we have any candidates check their constraints
       if (!candidates.empty())
@@ -3754,6 +4019,8 @@ namespace Legion {
                 continue;
             }
             // If we make it here, we succeeded
+            if ((*it) != recent)
+              record_recent_hit(regions, constraints->layout_id, *it);
             result = MappingInstance(*it);
             return true;
           }
@@ -3771,19 +4038,15 @@ namespace Legion {
                                 bool acquire, bool tight_bounds, bool remote)
     //--------------------------------------------------------------------------
     {
+      std::vector<LogicalRegion> ancestors;
+      find_ancestor_regions(regions, ancestors);
       // Hold the lock while iterating here
       {
+        std::deque<PhysicalManager*> region_candidates;
         AutoLock m_lock(manager_lock, 1, false/*exclusive*/);
-        for (std::map<PhysicalManager*,InstanceInfo>::const_iterator it = 
-              current_instances.begin(); it != current_instances.end(); it++)
-        {
-          // Skip it if has already been collected
-          if (it->second.current_state == ACTIVE_COLLECTED_STATE)
-            continue;
-          if (!it->first->meets_region_tree(regions))
-            continue;
-          candidates.insert(it->first);
-        }
+        find_region_candidates(regions, ancestors, 
+                               false/*valid only*/, region_candidates);
+        candidates.insert(region_candidates.begin(), region_candidates.end());
       }
       // If we have any candidates check their constraints
       if (!candidates.empty())
@@ -3821,19 +4084,15 @@ namespace Legion {
                                   bool acquire, bool tight_bounds, bool remote)
     //--------------------------------------------------------------------------
     {
+      std::vector<LogicalRegion> ancestors;
+      find_ancestor_regions(regions, ancestors);
       // Hold the lock while iterating here
       {
+        std::deque<PhysicalManager*> region_candidates;
         AutoLock m_lock(manager_lock, 1, false/*exclusive*/);
-        for (std::map<PhysicalManager*,InstanceInfo>::const_iterator it = 
-              current_instances.begin(); it != current_instances.end(); it++)
-        {
-          // Skip it if has already been collected
-          if (it->second.current_state == ACTIVE_COLLECTED_STATE)
-            continue;
-          if (!it->first->meets_region_tree(regions))
-            continue;
-          candidates.insert(it->first);
-        }
+        find_region_candidates(regions, ancestors, 
+                               false/*valid only*/, region_candidates);
+        candidates.insert(region_candidates.begin(), region_candidates.end());
       }
       // If we have any candidates check their constraints
       if (!candidates.empty())
@@ -3872,18 +4131,14 @@ namespace Legion {
                                      bool tight_region_bounds, bool remote)
     //--------------------------------------------------------------------------
     {
+      std::vector<LogicalRegion> ancestors;
+      find_ancestor_regions(regions, ancestors);
       // Hold the lock while iterating here
       std::deque<PhysicalManager*> candidates;
       {
         AutoLock m_lock(manager_lock, 1, false/*exclusive*/);
-        for (std::map<PhysicalManager*,InstanceInfo>::const_iterator it = 
-              current_instances.begin(); it != current_instances.end(); it++)
-        {
-          // Only consider ones that are currently valid
-          if (it->second.current_state != VALID_STATE)
-            continue;
-          candidates.push_back(it->first);
-        }
+        find_region_candidates(regions, ancestors, 
+                               true/*valid only*/, candidates);
       }
       // If we have any candidates check their constraints
       if (!candidates.empty())
@@ -3921,18 +4176,38 @@ namespace Legion {
                                      bool tight_region_bounds, bool remote)
     //--------------------------------------------------------------------------
     {
+      std::vector<LogicalRegion> ancestors;
+      find_ancestor_regions(regions, ancestors);
       // Hold the lock while iterating here
       std::deque<PhysicalManager*> candidates;
+      PhysicalManager *recent = NULL;
       {
         AutoLock m_lock(manager_lock, 1, false/*exclusive*/);
-        for (std::map<PhysicalManager*,InstanceInfo>::const_iterator it = 
-              current_instances.begin(); it != current_instances.end(); it++)
+        // Try the last instance that satisfied these constraints first,
+        // it will show up again below but only gets checked twice if
+        // it no longer satisfies the constraints
+        if (!regions.empty())
         {
-          // Only consider ones that are currently valid
-          if (it->second.current_state != VALID_STATE)
-            continue;
-          candidates.push_back(it->first);
+          std::map<std::pair<LogicalRegion,LayoutConstraintID>,
+                   PhysicalManager*>::const_iterator finder = 
+            recent_hits.find(std::pair<LogicalRegion,LayoutConstraintID>(
+                                          regions[0], constraints->layout_id));
+          if (finder != recent_hits.end())
+          {
+            std::map<PhysicalManager*,InstanceInfo>::const_iterator 
+              state_finder = current_instances.find(finder->second);
+#ifdef DEBUG_LEGION
+            assert(state_finder != current_instances.end());
+#endif
+            if (state_finder->second.current_state == VALID_STATE)
+            {
+              recent = finder->second;
+              candidates.push_back(recent);
+            }
+          }
         }
+        find_region_candidates(regions, ancestors, 
+                               true/*valid only*/, candidates);
       }
       // If we have any candidates check their constraints
       if (!candidates.empty())
@@ -3954,6 +4229,8 @@ namespace Legion {
                 continue;
             }
             // If we make it here, we succeeded
+            if ((*it) != recent)
+              record_recent_hit(regions, constraints->layout_id, *it);
             result = MappingInstance(*it);
             return true;
           }
@@ -3963,138 +4240,25 @@ namespace Legion {
     }
 
     //--------------------------------------------------------------------------
-    template<bool SMALLER>
-    MemoryManager::CollectableInfo<SMALLER>::CollectableInfo(PhysicalManager *m,
-                                                      size_t size, GCPriority p)
-      : manager(m), instance_size(size), priority(p)
+    bool MemoryManager::EvictionKey::operator<(const EvictionKey &rhs) const
     //--------------------------------------------------------------------------
     {
-      if (manager != NULL)
-        manager->add_base_resource_ref(MEMORY_MANAGER_REF);
-    }
-
-    //--------------------------------------------------------------------------
-    template<bool SMALLER>
-    MemoryManager::CollectableInfo<SMALLER>::CollectableInfo(
-                                                    const CollectableInfo &rhs)
-      : manager(rhs.manager), instance_size(rhs.instance_size), 
-        priority(rhs.priority)
-    //--------------------------------------------------------------------------
-    {
-      if (manager != NULL)
-        manager->add_base_resource_ref(MEMORY_MANAGER_REF);
-    }
-
-    //--------------------------------------------------------------------------
-    template<bool SMALLER>
-    MemoryManager::CollectableInfo<SMALLER>::~CollectableInfo(void)
-    //--------------------------------------------------------------------------
-    {
-      if ((manager != NULL) && 
-          manager->remove_base_resource_ref(MEMORY_MANAGER_REF))
-        PhysicalManager::delete_physical_manager(manager);
-    }
-
-    //--------------------------------------------------------------------------
-    template<bool SMALLER>
-    MemoryManager::CollectableInfo<SMALLER>& 
-      MemoryManager::CollectableInfo<SMALLER>::operator=(
-                                                     const CollectableInfo &rhs)
-    //--------------------------------------------------------------------------
-    {
-      if ((manager != NULL) && 
-          manager->remove_base_resource_ref(MEMORY_MANAGER_REF))
-        PhysicalManager::delete_physical_manager(manager);
-      manager = rhs.manager;
-      instance_size = rhs.instance_size;
-      priority = rhs.priority;
-      if (manager != NULL)
-        manager->add_base_resource_ref(MEMORY_MANAGER_REF);
-      return *this;
-    }
-
-    //--------------------------------------------------------------------------
-    template<bool SMALLER>
-    bool MemoryManager::CollectableInfo<SMALLER>::operator<(
-                                               const CollectableInfo &rhs) const
-    //--------------------------------------------------------------------------
-    {
-      if (SMALLER)
-      {
-        // For smaller, we want largest instances first, then largest priorities
-        if (instance_size > rhs.instance_size)
-          return true;
-        else if (instance_size < rhs.instance_size)
-          return false;
-        else
-        {
-          if (priority > rhs.priority)
-            return true;
-          else if (priority < rhs.priority)
-            return false;
-          else
-          {
-            if (((unsigned long)manager) < ((unsigned long)rhs.manager))
-              return true;
-            return false;
-          }
-        }
-      }
-      else
-      {
-        // For larger, we want smallest sizes first, then largest priorities
-        if (instance_size < rhs.instance_size)
-          return true;
-        else if (instance_size > rhs.instance_size)
-          return false;
-        else
-        {
-          if (priority > rhs.priority)
-            return true;
-          else if (priority < rhs.priority)
-            return false;
-          else
-          {
-            if (((unsigned long)manager) < ((unsigned long)rhs.manager))
-              return true;
-            return false;
-          }
-        }
-      }
-    }
-
-    //--------------------------------------------------------------------------
-    template<bool SMALLER>
-    bool MemoryManager::CollectableInfo<SMALLER>::operator==(
-                                               const CollectableInfo &rhs) const
-    //--------------------------------------------------------------------------
-    {
-      if ((((unsigned long)manager) == ((unsigned long)rhs.manager)) &&
-          (instance_size == rhs.instance_size) && (priority == rhs.priority))
+      // Largest priorities first
+      if (priority > rhs.priority)
         return true;
-      return false;
-    }
-
-    //--------------------------------------------------------------------------
-    void MemoryManager::find_instances_by_state(size_t needed_size, 
-                                                InstanceState state,
-                std::set<CollectableInfo<true> > &smaller_instances,
-                std::set<CollectableInfo<false> > &larger_instances) const
-    //--------------------------------------------------------------------------
-    {
-      AutoLock m_lock(manager_lock,1,false/*exclusive*/);
-      for (std::map<PhysicalManager*,InstanceInfo>::const_iterator it = 
-            current_instances.begin(); it != current_instances.end(); it++)
-      {
-        if (it->second.current_state != state)
-          continue;
-        if (it->second.instance_size >= needed_size)
-          larger_instances.insert(CollectableInfo<false>(it->first,
-                it->second.instance_size, it->second.min_priority));
-        else
-          smaller_instances.insert(CollectableInfo<true>(it->first,
-                it->second.instance_size, it->second.min_priority));
-      }
+      else if (priority < rhs.priority)
+        return false;
+      // Then least recently used
+      if (last_use < rhs.last_use)
+        return true;
+      else if (last_use > rhs.last_use)
+        return false;
+      // Then largest sizes
+      if (instance_size > rhs.instance_size)
+        return true;
+      else if (instance_size < rhs.instance_size)
+        return false;
+      return (((unsigned long)manager) < ((unsigned long)rhs.manager));
     }
 
     //--------------------------------------------------------------------------
@@ -4113,56 +4277,34 @@ namespace Legion {
                               builder.create_physical_instance(runtime->forest);
       if (manager != NULL)
         return manager;
-      // If that didn't work find the set of immediately collectable regions
-      // Rank them by size and then by GC priority
-      // Start with all the ones larger than given size and try to 
-      // delete them starting from the smallest size and highest priority
-      // If that didnt' work try to delete enough from the small set to 
-      // open up space.
+      // If that didn't work walk the eviction index of immediately 
+      // collectable instances, first the ones at least as large as the
+      // needed size starting from the smallest size class, then the smaller
+      // ones starting from the largest size class until enough contiguous
+      // space has been freed. Within a size class instances are ranked by
+      // GC priority and then by how recently they were used.
       const size_t needed_size = builder.compute_needed_size(runtime->forest);
-      std::set<CollectableInfo<true> > smaller_instances;
-      std::set<CollectableInfo<false> > larger_instances;
-      find_instances_by_state(needed_size, COLLECTABLE_STATE,
-                              smaller_instances, larger_instances);
       size_t total_bytes_deleted = 0;
-      if (!larger_instances.empty())
-      {
-        PhysicalManager *result = 
-          delete_and_allocate<false>(builder, needed_size,
-                                     total_bytes_deleted, larger_instances);
-        if (result != NULL)
-          return result;
-        larger_instances.clear();
-      }
-      if (!smaller_instances.empty())
-      {
-        PhysicalManager *result = 
-          delete_and_allocate<true>(builder, needed_size, 
-                                    total_bytes_deleted, smaller_instances);
-        if (result != NULL)
-          return result;
-        smaller_instances.clear();
-      }
+      manager = evict_and_allocate(builder, COLLECTABLE_STATE, true/*larger*/,
+                                   needed_size, total_bytes_deleted);
+      if (manager != NULL)
+        return manager;
+      manager = evict_and_allocate(builder, COLLECTABLE_STATE, false/*larger*/,
+                                   needed_size, total_bytes_deleted);
+      if (manager != NULL)
+        return manager;
       // If we still haven't been able to allocate the region do the same
       // thing as above except with the active regions and deferred deletions
-      find_instances_by_state(needed_size, ACTIVE_STATE, 
-                              smaller_instances, larger_instances);
-      if (!larger_instances.empty())
-      {
-        PhysicalManager *result = 
-          delete_and_allocate<false>(builder, needed_size,
-                                     total_bytes_deleted, larger_instances);
-        if (result != NULL)
-          return result;
-      }
-      if (!smaller_instances.empty())
-      {
-        PhysicalManager *result = 
-          delete_and_allocate<true>(builder, needed_size,
-                                    total_bytes_deleted, smaller_instances);
-        if (result != NULL)
-          return result;
-      }
+      manager = evict_and_allocate(builder, ACTIVE_STATE, true/*larger*/,
+                                   needed_size, total_bytes_deleted);
+      if (manager != NULL)
+        return manager;
+      manager = evict_and_allocate(builder, ACTIVE_STATE, false/*larger*/,
+                                   needed_size, total_bytes_deleted);
+      if (manager != NULL)
+        return manager;
+      if (runtime->profiler != NULL)
+        runtime->profiler->record_alloc_failure(memory, needed_size);
       // If we made it here well then we failed 
       return NULL;
     }
@@ -4188,35 +4330,36 @@ namespace Legion {
       // Since we're going to put this in the table add a reference
       if (is_owner)
         manager->add_base_resource_ref(MEMORY_MANAGER_REF);
+      std::vector<LogicalRegion> ancestors;
+      find_ancestor_regions(regions, ancestors);
       std::deque<PhysicalManager*> candidates;
       {
         AutoLock m_lock(manager_lock);
         // Find our candidates
-        for (std::map<PhysicalManager*,InstanceInfo>::const_iterator it = 
-              current_instances.begin(); it != current_instances.end(); it++)
+        std::deque<PhysicalManager*> region_candidates;
+        find_region_candidates(regions, ancestors, 
+                               false/*valid only*/, region_candidates);
+        for (std::deque<PhysicalManager*>::const_iterator it = 
+              region_candidates.begin(); it != region_candidates.end(); it++)
         {
-          // Skip it if has already been collected
-          if (it->second.current_state == ACTIVE_COLLECTED_STATE)
-            continue;
-          // Check if the region trees are the same
-          if (!it->first->meets_region_tree(regions))
-            continue;
           // If we already considered it we don't have to do it again
-          if (previous_cands.find(it->first) != previous_cands.end())
+          if (previous_cands.find(*it) != previous_cands.end())
             continue;
-          candidates.push_back(it->first);
+          candidates.push_back(*it);
         }
         // Now add our instance
 #ifdef DEBUG_LEGION
         assert(current_instances.find(manager) == current_instances.end());
 #endif
         InstanceInfo &info = current_instances[manager];
+        add_instance_index(manager);
         if (early_valid)
           info.current_state = VALID_STATE;
         info.min_priority = priority;
         info.instance_size = instance_size;
         info.mapper_priorities[
           std::pair<MapperID,Processor>(mapper_id,proc)] = priority;
+        update_eviction_index(manager, info, true/*used*/);
       }
       // Now see if we can find a matching candidate
       if (!candidates.empty())
@@ -4249,6 +4392,7 @@ namespace Legion {
               finder->second.min_priority = 0;
               finder->second.mapper_priorities[
                 std::pair<MapperID,Processor>(mapper_id,proc)] = 0;
+              update_eviction_index(manager, finder->second);
             }
             return (*it);
           }
@@ -4291,35 +4435,36 @@ namespace Legion {
       // Since we're going to put this in the table add a reference
       if (is_owner)
         manager->add_base_resource_ref(MEMORY_MANAGER_REF);
+      std::vector<LogicalRegion> ancestors;
+      find_ancestor_regions(regions, ancestors);
       std::deque<PhysicalManager*> candidates;
       {
         AutoLock m_lock(manager_lock);
         // Find our candidates
-        for (std::map<PhysicalManager*,InstanceInfo>::const_iterator it = 
-              current_instances.begin(); it != current_instances.end(); it++)
+        std::deque<PhysicalManager*> region_candidates;
+        find_region_candidates(regions, ancestors, 
+                               false/*valid only*/, region_candidates);
+        for (std::deque<PhysicalManager*>::const_iterator it = 
+              region_candidates.begin(); it != region_candidates.end(); it++)
         {
-          // Skip it if has already been collected
-          if (it->second.current_state == ACTIVE_COLLECTED_STATE)
-            continue;
-          // Check if the region trees are the same
-          if (!it->first->meets_region_tree(regions))
-            continue;
           // If we already considered it we don't have to do it again
-          if (previous_cands.find(it->first) != previous_cands.end())
+          if (previous_cands.find(*it) != previous_cands.end())
             continue;
-          candidates.push_back(it->first);
+          candidates.push_back(*it);
         }
         // Now add our instance
 #ifdef DEBUG_LEGION
         assert(current_instances.find(manager) == current_instances.end());
 #endif
         InstanceInfo &info = current_instances[manager];
+        add_instance_index(manager);
         if (early_valid)
           info.current_state = VALID_STATE;
         info.min_priority = priority;
         info.instance_size = instance_size;
         info.mapper_priorities[
           std::pair<MapperID,Processor>(mapper_id,proc)] = priority;
+        update_eviction_index(manager, info, true/*used*/);
       }
       // Now see if we can find a matching candidate
       if (!candidates.empty())
@@ -4352,6 +4497,7 @@ namespace Legion {
               finder->second.min_priority = 0;
               finder->second.mapper_priorities[
                 std::pair<MapperID,Processor>(mapper_id,proc)] = 0;
+              update_eviction_index(manager, finder->second);
             }
             return (*it);
           }
@@ -4395,12 +4541,14 @@ namespace Legion {
         assert(current_instances.find(manager) == current_instances.end());
 #endif
         InstanceInfo &info = current_instances[manager];
+        add_instance_index(manager);
         if (early_valid)
           info.current_state = VALID_STATE;
         info.min_priority = priority;
         info.instance_size = instance_size;
         info.mapper_priorities[
           std::pair<MapperID,Processor>(mapper_id,p)] = priority;
+        update_eviction_index(manager, info, true/*used*/);
       }
       // Now we can add any references that we need to
       if (acquire)
@@ -4437,13 +4585,16 @@ namespace Legion {
           finder->second.current_state = ACTIVE_COLLECTED_STATE;
           finder->second.deferred_collect = Runtime::create_rt_user_event();
           deletion_precondition = finder->second.deferred_collect;
+          remove_eviction_index(finder->second);
         }
         else
         {
 #ifdef DEBUG_LEGION
           assert(finder->second.current_state == COLLECTABLE_STATE);
 #endif
+          remove_eviction_index(finder->second);
           current_instances.erase(finder);
+          remove_instance_index(manager);
           if (is_owner)
             remove_reference = true;
         }
@@ -4455,33 +4606,295 @@ namespace Legion {
     }
 
     //--------------------------------------------------------------------------
-    template<bool SMALLER>
-    PhysicalManager* MemoryManager::delete_and_allocate(
-                                InstanceBuilder &builder, size_t needed_size, 
-                                size_t &total_bytes_deleted,
-                          const std::set<CollectableInfo<SMALLER> > &instances)
+    void MemoryManager::add_instance_index(PhysicalManager *manager)
+    //--------------------------------------------------------------------------
+    {
+      const LogicalRegion handle = manager->region_node->handle;
+      tree_instances[handle.get_tree_id()].insert(manager);
+      region_instances[handle].insert(manager);
+    }
+
+    //--------------------------------------------------------------------------
+    void MemoryManager::remove_instance_index(PhysicalManager *manager)
+    //--------------------------------------------------------------------------
+    {
+      const LogicalRegion handle = manager->region_node->handle;
+      std::map<RegionTreeID,std::set<PhysicalManager*> >::iterator 
+        tree_finder = tree_instances.find(handle.get_tree_id());
+#ifdef DEBUG_LEGION
+      assert(tree_finder != tree_instances.end());
+#endif
+      tree_finder->second.erase(manager);
+      if (tree_finder->second.empty())
+        tree_instances.erase(tree_finder);
+      std::map<LogicalRegion,std::set<PhysicalManager*> >::iterator
+        region_finder = region_instances.find(handle);
+#ifdef DEBUG_LEGION
+      assert(region_finder != region_instances.end());
+#endif
+      region_finder->second.erase(manager);
+      if (region_finder->second.empty())
+        region_instances.erase(region_finder);
+      // Don't leave any dangling pointers in the recent hits
+      std::map<std::pair<LogicalRegion,LayoutConstraintID>,
+               PhysicalManager*>::iterator it = recent_hits.begin();
+      while (it != recent_hits.end())
+      {
+        if (it->second == manager)
+        {
+          std::map<std::pair<LogicalRegion,LayoutConstraintID>,
+                   PhysicalManager*>::iterator to_delete = it++;
+          recent_hits.erase(to_delete);
+        }
+        else
+          it++;
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    void MemoryManager::find_ancestor_regions(
+                                      const std::vector<LogicalRegion> &regions,
+                                      std::vector<LogicalRegion> &ancestors) const
+    //--------------------------------------------------------------------------
+    {
+      if (regions.empty())
+        return;
+      // Any instance that meets all the regions must have been made 
+      // for an ancestor of the first one, so start with the closest
+      RegionNode *node = runtime->forest->get_node(regions[0]);
+      while (node != NULL)
+      {
+        ancestors.push_back(node->handle);
+        if (node->parent == NULL)
+          break;
+        node = node->parent->parent;
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    void MemoryManager::find_region_candidates(
+                                  const std::vector<LogicalRegion> &regions,
+                                  const std::vector<LogicalRegion> &ancestors,
+                                  bool valid_only,
+                                  std::deque<PhysicalManager*> &cands) const
+    //--------------------------------------------------------------------------
+    {
+      // No regions means anything can match so we have to look at them all
+      if (regions.empty())
+      {
+        for (std::map<PhysicalManager*,InstanceInfo>::const_iterator it = 
+              current_instances.begin(); it != current_instances.end(); it++)
+        {
+          if (valid_only ? (it->second.current_state != VALID_STATE) :
+              (it->second.current_state == ACTIVE_COLLECTED_STATE))
+            continue;
+          cands.push_back(it->first);
+        }
+        return;
+      }
+      for (std::vector<LogicalRegion>::const_iterator it = 
+            ancestors.begin(); it != ancestors.end(); it++)
+      {
+        std::map<LogicalRegion,std::set<PhysicalManager*> >::const_iterator
+          finder = region_instances.find(*it);
+        if (finder == region_instances.end())
+          continue;
+        for (std::set<PhysicalManager*>::const_iterator mit = 
+              finder->second.begin(); mit != finder->second.end(); mit++)
+        {
+          std::map<PhysicalManager*,InstanceInfo>::const_iterator info = 
+            current_instances.find(*mit);
+#ifdef DEBUG_LEGION
+          assert(info != current_instances.end());
+#endif
+          if (valid_only ? (info->second.current_state != VALID_STATE) :
+              (info->second.current_state == ACTIVE_COLLECTED_STATE))
+            continue;
+          cands.push_back(*mit);
+        }
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    void MemoryManager::record_recent_hit(
+                                      const std::vector<LogicalRegion> &regions,
+                                      LayoutConstraintID layout_id,
+                                      PhysicalManager *manager)
     //--------------------------------------------------------------------------
     {
-      for (typename std::set<CollectableInfo<SMALLER> >::const_iterator it = 
-            instances.begin(); it != instances.end(); it++)
+      if (regions.empty())
+        return;
+      AutoLock m_lock(manager_lock);
+      // Make sure it wasn't deleted while we weren't holding the lock
+      if (current_instances.find(manager) == current_instances.end())
+        return;
+      recent_hits[std::pair<LogicalRegion,LayoutConstraintID>(regions[0],
+                                                          layout_id)] = manager;
+    }
+
+    //--------------------------------------------------------------------------
+    void MemoryManager::update_eviction_index(PhysicalManager *manager,
+                                              InstanceInfo &info, bool used)
+    //--------------------------------------------------------------------------
+    {
+      // Only the owner ever does evictions
+      if (!is_owner)
+        return;
+      if (used)
+        info.last_use = ++use_clock;
+      const bool evictable = (info.min_priority != GC_NEVER_PRIORITY) &&
+        ((info.current_state == COLLECTABLE_STATE) || 
+         (info.current_state == ACTIVE_STATE));
+      if (info.indexed)
+      {
+        // See if we are already in the right place
+        if (evictable && (info.indexed_state == info.current_state) &&
+            (info.eviction_key.priority == info.min_priority) &&
+            (info.eviction_key.last_use == info.last_use) &&
+            (info.eviction_key.instance_size == info.instance_size))
+          return;
+        remove_eviction_index(info);
+      }
+      if (!evictable)
+        return;
+      info.eviction_key = EvictionKey(info.min_priority, info.last_use,
+                                      info.instance_size, manager);
+      info.indexed_state = info.current_state;
+      info.indexed = true;
+      eviction_index[info.indexed_state][
+        compute_size_class(info.instance_size)].insert(info.eviction_key);
+    }
+
+    //--------------------------------------------------------------------------
+    void MemoryManager::remove_eviction_index(InstanceInfo &info)
+    //--------------------------------------------------------------------------
+    {
+      if (!info.indexed)
+        return;
+      std::map<unsigned,std::set<EvictionKey> > &index = 
+        eviction_index[info.indexed_state];
+      std::map<unsigned,std::set<EvictionKey> >::iterator finder = 
+        index.find(compute_size_class(info.eviction_key.instance_size));
+#ifdef DEBUG_LEGION
+      assert(finder != index.end());
+      assert(finder->second.find(info.eviction_key) != finder->second.end());
+#endif
+      finder->second.erase(info.eviction_key);
+      if (finder->second.empty())
+        index.erase(finder);
+      info.indexed = false;
+    }
+
+    //--------------------------------------------------------------------------
+    /*static*/ unsigned MemoryManager::compute_size_class(size_t size)
+    //--------------------------------------------------------------------------
+    {
+      unsigned result = 0;
+      while (size > 1)
       {
-        PhysicalManager *target_manager = it->manager;
-        if (target_manager->try_active_deletion())
+        size >>= 1;
+        result++;
+      }
+      return result;
+    }
+
+    //--------------------------------------------------------------------------
+    PhysicalManager* MemoryManager::evict_and_allocate(
+                                InstanceBuilder &builder, InstanceState state,
+                                bool larger, size_t needed_size, 
+                                size_t &total_bytes_deleted)
+    //--------------------------------------------------------------------------
+    {
+#ifdef DEBUG_LEGION
+      assert((state == COLLECTABLE_STATE) || (state == ACTIVE_STATE));
+#endif
+      const std::map<unsigned,std::set<EvictionKey> > &index = 
+                                                      eviction_index[state];
+      // Cursor into the index so that each step only has to look at the 
+      // candidates after the last one that we tried, the index can change
+      // while we are deleting so we always pick up from the cursor again
+      unsigned size_class = compute_size_class(needed_size);
+      EvictionKey cursor;
+      bool has_cursor = false;
+      while (true)
+      {
+        EvictionKey next;
         {
-          record_deleted_instance(target_manager);
-          total_bytes_deleted += it->instance_size;
-          // Only need to do the test if we're smaller
-          if (!SMALLER || (total_bytes_deleted >= needed_size))
+          AutoLock m_lock(manager_lock,1,false/*exclusive*/);
+          while (next.manager == NULL)
           {
-            PhysicalManager *manager = 
-              builder.create_physical_instance(runtime->forest);
-            // If we succeeded we are done
-            if (manager != NULL)
-              return manager;
+            std::map<unsigned,std::set<EvictionKey> >::const_iterator 
+              class_finder;
+            if (larger)
+            {
+              class_finder = index.lower_bound(size_class);
+              if (class_finder == index.end())
+                break;
+            }
+            else
+            {
+              class_finder = index.upper_bound(size_class);
+              if (class_finder == index.begin())
+                break;
+              class_finder--;
+            }
+            if (class_finder->first != size_class)
+            {
+              size_class = class_finder->first;
+              has_cursor = false;
+            }
+            const std::set<EvictionKey> &keys = class_finder->second;
+            for (std::set<EvictionKey>::const_iterator it = has_cursor ? 
+                  keys.upper_bound(cursor) : keys.begin(); 
+                  it != keys.end(); it++)
+            {
+              // The size class of the needed size holds both kinds
+              if (larger != (it->instance_size >= needed_size))
+                continue;
+              next = *it;
+              break;
+            }
+            if (next.manager != NULL)
+              break;
+            // Move on to the next size class
+            if (larger)
+              size_class++;
+            else if (size_class == 0)
+              break;
+            else
+              size_class--;
+            has_cursor = false;
           }
+          // Hold a reference while we try to delete it
+          if (next.manager != NULL)
+            next.manager->add_base_resource_ref(MEMORY_MANAGER_REF);
+        }
+        if (next.manager == NULL)
+          return NULL;
+        cursor = next;
+        has_cursor = true;
+        PhysicalManager *result = NULL;
+        if (next.manager->try_active_deletion())
+        {
+          record_deleted_instance(next.manager);
+          total_bytes_deleted += next.instance_size;
+          if (runtime->profiler != NULL)
+            runtime->profiler->record_eviction(memory, next.instance_size);
+          // Only try to allocate once there is a contiguous block that
+          // is big enough. Memories that don't track their free blocks
+          // report their whole capacity, so for those we fall back to
+          // waiting until the deleted instances add up to the needed size
+          const size_t largest_free = memory.largest_free_block();
+          if ((largest_free >= needed_size) && (larger || 
+                (largest_free < capacity) || 
+                (total_bytes_deleted >= needed_size)))
+            result = builder.create_physical_instance(runtime->forest);
         }
+        if (next.manager->remove_base_resource_ref(MEMORY_MANAGER_REF))
+          PhysicalManager::delete_physical_manager(next.manager);
+        if (result != NULL)
+          return result;
       }
-      return NULL;
     }
 
     /////////////////////////////////////////////////////////////
@@ -4968,6 +5381,11 @@ namespace Legion {
               runtime->handle_did_remote_resource_update(derez);
               break;
             }
+          case DISTRIBUTED_BATCH_UPDATE:
+            {
+              runtime->handle_did_remote_batch_update(derez);
+              break;
+            }
           case DISTRIBUTED_CREATE_ADD:
             {
               runtime->handle_did_create_add(derez);
@@ -5369,7 +5787,8 @@ namespace Legion {
     MessageManager::MessageManager(AddressSpaceID remote,
                                    Runtime *rt, size_t max_message_size,
                                    const std::set<Processor> &remote_util_procs)
-      : remote_address_space(remote), runtime(rt), channels((VirtualChannel*)
+      : remote_address_space(remote), reference_removals_pending(false),
+        runtime(rt), channels((VirtualChannel*)
                       malloc(MAX_NUM_VIRTUAL_CHANNELS*sizeof(VirtualChannel))) 
     //--------------------------------------------------------------------------
     {
@@ -5409,7 +5828,8 @@ namespace Legion {
 
     //--------------------------------------------------------------------------
     MessageManager::MessageManager(const MessageManager &rhs)
-      : remote_address_space(0), runtime(NULL), channels(NULL)
+      : remote_address_space(0), reference_removals_pending(false),
+        runtime(NULL), channels(NULL)
     //--------------------------------------------------------------------------
     {
       // should never be called
@@ -5441,6 +5861,13 @@ namespace Legion {
                                       VirtualChannelKind channel, bool flush)
     //--------------------------------------------------------------------------
     {
+      // Buffered reference removals have to go out first so that this
+      // message can't overtake them (e.g. an unregistration), they always
+      // travel on the default channel with all the other distributed
+      // collectable messages so they stay ordered with this message
+      if (reference_removals_pending && (channel == DEFAULT_VIRTUAL_CHANNEL) &&
+          (kind != DISTRIBUTED_BATCH_UPDATE))
+        runtime->flush_remote_reference_updates(remote_address_space);
       channels[channel].package_message(rez, kind, flush, runtime, target);
     }
 
@@ -7165,6 +7592,8 @@ namespace Legion {
         distributed_id_lock(Reservation::create_reservation()),
         unique_distributed_id((unique == 0) ? runtime_stride : unique),
         distributed_collectable_lock(Reservation::create_reservation()),
+        reference_batch_lock(Reservation::create_reservation()),
+        reference_flush_pending(false),
         gc_epoch_lock(Reservation::create_reservation()), gc_epoch_counter(0),
         context_lock(Reservation::create_reservation()),
         random_lock(Reservation::create_reservation()),
@@ -7671,6 +8100,8 @@ namespace Legion {
       distributed_id_lock = Reservation::NO_RESERVATION;
       distributed_collectable_lock.destroy_reservation();
       distributed_collectable_lock = Reservation::NO_RESERVATION;
+      reference_batch_lock.destroy_reservation();
+      reference_batch_lock = Reservation::NO_RESERVATION;
       gc_epoch_lock.destroy_reservation();
       gc_epoch_lock = Reservation::NO_RESERVATION;
       context_lock.destroy_reservation();
@@ -7771,7 +8202,7 @@ namespace Legion {
       HLR_TASK_DESCRIPTIONS(hlr_task_descriptions);
       profiler = new LegionProfiler((local_utils.empty() ? 
                                     Processor::NO_PROC : utility_group), 
-                                    machine, HLR_LAST_TASK_ID,
+                                    address_space, machine, HLR_LAST_TASK_ID,
                                     hlr_task_descriptions, 
                                     Operation::LAST_OP_KIND, 
                                     Operation::op_names); 
@@ -14486,6 +14917,15 @@ namespace Legion {
                                     DEFAULT_VIRTUAL_CHANNEL, true/*flush*/);
     }
 
+    //--------------------------------------------------------------------------
+    void Runtime::send_did_remote_batch_update(AddressSpaceID target,
+                                               Serializer &rez, bool flush)
+    //--------------------------------------------------------------------------
+    {
+      find_messenger(target)->send_message(rez, DISTRIBUTED_BATCH_UPDATE,
+                                           DEFAULT_VIRTUAL_CHANNEL, flush);
+    }
+
     //--------------------------------------------------------------------------
     void Runtime::send_did_add_create_reference(AddressSpaceID target,
                                                  Serializer &rez)
@@ -15361,6 +15801,13 @@ namespace Legion {
       DistributedCollectable::handle_did_remote_resource_update(this, derez); 
     }
 
+    //--------------------------------------------------------------------------
+    void Runtime::handle_did_remote_batch_update(Deserializer &derez)
+    //--------------------------------------------------------------------------
+    {
+      DistributedCollectable::handle_did_remote_batch_update(this, derez);
+    }
+
     //--------------------------------------------------------------------------
     void Runtime::handle_did_create_add(Deserializer &derez)
     //--------------------------------------------------------------------------
@@ -16332,6 +16779,28 @@ namespace Legion {
                                     precondition, priority));
     } 
 
+    //--------------------------------------------------------------------------
+    void Runtime::defer_meta_task_completion(RtEvent wait_on,
+                                             HLRPriority priority)
+    //--------------------------------------------------------------------------
+    {
+      // The continuation counts as an outstanding meta-task just like
+      // one issued with issue_runtime_meta_task
+#ifdef DEBUG_LEGION
+      increment_total_outstanding_tasks(HLR_DEFERRED_WAIT_TASK_ID,true/*meta*/);
+#else
+      increment_total_outstanding_tasks();
+#endif
+#ifdef DEBUG_SHUTDOWN_HANG
+      __sync_fetch_and_add(&outstanding_counts[HLR_DEFERRED_WAIT_TASK_ID],1);
+#endif
+      DeferredWaitArgs args;
+      args.hlr_id = HLR_DEFERRED_WAIT_TASK_ID;
+      // No utility thread is tied up while we wait
+      Processor::spawn_continuation(HLR_TASK_ID, &args, sizeof(args),
+                                    wait_on, priority);
+    }
+
     //--------------------------------------------------------------------------
     DistributedID Runtime::get_available_distributed_id(bool need_cont,
                                                         bool has_lock)
@@ -16525,6 +16994,172 @@ namespace Legion {
       return false;
     }
 
+    //--------------------------------------------------------------------------
+    bool Runtime::defer_remote_reference_removal(AddressSpaceID target,
+                     DistributedID did, ReferenceKind kind, unsigned count)
+    //--------------------------------------------------------------------------
+    {
+      if (reference_batch_size == 0)
+        return false;
+      MessageManager *messenger = find_messenger(target);
+      bool launch_flush = false;
+      {
+        AutoLock b_lock(reference_batch_lock);
+        PendingReferenceRemovals &pending = pending_reference_removals[target];
+        messenger->reference_removals_pending = true;
+        // The target has to apply the removals for a did in the order
+        // that we made them, so we can only combine with the most recent
+        // removal for this did and only if it is of the same kind
+        std::map<DistributedID,int>::iterator finder = 
+          pending.last_removal.find(did);
+        if ((finder != pending.last_removal.end()) &&
+            (pending.removals[finder->second].kind == kind))
+          pending.removals[finder->second].count += count;
+        else
+        {
+          ReferenceRemoval removal;
+          removal.did = did;
+          removal.kind = kind;
+          removal.count = count;
+          removal.previous = 
+            (finder != pending.last_removal.end()) ? finder->second : -1;
+          pending.last_removal[did] = pending.removals.size();
+          pending.removals.push_back(removal);
+        }
+        if (pending.removals.size() >= reference_batch_size)
+        {
+          // Full batch so send it off right away, still holding the lock
+          // so no other message to the target can get ahead of it
+          send_remote_reference_removals(target, pending, true/*flush*/);
+          pending_reference_removals.erase(target);
+          messenger->reference_removals_pending = false;
+        }
+        else if (!reference_flush_pending)
+        {
+          // First removal of this epoch so launch the task that
+          // will flush everything that gets buffered until it runs
+          reference_flush_pending = true;
+          launch_flush = true;
+        }
+      }
+      if (launch_flush)
+      {
+        HLRTaskID hlr_id = HLR_FLUSH_REFERENCE_UPDATES_TASK_ID;
+        // Latency priority so that removals are not held up behind a
+        // long queue of other meta-tasks, anything buffered by the time
+        // it runs still goes out in the same messages
+        issue_runtime_meta_task(&hlr_id, sizeof(hlr_id), hlr_id,
+                                HLR_LATENCY_PRIORITY);
+      }
+      return true;
+    }
+
+    //--------------------------------------------------------------------------
+    bool Runtime::elide_remote_reference_add(AddressSpaceID target,
+                     DistributedID did, ReferenceKind kind, unsigned count)
+    //--------------------------------------------------------------------------
+    {
+      if (reference_batch_size == 0)
+        return false;
+      AutoLock b_lock(reference_batch_lock);
+      std::map<AddressSpaceID,PendingReferenceRemovals>::iterator 
+        target_finder = pending_reference_removals.find(target);
+      if (target_finder == pending_reference_removals.end())
+        return false;
+      PendingReferenceRemovals &pending = target_finder->second;
+      std::map<DistributedID,int>::iterator finder = 
+        pending.last_removal.find(did);
+      if (finder == pending.last_removal.end())
+        return false;
+      // Only the most recent removal for the did can be cancelled out
+      // without changing the order the target sees the others in
+      ReferenceRemoval &removal = pending.removals[finder->second];
+      if ((removal.kind != kind) || (removal.count < count))
+        return false;
+      // The target still holds the references from the removals that we
+      // haven't sent yet so we can just hand them back to the add
+      removal.count -= count;
+      if (removal.count == 0)
+      {
+        // Leave the empty entry in place (it is skipped when sending)
+        // so that the indexes of the other entries stay the same
+        if (removal.previous >= 0)
+          finder->second = removal.previous;
+        else
+          pending.last_removal.erase(finder);
+      }
+      return true;
+    }
+
+    //--------------------------------------------------------------------------
+    void Runtime::flush_remote_reference_updates(void)
+    //--------------------------------------------------------------------------
+    {
+      // Hold the lock until every batch is queued, anyone trying to
+      // send another message to one of these targets waits for it in
+      // flush_remote_reference_updates(target) below
+      AutoLock b_lock(reference_batch_lock);
+      reference_flush_pending = false;
+      for (std::map<AddressSpaceID,PendingReferenceRemovals>::const_iterator
+            it = pending_reference_removals.begin(); it != 
+            pending_reference_removals.end(); it++)
+      {
+        send_remote_reference_removals(it->first, it->second, true/*flush*/);
+        find_messenger(it->first)->reference_removals_pending = false;
+      }
+      pending_reference_removals.clear();
+    }
+
+    //--------------------------------------------------------------------------
+    void Runtime::flush_remote_reference_updates(AddressSpaceID target)
+    //--------------------------------------------------------------------------
+    {
+      // If someone else is in the middle of sending the removals then
+      // taking the lock waits for them to be queued
+      AutoLock b_lock(reference_batch_lock);
+      std::map<AddressSpaceID,PendingReferenceRemovals>::iterator finder =
+        pending_reference_removals.find(target);
+      if (finder == pending_reference_removals.end())
+        return;
+      // No need to flush the channel, the message that made us flush
+      // is about to go out on it right behind the removals
+      send_remote_reference_removals(target, finder->second, false/*flush*/);
+      pending_reference_removals.erase(finder);
+      find_messenger(target)->reference_removals_pending = false;
+    }
+
+    //--------------------------------------------------------------------------
+    void Runtime::send_remote_reference_removals(AddressSpaceID target,
+                                       const PendingReferenceRemovals &pending,
+                                       bool flush)
+    //--------------------------------------------------------------------------
+    {
+      size_t num_removals = 0;
+      for (std::vector<ReferenceRemoval>::const_iterator it = 
+            pending.removals.begin(); it != pending.removals.end(); it++)
+        if (it->count > 0)
+          num_removals++;
+      if (num_removals == 0)
+        return;
+      Serializer rez;
+      {
+        RezCheck z(rez);
+        rez.serialize(num_removals);
+        // Send them in the order they were made, the target applies
+        // them in the same order
+        for (std::vector<ReferenceRemoval>::const_iterator it = 
+              pending.removals.begin(); it != pending.removals.end(); it++)
+        {
+          if (it->count == 0)
+            continue;
+          rez.serialize(it->did);
+          rez.serialize(it->kind);
+          rez.serialize(it->count);
+        }
+      }
+      send_did_remote_batch_update(target, rez, flush);
+    }
+
     //--------------------------------------------------------------------------
     LogicalView* Runtime::find_or_request_logical_view(DistributedID did,
                                                        RtEvent &ready)
@@ -18301,6 +18936,14 @@ namespace Legion {
       return f.impl->reset_future();
     }
 
+    //--------------------------------------------------------------------------
+    void Runtime::help_set_future_result(const Future &f, const void *result,
+                                         size_t result_size)
+    //--------------------------------------------------------------------------
+    {
+      f.impl->set_result(result, result_size, false/*owner*/);
+    }
+
     //--------------------------------------------------------------------------
     unsigned Runtime::generate_random_integer(void)
     //--------------------------------------------------------------------------
@@ -19038,10 +19681,14 @@ namespace Legion {
                                       DEFAULT_MIN_TASKS_TO_SCHEDULE;
     /*static*/ unsigned Runtime::superscalar_width = 
                                       DEFAULT_SUPERSCALAR_WIDTH;
+    /*static*/ unsigned Runtime::mapping_batch_size = 
+                                      DEFAULT_MAPPING_BATCH_SIZE;
     /*static*/ unsigned Runtime::max_message_size = 
                                       DEFAULT_MAX_MESSAGE_SIZE;
     /*static*/ unsigned Runtime::gc_epoch_size = 
                                       DEFAULT_GC_EPOCH_SIZE;
+    /*static*/ unsigned Runtime::reference_batch_size = 
+                                      DEFAULT_REFERENCE_BATCH_SIZE;
     /*static*/ bool Runtime::runtime_started = false;
     /*static*/ bool Runtime::runtime_backgrounded = false;
     /*static*/ bool Runtime::separate_runtime_instances = false;
@@ -19065,6 +19712,7 @@ namespace Legion {
     /*static*/ RtUserEvent Runtime::mpi_rank_event = 
       RtUserEvent::NO_RT_USER_EVENT;
     /*static*/ bool Runtime::program_order_execution = false;
+    /*static*/ bool Runtime::concurrent_dependence_analysis = false;
 #ifdef DEBUG_LEGION
     /*static*/ bool Runtime::logging_region_tree_state = false;
     /*static*/ bool Runtime::verbose_logging = false;
@@ -19075,6 +19723,8 @@ namespace Legion {
     /*static*/ bool Runtime::bit_mask_logging = false;
 #endif
     /*static*/ unsigned Runtime::num_profiling_nodes = 0;
+    /*static*/ bool Runtime::profile_hardware_counters = false;
+    /*static*/ const char* Runtime::prof_logfile = NULL;
 
     //--------------------------------------------------------------------------
     /*static*/ int Runtime::start(int argc, char **argv, bool background)
@@ -19159,10 +19809,15 @@ namespace Legion {
         initial_task_window_hysteresis = DEFAULT_TASK_WINDOW_HYSTERESIS;
         initial_tasks_to_schedule = DEFAULT_MIN_TASKS_TO_SCHEDULE;
         superscalar_width = DEFAULT_SUPERSCALAR_WIDTH;
+        mapping_batch_size = DEFAULT_MAPPING_BATCH_SIZE;
         max_message_size = DEFAULT_MAX_MESSAGE_SIZE;
         gc_epoch_size = DEFAULT_GC_EPOCH_SIZE;
+        reference_batch_size = DEFAULT_REFERENCE_BATCH_SIZE;
         program_order_execution = false;
+        concurrent_dependence_analysis = false;
         num_profiling_nodes = 0;
+        profile_hardware_counters = false;
+        prof_logfile = NULL;
 #ifdef DEBUG_LEGION
         logging_region_tree_state = false;
         verbose_logging = false;
@@ -19184,12 +19839,15 @@ namespace Legion {
           if (!strcmp(argv[i],"-hl:safe_mapper"))
             unsafe_mapper = false;
           BOOL_ARG("-hl:inorder",program_order_execution);
+          BOOL_ARG("-hl:concurrent_analysis",concurrent_dependence_analysis);
           INT_ARG("-hl:window", initial_task_window_size);
           INT_ARG("-hl:hysteresis", initial_task_window_hysteresis);
           INT_ARG("-hl:sched", initial_tasks_to_schedule);
           INT_ARG("-hl:width", superscalar_width);
+          INT_ARG("-hl:map_batch", mapping_batch_size);
           INT_ARG("-hl:message",max_message_size);
           INT_ARG("-hl:epoch", gc_epoch_size);
+          INT_ARG("-hl:ref_batch", reference_batch_size);
           if (!strcmp(argv[i],"-hl:no_dyn"))
             dynamic_independence_tests = false;
           BOOL_ARG("-hl:spy",legion_spy_enabled);
@@ -19228,6 +19886,12 @@ namespace Legion {
           }
 #endif
           INT_ARG("-hl:prof", num_profiling_nodes);
+          BOOL_ARG("-hl:prof_hwcounters", profile_hardware_counters);
+          if (!strcmp(argv[i],"-hl:prof_logfile"))
+          {
+            prof_logfile = argv[++i];
+            continue;
+          }
         }
         if (delay_start > 0)
           sleep(delay_start);
@@ -19235,6 +19899,16 @@ namespace Legion {
 #undef BOOL_ARG
 #ifdef DEBUG_LEGION
         assert(initial_task_window_hysteresis <= 100);
+#endif
+#ifdef LEGION_SPY
+        // Legion Spy builds serialize mapping in dependence analysis order
+        if (concurrent_dependence_analysis)
+        {
+          log_run.warning("WARNING: Concurrent dependence analysis is "
+                          "not supported with Legion Spy builds and will "
+                          "be disabled.");
+          concurrent_dependence_analysis = false;
+        }
 #endif
       }
 #ifdef DEBUG_LEGION
@@ -20328,12 +21002,12 @@ namespace Legion {
             const size_t result_size = 
               future_args->task_op->check_future_size(future_args->result);
             const void *result = future_args->result->get_untyped_result();
-            for (Domain::DomainPointIterator itr(future_args->domain); 
-                  itr; itr++)
+            if (result_size > 0)
             {
-              Future f = future_args->future_map->get_future(itr.p);
-              if (result_size > 0)
-                f.impl->set_result(result, result_size, false/*own*/);
+              for (Domain::DomainPointIterator itr(future_args->domain); 
+                    itr; itr++)
+                future_args->future_map->set_point_result(itr.p, result,
+                                              result_size, false/*own*/);
             }
             future_args->future_map->complete_all_futures();
             if (future_args->future_map->remove_reference())
@@ -20449,15 +21123,29 @@ namespace Legion {
           {
             SingleTask::WindowWaitArgs *wargs = 
               (SingleTask::WindowWaitArgs*)args;
-            wargs->parent_ctx->perform_window_wait();
+            RtEvent wait_on = wargs->parent_ctx->perform_window_wait();
+            // The application task is waiting on our completion, so
+            // hold that back instead of blocking a utility processor
+            if (!wait_on.has_triggered())
+              Runtime::get_runtime(p)->defer_meta_task_completion(wait_on,
+                                                    HLR_RESOURCE_PRIORITY);
             break;
           }
         case HLR_ISSUE_FRAME_TASK_ID:
           {
             SingleTask::IssueFrameArgs *fargs = 
               (SingleTask::IssueFrameArgs*)args;
-            fargs->parent_ctx->perform_frame_issue(fargs->frame, 
-                                                   fargs->frame_termination);
+            RtEvent wait_on = fargs->parent_ctx->perform_frame_issue(
+                                  fargs->frame, fargs->frame_termination);
+            // Same as for the window wait above
+            if (!wait_on.has_triggered())
+              Runtime::get_runtime(p)->defer_meta_task_completion(wait_on,
+                                                  HLR_THROUGHPUT_PRIORITY);
+            break;
+          }
+        case HLR_DEFERRED_WAIT_TASK_ID:
+          {
+            // Nothing to do, the wait is over
             break;
           }
         case HLR_CONTINUATION_TASK_ID:
@@ -20599,6 +21287,11 @@ namespace Legion {
             SingleTask::handle_remote_view_creation(args);
             break;
           }
+        case HLR_FLUSH_REFERENCE_UPDATES_TASK_ID:
+          {
+            Runtime::get_runtime(p)->flush_remote_reference_updates();
+            break;
+          }
         case HLR_RETRY_SHUTDOWN_TASK_ID:
           {
             Runtime *runtime = Runtime::get_runtime(p);
@@ -220,6 +220,14 @@ namespace Legion {
      * another, future maps will never leave the node on
      * which they are created.  The futures contained within
      * a future map are permitted to migrate.
+     *
+     * The results of the points are stored in the future map
+     * itself rather than in one future per point. If the launch
+     * domain is a rectangle and all the points return values of
+     * the same size then the values are kept in one contiguous
+     * buffer ordered by the linearized point, otherwise they are
+     * kept in a map. Futures are only made for points that are
+     * explicitly asked for.
      */
     class FutureMapImpl : public Collectable {
     public:
@@ -238,6 +246,21 @@ namespace Legion {
       void wait_all_results(void);
       void complete_all_futures(void);
       bool reset_all_futures(void);
+    public:
+      void initialize_dense_storage(const Domain &launch_domain);
+      void set_point_result(const DomainPoint &point, const void *result,
+                            size_t result_size, bool owner);
+      void set_dense_results(const Domain &domain, const void *values,
+                             size_t value_size);
+      const void* get_all_untyped_results(size_t &value_size,
+                                          size_t &num_points);
+    protected:
+      // These must be called while holding the lock
+      void record_point_result(const DomainPoint &point, const void *result,
+                               size_t result_size, bool owner);
+      bool find_point_result(const DomainPoint &point, const void *&result,
+                             size_t &result_size) const;
+      bool linearize_point(const DomainPoint &point, size_t &index) const;
 #ifdef DEBUG_LEGION
     public:
       void add_valid_domain(const Domain &d);
@@ -252,6 +275,16 @@ namespace Legion {
     private:
       ApEvent ready_event;
       std::map<DomainPoint,Future> futures;
+      bool futures_complete;
+    private:
+      Domain dense_domain;
+      size_t dense_volume;
+      bool dense_size_known;
+      size_t dense_value_size;
+      char *dense_values;
+      std::vector<bool> dense_present;
+      size_t dense_count;
+      std::map<DomainPoint,std::pair<void*,size_t> > sparse_values;
       // Unlike futures, the future map is never used remotely
       // so it can create and destroy its own lock.
       Reservation lock;
@@ -576,36 +609,42 @@ namespace Legion {
         VALID_STATE = 3,
       };
     public:
+      // Order in which instances are considered for eviction: highest
+      // GC priority first, then least recently used, then largest
+      struct EvictionKey {
+      public:
+        EvictionKey(void)
+          : priority(0), last_use(0), instance_size(0), manager(NULL) { }
+        EvictionKey(GCPriority p, unsigned long long use, 
+                    size_t size, PhysicalManager *m)
+          : priority(p), last_use(use), instance_size(size), manager(m) { }
+      public:
+        bool operator<(const EvictionKey &rhs) const;
+      public:
+        GCPriority priority;
+        unsigned long long last_use;
+        size_t instance_size;
+        PhysicalManager *manager;
+      };
       struct InstanceInfo {
       public:
         InstanceInfo(void)
           : current_state(COLLECTABLE_STATE), 
             deferred_collect(RtUserEvent::NO_RT_USER_EVENT),
-            instance_size(0), min_priority(0) { }
+            instance_size(0), min_priority(0), last_use(0), 
+            indexed_state(COLLECTABLE_STATE), indexed(false) { }
       public:
         InstanceState current_state;
         RtUserEvent deferred_collect;
         size_t instance_size;
         GCPriority min_priority;
         std::map<std::pair<MapperID,Processor>,GCPriority> mapper_priorities;
-      };
-      template<bool SMALLER>
-      struct CollectableInfo {
-      public:
-        CollectableInfo(void)
-          : manager(NULL), instance_size(0), priority(0) { }
-        CollectableInfo(PhysicalManager *m, size_t size, GCPriority p);
-        CollectableInfo(const CollectableInfo &rhs);
-        ~CollectableInfo(void);
-      public:
-        CollectableInfo& operator=(const CollectableInfo &rhs);
-      public:
-        bool operator<(const CollectableInfo &rhs) const;
-        bool operator==(const CollectableInfo &rhs) const;
-      public:
-        PhysicalManager *manager;
-        size_t instance_size;
-        GCPriority priority;
+        // Last time this instance was activated or validated
+        unsigned long long last_use;
+        // Where the instance currently sits in the eviction index
+        EvictionKey eviction_key;
+        InstanceState indexed_state;
+        bool indexed;
       };
     public:
       MemoryManager(Memory mem, Runtime *rt);
@@ -723,13 +762,29 @@ namespace Legion {
                                     MapperID mapper_id, Processor proc,
                                     GCPriority priority, bool remote);
       void record_deleted_instance(PhysicalManager *manager); 
-      void find_instances_by_state(size_t needed_size, InstanceState state, 
-                     std::set<CollectableInfo<true> > &smaller_instances,
-                     std::set<CollectableInfo<false> > &larger_instances) const;
-      template<bool SMALLER>
-      PhysicalManager* delete_and_allocate(InstanceBuilder &builder, 
-                            size_t needed_size, size_t &total_bytes_deleted,
-                      const std::set<CollectableInfo<SMALLER> > &instances);
+    protected:
+      // Must be called while holding the manager lock
+      void add_instance_index(PhysicalManager *manager);
+      void remove_instance_index(PhysicalManager *manager);
+      void find_region_candidates(const std::vector<LogicalRegion> &regions,
+                                  const std::vector<LogicalRegion> &ancestors,
+                                  bool valid_only, 
+                                  std::deque<PhysicalManager*> &cands) const;
+      // Must be called without holding the manager lock
+      void find_ancestor_regions(const std::vector<LogicalRegion> &regions,
+                                 std::vector<LogicalRegion> &ancestors) const;
+      void record_recent_hit(const std::vector<LogicalRegion> &regions,
+                             LayoutConstraintID layout_id, 
+                             PhysicalManager *manager);
+      // Must be called while holding the manager lock
+      void update_eviction_index(PhysicalManager *manager, 
+                                 InstanceInfo &info, bool used = false);
+      void remove_eviction_index(InstanceInfo &info);
+      static unsigned compute_size_class(size_t size);
+    protected:
+      PhysicalManager* evict_and_allocate(InstanceBuilder &builder, 
+                            InstanceState state, bool larger,
+                            size_t needed_size, size_t &total_bytes_deleted);
     public:
       // The memory that we are managing
       const Memory memory;
@@ -752,6 +807,22 @@ namespace Legion {
       // It is only valid on the owner node
       LegionMap<PhysicalManager*,InstanceInfo,
                 MEMORY_INSTANCES_ALLOC>::tracked current_instances;
+      // Indexes over the current instances by region tree and by the
+      // logical region that each instance was made for, an instance can
+      // only satisfy regions that descend from its own region so lookups
+      // only need to look at the instances of the regions' ancestors
+      std::map<RegionTreeID,std::set<PhysicalManager*> > tree_instances;
+      std::map<LogicalRegion,std::set<PhysicalManager*> > region_instances;
+      // The last instance to satisfy a lookup for a region with 
+      // a registered set of layout constraints
+      std::map<std::pair<LogicalRegion,LayoutConstraintID>,
+               PhysicalManager*> recent_hits;
+      // Incrementally maintained eviction candidates on the owner node, 
+      // one index for collectable and one for active instances, each 
+      // bucketed by size class (floor of log2 of the instance size)
+      std::map<unsigned,std::set<EvictionKey> > eviction_index[2];
+      // Logical clock for tracking instance recency
+      unsigned long long use_clock;
     };
 
     /**
@@ -847,6 +918,11 @@ namespace Legion {
                             bool phase_one);
     public:
       const AddressSpaceID remote_address_space;
+      // Set while the runtime has reference removals buffered for the
+      // remote node, and only cleared once they have been queued on the
+      // default channel, they get packed ahead of any other message on
+      // that channel so that nothing that depends on them can overtake them
+      volatile bool reference_removals_pending;
     private:
       Runtime *const runtime;
       // State for sending messages
@@ -1270,6 +1346,9 @@ namespace Legion {
         SingleTask *task;
         FutureImpl *result;
       };
+      struct DeferredWaitArgs {
+        HLRTaskID hlr_id;
+      };
     public:
       struct ProcessorGroupInfo {
       public:
@@ -1896,6 +1975,8 @@ namespace Legion {
       void send_did_remote_gc_update(AddressSpaceID target, Serializer &rez);
       void send_did_remote_resource_update(AddressSpaceID target,
                                            Serializer &rez);
+      void send_did_remote_batch_update(AddressSpaceID target, 
+                                        Serializer &rez, bool flush);
       void send_did_add_create_reference(AddressSpaceID target,Serializer &rez);
       void send_did_remove_create_reference(AddressSpaceID target,
                                             Serializer &rez, bool flush = true);
@@ -2035,6 +2116,7 @@ namespace Legion {
       void handle_did_remote_valid_update(Deserializer &derez);
       void handle_did_remote_gc_update(Deserializer &derez);
       void handle_did_remote_resource_update(Deserializer &derez);
+      void handle_did_remote_batch_update(Deserializer &derez);
       void handle_did_create_add(Deserializer &derez);
       void handle_did_create_remove(Deserializer &derez);
       void handle_did_remote_unregister(Deserializer &derez);
@@ -2191,6 +2273,11 @@ namespace Legion {
                                   Operation *op = NULL,
                                   RtEvent precondition = RtEvent::NO_RT_EVENT, 
                                   Processor proc = Processor::NO_PROC); 
+      // Called from a meta-task that would otherwise block on 'wait_on':
+      // the meta-task returns instead, but its completion event does 
+      // not trigger until 'wait_on' has
+      void defer_meta_task_completion(RtEvent wait_on, 
+                                      HLRPriority hlr_priority);
     public:
       DistributedID get_available_distributed_id(bool need_cont, 
                                                  bool has_lock = false);
@@ -2207,6 +2294,37 @@ namespace Legion {
       DistributedCollectable* weak_find_distributed_collectable(
                                                            DistributedID did);
       bool find_pending_collectable_location(DistributedID did,void *&location);
+    public:
+      // Buffering of remote reference removals so that they can be
+      // sent to each node in batches, adds of references that still
+      // have a buffered removal can be cancelled out locally
+      bool defer_remote_reference_removal(AddressSpaceID target,
+                DistributedID did, ReferenceKind kind, unsigned count);
+      bool elide_remote_reference_add(AddressSpaceID target,
+                DistributedID did, ReferenceKind kind, unsigned count);
+      void flush_remote_reference_updates(void);
+      void flush_remote_reference_updates(AddressSpaceID target);
+    protected:
+      struct ReferenceRemoval {
+      public:
+        DistributedID did;
+        ReferenceKind kind;
+        unsigned count;
+        // index of the previous removal for the same did, if any
+        int previous;
+      };
+      // Removals for one node in the order they were made, consecutive
+      // removals of the same kind for a did are combined into one entry
+      struct PendingReferenceRemovals {
+      public:
+        std::vector<ReferenceRemoval> removals;
+        std::map<DistributedID,int> last_removal;
+      };
+      // Must be called while holding the reference batch lock so that
+      // the batch is queued before any other message can be sent
+      void send_remote_reference_removals(AddressSpaceID target,
+                                 const PendingReferenceRemovals &pending,
+                                 bool flush);
     public:
       LogicalView* find_or_request_logical_view(DistributedID did,
                                                 RtEvent &ready);
@@ -2376,6 +2494,8 @@ namespace Legion {
       Future help_create_future(Operation *op = NULL);
       void help_complete_future(const Future &f);
       bool help_reset_future(const Future &f);
+      void help_set_future_result(const Future &f, const void *result,
+                                  size_t result_size);
     public:
       unsigned generate_random_integer(void);
 #ifdef TRACE_ALLOCATION
@@ -2527,6 +2647,11 @@ namespace Legion {
                 RUNTIME_DIST_COLLECT_ALLOC>::tracked dist_collectables;
       std::map<DistributedID,
         std::pair<DistributedCollectable*,RtUserEvent> > pending_collectables;
+    protected:
+      Reservation reference_batch_lock;
+      std::map<AddressSpaceID,
+               PendingReferenceRemovals> pending_reference_removals;
+      bool reference_flush_pending;
     protected:
       Reservation gc_epoch_lock;
       GarbageCollectionEpoch *current_gc_epoch;
@@ -2717,8 +2842,10 @@ namespace Legion {
       static unsigned initial_task_window_hysteresis;
       static unsigned initial_tasks_to_schedule;
       static unsigned superscalar_width;
+      static unsigned mapping_batch_size;
       static unsigned max_message_size;
       static unsigned gc_epoch_size;
+      static unsigned reference_batch_size;
       static bool runtime_started;
       static bool runtime_backgrounded;
       static bool separate_runtime_instances;
@@ -2746,8 +2873,11 @@ namespace Legion {
       static bool bit_mask_logging;
 #endif
       static bool program_order_execution;
+      static bool concurrent_dependence_analysis;
     public:
       static unsigned num_profiling_nodes;
+      static bool profile_hardware_counters;
+      static const char* prof_logfile;
     public:
       static inline ApEvent merge_events(ApEvent e1, ApEvent e2);
       static inline ApEvent merge_events(ApEvent e1, ApEvent e2, ApEvent e3);
@@ -1177,7 +1177,88 @@ namespace LegionRuntime {
   namespace Accessor {
     using namespace LegionRuntime::LowLevel;
 
-    void AccessorType::Generic::Untyped::read_untyped(ptr_t ptr, void *dst, size_t bytes, off_t offset) const
+    template <int DIM>
+    static void get_affine_linearization(const DomainLinearization& dl,
+					 coord_t& image_origin, coord_t *strides)
+    {
+      // instance linearizations are all affine, so asking for the linear subrect
+      //  of any single point gives us the strides for the whole thing
+      Arrays::Mapping<DIM, 1> *mapping = dl.get_mapping<DIM>();
+      Rect<DIM> r(Point<DIM>::ZEROES(), Point<DIM>::ZEROES());
+      Rect<DIM> subrect;
+      Point<1> lin_strides[DIM];
+      image_origin = mapping->image_linear_subrect(r, subrect, lin_strides)[0];
+      for(int i = 0; i < DIM; i++)
+	strides[i] = lin_strides[i][0];
+    }
+
+    void AccessorType::Generic::Untyped::init_fast_path(void) const
+    {
+      RegionInstanceImpl *impl = (RegionInstanceImpl *) internal;
+
+      // must have valid data by now - block if we have to
+      impl->metadata.await_data();
+
+      const RegionInstanceImpl::Metadata& md = impl->metadata;
+      int dim = md.linearization.get_dim();
+      off_t elmt_stride, start_offset, min_offset, max_offset;
+
+      if(md.block_size <= 1) {
+	// AOS - anything within the element is fair game
+	elmt_stride = md.elmt_size;
+	start_offset = md.alloc_offset + field_offset;
+	min_offset = -field_offset;
+	max_offset = md.elmt_size - field_offset;
+      } else if((md.block_size * md.elmt_size) >= md.size) {
+	// SOA - accesses have to stay within the field
+	off_t field_start = 0;
+	int field_size = 0;
+	Realm::find_field_start(md.field_sizes, field_offset, 1, field_start, field_size);
+	elmt_stride = field_size;
+	start_offset = (md.alloc_offset + (field_start * md.block_size) +
+			(field_offset - field_start));
+	min_offset = field_start - field_offset;
+	max_offset = field_start + field_size - field_offset;
+      } else {
+	// hybrid layouts aren't affine
+	dim = 0;
+      }
+
+      char *base = 0;
+      if(dim > 0) {
+	MemoryImpl *mem = get_runtime()->get_memory_impl(impl->memory);
+	// the whole instance has to be directly accessible (and a framebuffer
+	//  pointer is no good to the CPU)
+	if((mem->get_kind() != Memory::GPU_FB_MEM) &&
+	   (mem->get_direct_ptr(md.alloc_offset, md.size) != 0))
+	  base = (char *)(mem->get_direct_ptr(start_offset, 0));
+	if(!base)
+	  dim = 0;
+      }
+
+      if(dim > 0) {
+	coord_t image_origin = 0;
+	coord_t lin_strides[3];
+	switch(dim) {
+	case 1: get_affine_linearization<1>(md.linearization, image_origin, lin_strides); break;
+	case 2: get_affine_linearization<2>(md.linearization, image_origin, lin_strides); break;
+	case 3: get_affine_linearization<3>(md.linearization, image_origin, lin_strides); break;
+	default: assert(0);
+	}
+	fast_base = base + (image_origin * elmt_stride);
+	for(int i = 0; i < dim; i++)
+	  fast_strides[i] = lin_strides[i] * elmt_stride;
+	fast_min_offset = min_offset;
+	fast_max_offset = max_offset;
+      }
+
+      // other threads may be using a copy of this accessor, so make sure everything
+      //  else is visible before the dimension is
+      __sync_synchronize();
+      fast_dim = dim;
+    }
+
+    void AccessorType::Generic::Untyped::read_untyped_slow(ptr_t ptr, void *dst, size_t bytes, off_t offset) const
     {
       RegionInstanceImpl *impl = (RegionInstanceImpl *) internal;
 
@@ -1202,6 +1283,18 @@ namespace LegionRuntime {
     //bool debug_mappings = false;
     void AccessorType::Generic::Untyped::read_untyped(const DomainPoint& dp, void *dst, size_t bytes, off_t offset) const
     {
+#if !defined(PRIVILEGE_CHECKS) && !defined(BOUNDS_CHECKS)
+      if(fast_dim < 0)
+	init_fast_path();
+      if((fast_dim > 0) && (dp.dim == fast_dim) && fast_path_ok(offset, bytes)) {
+	char *elem = fast_base + offset;
+	for(int i = 0; i < fast_dim; i++)
+	  elem += dp.point_data[i] * fast_strides[i];
+	memcpy(dst, elem, bytes);
+	return;
+      }
+#endif
+
       RegionInstanceImpl *impl = (RegionInstanceImpl *) internal;
 
       // must have valid data by now - block if we have to
@@ -1244,7 +1337,7 @@ namespace LegionRuntime {
       // }
     }
 
-    void AccessorType::Generic::Untyped::write_untyped(ptr_t ptr, const void *src, size_t bytes, off_t offset) const
+    void AccessorType::Generic::Untyped::write_untyped_slow(ptr_t ptr, const void *src, size_t bytes, off_t offset) const
     {
       RegionInstanceImpl *impl = (RegionInstanceImpl *) internal;
 
@@ -1269,6 +1362,18 @@ namespace LegionRuntime {
 
     void AccessorType::Generic::Untyped::write_untyped(const DomainPoint& dp, const void *src, size_t bytes, off_t offset) const
     {
+#if !defined(PRIVILEGE_CHECKS) && !defined(BOUNDS_CHECKS)
+      if(fast_dim < 0)
+	init_fast_path();
+      if((fast_dim > 0) && (dp.dim == fast_dim) && fast_path_ok(offset, bytes)) {
+	char *elem = fast_base + offset;
+	for(int i = 0; i < fast_dim; i++)
+	  elem += dp.point_data[i] * fast_strides[i];
+	memcpy(elem, src, bytes);
+	return;
+      }
+#endif
+
       RegionInstanceImpl *impl = (RegionInstanceImpl *) internal;
 
       // must have valid data by now - block if we have to
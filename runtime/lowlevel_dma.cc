@@ -17,6 +17,7 @@
 #include "lowlevel_dma.h"
 #include "accessor.h"
 #include "realm/threads.h"
+#include "realm/utils.h"
 #include <errno.h>
 // included for file memory data transfer
 #include <unistd.h>
@@ -44,6 +45,7 @@ using namespace LegionRuntime::Accessor;
 
 #include "realm/timers.h"
 #include "realm/serialize.h"
+#include "realm/event_graph.h"
 
 using namespace Realm::Serialization;
 
@@ -74,7 +76,7 @@ namespace LegionRuntime {
 
     class DmaRequestQueue {
     public:
-      DmaRequestQueue(Realm::CoreReservationSet& crs);
+      DmaRequestQueue(Realm::CoreReservationSet& _crs);
 
       void enqueue_request(DmaRequest *r);
 
@@ -86,13 +88,18 @@ namespace LegionRuntime {
 
       void worker_thread_loop(void);
 
+      const std::vector<CoreReservation *>& get_core_reservations(void) const { return core_rsrvs; }
+
     protected:
       GASNetHSL queue_mutex;
       GASNetCondVar queue_condvar;
       std::map<int, std::list<DmaRequest *> *> queues;
       int queue_sleepers;
       bool shutdown_flag;
-      CoreReservation core_rsrv;
+      Realm::CoreReservationSet& crs;
+      // each worker gets its own reservation so that it can be placed near
+      //  a particular processor
+      std::vector<CoreReservation *> core_rsrvs;
       std::vector<Thread *> worker_threads;
     };
 
@@ -274,9 +281,9 @@ namespace LegionRuntime {
       Waiter waiter;
     };
 
-    DmaRequestQueue::DmaRequestQueue(Realm::CoreReservationSet& crs)
+    DmaRequestQueue::DmaRequestQueue(Realm::CoreReservationSet& _crs)
       : queue_condvar(queue_mutex)
-      , core_rsrv("DMA request queue", crs, CoreReservationParameters())
+      , crs(_crs)
     {
       queue_sleepers = 0;
       shutdown_flag = false;
@@ -302,6 +309,12 @@ namespace LegionRuntime {
 	delete (*it);
       }
       worker_threads.clear();
+
+      for(std::vector<CoreReservation *>::iterator it = core_rsrvs.begin();
+	  it != core_rsrvs.end();
+	  it++)
+	delete (*it);
+      core_rsrvs.clear();
     }
 
     void DmaRequestQueue::enqueue_request(DmaRequest *r)
@@ -614,35 +627,26 @@ namespace LegionRuntime {
           }
 	}
 
-	// now go through all instance pairs
-	for(OASByInst::iterator it = oas_by_inst->begin(); it != oas_by_inst->end(); it++) {
-	  RegionInstanceImpl *src_impl = get_runtime()->get_instance_impl(it->first.first);
-	  RegionInstanceImpl *dst_impl = get_runtime()->get_instance_impl(it->first.second);
-
-	  {
-	    Event e = src_impl->request_metadata();
-	    if(!e.has_triggered()) {
-	      if(just_check) {
-		log_dma.debug("dma request %p - no src instance (" IDFMT ") metadata yet", this, src_impl->me.id);
-		return false;
-	      }
-	      log_dma.debug() << "request " << (void *)this << " - src instance metadata invalid - sleeping on event " << e;
-	      waiter.sleep_on_event(e);
-	      return false;
-	    }
+	// now request the metadata for all the instances at once, so that we pay for
+	//  (at most) one round trip to each owner rather than one per instance
+	{
+	  std::vector<RegionInstance> insts;
+	  for(OASByInst::iterator it = oas_by_inst->begin(); it != oas_by_inst->end(); it++) {
+	    insts.push_back(it->first.first);
+	    insts.push_back(it->first.second);
 	  }
-
-	  {
-	    Event e = dst_impl->request_metadata();
-	    if(!e.has_triggered()) {
-	      if(just_check) {
-		log_dma.debug("dma request %p - no dst instance (" IDFMT ") metadata yet", this, dst_impl->me.id);
-		return false;
-	      }
-	      log_dma.debug() << "request " << (void *)this << " - dst instance metadata invalid - sleeping on event " << e;
-	      waiter.sleep_on_event(e);
+	  std::set<Event> events;
+	  if(!Realm::request_instance_metadata(insts, events)) {
+	    if(just_check) {
+	      log_dma.debug("dma request %p - no instance metadata yet", this);
 	      return false;
 	    }
+	    // only build a merged event when we're actually going to sleep on it
+	    Event e = Event::merge_events(events);
+	    log_dma.debug() << "request " << (void *)this << " - instance metadata invalid - sleeping on event " << e;
+	    Realm::MetadataStats::record_stall();
+	    waiter.sleep_on_event(e);
+	    return false;
 	  }
 	}
 
@@ -3422,40 +3426,26 @@ namespace LegionRuntime {
           }
 	}
 
-	// now go through all source instance pairs
-	for(std::vector<Domain::CopySrcDstField>::iterator it = srcs.begin();
-	    it != srcs.end();
-	    it++) {
-	  RegionInstanceImpl *src_impl = get_runtime()->get_instance_impl(it->inst);
-
-	  {
-	    Event e = src_impl->request_metadata();
-	    if(!e.has_triggered()) {
-	      if(just_check) {
-		log_dma.debug("dma request %p - no src instance (" IDFMT ") metadata yet", this, src_impl->me.id);
-		return false;
-	      }
-	      log_dma.debug("request %p - src instance metadata invalid - sleeping on event " IDFMT, this, e.id);
-	      waiter.sleep_on_event(e);
-	      return false;
-	    }
-	  }
-	}
-
+	// now request the metadata for all the source instances and the destination at once
 	{
-	  RegionInstanceImpl *dst_impl = get_runtime()->get_instance_impl(dst.inst);
-
-	  {
-	    Event e = dst_impl->request_metadata();
-	    if(!e.has_triggered()) {
-	      if(just_check) {
-		log_dma.debug("dma request %p - no dst instance (" IDFMT ") metadata yet", this, dst_impl->me.id);
-		return false;
-	      }
-	      log_dma.debug("request %p - dst instance metadata invalid - sleeping on event " IDFMT, this, e.id);
-	      waiter.sleep_on_event(e);
+	  std::vector<RegionInstance> insts;
+	  for(std::vector<Domain::CopySrcDstField>::iterator it = srcs.begin();
+	      it != srcs.end();
+	      it++)
+	    insts.push_back(it->inst);
+	  insts.push_back(dst.inst);
+	  std::set<Event> events;
+	  if(!Realm::request_instance_metadata(insts, events)) {
+	    if(just_check) {
+	      log_dma.debug("dma request %p - no instance metadata yet", this);
 	      return false;
 	    }
+	    // only build a merged event when we're actually going to sleep on it
+	    Event e = Event::merge_events(events);
+	    log_dma.debug("request %p - instance metadata invalid - sleeping on event " IDFMT, this, e.id);
+	    Realm::MetadataStats::record_stall();
+	    waiter.sleep_on_event(e);
+	    return false;
 	  }
 	}
 
@@ -4295,10 +4285,14 @@ namespace LegionRuntime {
       ThreadLaunchParameters tlp;
 
       for(int i = 0; i < count; i++) {
+	std::string name = Realm::stringbuilder() << "DMA worker " << i;
+	CoreReservation *rsrv = new CoreReservation(name, crs, CoreReservationParameters());
+	core_rsrvs.push_back(rsrv);
+
 	Thread *t = Thread::create_kernel_thread<DmaRequestQueue,
 						 &DmaRequestQueue::worker_thread_loop>(this,
 										       tlp,
-										       core_rsrv,
+										       *rsrv,
 										       0 /* default scheduler*/);
 	worker_threads.push_back(t);
       }
@@ -4311,6 +4305,12 @@ namespace LegionRuntime {
       dma_queue->start_workers(count);
     }
 
+    const std::vector<Realm::CoreReservation *>& get_dma_core_reservations(void)
+    {
+      assert(dma_queue != 0);
+      return dma_queue->get_core_reservations();
+    }
+
     void stop_dma_worker_threads(void)
     {
       dma_queue->shutdown_queue();
@@ -4345,6 +4345,7 @@ namespace Realm {
             it != dsts.end(); it++)
       {
         Event ev = GenEventImpl::create_genevent()->current_event();
+        EventGraphTrace::record(EventGraphTrace::Record::REC_COPY_REQUEST, ev, wait_on);
         FillRequest *r = new FillRequest(*this, *it, fill_value,
                                          fill_value_size, wait_on,
                                          ev, 0/*priority*/, requests);
@@ -4526,6 +4527,7 @@ namespace Realm {
 	    OASByInst* oas_by_inst = new OASByInst;
 	    (*oas_by_inst)[ip].push_back(oas);
 	    Event ev = GenEventImpl::create_genevent()->current_event();
+	    EventGraphTrace::record(EventGraphTrace::Record::REC_COPY_REQUEST, ev, wait_on);
 	    int priority = 0; // always have priority zero
 	    CopyRequest *r = new CopyRequest(*this, oas_by_inst,
   					     wait_on, ev, priority, requests);
@@ -4552,6 +4554,9 @@ namespace Realm {
               r->serialize(msgdata);
 
               log_dma.debug("performing serdez on remote node (%d), event=" IDFMT, dma_node, args.after_copy.id);
+	      // the remote node will need the metadata of any instances we own
+	      Realm::push_instance_metadata(ip.first, dma_node);
+	      Realm::push_instance_metadata(ip.second, dma_node);
 	      get_runtime()->optable.add_remote_operation(ev, dma_node);
               RemoteCopyMessage::request(dma_node, args, msgdata, msglen, PAYLOAD_FREE);
 
@@ -4599,6 +4604,7 @@ namespace Realm {
 	  OASByInst *oas_by_inst = it->second;
 
 	  Event ev = GenEventImpl::create_genevent()->current_event();
+	  EventGraphTrace::record(EventGraphTrace::Record::REC_COPY_REQUEST, ev, wait_on);
 #ifdef EVENT_GRAPH_TRACE
           Event enclosing = find_enclosing_termination_event();
           log_event_graph.info("Copy Request: (" IDFMT ",%d) (" IDFMT ",%d) "
@@ -4643,6 +4649,11 @@ namespace Realm {
             r->serialize(msgdata);
 
 	    log_dma.debug("performing copy on remote node (%d), event=" IDFMT, dma_node, args.after_copy.id);
+	    // the remote node will need the metadata of any instances we own
+	    for(OASByInst::const_iterator it2 = oas_by_inst->begin(); it2 != oas_by_inst->end(); it2++) {
+	      Realm::push_instance_metadata(it2->first.first, dma_node);
+	      Realm::push_instance_metadata(it2->first.second, dma_node);
+	    }
 	    get_runtime()->optable.add_remote_operation(ev, dma_node);
 	    RemoteCopyMessage::request(dma_node, args, msgdata, msglen, PAYLOAD_FREE);
 	  
@@ -4682,6 +4693,7 @@ namespace Realm {
 	bool inst_lock_needed = (dst_kind == MemoryImpl::MKIND_GLOBAL);
 
 	Event ev = GenEventImpl::create_genevent()->current_event();
+	EventGraphTrace::record(EventGraphTrace::Record::REC_COPY_REQUEST, ev, wait_on);
 
 	ReduceRequest *r = new ReduceRequest(*this, 
 					     srcs, dsts[0],
@@ -4710,6 +4722,12 @@ namespace Realm {
 
 	  log_dma.debug("performing reduction on remote node (%d), event=" IDFMT,
 		       src_node, args.after_copy.id);
+	  // the remote node will need the metadata of any instances we own
+	  for(std::vector<CopySrcDstField>::const_iterator it = srcs.begin();
+	      it != srcs.end();
+	      it++)
+	    Realm::push_instance_metadata(it->inst, src_node);
+	  Realm::push_instance_metadata(dsts[0].inst, src_node);
 	  get_runtime()->optable.add_remote_operation(ev, src_node);
 	  RemoteCopyMessage::request(src_node, args, msgdata, msglen, PAYLOAD_FREE);
 	  // done with the local copy of the request
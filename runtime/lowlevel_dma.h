@@ -59,6 +59,9 @@ namespace LegionRuntime {
     extern void init_dma_handler(void);
 
     extern void start_dma_worker_threads(int count, Realm::CoreReservationSet& crs);
+    // lets the DMA worker threads (one reservation each) express cache placement
+    //  preferences relative to other reservations
+    extern const std::vector<Realm::CoreReservation *>& get_dma_core_reservations(void);
     extern void stop_dma_worker_threads(void);
 
     extern void create_builtin_dma_channels(Realm::RuntimeImpl *r);
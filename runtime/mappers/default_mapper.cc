@@ -59,6 +59,7 @@ namespace Legion {
         next_global_io(Processor::NO_PROC), next_global_cpu(Processor::NO_PROC),
         next_global_gpu(Processor::NO_PROC), next_global_procset(Processor::NO_PROC), 
         global_io_query(NULL), global_cpu_query(NULL), global_gpu_query(NULL), global_procset_query(NULL),
+        active_map_batches(0),
         max_steals_per_theft(STATIC_MAX_PERMITTED_STEALS),
         max_steal_count(STATIC_MAX_STEAL_COUNT),
         breadth_first_traversal(STATIC_BREADTH_FIRST),
@@ -1253,6 +1254,81 @@ namespace Legion {
     //--------------------------------------------------------------------------
     {
       log_mapper.spew("Default map_task in %s", get_mapper_name());
+      default_map_task(ctx, task, input, output, 
+                       (active_map_batches > 0) ? &map_batch_cache : NULL);
+    }
+
+    //--------------------------------------------------------------------------
+    void DefaultMapper::map_tasks(const MapperContext                  ctx,
+                                  const std::vector<const Task*>&      tasks,
+                                  const std::vector<MapTaskInput>&     inputs,
+                                        std::vector<MapTaskOutput>&    outputs)
+    //--------------------------------------------------------------------------
+    {
+      log_mapper.spew("Default map_tasks (%zd tasks) in %s", 
+                      tasks.size(), get_mapper_name());
+      // The tasks in a batch share their target processor and variant
+      // so we only need to look up target memories and layout
+      // constraints once for the whole batch. We still go through
+      // map_task for each task in case a derived mapper overrides it.
+      // The cache lives in the mapper since we are re-entrant and
+      // another batch could start while this one is blocked.
+      if (active_map_batches++ == 0)
+      {
+        map_batch_cache.target_memories.clear();
+        map_batch_cache.layout_constraints.clear();
+      }
+      for (unsigned idx = 0; idx < tasks.size(); idx++)
+        map_task(ctx, *tasks[idx], inputs[idx], outputs[idx]);
+      active_map_batches--;
+    }
+
+    //--------------------------------------------------------------------------
+    Memory DefaultMapper::default_find_target_memory(MapperContext ctx,
+                                                     Processor target_proc,
+                                                     MapTasksBatch *batch)
+    //--------------------------------------------------------------------------
+    {
+      if (batch == NULL)
+        return default_policy_select_target_memory(ctx, target_proc);
+      std::map<Processor,Memory>::const_iterator finder = 
+        batch->target_memories.find(target_proc);
+      if (finder != batch->target_memories.end())
+        return finder->second;
+      Memory result = default_policy_select_target_memory(ctx, target_proc);
+      batch->target_memories[target_proc] = result;
+      return result;
+    }
+
+    //--------------------------------------------------------------------------
+    const TaskLayoutConstraintSet& 
+      DefaultMapper::default_find_layout_constraints(MapperContext ctx,
+                                  TaskID task_id, VariantID variant, 
+                                  MapTasksBatch *batch)
+    //--------------------------------------------------------------------------
+    {
+      if (batch == NULL)
+        return runtime->find_task_layout_constraints(ctx, task_id, variant);
+      const std::pair<TaskID,VariantID> key(task_id, variant);
+      std::map<std::pair<TaskID,VariantID>,
+               const TaskLayoutConstraintSet*>::const_iterator finder = 
+        batch->layout_constraints.find(key);
+      if (finder != batch->layout_constraints.end())
+        return *(finder->second);
+      const TaskLayoutConstraintSet &result = 
+        runtime->find_task_layout_constraints(ctx, task_id, variant);
+      batch->layout_constraints[key] = &result;
+      return result;
+    }
+
+    //--------------------------------------------------------------------------
+    void DefaultMapper::default_map_task(const MapperContext      ctx,
+                                         const Task&              task,
+                                         const MapTaskInput&      input,
+                                               MapTaskOutput&     output,
+                                               MapTasksBatch*     batch)
+    //--------------------------------------------------------------------------
+    {
       Processor::Kind target_kind = task.target_proc.kind();
       // Get the variant that we are going to use to map this task
       VariantInfo chosen = default_find_preferred_variant(task, ctx,
@@ -1297,10 +1373,10 @@ namespace Legion {
           if (!reduction_indexes.empty())
           {
             const TaskLayoutConstraintSet &layout_constraints =
-                runtime->find_task_layout_constraints(ctx,
-                                      task.task_id, output.chosen_variant);
-            Memory target_memory = default_policy_select_target_memory(ctx, 
-                                                         task.target_proc);
+                default_find_layout_constraints(ctx,
+                                      task.task_id, output.chosen_variant, batch);
+            Memory target_memory = default_find_target_memory(ctx, 
+                                                         task.target_proc, batch);
             for (std::vector<unsigned>::const_iterator it = 
                   reduction_indexes.begin(); it != 
                   reduction_indexes.end(); it++)
@@ -1329,8 +1405,8 @@ namespace Legion {
       // possibly because a new field was allocated in a region, so our old
       // cached physical instance(s) is(are) no longer valid
       bool needs_field_constraint_check = false;
-      Memory target_memory = default_policy_select_target_memory(ctx, 
-                                                         task.target_proc);
+      Memory target_memory = default_find_target_memory(ctx, 
+                                                         task.target_proc, batch);
       if (finder != cached_task_mappings.end())
       {
         bool found = false;
@@ -1357,8 +1433,8 @@ namespace Legion {
           if (has_reductions)
           {
             const TaskLayoutConstraintSet &layout_constraints =
-              runtime->find_task_layout_constraints(ctx,
-                                  task.task_id, output.chosen_variant);
+              default_find_layout_constraints(ctx,
+                                  task.task_id, output.chosen_variant, batch);
             for (unsigned idx = 0; idx < task.regions.size(); idx++)
             {
               if (task.regions[idx].privilege == REDUCE)
@@ -1405,8 +1481,8 @@ namespace Legion {
               input.premapped_regions.end(); it++)
           done_regions[*it] = true;
       const TaskLayoutConstraintSet &layout_constraints = 
-        runtime->find_task_layout_constraints(ctx, 
-                              task.task_id, output.chosen_variant);
+        default_find_layout_constraints(ctx, 
+                              task.task_id, output.chosen_variant, batch);
       // Now we need to go through and make instances for any of our
       // regions which do not have space for certain fields
       bool has_reductions = false;
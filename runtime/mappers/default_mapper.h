@@ -82,6 +82,13 @@ namespace Legion {
         std::vector<std::vector<PhysicalInstance> > mapping;
         bool                                        has_reductions;
       };
+      // Lookups shared by all the tasks in a map_tasks call
+      struct MapTasksBatch {
+      public:
+        std::map<Processor,Memory>                  target_memories;
+        std::map<std::pair<TaskID,VariantID>,
+                 const TaskLayoutConstraintSet*>    layout_constraints;
+      };
       struct MapperMsgHdr {
       public:
         MapperMsgHdr(void) : magic(0xABCD), type(INVALID_MESSAGE) { }
@@ -124,6 +131,10 @@ namespace Legion {
                             const Task&              task,
                             const MapTaskInput&      input,
                                   MapTaskOutput&     output);
+      virtual void map_tasks(const MapperContext                  ctx,
+                             const std::vector<const Task*>&      tasks,
+                             const std::vector<MapTaskInput>&     inputs,
+                                   std::vector<MapTaskOutput>&    outputs);
       virtual void select_task_variant(const MapperContext          ctx,
                                        const Task&                  task,
                                        const SelectVariantInput&    input,
@@ -351,6 +362,14 @@ namespace Legion {
                                  const Task &task, MapperContext ctx,
                                  bool needs_tight_bound, bool cache = true,
                                  Processor::Kind kind = Processor::NO_KIND);
+      void default_map_task(MapperContext ctx, const Task &task,
+                              const MapTaskInput &input, 
+                              MapTaskOutput &output, MapTasksBatch *batch);
+      Memory default_find_target_memory(MapperContext ctx, 
+                              Processor target_proc, MapTasksBatch *batch);
+      const TaskLayoutConstraintSet& default_find_layout_constraints(
+                              MapperContext ctx, TaskID task_id, 
+                              VariantID variant, MapTasksBatch *batch);
       void default_slice_task(const Task &task,
                               const std::vector<Processor> &local_procs,
                               const std::vector<Processor> &remote_procs,
@@ -444,6 +463,9 @@ namespace Legion {
                LayoutConstraintID>             layout_constraint_cache;
       std::map<std::pair<Memory::Kind,ReductionOpID>,
                LayoutConstraintID>             reduction_constraint_cache;
+      // Only valid while a map_tasks call is in progress
+      MapTasksBatch                            map_batch_cache;
+      unsigned                                 active_map_batches;
     protected:
       // The maximum number of tasks a mapper will allow to be stolen at a time
       // Controlled by -dm:thefts
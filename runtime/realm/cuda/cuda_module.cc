@@ -1473,6 +1473,11 @@ namespace Realm {
       free_bytes_local(offset, size);
     }
 
+    size_t GPUFBMemory::largest_free_block(void)
+    {
+      return largest_free_block_local();
+    }
+
     // these work, but they are SLOW
     void GPUFBMemory::get_bytes(off_t offset, void *dst, size_t size)
     {
@@ -1547,6 +1552,11 @@ namespace Realm {
       free_bytes_local(offset, size);
     }
 
+    size_t GPUZCMemory::largest_free_block(void)
+    {
+      return largest_free_block_local();
+    }
+
     void GPUZCMemory::get_bytes(off_t offset, void *dst, size_t size)
     {
       memcpy(dst, cpu_base+offset, size);
@@ -560,6 +560,8 @@ namespace Realm {
 
       virtual void free_bytes(off_t offset, size_t size);
 
+      virtual size_t largest_free_block(void);
+
       // these work, but they are SLOW
       virtual void get_bytes(off_t offset, void *dst, size_t size);
       virtual void put_bytes(off_t offset, const void *src, size_t size);
@@ -597,6 +599,8 @@ namespace Realm {
 
       virtual void free_bytes(off_t offset, size_t size);
 
+      virtual size_t largest_free_block(void);
+
       virtual void get_bytes(off_t offset, void *dst, size_t size);
 
       virtual void put_bytes(off_t offset, const void *src, size_t size);
@@ -18,6 +18,8 @@
 #ifndef REALM_DYNAMIC_TABLE_H
 #define REALM_DYNAMIC_TABLE_H
 
+#include "threads.h"
+
 namespace Realm {
 
     // we have a base type that's element-type agnostic
@@ -81,8 +83,41 @@ namespace Realm {
       ET *alloc_entry(void);
       void free_entry(ET *entry);
 
+    protected:
+      // each thread keeps a small cache (a "magazine") of free entries so that
+      //  most allocations and frees don't touch the shared list - entries move
+      //  between a magazine and the shared list in batches of half a magazine
+      static const int MAGAZINE_SIZE = 32;
+
+      struct Magazine : public ThreadLocalCache {
+	Magazine(DynamicTableFreeList<ALLOCATOR> *_list);
+	virtual ~Magazine(void);
+
+	virtual void flush(void);
+
+	DynamicTableFreeList<ALLOCATOR> *list;  // list this cache belongs to
+	unsigned list_id;
+	ET *first;
+	int count;
+	Magazine *next_magazine;  // this thread's other magazines of this type
+      };
+
+      Magazine& get_magazine(void);
+      void refill_magazine(Magazine& mag);
+      void drain_magazine(Magazine& mag, int to_return);
+
+      // list IDs are never reused, so a magazine can't be mistaken for one
+      //  belonging to a later list that happens to have the same address
+      static unsigned next_list_id;
+
+      // the calling thread's magazines for lists of this type, most recently
+      //  used first
+      static __thread Magazine *thread_magazines;
+
+    public:
       DynamicTable<ALLOCATOR>& table;
       int owner;
+      unsigned list_id;
       LT lock;
       ET * volatile first_free;
       IT volatile next_alloc;
@@ -224,13 +224,71 @@ namespace Realm {
   // class DynamicTableFreeList<ALLOCATOR>
   //
 
+  template <typename ALLOCATOR>
+  /*static*/ unsigned DynamicTableFreeList<ALLOCATOR>::next_list_id = 0;
+
+  template <typename ALLOCATOR>
+  /*static*/ __thread typename DynamicTableFreeList<ALLOCATOR>::Magazine *DynamicTableFreeList<ALLOCATOR>::thread_magazines = 0;
+
   template <typename ALLOCATOR>
   DynamicTableFreeList<ALLOCATOR>::DynamicTableFreeList(DynamicTable<ALLOCATOR>& _table, int _owner)
-    : table(_table), owner(_owner), first_free(0), next_alloc(0)
+    : table(_table), owner(_owner), list_id(__sync_fetch_and_add(&next_list_id, 1))
+    , first_free(0), next_alloc(0)
   {}
 
   template <typename ALLOCATOR>
-  typename DynamicTableFreeList<ALLOCATOR>::ET *DynamicTableFreeList<ALLOCATOR>::alloc_entry(void)
+  DynamicTableFreeList<ALLOCATOR>::Magazine::Magazine(DynamicTableFreeList<ALLOCATOR> *_list)
+    : list(_list), list_id(_list->list_id), first(0), count(0), next_magazine(0)
+  {}
+
+  template <typename ALLOCATOR>
+  DynamicTableFreeList<ALLOCATOR>::Magazine::~Magazine(void)
+  {
+    // magazines are only deleted by the thread that owns them, so unlink
+    //  ourselves from that thread's chain
+    Magazine **pp = &thread_magazines;
+    while(*pp != this) {
+      assert(*pp != 0);
+      pp = &((*pp)->next_magazine);
+    }
+    *pp = next_magazine;
+  }
+
+  template <typename ALLOCATOR>
+  void DynamicTableFreeList<ALLOCATOR>::Magazine::flush(void)
+  {
+    if(count > 0)
+      list->drain_magazine(*this, count);
+  }
+
+  template <typename ALLOCATOR>
+  typename DynamicTableFreeList<ALLOCATOR>::Magazine& DynamicTableFreeList<ALLOCATOR>::get_magazine(void)
+  {
+    // common case is that the most recently used magazine is ours
+    Magazine *mag = thread_magazines;
+    if(mag && (mag->list_id == list_id))
+      return *mag;
+
+    // otherwise search the rest of the chain, moving a match to the front -
+    //  magazines of lists that have been destroyed (e.g. by an earlier
+    //  runtime instance) never match and are simply left alone
+    Magazine **pp = &thread_magazines;
+    while(*pp && ((*pp)->list_id != list_id))
+      pp = &((*pp)->next_magazine);
+    mag = *pp;
+    if(mag) {
+      *pp = mag->next_magazine;
+    } else {
+      mag = new Magazine(this);
+      ThreadLocalCache::register_cache(mag);
+    }
+    mag->next_magazine = thread_magazines;
+    thread_magazines = mag;
+    return *mag;
+  }
+
+  template <typename ALLOCATOR>
+  void DynamicTableFreeList<ALLOCATOR>::refill_magazine(Magazine& mag)
   {
     // take the lock first, since we're messing with the free list
     lock.lock();
@@ -251,21 +309,64 @@ namespace Realm {
       lock.lock();
     }
 
-    typename DynamicTable<ALLOCATOR>::ET *entry = first_free;
-    first_free = entry->next_free;
+    // take up to half a magazine's worth of entries in one go
+    ET *last = first_free;
+    int taken = 1;
+    while((taken < (MAGAZINE_SIZE / 2)) && last->next_free) {
+      last = last->next_free;
+      taken++;
+    }
+    mag.first = first_free;
+    first_free = last->next_free;
     lock.unlock();
 
-    return entry;
+    last->next_free = 0;
+    mag.count = taken;
   }
 
   template <typename ALLOCATOR>
-  void DynamicTableFreeList<ALLOCATOR>::free_entry(ET *entry)
+  void DynamicTableFreeList<ALLOCATOR>::drain_magazine(Magazine& mag, int to_return)
   {
-    // just stick ourselves on front of free list
+    // split off the first 'to_return' entries and splice them onto the
+    //  shared list with a single lock acquisition
+    assert((to_return > 0) && (to_return <= mag.count));
+    ET *first = mag.first;
+    ET *last = first;
+    for(int i = 1; i < to_return; i++)
+      last = last->next_free;
+    mag.first = last->next_free;
+    mag.count -= to_return;
+
     lock.lock();
-    entry->next_free = first_free;
-    first_free = entry;
+    last->next_free = first_free;
+    first_free = first;
     lock.unlock();
   }
 
+  template <typename ALLOCATOR>
+  typename DynamicTableFreeList<ALLOCATOR>::ET *DynamicTableFreeList<ALLOCATOR>::alloc_entry(void)
+  {
+    Magazine& mag = get_magazine();
+    if(mag.count == 0)
+      refill_magazine(mag);
+
+    ET *entry = mag.first;
+    mag.first = entry->next_free;
+    mag.count--;
+    return entry;
+  }
+
+  template <typename ALLOCATOR>
+  void DynamicTableFreeList<ALLOCATOR>::free_entry(ET *entry)
+  {
+    // just stick ourselves on front of this thread's magazine, handing half
+    //  of it back to the shared list if it's full
+    Magazine& mag = get_magazine();
+    if(mag.count == MAGAZINE_SIZE)
+      drain_magazine(mag, MAGAZINE_SIZE / 2);
+    entry->next_free = mag.first;
+    mag.first = entry;
+    mag.count++;
+  }
+
 }; // namespace Realm
@@ -0,0 +1,253 @@
+/* Copyright 2016 Stanford University, NVIDIA Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// compact binary tracing of the event graph for Realm
+
+#include "event_graph.h"
+#include "operation.h"
+#include "threads.h"
+#include "cmdline.h"
+#include "timers.h"
+#include "logging.h"
+#include "activemsg.h"
+
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+namespace Realm {
+
+  Logger log_eventgraph("eventgraph");
+
+  namespace EventGraphTrace {
+
+    bool enabled = false;
+
+    // each thread fills its own buffer - the list of all of them is only used
+    //  to flush partial buffers at shutdown
+    struct ThreadBuffer {
+      unsigned thread_index;
+      size_t count;
+      Record *records;
+      ThreadBuffer *next;
+    };
+
+    namespace {
+      size_t cfg_buffer_size = 4096;  // records per thread buffer
+      int output_fd = -1;
+      unsigned next_thread_index = 0;
+      ThreadBuffer *all_buffers = 0;
+      // full record arrays waiting to be written, and empty ones that can be
+      //  reused - a thread that fills its buffer just swaps arrays, and
+      //  whichever thread finds nobody else writing does the write() calls
+      //  without holding the mutex
+      std::vector<std::pair<Record *, size_t> > full_arrays;
+      std::vector<Record *> empty_arrays;
+      bool writer_active = false;
+      GASNetHSL *mutex = 0;  // protects the buffer list and the array lists
+    };
+
+  }; // namespace EventGraphTrace
+
+  namespace ThreadLocal {
+    static __thread EventGraphTrace::ThreadBuffer *event_graph_buffer = 0;
+  };
+
+  namespace EventGraphTrace {
+
+    void configure_from_cmdline(std::vector<std::string>& cmdline)
+    {
+      int nodes_traced = 0;
+      std::string logfile = "eventgraph_%.dat";
+
+      bool ok = CommandLineParser()
+	.add_option_int("-realm:eventgraph", nodes_traced)
+	.add_option_string("-realm:eventgraph_file", logfile)
+	.add_option_int("-realm:eventgraph_buffer_size", cfg_buffer_size)
+	.parse_command_line(cmdline);
+
+      assert(ok);
+
+      if((int)gasnet_mynode() >= nodes_traced)
+	return;
+
+      assert(cfg_buffer_size > 0);
+
+      // compute a per-node filename
+      size_t pct = logfile.find('%');
+      if(pct == std::string::npos) {
+	// no node number - only ok when tracing a single node
+	if(nodes_traced > 1) {
+	  log_eventgraph.fatal() << "cannot write event graph traces from multiple nodes to common file '" << logfile << "'";
+	  assert(0);
+	}
+      } else {
+	// replace % with node number
+	char filename[256];
+	sprintf(filename, "%.*s%d%s",
+		(int)pct, logfile.c_str(), gasnet_mynode(), logfile.c_str() + pct + 1);
+	logfile = filename;
+      }
+
+      output_fd = open(logfile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+      if(output_fd < 0) {
+	log_eventgraph.fatal() << "could not create/write '" << logfile << "': " << strerror(errno);
+	assert(0);
+      }
+
+      FileHeader hdr;
+      hdr.magic = FileHeader::MAGIC;
+      hdr.version = FileHeader::VERSION;
+      hdr.record_size = sizeof(Record);
+      hdr.node = gasnet_mynode();
+      ssize_t amt = write(output_fd, &hdr, sizeof(hdr));
+      assert(amt == (ssize_t)sizeof(hdr));
+
+      mutex = new GASNetHSL;
+      enabled = true;
+
+      log_eventgraph.info() << "event graph tracing enabled: logfile='" << logfile << "' buffer=" << cfg_buffer_size << " records";
+    }
+
+    // only one thread at a time may be writing (either the active writer or
+    //  shutdown, once no other threads are recording)
+    static void write_records(const Record *records, size_t count)
+    {
+      if(count == 0) return;
+      size_t bytes = count * sizeof(Record);
+      ssize_t amt = write(output_fd, records, bytes);
+      assert(amt == (ssize_t)bytes);
+    }
+
+    // hands a full record array off to be written, and returns an empty one
+    //  for the calling thread to continue with
+    static Record *swap_full_array(Record *records, size_t count)
+    {
+      std::vector<std::pair<Record *, size_t> > to_write;
+      Record *fresh = 0;
+      {
+	AutoHSLLock al(*mutex);
+	full_arrays.push_back(std::make_pair(records, count));
+	if(!empty_arrays.empty()) {
+	  fresh = empty_arrays.back();
+	  empty_arrays.pop_back();
+	}
+	// if somebody else is already writing, they'll pick this one up too
+	if(!writer_active) {
+	  writer_active = true;
+	  to_write.swap(full_arrays);
+	}
+      }
+      if(!fresh)
+	fresh = new Record[cfg_buffer_size];
+
+      // keep writing until nobody has added anything while we weren't holding
+      //  the lock
+      while(!to_write.empty()) {
+	for(std::vector<std::pair<Record *, size_t> >::const_iterator it = to_write.begin();
+	    it != to_write.end();
+	    it++)
+	  write_records(it->first, it->second);
+
+	AutoHSLLock al(*mutex);
+	for(std::vector<std::pair<Record *, size_t> >::const_iterator it = to_write.begin();
+	    it != to_write.end();
+	    it++)
+	  empty_arrays.push_back(it->first);
+	to_write.clear();
+	if(full_arrays.empty())
+	  writer_active = false;
+	else
+	  to_write.swap(full_arrays);
+      }
+
+      return fresh;
+    }
+
+    void shutdown(void)
+    {
+      if(!enabled) return;
+      enabled = false;
+
+      AutoHSLLock al(*mutex);
+      // no other threads are recording, so nobody can still be writing
+      assert(!writer_active);
+      for(std::vector<std::pair<Record *, size_t> >::const_iterator it = full_arrays.begin();
+	  it != full_arrays.end();
+	  it++) {
+	write_records(it->first, it->second);
+	delete[] it->first;
+      }
+      full_arrays.clear();
+      for(std::vector<Record *>::const_iterator it = empty_arrays.begin();
+	  it != empty_arrays.end();
+	  it++)
+	delete[] *it;
+      empty_arrays.clear();
+
+      size_t num_threads = 0;
+      while(all_buffers) {
+	ThreadBuffer *buf = all_buffers;
+	write_records(buf->records, buf->count);
+	all_buffers = buf->next;
+	delete[] buf->records;
+	delete buf;
+	num_threads++;
+      }
+      close(output_fd);
+      output_fd = -1;
+
+      log_eventgraph.info() << "event graph trace complete: " << num_threads << " threads";
+    }
+
+    void add_record(Record::Kind kind, Event event, unsigned long long other)
+    {
+      ThreadBuffer *buf = ThreadLocal::event_graph_buffer;
+      if(!buf) {
+	buf = new ThreadBuffer;
+	buf->thread_index = __sync_fetch_and_add(&next_thread_index, 1);
+	buf->count = 0;
+	buf->records = new Record[cfg_buffer_size];
+	{
+	  AutoHSLLock al(*mutex);
+	  buf->next = all_buffers;
+	  all_buffers = buf;
+	}
+	ThreadLocal::event_graph_buffer = buf;
+      }
+
+      Record& r = buf->records[buf->count];
+      r.timestamp = Clock::current_time_in_nanoseconds();
+      r.event = event.id;
+      r.other = other;
+      Thread *thread = Thread::self();
+      Operation *op = (thread ? thread->get_operation() : 0);
+      r.context = (op ? op->get_finish_event().id : 0);
+      r.kind = kind;
+      r.node = gasnet_mynode();
+      r.thread = buf->thread_index;
+
+      if(++(buf->count) == cfg_buffer_size) {
+	buf->records = swap_full_array(buf->records, buf->count);
+	buf->count = 0;
+      }
+    }
+
+  }; // namespace EventGraphTrace
+
+}; // namespace Realm
@@ -0,0 +1,91 @@
+/* Copyright 2016 Stanford University, NVIDIA Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// compact binary tracing of the event graph for Realm
+
+#ifndef REALM_EVENT_GRAPH_H
+#define REALM_EVENT_GRAPH_H
+
+#include "event.h"
+#include "processor.h"
+
+#include <vector>
+#include <string>
+
+namespace Realm {
+
+  // the event graph tracer is always compiled in - unless it is turned on with
+  //  -realm:eventgraph, each hook costs a single well-predicted branch
+  // records go into per-thread buffers that are written out (to one file per
+  //  node) as they fill up, and can be analyzed offline with
+  //  tools/event_graph.py
+  namespace EventGraphTrace {
+
+    // one fixed-size record per action, written in the node's native byte order
+    struct Record {
+      enum Kind {
+	REC_CREATE       = 1,  // event (of any kind) or barrier 'event' created
+	REC_MERGE        = 2,  // 'other' is an input of merged event 'event'
+	REC_TRIGGER      = 3,  // 'event' triggered on this node
+	REC_WAIT_BEGIN   = 4,  // processor 'other' blocked waiting on 'event'
+	REC_WAIT_END     = 5,  // ... and resumed
+	REC_TASK_REQUEST = 6,  // task with finish event 'event' requested, precondition 'other'
+	REC_TASK_BEGIN   = 7,  // task with finish event 'event' started on processor 'other'
+	REC_TASK_END     = 8,  // ... and finished running
+	REC_COPY_REQUEST = 9,  // copy/fill with finish event 'event' requested, precondition 'other'
+	REC_ARRIVE       = 10, // arrival at barrier generation 'event', precondition 'other'
+      };
+
+      long long timestamp;         // in nanoseconds
+      unsigned long long event;
+      unsigned long long other;
+      unsigned long long context;  // finish event of the task doing the recording, if any
+      unsigned short kind;
+      unsigned short node;
+      unsigned thread;             // per-node index of the recording thread
+    };
+
+    struct FileHeader {
+      static const unsigned MAGIC = 0x52474552;  // "REGR"
+      static const unsigned VERSION = 1;
+
+      unsigned magic;
+      unsigned version;
+      unsigned record_size;
+      unsigned node;
+    };
+
+    extern bool enabled;
+
+    // parses -realm:eventgraph* options and opens the trace file if enabled
+    void configure_from_cmdline(std::vector<std::string>& cmdline);
+
+    // writes out all buffered records and closes the trace file - must only be
+    //  called once no other threads can be recording
+    void shutdown(void);
+
+    void record(Record::Kind kind, Event event, Event other = Event::NO_EVENT);
+    void record(Record::Kind kind, Event event, Processor proc);
+
+    // out-of-line part of record() that actually fills in a record
+    void add_record(Record::Kind kind, Event event, unsigned long long other);
+
+  }; // namespace EventGraphTrace
+
+}; // namespace Realm
+
+#include "event_graph.inl"
+
+#endif // ifndef REALM_EVENT_GRAPH_H
@@ -0,0 +1,39 @@
+/* Copyright 2016 Stanford University, NVIDIA Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// INCLDUED FROM event_graph.h - DO NOT INCLUDE THIS DIRECTLY
+
+// this is a nop, but it's for the benefit of IDEs trying to parse this file
+#include "event_graph.h"
+
+namespace Realm {
+
+  namespace EventGraphTrace {
+
+    inline void record(Record::Kind kind, Event event, Event other /*= Event::NO_EVENT*/)
+    {
+      if(__builtin_expect(enabled, false))
+	add_record(kind, event, other.id);
+    }
+
+    inline void record(Record::Kind kind, Event event, Processor proc)
+    {
+      if(__builtin_expect(enabled, false))
+	add_record(kind, event, proc.id);
+    }
+
+  }; // namespace EventGraphTrace
+
+}; // namespace Realm
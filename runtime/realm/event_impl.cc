@@ -20,6 +20,11 @@
 #include "logging.h"
 #include "threads.h"
 #include "profiling.h"
+#include "event_graph.h"
+#include "timers.h"
+
+#include <deque>
+#include <unistd.h>
 
 namespace Realm {
 
@@ -255,10 +260,20 @@ namespace Realm {
 	if(interval)
 	  interval->record_wait_start();
       }
+      EventGraphTrace::record(EventGraphTrace::Record::REC_WAIT_BEGIN, *this,
+			      Processor::get_executing_processor());
+      // other work may run on this kernel thread while we're blocked
+      Operation *op = thread->get_operation();
+      if(op)
+	op->pause_hardware_counters();
       // describe the condition we want the thread to wait on
       thread->wait_for_condition(EventTriggeredCondition(e, gen, interval), poisoned);
+      if(op)
+	op->resume_hardware_counters();
       if(interval)
 	interval->record_wait_end();
+      EventGraphTrace::record(EventGraphTrace::Record::REC_WAIT_END, *this,
+			      Processor::get_executing_processor());
       log_event.info() << "thread resumed: thread=" << thread << " event=" << *this << " poisoned=" << poisoned;
       return;
     }
@@ -330,6 +345,14 @@ namespace Realm {
     // if non-zero, eagerly checks deferred user event triggers for loops up to the
     //  specified limit
     int event_loop_detection_limit = 0;
+
+    // if non-zero, barrier arrivals and triggers travel through a tree with
+    //  this fan-in/fan-out
+    int barrier_tree_radix = 0;
+
+    // plain arrivals are held this long (in microseconds) for combining before
+    //  being sent up the arrival tree
+    int barrier_combine_window = 20;
   };
 
   void UserEvent::trigger(Event wait_on) const
@@ -408,6 +431,7 @@ namespace Realm {
 
     BarrierImpl *impl = BarrierImpl::create_barrier(expected_arrivals, redop_id, initial_value, initial_value_size);
     Barrier b = impl->current_barrier();
+    EventGraphTrace::record(EventGraphTrace::Record::REC_CREATE, b);
 
 #ifdef EVENT_GRAPH_TRACE
     log_event_graph.info("Barrier Creation: " IDFMT " %d", b.id, expected_arrivals);
@@ -473,6 +497,8 @@ namespace Realm {
 			 id, gen, wait_on.id, wait_on.gen,
 			 enclosing.id, enclosing.gen, count);
 #endif
+    EventGraphTrace::record(EventGraphTrace::Record::REC_ARRIVE, *this, wait_on);
+
     // arrival uses the timestamp stored in this barrier object
     BarrierImpl *impl = get_runtime()->get_barrier_impl(*this);
     impl->adjust_arrival(ID(id).barrier.generation, -count, timestamp, wait_on,
@@ -643,6 +669,8 @@ namespace Realm {
 
       void add_event(Event wait_for)
       {
+	EventGraphTrace::record(EventGraphTrace::Record::REC_MERGE, finish_event, wait_for);
+
 	bool poisoned = false;
 	if(wait_for.has_triggered_faultaware(poisoned)) {
 	  if(poisoned) {
@@ -936,6 +964,8 @@ namespace Realm {
       assert(ID(impl->me).is_event());
 
       log_event.spew() << "event created: event=" << impl->current_event();
+      // covers user events as well as task/copy finish events and merges
+      EventGraphTrace::record(EventGraphTrace::Record::REC_CREATE, impl->current_event());
 
 #ifdef EVENT_TRACING
       {
@@ -1434,6 +1464,10 @@ namespace Realm {
       log_event.debug() << "event triggered: event=" << e << " by node " << trigger_node
 			<< " (poisoned=" << poisoned << ")";
 
+      // remote triggers are recorded by the node that performed them
+      if(trigger_node == (int)gasnet_mynode())
+	EventGraphTrace::record(EventGraphTrace::Record::REC_TRIGGER, e);
+
 #ifdef EVENT_TRACING
       {
         EventTraceItem &item = Tracer<EventTraceItem>::trace_item();
@@ -1639,6 +1673,8 @@ namespace Realm {
       initial_value = 0;
       value_capacity = 0;
       final_values = 0;
+      pending_arrivals.clear();
+      arrival_flush_active = false;
     }
 
     void BarrierImpl::init(ID _me, unsigned _init_owner)
@@ -1656,6 +1692,8 @@ namespace Realm {
       initial_value = 0;
       value_capacity = 0;
       final_values = 0;
+      pending_arrivals.clear();
+      arrival_flush_active = false;
     }
 
     /*static*/ void BarrierAdjustMessage::handle_request(RequestArgs args, const void *data, size_t datalen)
@@ -1707,7 +1745,9 @@ namespace Realm {
 							EventImpl::gen_t trigger_gen, EventImpl::gen_t previous_gen,
 							EventImpl::gen_t first_generation, ReductionOpID redop_id,
 							gasnet_node_t migration_target,	unsigned base_arrival_count,
-							const void *data, size_t datalen)
+							const void *data, size_t datalen,
+							const gasnet_node_t *forwards /*= 0*/,
+							size_t num_forwards /*= 0*/)
     {
       RequestArgs args;
 
@@ -1719,8 +1759,20 @@ namespace Realm {
       args.redop_id = redop_id;
       args.migration_target = migration_target;
       args.base_arrival_count = base_arrival_count;
+      args.num_forwards = num_forwards;
 
-      Message::request(target, args, data, datalen, PAYLOAD_COPY);
+      if(num_forwards == 0) {
+	Message::request(target, args, data, datalen, PAYLOAD_COPY);
+      } else {
+	// the nodes this message is to be passed on to follow the reduction data
+	size_t fwdlen = num_forwards * sizeof(gasnet_node_t);
+	char *buffer = (char *)malloc(datalen + fwdlen);
+	assert(buffer != 0);
+	if(datalen > 0)
+	  memcpy(buffer, data, datalen);
+	memcpy(buffer + datalen, forwards, fwdlen);
+	Message::request(target, args, buffer, datalen + fwdlen, PAYLOAD_FREE);
+      }
     }
 
 // like strdup, but works on arbitrary byte arrays
@@ -1733,6 +1785,201 @@ static void *bytedup(const void *data, size_t datalen)
   return dst;
 }
 
+    // parent of a node in the radix-k arrival tree rooted at 'root' - numbering nodes
+    //  relative to the root, the children of node i are k*i+1 through k*i+k
+    static gasnet_node_t barrier_tree_parent(gasnet_node_t node, gasnet_node_t root,
+					     unsigned radix)
+    {
+      unsigned num_nodes = gasnet_nodes();
+      unsigned rel = (node + num_nodes - root) % num_nodes;
+      assert(rel > 0);
+      return (((rel - 1) / radix) + root) % num_nodes;
+    }
+
+    // splits a list of nodes into (up to) radix contiguous subtrees and sends the
+    //  trigger to the first node of each, which passes it on to the rest of its subtree
+    static void broadcast_barrier_trigger(const gasnet_node_t *nodes, size_t count,
+					  ID::IDType barrier_id,
+					  EventImpl::gen_t trigger_gen, EventImpl::gen_t previous_gen,
+					  EventImpl::gen_t first_generation, ReductionOpID redop_id,
+					  const void *data, size_t datalen)
+    {
+      size_t fanout = ((Config::barrier_tree_radix > 0) ? Config::barrier_tree_radix : count);
+      if(fanout > count)
+	fanout = count;
+      size_t pos = 0;
+      for(size_t i = 0; i < fanout; i++) {
+	// spread any remainder over the first few subtrees
+	size_t subtree = (count / fanout) + ((i < (count % fanout)) ? 1 : 0);
+	log_barrier.info() << "sending remote trigger notification: " << barrier_id << "/"
+			   << previous_gen << " -> " << trigger_gen << ", dest=" << nodes[pos]
+			   << " subtree=" << subtree;
+	BarrierTriggerMessage::send_request(nodes[pos], barrier_id, trigger_gen, previous_gen,
+					    first_generation, redop_id,
+					    (gasnet_node_t) -1 /*no migration*/, 0 /*dummy arrival count*/,
+					    data, datalen,
+					    nodes + pos + 1, subtree - 1);
+	pos += subtree;
+      }
+      assert(pos == count);
+    }
+
+    // a single thread per node sends combined barrier arrivals once their window
+    //  has expired - barriers are queued in the order their first arrival showed
+    //  up, which (with a fixed window) is also deadline order
+    class BarrierArrivalFlusher {
+    public:
+      BarrierArrivalFlusher(CoreReservationSet& crs);
+      ~BarrierArrivalFlusher(void);
+
+      void schedule(BarrierImpl *barrier);
+
+      void shutdown(void);
+
+      void flusher_loop(void);
+
+    protected:
+      GASNetHSL mutex;
+      GASNetCondVar condvar;
+      std::deque<std::pair<long long, BarrierImpl *> > queue;
+      bool shutdown_flag;
+      CoreReservation *core_rsrv;
+      Thread *flusher_thread;
+    };
+
+    static BarrierArrivalFlusher *arrival_flusher = 0;
+
+    BarrierArrivalFlusher::BarrierArrivalFlusher(CoreReservationSet& crs)
+      : condvar(mutex), shutdown_flag(false)
+    {
+      CoreReservationParameters params;
+      params.set_num_cores(1);
+      core_rsrv = new CoreReservation("barrier arrival flusher", crs, params);
+      ThreadLaunchParameters tparams;
+      flusher_thread = Thread::create_kernel_thread<BarrierArrivalFlusher,
+						    &BarrierArrivalFlusher::flusher_loop>(this,
+											  tparams,
+											  *core_rsrv);
+    }
+
+    BarrierArrivalFlusher::~BarrierArrivalFlusher(void)
+    {
+      assert(queue.empty());
+      delete flusher_thread;
+      delete core_rsrv;
+    }
+
+    void BarrierArrivalFlusher::schedule(BarrierImpl *barrier)
+    {
+      long long deadline = (Clock::current_time_in_nanoseconds() +
+			    1000LL * Config::barrier_combine_window);
+      AutoHSLLock al(mutex);
+      bool was_empty = queue.empty();
+      queue.push_back(std::make_pair(deadline, barrier));
+      if(was_empty)
+	condvar.signal();
+    }
+
+    void BarrierArrivalFlusher::shutdown(void)
+    {
+      {
+	AutoHSLLock al(mutex);
+	shutdown_flag = true;
+	condvar.signal();
+      }
+      flusher_thread->join();
+    }
+
+    void BarrierArrivalFlusher::flusher_loop(void)
+    {
+      while(true) {
+	BarrierImpl *barrier;
+	{
+	  AutoHSLLock al(mutex);
+	  while(queue.empty() && !shutdown_flag)
+	    condvar.wait();
+	  // anything still queued at shutdown is sent right away
+	  if(queue.empty())
+	    return;
+	  if(!shutdown_flag) {
+	    long long wait_time = queue.front().first - Clock::current_time_in_nanoseconds();
+	    if(wait_time >= 1000) {
+	      // don't hold the lock while sleeping - the front entry can't change
+	      //  out from under us, but new ones can be added behind it
+	      mutex.unlock();
+	      usleep(wait_time / 1000);
+	      mutex.lock();
+	    }
+	  }
+	  barrier = queue.front().second;
+	  queue.pop_front();
+	}
+	barrier->flush_tree_arrivals();
+      }
+    }
+
+    // queues a barrier to have its pending arrivals flushed at the end of the
+    //  combining window - returns false if the caller should flush right away
+    static bool schedule_arrival_flush(BarrierImpl *barrier)
+    {
+      if(!arrival_flusher || (Config::barrier_combine_window <= 0))
+	return false;
+      arrival_flusher->schedule(barrier);
+      return true;
+    }
+
+    /*static*/ void BarrierImpl::start_arrival_flusher(CoreReservationSet& crs)
+    {
+      // the flusher is only needed if arrivals are combined at all
+      if((Config::barrier_tree_radix <= 0) || (Config::barrier_combine_window <= 0) ||
+	 (gasnet_nodes() == 1))
+	return;
+      assert(arrival_flusher == 0);
+      arrival_flusher = new BarrierArrivalFlusher(crs);
+    }
+
+    /*static*/ void BarrierImpl::stop_arrival_flusher(void)
+    {
+      if(!arrival_flusher)
+	return;
+      arrival_flusher->shutdown();
+      delete arrival_flusher;
+      arrival_flusher = 0;
+    }
+
+    // attempts to fold an arrival into the one already waiting to go up the arrival tree
+    //  for the same generation - fails if reduction values can't be combined here
+    static bool combine_pending_arrival(std::map<EventImpl::gen_t, BarrierImpl::PendingArrival>& pending,
+					const ReductionOpUntyped *redop,
+					EventImpl::gen_t barrier_gen, int delta,
+					const void *reduce_value, size_t reduce_value_size)
+    {
+      std::map<EventImpl::gen_t, BarrierImpl::PendingArrival>::iterator it = pending.find(barrier_gen);
+      if(it == pending.end()) {
+	BarrierImpl::PendingArrival& pa = pending[barrier_gen];
+	pa.delta = delta;
+	pa.reduce_value = bytedup(reduce_value, reduce_value_size);
+	pa.reduce_value_size = reduce_value_size;
+	return true;
+      }
+
+      BarrierImpl::PendingArrival& pa = it->second;
+      if(reduce_value_size > 0) {
+	if(pa.reduce_value_size == 0) {
+	  pa.reduce_value = bytedup(reduce_value, reduce_value_size);
+	  pa.reduce_value_size = reduce_value_size;
+	} else {
+	  // non-owners only know the redop once they've seen a trigger with data
+	  if(!redop || !redop->is_foldable || (redop->sizeof_rhs != reduce_value_size))
+	    return false;
+	  assert(pa.reduce_value_size == reduce_value_size);
+	  redop->fold(pa.reduce_value, reduce_value, 1, true /*exclusive*/);
+	}
+      }
+      pa.delta += delta;
+      return true;
+    }
+
     class DeferredBarrierArrival : public EventWaiter {
     public:
       DeferredBarrierArrival(Barrier _barrier, int _delta,
@@ -1900,12 +2147,27 @@ static void *bytedup(const void *data, size_t datalen)
       gasnet_node_t migration_target = (gasnet_node_t) -1;
       gasnet_node_t forward_to_node = (gasnet_node_t) -1;
       gasnet_node_t inform_migration = (gasnet_node_t) -1;
+      bool flush_arrivals = false;
 
       do { // so we can use 'break' from the middle
 	AutoHSLLock a(mutex);
 
 	// ownership can change, so check it inside the lock
 	if(owner != gasnet_mynode()) {
+	  // plain arrivals (i.e. no timestamp ordering to respect) can be combined with
+	  //  others on their way up the arrival tree, as long as the barrier hasn't
+	  //  migrated away from the tree's root
+	  if((Config::barrier_tree_radix > 0) && (delta < 0) && (timestamp == 0) &&
+	     (owner == ID(me).barrier.creator_node) &&
+	     combine_pending_arrival(pending_arrivals, redop, barrier_gen, delta,
+				     reduce_value, reduce_value_size)) {
+	    // if a flush is already scheduled (or in progress), it'll pick this up too
+	    if(!arrival_flush_active) {
+	      arrival_flush_active = true;
+	      flush_arrivals = true;
+	    }
+	    break;
+	  }
 	  forward_to_node = owner;
 	  break;
 	} else {
@@ -1946,6 +2208,7 @@ static void *bytedup(const void *data, size_t datalen)
 	    local_notifications.insert(local_notifications.end(), 
 				       it->second->local_waiters.begin(), it->second->local_waiters.end());
 	    trigger_gen = generation = it->first;
+	    EventGraphTrace::record(EventGraphTrace::Record::REC_TRIGGER, make_barrier(trigger_gen));
 	    delete it->second;
 	    generations.erase(it);
 	    it = generations.begin();
@@ -2035,6 +2298,16 @@ static void *bytedup(const void *data, size_t datalen)
 	}
       } while(0);
 
+      if(flush_arrivals) {
+	// give other arrivals for this barrier (from local tasks or from our
+	//  children in the tree) a chance to be combined with this one - without
+	//  a window the root's fan-in is only reduced for arrivals that happen
+	//  to overlap with a send
+	if(!schedule_arrival_flush(this))
+	  flush_tree_arrivals();
+	return;
+      }
+
       if(forward_to_node != (gasnet_node_t) -1) {
 	Barrier b = make_barrier(barrier_gen, timestamp);
 	BarrierAdjustMessage::send_request(forward_to_node, b, delta, Event::NO_EVENT,
@@ -2061,21 +2334,44 @@ static void *bytedup(const void *data, size_t datalen)
 	    delete (*it);
 	}
 
-	// now do remote notifications
-	for(std::vector<RemoteNotification>::const_iterator it = remote_notifications.begin();
-	    it != remote_notifications.end();
-	    it++) {
-	  log_barrier.info() << "sending remote trigger notification: " << me.id << "/"
-			     << (*it).previous_gen << " -> " << (*it).trigger_gen << ", dest=" << (*it).node;
-	  void *data = 0;
-	  size_t datalen = 0;
-	  if(final_values_copy) {
-	    data = (char *)final_values_copy + (((*it).previous_gen - oldest_previous) * redop->sizeof_lhs);
-	    datalen = ((*it).trigger_gen - (*it).previous_gen) * redop->sizeof_lhs;
+	// now do remote notifications - with a tree radix set, nodes that are being
+	//  told about the same range of generations share a broadcast tree
+	if((Config::barrier_tree_radix > 0) && (remote_notifications.size() > 1)) {
+	  std::map<std::pair<gen_t, gen_t>, std::vector<gasnet_node_t> > groups;
+	  for(std::vector<RemoteNotification>::const_iterator it = remote_notifications.begin();
+	      it != remote_notifications.end();
+	      it++)
+	    groups[std::make_pair((*it).previous_gen, (*it).trigger_gen)].push_back((*it).node);
+
+	  for(std::map<std::pair<gen_t, gen_t>, std::vector<gasnet_node_t> >::const_iterator it = groups.begin();
+	      it != groups.end();
+	      it++) {
+	    void *data = 0;
+	    size_t datalen = 0;
+	    if(final_values_copy) {
+	      data = (char *)final_values_copy + ((it->first.first - oldest_previous) * redop->sizeof_lhs);
+	      datalen = (it->first.second - it->first.first) * redop->sizeof_lhs;
+	    }
+	    broadcast_barrier_trigger(&(it->second[0]), it->second.size(), me.id,
+				      it->first.second, it->first.first,
+				      first_generation, redop_id, data, datalen);
+	  }
+	} else {
+	  for(std::vector<RemoteNotification>::const_iterator it = remote_notifications.begin();
+	      it != remote_notifications.end();
+	      it++) {
+	    log_barrier.info() << "sending remote trigger notification: " << me.id << "/"
+			       << (*it).previous_gen << " -> " << (*it).trigger_gen << ", dest=" << (*it).node;
+	    void *data = 0;
+	    size_t datalen = 0;
+	    if(final_values_copy) {
+	      data = (char *)final_values_copy + (((*it).previous_gen - oldest_previous) * redop->sizeof_lhs);
+	      datalen = ((*it).trigger_gen - (*it).previous_gen) * redop->sizeof_lhs;
+	    }
+	    BarrierTriggerMessage::send_request((*it).node, me.id, (*it).trigger_gen, (*it).previous_gen,
+						first_generation, redop_id, migration_target, base_arrival_count,
+						data, datalen);
 	  }
-	  BarrierTriggerMessage::send_request((*it).node, me.id, (*it).trigger_gen, (*it).previous_gen,
-					      first_generation, redop_id, migration_target, base_arrival_count,
-					      data, datalen);
 	}
       }
 
@@ -2084,6 +2380,48 @@ static void *bytedup(const void *data, size_t datalen)
 	free(final_values_copy);
     }
 
+    void BarrierImpl::flush_tree_arrivals(void)
+    {
+      // keep sending until nobody has added anything while we weren't holding the lock
+      while(true) {
+	std::map<gen_t, PendingArrival> to_send;
+	gasnet_node_t target;
+	{
+	  AutoHSLLock a(mutex);
+	  if(pending_arrivals.empty()) {
+	    arrival_flush_active = false;
+	    return;
+	  }
+	  to_send.swap(pending_arrivals);
+
+	  // if the barrier migrated while these were waiting, go straight to the owner
+	  if(owner == ID(me).barrier.creator_node)
+	    target = barrier_tree_parent(gasnet_mynode(), owner, Config::barrier_tree_radix);
+	  else
+	    target = owner;
+	}
+
+	for(std::map<gen_t, PendingArrival>::iterator it = to_send.begin();
+	    it != to_send.end();
+	    it++) {
+	  Barrier b = make_barrier(it->first);
+	  log_barrier.info() << "sending combined barrier arrival: delta=" << it->second.delta
+			     << " out=" << b << " dest=" << target;
+	  if(target == gasnet_mynode()) {
+	    // we became the owner - apply the arrivals directly
+	    adjust_arrival(it->first, it->second.delta, 0, Event::NO_EVENT,
+			   gasnet_mynode(), false /*!forwarded*/,
+			   it->second.reduce_value, it->second.reduce_value_size);
+	  } else
+	    BarrierAdjustMessage::send_request(target, b, it->second.delta, Event::NO_EVENT,
+					       gasnet_mynode(), false /*!forwarded*/,
+					       it->second.reduce_value, it->second.reduce_value_size);
+	  if(it->second.reduce_value)
+	    free(it->second.reduce_value);
+	}
+      }
+    }
+
     bool BarrierImpl::has_triggered(gen_t needed_gen, bool& poisoned)
     {
       poisoned = POISON_FIXME;
@@ -2269,6 +2607,21 @@ static void *bytedup(const void *data, size_t datalen)
       Barrier b = id.convert<Barrier>();
       BarrierImpl *impl = get_runtime()->get_barrier_impl(b);
 
+      // if we're an interior node of a broadcast tree, pass the trigger on to our
+      //  subtree before dealing with it ourselves
+      if(args.num_forwards > 0) {
+	size_t fwdlen = args.num_forwards * sizeof(gasnet_node_t);
+	assert(datalen >= fwdlen);
+	datalen -= fwdlen;
+	// copy the node list out - it's not necessarily aligned in the payload
+	std::vector<gasnet_node_t> forwards(args.num_forwards);
+	memcpy(&forwards[0], (const char *)data + datalen, fwdlen);
+	broadcast_barrier_trigger(&forwards[0], forwards.size(), args.barrier_id,
+				  args.trigger_gen, args.previous_gen,
+				  args.first_generation, args.redop_id,
+				  data, datalen);
+      }
+
       // we'll probably end up with a list of local waiters to notify
       std::vector<EventWaiter *> local_notifications;
       {
@@ -30,6 +30,8 @@
 
 namespace Realm {
 
+  class CoreReservationSet;
+
 #ifdef EVENT_TRACING
     // For event tracing
     struct EventTraceItem {
@@ -201,6 +203,14 @@ namespace Realm {
 
       bool get_result(gen_t result_gen, void *value, size_t value_size);
 
+      // sends any arrivals held for combining to the next node up the arrival tree
+      void flush_tree_arrivals(void);
+
+      // starts/stops the thread that flushes combined arrivals once their
+      //  -realm:barrier_window has expired (only used with a tree radix set)
+      static void start_arrival_flusher(CoreReservationSet& crs);
+      static void stop_arrival_flusher(void);
+
     public: //protected:
       ID me;
       unsigned owner;
@@ -243,6 +253,17 @@ namespace Realm {
 
       unsigned value_capacity; // how many values the two allocations below can hold
       char *final_values;   // results of completed reductions
+
+      // arrivals on a non-owner node that are waiting to be combined and sent up
+      //  the arrival tree - the first one to show up schedules a flush at the end
+      //  of the combining window, and only one thread at a time does the sending
+      struct PendingArrival {
+	int delta;
+	void *reduce_value;
+	size_t reduce_value_size;
+      };
+      std::map<gen_t, PendingArrival> pending_arrivals;
+      bool arrival_flush_active;
     };
 
   // active messages
@@ -351,6 +372,7 @@ namespace Realm {
 	ReductionOpID redop_id;
 	gasnet_node_t migration_target;
 	unsigned base_arrival_count;
+	unsigned num_forwards; // nodes appended to the payload that we pass this on to
       };
 
       static void handle_request(RequestArgs args, const void *data, size_t datalen);
@@ -363,7 +385,8 @@ namespace Realm {
 			       EventImpl::gen_t trigger_gen, EventImpl::gen_t previous_gen,
 			       EventImpl::gen_t first_generation, ReductionOpID redop_id,
 			       gasnet_node_t migration_target, unsigned base_arrival_count,
-			       const void *data, size_t datalen);
+			       const void *data, size_t datalen,
+			       const gasnet_node_t *forwards = 0, size_t num_forwards = 0);
     };
 
     struct BarrierMigrationMessage {
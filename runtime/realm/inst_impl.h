@@ -80,7 +80,7 @@ namespace Realm {
       class Metadata : public MetadataBase {
       public:
 	void *serialize(size_t& out_size) const;
-	void deserialize(const void *in_data, size_t in_size);
+	virtual void deserialize(const void *in_data, size_t in_size);
 
 	IndexSpace is;
 	off_t alloc_offset;
@@ -22,6 +22,8 @@
 
 #include "activemsg.h"
 
+#include <algorithm>
+
 namespace Realm {
 
   Logger log_machine("machine");
@@ -124,6 +126,7 @@ namespace Realm {
     MachineImpl *machine_singleton = 0;
 
   MachineImpl::MachineImpl(void)
+    : indices_valid(false)
   {
     assert(machine_singleton == 0);
     machine_singleton = this;
@@ -142,6 +145,8 @@ namespace Realm {
     {
       AutoHSLLock al(mutex);
 
+      invalidate_indices();
+
       const size_t *cur = (const size_t *)args;
 #ifndef NDEBUG
       const size_t *limit = (const size_t *)(((const char *)args)+arglen);
@@ -221,45 +226,37 @@ namespace Realm {
     {
       // TODO: consider using a reader/writer lock here instead
       AutoHSLLock al(mutex);
-      for(std::vector<Machine::ProcessorMemoryAffinity>::const_iterator it = proc_mem_affinities.begin();
-	  it != proc_mem_affinities.end();
-	  it++) {
-	mset.insert((*it).m);
-      }
+      update_indices();
+      mset.insert(all_mems.begin(), all_mems.end());
     }
 
     void MachineImpl::get_all_processors(std::set<Processor>& pset) const
     {
       // TODO: consider using a reader/writer lock here instead
       AutoHSLLock al(mutex);
-      for(std::vector<Machine::ProcessorMemoryAffinity>::const_iterator it = proc_mem_affinities.begin();
-	  it != proc_mem_affinities.end();
-	  it++) {
-	pset.insert((*it).p);
-      }
+      update_indices();
+      pset.insert(all_procs.begin(), all_procs.end());
     }
 
     void MachineImpl::get_local_processors(std::set<Processor>& pset) const
     {
-      for(std::vector<Machine::ProcessorMemoryAffinity>::const_iterator it = proc_mem_affinities.begin();
-	  it != proc_mem_affinities.end();
-	  it++) {
-	Processor p = (*it).p;
-	if(ID(p).proc.owner_node == gasnet_mynode())
-	  pset.insert(p);
-      }
+      AutoHSLLock al(mutex);
+      update_indices();
+      std::map<int, std::vector<Processor> >::const_iterator finder = 
+	procs_by_node.find(gasnet_mynode());
+      if(finder != procs_by_node.end())
+	pset.insert(finder->second.begin(), finder->second.end());
     }
 
     void MachineImpl::get_local_processors_by_kind(std::set<Processor>& pset,
 						   Processor::Kind kind) const
     {
-      for(std::vector<Machine::ProcessorMemoryAffinity>::const_iterator it = proc_mem_affinities.begin();
-	  it != proc_mem_affinities.end();
-	  it++) {
-	Processor p = (*it).p;
-	if((ID(p).proc.owner_node == gasnet_mynode()) && (p.kind() == kind))
-	  pset.insert(p);
-      }
+      AutoHSLLock al(mutex);
+      update_indices();
+      std::map<Processor::Kind, std::vector<Processor> >::const_iterator finder = 
+	local_procs_by_kind.find(kind);
+      if(finder != local_procs_by_kind.end())
+	pset.insert(finder->second.begin(), finder->second.end());
     }
 
     // Return the set of memories visible from a processor
@@ -267,10 +264,12 @@ namespace Realm {
     {
       // TODO: consider using a reader/writer lock here instead
       AutoHSLLock al(mutex);
-      for(std::vector<Machine::ProcessorMemoryAffinity>::const_iterator it = proc_mem_affinities.begin();
-	  it != proc_mem_affinities.end();
+      update_indices();
+      const std::vector<Machine::ProcessorMemoryAffinity>& pmas = find_proc_affinities(p);
+      for(std::vector<Machine::ProcessorMemoryAffinity>::const_iterator it = pmas.begin();
+	  it != pmas.end();
 	  it++) {
-	if((*it).p == p && (*it).m.capacity() > 0)
+	if((*it).m.capacity() > 0)
 	  mset.insert((*it).m);
       }
     }
@@ -280,14 +279,23 @@ namespace Realm {
     {
       // TODO: consider using a reader/writer lock here instead
       AutoHSLLock al(mutex);
-      for(std::vector<Machine::MemoryMemoryAffinity>::const_iterator it = mem_mem_affinities.begin();
-	  it != mem_mem_affinities.end();
+      update_indices();
+      const std::vector<Machine::MemoryMemoryAffinity>& mmas1 = find_mem_affinities(m);
+      for(std::vector<Machine::MemoryMemoryAffinity>::const_iterator it = mmas1.begin();
+	  it != mmas1.end();
 	  it++) {
-	if((*it).m1 == m && (*it).m2.capacity() > 0)
+	if((*it).m2.capacity() > 0)
 	  mset.insert((*it).m2);
-	
-	if((*it).m2 == m && (*it).m1.capacity() > 0)
-	  mset.insert((*it).m1);
+      }
+      std::map<Memory, std::vector<Machine::MemoryMemoryAffinity> >::const_iterator finder =
+	mmas_by_mem2.find(m);
+      if(finder != mmas_by_mem2.end()) {
+	for(std::vector<Machine::MemoryMemoryAffinity>::const_iterator it = finder->second.begin();
+	    it != finder->second.end();
+	    it++) {
+	  if((*it).m1.capacity() > 0)
+	    mset.insert((*it).m1);
+	}
       }
     }
 
@@ -296,48 +304,28 @@ namespace Realm {
     {
       // TODO: consider using a reader/writer lock here instead
       AutoHSLLock al(mutex);
-      for(std::vector<Machine::ProcessorMemoryAffinity>::const_iterator it = proc_mem_affinities.begin();
-	  it != proc_mem_affinities.end();
-	  it++) {
-	if((*it).m == m)
-	  pset.insert((*it).p);
-      }
+      update_indices();
+      const std::vector<Machine::ProcessorMemoryAffinity>& pmas = find_mem_proc_affinities(m);
+      for(std::vector<Machine::ProcessorMemoryAffinity>::const_iterator it = pmas.begin();
+	  it != pmas.end();
+	  it++)
+	pset.insert((*it).p);
     }
 
     bool MachineImpl::has_affinity(Processor p, Memory m, Machine::AffinityDetails *details /*= 0*/) const
     {
       // TODO: consider using a reader/writer lock here instead
       AutoHSLLock al(mutex);
-      for(std::vector<Machine::ProcessorMemoryAffinity>::const_iterator it = proc_mem_affinities.begin();
-	  it != proc_mem_affinities.end();
-	  it++) {
-	if(it->p != p) continue;
-	if(it->m != m) continue;
-	if(details) {
-	  details->bandwidth = it->bandwidth;
-	  details->latency = it->latency;
-	}
-	return true;
-      }
-      return false;
+      update_indices();
+      return find_affinity(p, m, details);
     }
 
     bool MachineImpl::has_affinity(Memory m1, Memory m2, Machine::AffinityDetails *details /*= 0*/) const
     {
       // TODO: consider using a reader/writer lock here instead
       AutoHSLLock al(mutex);
-      for(std::vector<Machine::MemoryMemoryAffinity>::const_iterator it = mem_mem_affinities.begin();
-	  it != mem_mem_affinities.end();
-	  it++) {
-	if(it->m1 != m1) continue;
-	if(it->m2 != m2) continue;
-	if(details) {
-	  details->bandwidth = it->bandwidth;
-	  details->latency = it->latency;
-	}
-	return true;
-      }
-      return false;
+      update_indices();
+      return find_affinity(m1, m2, details);
     }
 
     int MachineImpl::get_proc_mem_affinity(std::vector<Machine::ProcessorMemoryAffinity>& result,
@@ -349,8 +337,14 @@ namespace Realm {
       {
 	// TODO: consider using a reader/writer lock here instead
 	AutoHSLLock al(mutex);
-	for(std::vector<Machine::ProcessorMemoryAffinity>::const_iterator it = proc_mem_affinities.begin();
-	    it != proc_mem_affinities.end();
+	update_indices();
+	// use the narrowest index available
+	const std::vector<Machine::ProcessorMemoryAffinity>& pmas = 
+	  (restrict_proc.exists() ? find_proc_affinities(restrict_proc) :
+	   restrict_memory.exists() ? find_mem_proc_affinities(restrict_memory) :
+	                              proc_mem_affinities);
+	for(std::vector<Machine::ProcessorMemoryAffinity>::const_iterator it = pmas.begin();
+	    it != pmas.end();
 	    it++) {
 	  if(restrict_proc.exists() && ((*it).p != restrict_proc)) continue;
 	  if(restrict_memory.exists() && ((*it).m != restrict_memory)) continue;
@@ -383,8 +377,12 @@ namespace Realm {
       {
 	// TODO: consider using a reader/writer lock here instead
 	AutoHSLLock al(mutex);
-	for(std::vector<Machine::MemoryMemoryAffinity>::const_iterator it = mem_mem_affinities.begin();
-	    it != mem_mem_affinities.end();
+	update_indices();
+	const std::vector<Machine::MemoryMemoryAffinity>& mmas = 
+	  (restrict_mem1.exists() ? find_mem_affinities(restrict_mem1) :
+	                            mem_mem_affinities);
+	for(std::vector<Machine::MemoryMemoryAffinity>::const_iterator it = mmas.begin();
+	    it != mmas.end();
 	    it++) {
 	  if(restrict_mem1.exists() && 
 	     ((*it).m1 != restrict_mem1)) continue;
@@ -402,12 +400,14 @@ namespace Realm {
     {
       AutoHSLLock al(mutex);
       proc_mem_affinities.push_back(pma);
+      invalidate_indices();
     }
 
     void MachineImpl::add_mem_mem_affinity(const Machine::MemoryMemoryAffinity& mma)
     {
       AutoHSLLock al(mutex);
       mem_mem_affinities.push_back(mma);
+      invalidate_indices();
     }
 
     void MachineImpl::add_subscription(Machine::MachineUpdateSubscriber *subscriber)
@@ -422,6 +422,125 @@ namespace Realm {
       subscribers.erase(subscriber);
     }
 
+    template <typename T>
+    static void sort_and_unique(std::vector<T>& v)
+    {
+      std::sort(v.begin(), v.end());
+      v.erase(std::unique(v.begin(), v.end()), v.end());
+    }
+
+    void MachineImpl::update_indices(void) const
+    {
+      if(indices_valid) return;
+
+      all_procs.clear();
+      all_mems.clear();
+      procs_by_node.clear();
+      mems_by_node.clear();
+      local_procs_by_kind.clear();
+      pmas_by_proc.clear();
+      pmas_by_mem.clear();
+      mmas_by_mem1.clear();
+      mmas_by_mem2.clear();
+
+      // processors and memories are only known through their affinities
+      for(std::vector<Machine::ProcessorMemoryAffinity>::const_iterator it = proc_mem_affinities.begin();
+	  it != proc_mem_affinities.end();
+	  it++) {
+	all_procs.push_back((*it).p);
+	all_mems.push_back((*it).m);
+	pmas_by_proc[(*it).p].push_back(*it);
+	pmas_by_mem[(*it).m].push_back(*it);
+      }
+      sort_and_unique(all_procs);
+      sort_and_unique(all_mems);
+
+      for(std::vector<Processor>::const_iterator it = all_procs.begin();
+	  it != all_procs.end();
+	  it++) {
+	int node = ID(*it).proc.owner_node;
+	procs_by_node[node].push_back(*it);
+	if(node == (int)gasnet_mynode())
+	  local_procs_by_kind[(*it).kind()].push_back(*it);
+      }
+      for(std::vector<Memory>::const_iterator it = all_mems.begin();
+	  it != all_mems.end();
+	  it++)
+	mems_by_node[ID(*it).memory.owner_node].push_back(*it);
+
+      for(std::vector<Machine::MemoryMemoryAffinity>::const_iterator it = mem_mem_affinities.begin();
+	  it != mem_mem_affinities.end();
+	  it++) {
+	mmas_by_mem1[(*it).m1].push_back(*it);
+	mmas_by_mem2[(*it).m2].push_back(*it);
+      }
+
+      indices_valid = true;
+    }
+
+    void MachineImpl::invalidate_indices(void)
+    {
+      indices_valid = false;
+      proc_query_cache.clear();
+      mem_query_cache.clear();
+    }
+
+    const std::vector<Machine::ProcessorMemoryAffinity>& MachineImpl::find_proc_affinities(Processor p) const
+    {
+      static const std::vector<Machine::ProcessorMemoryAffinity> empty;
+      std::map<Processor, std::vector<Machine::ProcessorMemoryAffinity> >::const_iterator finder =
+	pmas_by_proc.find(p);
+      return ((finder != pmas_by_proc.end()) ? finder->second : empty);
+    }
+
+    const std::vector<Machine::ProcessorMemoryAffinity>& MachineImpl::find_mem_proc_affinities(Memory m) const
+    {
+      static const std::vector<Machine::ProcessorMemoryAffinity> empty;
+      std::map<Memory, std::vector<Machine::ProcessorMemoryAffinity> >::const_iterator finder =
+	pmas_by_mem.find(m);
+      return ((finder != pmas_by_mem.end()) ? finder->second : empty);
+    }
+
+    const std::vector<Machine::MemoryMemoryAffinity>& MachineImpl::find_mem_affinities(Memory m1) const
+    {
+      static const std::vector<Machine::MemoryMemoryAffinity> empty;
+      std::map<Memory, std::vector<Machine::MemoryMemoryAffinity> >::const_iterator finder =
+	mmas_by_mem1.find(m1);
+      return ((finder != mmas_by_mem1.end()) ? finder->second : empty);
+    }
+
+    bool MachineImpl::find_affinity(Processor p, Memory m, Machine::AffinityDetails *details) const
+    {
+      const std::vector<Machine::ProcessorMemoryAffinity>& pmas = find_proc_affinities(p);
+      for(std::vector<Machine::ProcessorMemoryAffinity>::const_iterator it = pmas.begin();
+	  it != pmas.end();
+	  it++) {
+	if(it->m != m) continue;
+	if(details) {
+	  details->bandwidth = it->bandwidth;
+	  details->latency = it->latency;
+	}
+	return true;
+      }
+      return false;
+    }
+
+    bool MachineImpl::find_affinity(Memory m1, Memory m2, Machine::AffinityDetails *details) const
+    {
+      const std::vector<Machine::MemoryMemoryAffinity>& mmas = find_mem_affinities(m1);
+      for(std::vector<Machine::MemoryMemoryAffinity>::const_iterator it = mmas.begin();
+	  it != mmas.end();
+	  it++) {
+	if(it->m2 != m2) continue;
+	if(details) {
+	  details->bandwidth = it->bandwidth;
+	  details->latency = it->latency;
+	}
+	return true;
+      }
+      return false;
+    }
+
 
   ////////////////////////////////////////////////////////////////////////
   //
@@ -656,6 +775,12 @@ namespace Realm {
     return (thing.kind() == kind);
   }
 
+  void ProcessorKindPredicate::append_signature(QuerySignature& sig) const
+  {
+    sig.push_back(QUERY_PRED_PROC_KIND);
+    sig.push_back((long long)kind);
+  }
+
 
   ////////////////////////////////////////////////////////////////////////
   //
@@ -678,12 +803,20 @@ namespace Realm {
   bool ProcessorHasAffinityPredicate::matches_predicate(MachineImpl *machine, Processor thing) const
   {
     Machine::AffinityDetails details;
-    if(!machine->has_affinity(thing, memory, &details)) return false;
+    if(!machine->find_affinity(thing, memory, &details)) return false;
     if((min_bandwidth != 0) && (details.bandwidth < min_bandwidth)) return false;
     if((max_latency != 0) && (details.latency > max_latency)) return false;
     return true;
   }
 
+  void ProcessorHasAffinityPredicate::append_signature(QuerySignature& sig) const
+  {
+    sig.push_back(QUERY_PRED_PROC_HAS_AFFINITY);
+    sig.push_back((long long)memory.id);
+    sig.push_back((long long)min_bandwidth);
+    sig.push_back((long long)max_latency);
+  }
+
 
   ////////////////////////////////////////////////////////////////////////
   //
@@ -707,8 +840,7 @@ namespace Realm {
   {
     Memory best = Memory::NO_MEMORY;
     int best_aff = INT_MIN;
-    std::vector<Machine::ProcessorMemoryAffinity> affinities;
-    machine->get_proc_mem_affinity(affinities, thing);
+    const std::vector<Machine::ProcessorMemoryAffinity>& affinities = machine->find_proc_affinities(thing);
     for(std::vector<Machine::ProcessorMemoryAffinity>::const_iterator it = affinities.begin();
 	it != affinities.end();
 	it++) {
@@ -721,6 +853,14 @@ namespace Realm {
     return (best == memory);
   }
 
+  void ProcessorBestAffinityPredicate::append_signature(QuerySignature& sig) const
+  {
+    sig.push_back(QUERY_PRED_PROC_BEST_AFFINITY);
+    sig.push_back((long long)memory.id);
+    sig.push_back((long long)bandwidth_weight);
+    sig.push_back((long long)latency_weight);
+  }
+
 
   ////////////////////////////////////////////////////////////////////////
   //
@@ -732,13 +872,16 @@ namespace Realm {
     , machine((MachineImpl *)_machine.impl)
     , is_restricted(false)
     , restricted_node_id(-1)
-  {}
+  {
+    update_signature();
+  }
      
   ProcessorQueryImpl::ProcessorQueryImpl(const ProcessorQueryImpl& copy_from)
     : references(1)
     , machine(copy_from.machine)
     , is_restricted(copy_from.is_restricted)
     , restricted_node_id(copy_from.restricted_node_id)
+    , signature(copy_from.signature)
   {
     predicates.reserve(copy_from.predicates.size());
     for(std::vector<QueryPredicate<Processor> *>::const_iterator it = copy_from.predicates.begin();
@@ -790,118 +933,89 @@ namespace Realm {
       is_restricted = true;
       restricted_node_id = new_node_id;
     }
+    update_signature();
   }
 
   void ProcessorQueryImpl::add_predicate(QueryPredicate<Processor> *pred)
   {
     // a writer is always unique, so no need for mutexes
     predicates.push_back(pred);
+    pred->append_signature(signature);
+  }
+
+  void ProcessorQueryImpl::update_signature(void)
+  {
+    signature.clear();
+    signature.push_back(is_restricted ? restricted_node_id : -2);
+    for(std::vector<QueryPredicate<Processor> *>::const_iterator it = predicates.begin();
+	it != predicates.end();
+	it++)
+      (*it)->append_signature(signature);
+  }
+
+  const std::vector<Processor>& ProcessorQueryImpl::find_matches(void) const
+  {
+    machine->update_indices();
+    std::map<QuerySignature, std::vector<Processor> >::iterator finder = 
+      machine->proc_query_cache.find(signature);
+    if(finder != machine->proc_query_cache.end())
+      return finder->second;
+
+    std::vector<Processor>& matches = machine->proc_query_cache[signature];
+    static const std::vector<Processor> empty;
+    const std::vector<Processor> *candidates = &(machine->all_procs);
+    if(is_restricted) {
+      std::map<int, std::vector<Processor> >::const_iterator it = 
+	machine->procs_by_node.find(restricted_node_id);
+      candidates = ((it != machine->procs_by_node.end()) ? &(it->second) : &empty);
+    }
+    // candidates are sorted, so the matches will be too
+    for(std::vector<Processor>::const_iterator it = candidates->begin();
+	it != candidates->end();
+	it++) {
+      bool ok = true;
+      for(std::vector<QueryPredicate<Processor> *>::const_iterator it2 = predicates.begin();
+	  ok && (it2 != predicates.end());
+	  it2++)
+	ok &= (*it2)->matches_predicate(machine, *it);
+      if(ok)
+	matches.push_back(*it);
+    }
+    return matches;
   }
 
   Processor ProcessorQueryImpl::first_match(void) const
   {
     if(is_restricted && (restricted_node_id < 0)) return Processor::NO_PROC;
-    Processor lowest = Processor::NO_PROC;
-    {
-      // problem with nested locks here...
-      //AutoHSLLock al(machine->mutex);
-      for(std::vector<Machine::ProcessorMemoryAffinity>::const_iterator it = machine->proc_mem_affinities.begin();
-	  it != machine->proc_mem_affinities.end();
-	  it++) {
-	Processor p =(*it).p;
-	if(is_restricted && (ID(p).proc.owner_node != (unsigned)restricted_node_id))
-	  continue;
-	bool ok = true;
-	for(std::vector<QueryPredicate<Processor> *>::const_iterator it2 = predicates.begin();
-	    ok && (it2 != predicates.end());
-	    it2++)
-	  ok &= (*it2)->matches_predicate(machine, p);
-	if(ok && (!lowest.exists() || (p.id < lowest.id)))
-	  lowest = p;
-      }
-    }
-    return lowest;
+    AutoHSLLock al(machine->mutex);
+    const std::vector<Processor>& matches = find_matches();
+    return (matches.empty() ? Processor::NO_PROC : matches[0]);
   }
 
   Processor ProcessorQueryImpl::next_match(Processor after) const
   {
     if(is_restricted && (restricted_node_id < 0)) return Processor::NO_PROC;
     if(!after.exists()) return Processor::NO_PROC;
-    Processor lowest = Processor::NO_PROC;
-    {
-      // problem with nested locks here...
-      //AutoHSLLock al(machine->mutex);
-      for(std::vector<Machine::ProcessorMemoryAffinity>::const_iterator it = machine->proc_mem_affinities.begin();
-	  it != machine->proc_mem_affinities.end();
-	  it++) {
-	Processor p =(*it).p;
-	if(p.id <= after.id) continue;
-	if(is_restricted && (ID(p).proc.owner_node != (unsigned)restricted_node_id))
-	  continue;
-	bool ok = true;
-	for(std::vector<QueryPredicate<Processor> *>::const_iterator it2 = predicates.begin();
-	    ok && (it2 != predicates.end());
-	    it2++)
-	  ok &= (*it2)->matches_predicate(machine, p);
-	if(ok && (!lowest.exists() || (p.id < lowest.id)))
-	  lowest = p;
-      }
-    }
-    return lowest;
+    AutoHSLLock al(machine->mutex);
+    const std::vector<Processor>& matches = find_matches();
+    std::vector<Processor>::const_iterator it = std::upper_bound(matches.begin(), matches.end(), after);
+    return ((it != matches.end()) ? *it : Processor::NO_PROC);
   }
 
   size_t ProcessorQueryImpl::count_matches(void) const
   {
     if(is_restricted && (restricted_node_id < 0)) return 0;
-    std::set<Processor> pset;
-    {
-      // problem with nested locks here...
-      //AutoHSLLock al(machine->mutex);
-      for(std::vector<Machine::ProcessorMemoryAffinity>::const_iterator it = machine->proc_mem_affinities.begin();
-	  it != machine->proc_mem_affinities.end();
-	  it++) {
-	Processor p =(*it).p;
-	if(is_restricted && (ID(p).proc.owner_node != (unsigned)restricted_node_id))
-	  continue;
-	bool ok = true;
-	for(std::vector<QueryPredicate<Processor> *>::const_iterator it2 = predicates.begin();
-	    ok && (it2 != predicates.end());
-	    it2++)
-	  ok &= (*it2)->matches_predicate(machine, p);
-	if(ok)
-	  pset.insert((*it).p);
-      }
-    }
-    return pset.size();
+    AutoHSLLock al(machine->mutex);
+    return find_matches().size();
   }
 
   Processor ProcessorQueryImpl::random_match(void) const
   {
     if(is_restricted && (restricted_node_id < 0)) return Processor::NO_PROC;
-    Processor chosen = Processor::NO_PROC;
-    int count = 0;
-    {
-      // problem with nested locks here...
-      //AutoHSLLock al(machine->mutex);
-      for(std::vector<Machine::ProcessorMemoryAffinity>::const_iterator it = machine->proc_mem_affinities.begin();
-	  it != machine->proc_mem_affinities.end();
-	  it++) {
-	Processor p =(*it).p;
-	if(is_restricted && (ID(p).proc.owner_node != (unsigned)restricted_node_id))
-	  continue;
-	bool ok = true;
-	for(std::vector<QueryPredicate<Processor> *>::const_iterator it2 = predicates.begin();
-	    ok && (it2 != predicates.end());
-	    it2++)
-	  ok &= (*it2)->matches_predicate(machine, p);
-	if(ok) {
-	  count++;
-	  if((count == 1) || ((lrand48() % count) == 0))
-	    chosen = p;
-	}
-      }
-    }
-    return chosen;
+    AutoHSLLock al(machine->mutex);
+    const std::vector<Processor>& matches = find_matches();
+    if(matches.empty()) return Processor::NO_PROC;
+    return matches[lrand48() % matches.size()];
   }
 
 
@@ -924,6 +1038,12 @@ namespace Realm {
     return (thing.kind() == kind);
   }
 
+  void MemoryKindPredicate::append_signature(QuerySignature& sig) const
+  {
+    sig.push_back(QUERY_PRED_MEM_KIND);
+    sig.push_back((long long)kind);
+  }
+
 
   ////////////////////////////////////////////////////////////////////////
   //
@@ -946,12 +1066,20 @@ namespace Realm {
   bool MemoryHasProcAffinityPredicate::matches_predicate(MachineImpl *machine, Memory thing) const
   {
     Machine::AffinityDetails details;
-    if(!machine->has_affinity(proc, thing, &details)) return false;
+    if(!machine->find_affinity(proc, thing, &details)) return false;
     if((min_bandwidth != 0) && (details.bandwidth < min_bandwidth)) return false;
     if((max_latency != 0) && (details.latency > max_latency)) return false;
     return true;
   }
 
+  void MemoryHasProcAffinityPredicate::append_signature(QuerySignature& sig) const
+  {
+    sig.push_back(QUERY_PRED_MEM_HAS_PROC_AFFINITY);
+    sig.push_back((long long)proc.id);
+    sig.push_back((long long)min_bandwidth);
+    sig.push_back((long long)max_latency);
+  }
+
 
   ////////////////////////////////////////////////////////////////////////
   //
@@ -974,12 +1102,20 @@ namespace Realm {
   bool MemoryHasMemAffinityPredicate::matches_predicate(MachineImpl *machine, Memory thing) const
   {
     Machine::AffinityDetails details;
-    if(!machine->has_affinity(memory, thing, &details)) return false;
+    if(!machine->find_affinity(memory, thing, &details)) return false;
     if((min_bandwidth != 0) && (details.bandwidth < min_bandwidth)) return false;
     if((max_latency != 0) && (details.latency > max_latency)) return false;
     return true;
   }
 
+  void MemoryHasMemAffinityPredicate::append_signature(QuerySignature& sig) const
+  {
+    sig.push_back(QUERY_PRED_MEM_HAS_MEM_AFFINITY);
+    sig.push_back((long long)memory.id);
+    sig.push_back((long long)min_bandwidth);
+    sig.push_back((long long)max_latency);
+  }
+
 
   ////////////////////////////////////////////////////////////////////////
   //
@@ -1003,8 +1139,7 @@ namespace Realm {
   {
     Processor best = Processor::NO_PROC;
     int best_aff = INT_MIN;
-    std::vector<Machine::ProcessorMemoryAffinity> affinities;
-    machine->get_proc_mem_affinity(affinities, Processor::NO_PROC, thing);
+    const std::vector<Machine::ProcessorMemoryAffinity>& affinities = machine->find_mem_proc_affinities(thing);
     for(std::vector<Machine::ProcessorMemoryAffinity>::const_iterator it = affinities.begin();
 	it != affinities.end();
 	it++) {
@@ -1017,6 +1152,14 @@ namespace Realm {
     return (best == proc);
   }
 
+  void MemoryBestProcAffinityPredicate::append_signature(QuerySignature& sig) const
+  {
+    sig.push_back(QUERY_PRED_MEM_BEST_PROC_AFFINITY);
+    sig.push_back((long long)proc.id);
+    sig.push_back((long long)bandwidth_weight);
+    sig.push_back((long long)latency_weight);
+  }
+
 
   ////////////////////////////////////////////////////////////////////////
   //
@@ -1040,8 +1183,7 @@ namespace Realm {
   {
     Memory best = Memory::NO_MEMORY;
     int best_aff = INT_MIN;
-    std::vector<Machine::MemoryMemoryAffinity> affinities;
-    machine->get_mem_mem_affinity(affinities, thing);
+    const std::vector<Machine::MemoryMemoryAffinity>& affinities = machine->find_mem_affinities(thing);
     for(std::vector<Machine::MemoryMemoryAffinity>::const_iterator it = affinities.begin();
 	it != affinities.end();
 	it++) {
@@ -1054,6 +1196,14 @@ namespace Realm {
     return (best == memory);
   }
 
+  void MemoryBestMemAffinityPredicate::append_signature(QuerySignature& sig) const
+  {
+    sig.push_back(QUERY_PRED_MEM_BEST_MEM_AFFINITY);
+    sig.push_back((long long)memory.id);
+    sig.push_back((long long)bandwidth_weight);
+    sig.push_back((long long)latency_weight);
+  }
+
 
   ////////////////////////////////////////////////////////////////////////
   //
@@ -1065,13 +1215,16 @@ namespace Realm {
     , machine((MachineImpl *)_machine.impl)
     , is_restricted(false)
     , restricted_node_id(-1)
-  {}
+  {
+    update_signature();
+  }
      
   MemoryQueryImpl::MemoryQueryImpl(const MemoryQueryImpl& copy_from)
     : references(1)
     , machine(copy_from.machine)
     , is_restricted(copy_from.is_restricted)
     , restricted_node_id(copy_from.restricted_node_id)
+    , signature(copy_from.signature)
   {
     predicates.reserve(copy_from.predicates.size());
     for(std::vector<QueryPredicate<Memory> *>::const_iterator it = copy_from.predicates.begin();
@@ -1123,118 +1276,89 @@ namespace Realm {
       is_restricted = true;
       restricted_node_id = new_node_id;
     }
+    update_signature();
   }
 
   void MemoryQueryImpl::add_predicate(QueryPredicate<Memory> *pred)
   {
     // a writer is always unique, so no need for mutexes
     predicates.push_back(pred);
+    pred->append_signature(signature);
+  }
+
+  void MemoryQueryImpl::update_signature(void)
+  {
+    signature.clear();
+    signature.push_back(is_restricted ? restricted_node_id : -2);
+    for(std::vector<QueryPredicate<Memory> *>::const_iterator it = predicates.begin();
+	it != predicates.end();
+	it++)
+      (*it)->append_signature(signature);
+  }
+
+  const std::vector<Memory>& MemoryQueryImpl::find_matches(void) const
+  {
+    machine->update_indices();
+    std::map<QuerySignature, std::vector<Memory> >::iterator finder = 
+      machine->mem_query_cache.find(signature);
+    if(finder != machine->mem_query_cache.end())
+      return finder->second;
+
+    std::vector<Memory>& matches = machine->mem_query_cache[signature];
+    static const std::vector<Memory> empty;
+    const std::vector<Memory> *candidates = &(machine->all_mems);
+    if(is_restricted) {
+      std::map<int, std::vector<Memory> >::const_iterator it = 
+	machine->mems_by_node.find(restricted_node_id);
+      candidates = ((it != machine->mems_by_node.end()) ? &(it->second) : &empty);
+    }
+    // candidates are sorted, so the matches will be too
+    for(std::vector<Memory>::const_iterator it = candidates->begin();
+	it != candidates->end();
+	it++) {
+      bool ok = true;
+      for(std::vector<QueryPredicate<Memory> *>::const_iterator it2 = predicates.begin();
+	  ok && (it2 != predicates.end());
+	  it2++)
+	ok &= (*it2)->matches_predicate(machine, *it);
+      if(ok)
+	matches.push_back(*it);
+    }
+    return matches;
   }
 
   Memory MemoryQueryImpl::first_match(void) const
   {
     if(is_restricted && (restricted_node_id < 0)) return Memory::NO_MEMORY;
-    Memory lowest = Memory::NO_MEMORY;
-    {
-      // problem with nested locks here...
-      //AutoHSLLock al(machine->mutex);
-      for(std::vector<Machine::ProcessorMemoryAffinity>::const_iterator it = machine->proc_mem_affinities.begin();
-	  it != machine->proc_mem_affinities.end();
-	  it++) {
-	Memory m =(*it).m;
-	if(is_restricted && (ID(m).memory.owner_node != (unsigned)restricted_node_id))
-	  continue;
-	bool ok = true;
-	for(std::vector<QueryPredicate<Memory> *>::const_iterator it2 = predicates.begin();
-	    ok && (it2 != predicates.end());
-	    it2++)
-	  ok &= (*it2)->matches_predicate(machine, m);
-	if(ok && (!lowest.exists() || (m.id < lowest.id)))
-	  lowest = m;
-      }
-    }
-    return lowest;
+    AutoHSLLock al(machine->mutex);
+    const std::vector<Memory>& matches = find_matches();
+    return (matches.empty() ? Memory::NO_MEMORY : matches[0]);
   }
 
   Memory MemoryQueryImpl::next_match(Memory after) const
   {
     if(is_restricted && (restricted_node_id < 0)) return Memory::NO_MEMORY;
     if(!after.exists()) return Memory::NO_MEMORY;
-    Memory lowest = Memory::NO_MEMORY;
-    {
-      // problem with nested locks here...
-      //AutoHSLLock al(machine->mutex);
-      for(std::vector<Machine::ProcessorMemoryAffinity>::const_iterator it = machine->proc_mem_affinities.begin();
-	  it != machine->proc_mem_affinities.end();
-	  it++) {
-	Memory m =(*it).m;
-	if(m.id <= after.id) continue;
-	if(is_restricted && (ID(m).memory.owner_node != (unsigned)restricted_node_id))
-	  continue;
-	bool ok = true;
-	for(std::vector<QueryPredicate<Memory> *>::const_iterator it2 = predicates.begin();
-	    ok && (it2 != predicates.end());
-	    it2++)
-	  ok &= (*it2)->matches_predicate(machine, m);
-	if(ok && (!lowest.exists() || (m.id < lowest.id)))
-	  lowest = m;
-      }
-    }
-    return lowest;
+    AutoHSLLock al(machine->mutex);
+    const std::vector<Memory>& matches = find_matches();
+    std::vector<Memory>::const_iterator it = std::upper_bound(matches.begin(), matches.end(), after);
+    return ((it != matches.end()) ? *it : Memory::NO_MEMORY);
   }
 
   size_t MemoryQueryImpl::count_matches(void) const
   {
     if(is_restricted && (restricted_node_id < 0)) return 0;
-    std::set<Memory> pset;
-    {
-      // problem with nested locks here...
-      //AutoHSLLock al(machine->mutex);
-      for(std::vector<Machine::ProcessorMemoryAffinity>::const_iterator it = machine->proc_mem_affinities.begin();
-	  it != machine->proc_mem_affinities.end();
-	  it++) {
-	Memory m =(*it).m;
-	if(is_restricted && (ID(m).memory.owner_node != (unsigned)restricted_node_id))
-	  continue;
-	bool ok = true;
-	for(std::vector<QueryPredicate<Memory> *>::const_iterator it2 = predicates.begin();
-	    ok && (it2 != predicates.end());
-	    it2++)
-	  ok &= (*it2)->matches_predicate(machine, m);
-	if(ok)
-	  pset.insert((*it).m);
-      }
-    }
-    return pset.size();
+    AutoHSLLock al(machine->mutex);
+    return find_matches().size();
   }
 
   Memory MemoryQueryImpl::random_match(void) const
   {
     if(is_restricted && (restricted_node_id < 0)) return Memory::NO_MEMORY;
-    Memory chosen = Memory::NO_MEMORY;
-    int count = 0;
-    {
-      // problem with nested locks here...
-      //AutoHSLLock al(machine->mutex);
-      for(std::vector<Machine::ProcessorMemoryAffinity>::const_iterator it = machine->proc_mem_affinities.begin();
-	  it != machine->proc_mem_affinities.end();
-	  it++) {
-	Memory m =(*it).m;
-	if(is_restricted && (ID(m).memory.owner_node != (unsigned)restricted_node_id))
-	  continue;
-	bool ok = true;
-	for(std::vector<QueryPredicate<Memory> *>::const_iterator it2 = predicates.begin();
-	    ok && (it2 != predicates.end());
-	    it2++)
-	  ok &= (*it2)->matches_predicate(machine, m);
-	if(ok) {
-	  count++;
-	  if((count == 1) || ((lrand48() % count) == 0))
-	    chosen = m;
-	}
-      }
-    }
-    return chosen;
+    AutoHSLLock al(machine->mutex);
+    const std::vector<Memory>& matches = find_matches();
+    if(matches.empty()) return Memory::NO_MEMORY;
+    return matches[lrand48() % matches.size()];
   }
 
 
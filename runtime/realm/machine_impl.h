@@ -26,9 +26,16 @@
 
 #include <vector>
 #include <set>
+#include <map>
 
 namespace Realm {
 
+    template <typename T> class QueryPredicate;
+
+    // queries are memoized by a signature built from their node restriction
+    //  and the parameters of each of their predicates
+    typedef std::vector<long long> QuerySignature;
+
     class MachineImpl {
     public:
       MachineImpl(void);
@@ -72,10 +79,43 @@ namespace Realm {
       void add_subscription(Machine::MachineUpdateSubscriber *subscriber);
       void remove_subscription(Machine::MachineUpdateSubscriber *subscriber);
 
+      // everything below requires the caller to hold the mutex - query
+      //  predicates are evaluated with it held, so they must use these
+      //  rather than the public (locking) calls above
+
+      // rebuilds the indices if the machine has changed since the last call
+      void update_indices(void) const;
+      // discards the indices and every memoized query result
+      void invalidate_indices(void);
+
+      const std::vector<Machine::ProcessorMemoryAffinity>& find_proc_affinities(Processor p) const;
+      const std::vector<Machine::ProcessorMemoryAffinity>& find_mem_proc_affinities(Memory m) const;
+      const std::vector<Machine::MemoryMemoryAffinity>& find_mem_affinities(Memory m1) const;
+
+      bool find_affinity(Processor p, Memory m, Machine::AffinityDetails *details) const;
+      bool find_affinity(Memory m1, Memory m2, Machine::AffinityDetails *details) const;
+
       mutable GASNetHSL mutex;
       std::vector<Machine::ProcessorMemoryAffinity> proc_mem_affinities;
       std::vector<Machine::MemoryMemoryAffinity> mem_mem_affinities;
       std::set<Machine::MachineUpdateSubscriber *> subscribers;
+
+      // indices over the affinity lists above (all vectors of processors and
+      //  memories are sorted by id)
+      mutable bool indices_valid;
+      mutable std::vector<Processor> all_procs;
+      mutable std::vector<Memory> all_mems;
+      mutable std::map<int, std::vector<Processor> > procs_by_node;
+      mutable std::map<int, std::vector<Memory> > mems_by_node;
+      mutable std::map<Processor::Kind, std::vector<Processor> > local_procs_by_kind;
+      mutable std::map<Processor, std::vector<Machine::ProcessorMemoryAffinity> > pmas_by_proc;
+      mutable std::map<Memory, std::vector<Machine::ProcessorMemoryAffinity> > pmas_by_mem;
+      mutable std::map<Memory, std::vector<Machine::MemoryMemoryAffinity> > mmas_by_mem1;
+      mutable std::map<Memory, std::vector<Machine::MemoryMemoryAffinity> > mmas_by_mem2;
+
+      // memoized query results, cleared by invalidate_indices
+      mutable std::map<QuerySignature, std::vector<Processor> > proc_query_cache;
+      mutable std::map<QuerySignature, std::vector<Memory> > mem_query_cache;
     };
 
     template <typename T>
@@ -85,7 +125,22 @@ namespace Realm {
 
       virtual QueryPredicate<T> *clone(void) const = 0;
 
+      // called with the machine's mutex held
       virtual bool matches_predicate(MachineImpl *machine, T thing) const = 0;
+
+      // appends a tag and the predicate's parameters
+      virtual void append_signature(QuerySignature& sig) const = 0;
+    };
+
+    enum {
+      QUERY_PRED_PROC_KIND,
+      QUERY_PRED_PROC_HAS_AFFINITY,
+      QUERY_PRED_PROC_BEST_AFFINITY,
+      QUERY_PRED_MEM_KIND,
+      QUERY_PRED_MEM_HAS_PROC_AFFINITY,
+      QUERY_PRED_MEM_HAS_MEM_AFFINITY,
+      QUERY_PRED_MEM_BEST_PROC_AFFINITY,
+      QUERY_PRED_MEM_BEST_MEM_AFFINITY,
     };
 
     class ProcessorKindPredicate : public QueryPredicate<Processor> {
@@ -96,6 +151,8 @@ namespace Realm {
 
       virtual bool matches_predicate(MachineImpl *machine, Processor thing) const;
 
+      virtual void append_signature(QuerySignature& sig) const;
+
     protected:
       Processor::Kind kind;
     };
@@ -108,6 +165,8 @@ namespace Realm {
 
       virtual bool matches_predicate(MachineImpl *machine, Processor thing) const;
 
+      virtual void append_signature(QuerySignature& sig) const;
+
     protected:
       Memory memory;
       unsigned min_bandwidth;
@@ -122,6 +181,8 @@ namespace Realm {
 
       virtual bool matches_predicate(MachineImpl *machine, Processor thing) const;
 
+      virtual void append_signature(QuerySignature& sig) const;
+
     protected:
       Memory memory;
       int bandwidth_weight;
@@ -152,11 +213,18 @@ namespace Realm {
       Processor random_match(void) const;
 
     protected:
+      // returns the (sorted) list of matches, evaluating the query only if
+      //  no query with the same signature has been evaluated since the last
+      //  machine update - must be called with the machine's mutex held
+      const std::vector<Processor>& find_matches(void) const;
+      void update_signature(void);
+
       int references;
       MachineImpl *machine;
       bool is_restricted;
       int restricted_node_id;
       std::vector<QueryPredicate<Processor> *> predicates;     
+      QuerySignature signature;
     };            
 
     class MemoryKindPredicate : public QueryPredicate<Memory> {
@@ -167,6 +235,8 @@ namespace Realm {
 
       virtual bool matches_predicate(MachineImpl *machine, Memory thing) const;
 
+      virtual void append_signature(QuerySignature& sig) const;
+
     protected:
       Memory::Kind kind;
     };
@@ -179,6 +249,8 @@ namespace Realm {
 
       virtual bool matches_predicate(MachineImpl *machine, Memory thing) const;
 
+      virtual void append_signature(QuerySignature& sig) const;
+
     protected:
       Processor proc;
       unsigned min_bandwidth;
@@ -193,6 +265,8 @@ namespace Realm {
 
       virtual bool matches_predicate(MachineImpl *machine, Memory thing) const;
 
+      virtual void append_signature(QuerySignature& sig) const;
+
     protected:
       Memory memory;
       unsigned min_bandwidth;
@@ -207,6 +281,8 @@ namespace Realm {
 
       virtual bool matches_predicate(MachineImpl *machine, Memory thing) const;
 
+      virtual void append_signature(QuerySignature& sig) const;
+
     protected:
       Processor proc;
       int bandwidth_weight;
@@ -221,6 +297,8 @@ namespace Realm {
 
       virtual bool matches_predicate(MachineImpl *machine, Memory thing) const;
 
+      virtual void append_signature(QuerySignature& sig) const;
+
     protected:
       Memory memory;
       int bandwidth_weight;
@@ -251,11 +329,18 @@ namespace Realm {
       Memory random_match(void) const;
 
     protected:
+      // returns the (sorted) list of matches, evaluating the query only if
+      //  no query with the same signature has been evaluated since the last
+      //  machine update - must be called with the machine's mutex held
+      const std::vector<Memory>& find_matches(void) const;
+      void update_signature(void);
+
       int references;
       MachineImpl *machine;
       bool is_restricted;
       int restricted_node_id;
       std::vector<QueryPredicate<Memory> *> predicates;     
+      QuerySignature signature;
     };            
 
     extern MachineImpl *machine_singleton;
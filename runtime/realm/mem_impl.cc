@@ -57,6 +57,11 @@ namespace Realm {
       return get_runtime()->get_memory_impl(*this)->size;
     }
 
+    size_t Memory::largest_free_block(void) const
+    {
+      return get_runtime()->get_memory_impl(*this)->largest_free_block();
+    }
+
     // reports a problem with a memory in general (this is primarily for fault injection)
     void Memory::report_memory_fault(int reason,
 				     const void *reason_data,
@@ -232,6 +237,19 @@ namespace Realm {
       }
     }
 
+    size_t MemoryImpl::largest_free_block_local(void)
+    {
+      AutoHSLLock al(mutex);
+
+      off_t largest = 0;
+      for(std::map<off_t, off_t>::const_iterator it = free_blocks.begin();
+	  it != free_blocks.end();
+	  it++)
+	if(it->second > largest)
+	  largest = it->second;
+      return largest;
+    }
+
     off_t MemoryImpl::alloc_bytes_remote(size_t size)
     {
       // RPC over to owner's node for allocation
@@ -514,6 +532,11 @@ namespace Realm {
     free_bytes_local(offset, size);
   }
 
+  size_t LocalCPUMemory::largest_free_block(void)
+  {
+    return largest_free_block_local();
+  }
+
   void LocalCPUMemory::get_bytes(off_t offset, void *dst, size_t size)
   {
     memcpy(dst, base+offset, size);
@@ -102,6 +102,7 @@ namespace Realm {
 
       off_t alloc_bytes_local(size_t size);
       void free_bytes_local(off_t offset, size_t size);
+      size_t largest_free_block_local(void);
 
       off_t alloc_bytes_remote(size_t size);
       void free_bytes_remote(off_t offset, size_t size);
@@ -109,6 +110,9 @@ namespace Realm {
       virtual off_t alloc_bytes(size_t size) = 0;
       virtual void free_bytes(off_t offset, size_t size) = 0;
 
+      // memories that allocate from the local free list override this
+      virtual size_t largest_free_block(void) { return size; }
+
       virtual void get_bytes(off_t offset, void *dst, size_t size) = 0;
       virtual void put_bytes(off_t offset, const void *src, size_t size) = 0;
 
@@ -160,6 +164,7 @@ namespace Realm {
 				    bool local_destroy);
       virtual off_t alloc_bytes(size_t size);
       virtual void free_bytes(off_t offset, size_t size);
+      virtual size_t largest_free_block(void);
       virtual void get_bytes(off_t offset, void *dst, size_t size);
       virtual void put_bytes(off_t offset, const void *src, size_t size);
       virtual void *get_direct_ptr(off_t offset, size_t size);
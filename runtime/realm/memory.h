@@ -62,6 +62,9 @@ namespace Realm {
       Kind kind(void) const;
       // Return the maximum capacity of this memory
       size_t capacity(void) const;
+      // Return the size of the largest contiguous free block in this memory
+      //  (memories that don't track their free space return their capacity)
+      size_t largest_free_block(void) const;
 
       // reports a problem with a memory in general (this is primarily for fault injection)
       void report_memory_fault(int reason,
@@ -20,11 +20,38 @@
 #include "event_impl.h"
 #include "inst_impl.h"
 #include "runtime_impl.h"
+#include "timers.h"
 
 namespace Realm {
 
   Logger log_metadata("metadata");
 
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // struct MetadataStats
+  //
+
+  /*static*/ size_t MetadataStats::requests = 0;
+  /*static*/ size_t MetadataStats::request_msgs = 0;
+  /*static*/ size_t MetadataStats::pushes = 0;
+  /*static*/ size_t MetadataStats::stalls = 0;
+  /*static*/ long long MetadataStats::stall_ns = 0;
+
+  /*static*/ void MetadataStats::record_stall(long long ns /*= 0*/)
+  {
+    __sync_fetch_and_add(&stalls, 1);
+    if(ns > 0)
+      __sync_fetch_and_add(&stall_ns, ns);
+  }
+
+  /*static*/ void MetadataStats::report(void)
+  {
+    log_metadata.info() << "metadata: node=" << gasnet_mynode()
+			<< " requests=" << requests << " msgs=" << request_msgs
+			<< " pushes=" << pushes << " stalls=" << stalls
+			<< " stall_time=" << (stall_ns / 1000) << "us";
+  }
+
   ////////////////////////////////////////////////////////////////////////
   //
   // class MetadataBase
@@ -44,17 +71,33 @@ namespace Realm {
       state = STATE_VALID;
     }
 
-    void MetadataBase::handle_request(int requestor)
+    bool MetadataBase::handle_request(int requestor)
     {
       // just add the requestor to the list of remote nodes with copies
       AutoHSLLock a(mutex);
 
       assert(is_valid());
-      assert(!remote_copies.contains(requestor));
+      // if the requestor has already been pushed a copy, that copy will satisfy
+      //  the request - never having two copies in flight to a node means an
+      //  invalidation that overtakes a copy only ever has one copy to drop
+      if(remote_copies.contains(requestor))
+	return false;
       remote_copies.add(requestor);
+      return true;
+    }
+
+    bool MetadataBase::add_remote_copy(int node)
+    {
+      AutoHSLLock a(mutex);
+
+      assert(is_valid());
+      if(remote_copies.contains(node))
+	return false;
+      remote_copies.add(node);
+      return true;
     }
 
-    void MetadataBase::handle_response(void)
+    void MetadataBase::handle_response(const void *data, size_t datalen)
     {
       // update the state, and
       // if there was an event, we'll trigger it
@@ -65,12 +108,34 @@ namespace Realm {
 	switch(state) {
 	case STATE_REQUESTED:
 	  {
+	    deserialize(data, datalen);
+	    __sync_synchronize();  // data must be visible before the state change
 	    to_trigger = valid_event;
 	    valid_event = Event::NO_EVENT;
 	    state = STATE_VALID;
 	    break;
 	  }
 
+	case STATE_INVALID:
+	  {
+	    // data pushed to us before anybody asked for it
+	    deserialize(data, datalen);
+	    __sync_synchronize();  // data must be visible before the state change
+	    state = STATE_VALID;
+	    break;
+	  }
+
+	case STATE_INVALIDATE:
+	  {
+	    // the invalidation overtook this copy, so the data is stale - drop it
+	    //  (anybody that asked for it is woken up, but it's up to the app to
+	    //  not use an instance that's being destroyed)
+	    to_trigger = valid_event;
+	    valid_event = Event::NO_EVENT;
+	    state = STATE_INVALID;
+	    break;
+	  }
+
 	default:
 	  assert(0);
 	}
@@ -90,6 +155,18 @@ namespace Realm {
       assert(((unsigned)owner) != gasnet_mynode());
 
       Event e = Event::NO_EVENT;
+      if(start_request(e)) {
+	__sync_fetch_and_add(&MetadataStats::requests, 1);
+	__sync_fetch_and_add(&MetadataStats::request_msgs, 1);
+	MetadataRequestMessage::send_request(owner, id);
+      }
+
+      return e;
+    }
+
+    bool MetadataBase::start_request(Event& e)
+    {
+      e = Event::NO_EVENT;
       bool issue_request = false;
       {
 	AutoHSLLock a(mutex);
@@ -128,10 +205,7 @@ namespace Realm {
 	}
       }
 
-      if(issue_request)
-	MetadataRequestMessage::send_request(owner, id);
-
-      return e;
+      return issue_request;
     }
 
     void MetadataBase::await_data(bool block /*= true*/)
@@ -149,8 +223,11 @@ namespace Realm {
 	e = valid_event;
       }
 
-      if(!e.has_triggered())
+      if(!e.has_triggered()) {
+	long long t_start = Clock::current_time_in_nanoseconds();
         e.wait(); // FIXME
+	MetadataStats::record_stall(Clock::current_time_in_nanoseconds() - t_start);
+      }
     }
 
     bool MetadataBase::initiate_cleanup(ID::IDType id)
@@ -198,6 +275,14 @@ namespace Realm {
 	  break;
 	}
 
+      case STATE_INVALID:
+	{
+	  // the owner pushed us a copy and the invalidation got here first - the
+	  //  invalidation is still acked, and the copy is dropped when it arrives
+	  state = STATE_INVALIDATE;
+	  break;
+	}
+
       default:
 	assert(0);
       }
@@ -217,6 +302,64 @@ namespace Realm {
       return last_copy;
     }
 
+
+  bool request_instance_metadata(const std::vector<RegionInstance>& insts,
+				 std::set<Event>& events)
+  {
+    bool all_valid = true;
+    std::map<gasnet_node_t, std::vector<ID::IDType> > to_request;
+
+    for(std::vector<RegionInstance>::const_iterator it = insts.begin();
+	it != insts.end();
+	it++) {
+      RegionInstanceImpl *impl = get_runtime()->get_instance_impl(*it);
+      if(impl->metadata.is_valid()) continue;
+
+      gasnet_node_t owner = ID(*it).instance.owner_node;
+      assert(owner != gasnet_mynode());
+
+      Event e;
+      if(impl->metadata.start_request(e))
+	to_request[owner].push_back(it->id);
+      if(e.exists() && !e.has_triggered()) {
+	events.insert(e);
+	all_valid = false;
+      }
+    }
+
+    for(std::map<gasnet_node_t, std::vector<ID::IDType> >::const_iterator it = to_request.begin();
+	it != to_request.end();
+	it++) {
+      __sync_fetch_and_add(&MetadataStats::requests, it->second.size());
+      __sync_fetch_and_add(&MetadataStats::request_msgs, 1);
+      if(it->second.size() == 1)
+	MetadataRequestMessage::send_request(it->first, it->second[0]);
+      else
+	MetadataBatchRequestMessage::send_request(it->first, it->second);
+    }
+
+    return all_valid;
+  }
+
+  void push_instance_metadata(RegionInstance inst, gasnet_node_t target)
+  {
+    // only the owner knows (and tracks) who has copies
+    if(ID(inst).instance.owner_node != gasnet_mynode()) return;
+    if(target == gasnet_mynode()) return;
+
+    RegionInstanceImpl *impl = get_runtime()->get_instance_impl(inst);
+    if(!impl->metadata.is_valid()) return;
+    if(!impl->metadata.add_remote_copy(target)) return;
+
+    size_t datalen = 0;
+    void *data = impl->metadata.serialize(datalen);
+
+    log_metadata.info("metadata for " IDFMT " pushed to %d - %zd bytes",
+		      inst.id, target, datalen);
+    __sync_fetch_and_add(&MetadataStats::pushes, 1);
+    MetadataResponseMessage::send_request(target, inst.id, data, datalen, PAYLOAD_FREE);
+  }
+
   
   ////////////////////////////////////////////////////////////////////////
   //
@@ -232,7 +375,11 @@ namespace Realm {
     ID id(args.id);
     if(id.is_instance()) {
       RegionInstanceImpl *impl = get_runtime()->get_instance_impl(args.id);
-      impl->metadata.handle_request(args.node);
+      if(!impl->metadata.handle_request(args.node)) {
+	log_metadata.info("metadata for " IDFMT " requested by %d - already pushed",
+			  args.id, args.node);
+	return;
+      }
       data = impl->metadata.serialize(datalen);
     } else {
       assert(0);
@@ -269,8 +416,7 @@ namespace Realm {
     ID id(args.id);
     if(id.is_instance()) {
       RegionInstanceImpl *impl = get_runtime()->get_instance_impl(args.id);
-      impl->metadata.deserialize(data, datalen);
-      impl->metadata.handle_response();
+      impl->metadata.handle_response(data, datalen);
     } else {
       assert(0);
     }
@@ -288,6 +434,105 @@ namespace Realm {
     Message::request(target, args, data, datalen, payload_mode);
   }
   
+
+
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class MetadataBatchRequestMessage
+  //
+
+  namespace {
+    // each record in a batched response is padded so the next id stays aligned
+    inline size_t batch_record_size(size_t datalen)
+    {
+      return (sizeof(ID::IDType) + sizeof(size_t) + ((datalen + 7) & ~(size_t)7));
+    }
+  };
+
+  /*static*/ void MetadataBatchRequestMessage::handle_request(RequestArgs args,
+							      const void *data,
+							      size_t datalen)
+  {
+    const ID::IDType *ids = (const ID::IDType *)data;
+    size_t count = datalen / sizeof(ID::IDType);
+    assert((count * sizeof(ID::IDType)) == datalen);
+
+    // serialize everything first so we know how big the response is - objects
+    //  that have already been pushed to the requestor are left out
+    std::vector<ID::IDType> resp_ids;
+    std::vector<std::pair<void *, size_t> > pieces;
+    size_t total = 0;
+    for(size_t i = 0; i < count; i++) {
+      ID id(ids[i]);
+      assert(id.is_instance());
+      RegionInstanceImpl *impl = get_runtime()->get_instance_impl(ids[i]);
+      if(!impl->metadata.handle_request(args.node)) continue;
+      size_t piece_size = 0;
+      void *piece = impl->metadata.serialize(piece_size);
+      resp_ids.push_back(ids[i]);
+      pieces.push_back(std::make_pair(piece, piece_size));
+      total += batch_record_size(piece_size);
+    }
+
+    log_metadata.info("metadata for %zd objects requested by %d - %zd already pushed, %zd bytes",
+		      count, args.node, count - resp_ids.size(), total);
+
+    if(resp_ids.empty())
+      return;
+
+    char *msgdata = (char *)malloc(total);
+    assert(msgdata != 0);
+    char *pos = msgdata;
+    for(size_t i = 0; i < resp_ids.size(); i++) {
+      memcpy(pos, &resp_ids[i], sizeof(ID::IDType));
+      memcpy(pos + sizeof(ID::IDType), &pieces[i].second, sizeof(size_t));
+      memcpy(pos + sizeof(ID::IDType) + sizeof(size_t), pieces[i].first, pieces[i].second);
+      pos += batch_record_size(pieces[i].second);
+      free(pieces[i].first);
+    }
+
+    MetadataBatchResponseMessage::RequestArgs resp_args;
+    resp_args.count = resp_ids.size();
+    MetadataBatchResponseMessage::Message::request(args.node, resp_args,
+						   msgdata, total, PAYLOAD_FREE);
+  }
+
+  /*static*/ void MetadataBatchRequestMessage::send_request(gasnet_node_t target,
+							    const std::vector<ID::IDType>& ids)
+  {
+    RequestArgs args;
+
+    args.node = gasnet_mynode();
+    Message::request(target, args, &ids[0], ids.size() * sizeof(ID::IDType), PAYLOAD_COPY);
+  }
+
+
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class MetadataBatchResponseMessage
+  //
+
+  /*static*/ void MetadataBatchResponseMessage::handle_request(RequestArgs args,
+							       const void *data,
+							       size_t datalen)
+  {
+    log_metadata.info("metadata for %d objects received - %zd bytes",
+		      args.count, datalen);
+
+    const char *pos = (const char *)data;
+    for(int i = 0; i < args.count; i++) {
+      ID::IDType id;
+      size_t len;
+      memcpy(&id, pos, sizeof(ID::IDType));
+      memcpy(&len, pos + sizeof(ID::IDType), sizeof(size_t));
+      assert(ID(id).is_instance());
+      RegionInstanceImpl *impl = get_runtime()->get_instance_impl(id);
+      impl->metadata.handle_response(pos + sizeof(ID::IDType) + sizeof(size_t), len);
+      pos += batch_record_size(len);
+    }
+    assert(pos == ((const char *)data + datalen));
+  }
+
   
   ////////////////////////////////////////////////////////////////////////
   //
@@ -27,11 +27,12 @@
 namespace Realm {
 
   class GenEventImpl;
+  class RegionInstance;
 
     class MetadataBase {
     public:
       MetadataBase(void);
-      ~MetadataBase(void);
+      virtual ~MetadataBase(void);
 
       enum State { STATE_INVALID,
 		   STATE_VALID,
@@ -42,18 +43,32 @@ namespace Realm {
       bool is_valid(void) const { return state == STATE_VALID; }
 
       void mark_valid(void); // used by owner
-      void handle_request(int requestor);
+      // returns false if the requestor has already been sent a copy (i.e. a push
+      //  that is still in flight), in which case no response should be sent
+      bool handle_request(int requestor);
 
       // returns an Event for when data will be valid
       Event request_data(int owner, ID::IDType id);
+      // the first half of request_data - returns true if the caller is responsible
+      //  for sending the request, and sets 'e' to the event for when data will be valid
+      bool start_request(Event& e);
       void await_data(bool block = true);  // request must have already been made
-      void handle_response(void);
+      // applies a response (or a push) - the state check, the deserialization and the
+      //  state change all happen under the lock, so the data can't change underneath
+      //  anybody that sees the metadata become valid
+      void handle_response(const void *data, size_t datalen);
       void handle_invalidate(void);
 
+      // used by the owner to push a copy to a node that will probably need it -
+      //  returns false if 'node' already has (or has asked for) a copy
+      bool add_remote_copy(int node);
+
       // these return true once all remote copies have been invalidated
       bool initiate_cleanup(ID::IDType id);
       bool handle_inval_ack(int sender);
 
+      virtual void deserialize(const void *in_data, size_t in_size) = 0;
+
     protected:
       GASNetHSL mutex;
       State state;  // current state
@@ -61,6 +76,32 @@ namespace Realm {
       NodeSet remote_copies;
     };
 
+    // requests the metadata for a set of instances at once - instances whose
+    //  metadata is already valid (or requested) are skipped, and the rest are
+    //  requested with a single message per owner
+    // returns true if all of the metadata is valid, otherwise adds the events for
+    //  the data still in flight to 'events' - the caller only needs to merge them
+    //  if it's actually going to wait
+    bool request_instance_metadata(const std::vector<RegionInstance>& insts,
+				   std::set<Event>& events);
+
+    // sends a locally-owned instance's metadata to a node that is about to need
+    //  it (e.g. one that will perform a copy), saving that node a round trip
+    void push_instance_metadata(RegionInstance inst, gasnet_node_t target);
+
+    // counters of metadata traffic and of the stalls it causes - these are
+    //  reported at shutdown by the 'metadata' logger at the info level
+    struct MetadataStats {
+      static size_t requests;      // objects requested from their owners
+      static size_t request_msgs;  // messages those requests were sent in
+      static size_t pushes;        // objects sent to other nodes unasked
+      static size_t stalls;        // times a consumer had to wait for metadata
+      static long long stall_ns;   // time spent blocked in await_data
+
+      static void record_stall(long long ns = 0);
+      static void report(void);
+    };
+
     // active messages
     
     struct MetadataRequestMessage {
@@ -93,6 +134,35 @@ namespace Realm {
 			       const void *data, size_t datalen, int payload_mode);
     };
 
+    // requests for several objects owned by the target, in one message
+    struct MetadataBatchRequestMessage {
+      struct RequestArgs : public BaseMedium {
+	int node;
+      };
+
+      static void handle_request(RequestArgs args, const void *data, size_t datalen);
+
+      typedef ActiveMessageMediumNoReply<METADATA_BATCH_REQUEST_MSGID,
+					 RequestArgs,
+					 handle_request> Message;
+
+      static void send_request(gasnet_node_t target, const std::vector<ID::IDType>& ids);
+    };
+
+    // the responses to a batched request - the payload is a sequence of
+    //  (id, length, data padded to 8 bytes) records
+    struct MetadataBatchResponseMessage {
+      struct RequestArgs : public BaseMedium {
+	int count;
+      };
+
+      static void handle_request(RequestArgs args, const void *data, size_t datalen);
+
+      typedef ActiveMessageMediumNoReply<METADATA_BATCH_RESPONSE_MSGID,
+					 RequestArgs,
+					 handle_request> Message;
+    };
+
     struct MetadataInvalidateMessage {
       struct RequestArgs {
 	int owner;
@@ -18,11 +18,161 @@
 #include "faults.h"
 #include "runtime_impl.h"
 
+#include <errno.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 namespace Realm {
 
   Logger log_optable("optable");
 
 
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class HardwareCounterGroup
+  //
+
+  // a group of perf_event counters for the calling kernel thread - these are
+  //  opened lazily the first time a thread runs an operation that wants them
+  //  and then left running for the life of the thread, so each sample is a
+  //  single read() of the whole group
+  class HardwareCounterGroup {
+  public:
+    enum CounterIndex {
+      HWC_CYCLES,
+      HWC_INSTRUCTIONS,
+      HWC_LLC_REFERENCES,
+      HWC_LLC_MISSES,
+      HWC_STALLED_CYCLES,
+      NUM_COUNTERS
+    };
+
+    // returns the calling thread's group, or 0 if counters are unavailable
+    static HardwareCounterGroup *get_thread_group(void);
+
+    // fills in 'values' (one per CounterIndex) - counters that could not be
+    //  opened are reported as INVALID_COUNT - along with the times the group
+    //  has been enabled and actually counting (these differ if the kernel
+    //  multiplexed the counters)
+    bool read_counters(long long *values,
+		       long long& time_enabled, long long& time_running) const;
+
+  protected:
+    HardwareCounterGroup(void);
+
+    bool open_counters(void);
+
+    int leader_fd;
+    int num_open;
+    int group_slot[NUM_COUNTERS];  // position in the group read, or -1
+  };
+
+  namespace ThreadLocal {
+    // opened on first use - a failed open is remembered so we don't retry
+    static __thread HardwareCounterGroup *hw_counter_group = 0;
+    static __thread bool hw_counters_unavailable = false;
+  };
+
+  HardwareCounterGroup::HardwareCounterGroup(void)
+    : leader_fd(-1), num_open(0)
+  {
+    for(int i = 0; i < NUM_COUNTERS; i++)
+      group_slot[i] = -1;
+  }
+
+  /*static*/ HardwareCounterGroup *HardwareCounterGroup::get_thread_group(void)
+  {
+    if(ThreadLocal::hw_counter_group != 0)
+      return ThreadLocal::hw_counter_group;
+    if(ThreadLocal::hw_counters_unavailable)
+      return 0;
+
+    HardwareCounterGroup *g = new HardwareCounterGroup;
+    if(!g->open_counters()) {
+      delete g;
+      ThreadLocal::hw_counters_unavailable = true;
+      return 0;
+    }
+    // the counters live as long as the thread does - the kernel releases the
+    //  descriptors when the process exits
+    ThreadLocal::hw_counter_group = g;
+    return g;
+  }
+
+  bool HardwareCounterGroup::open_counters(void)
+  {
+#ifdef __linux__
+    static const unsigned long long configs[NUM_COUNTERS] = {
+      PERF_COUNT_HW_CPU_CYCLES,
+      PERF_COUNT_HW_INSTRUCTIONS,
+      PERF_COUNT_HW_CACHE_REFERENCES,
+      PERF_COUNT_HW_CACHE_MISSES,
+      PERF_COUNT_HW_STALLED_CYCLES_BACKEND,
+    };
+
+    for(int i = 0; i < NUM_COUNTERS; i++) {
+      struct perf_event_attr attr;
+      memset(&attr, 0, sizeof(attr));
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.size = sizeof(attr);
+      attr.config = configs[i];
+      attr.read_format = (PERF_FORMAT_GROUP |
+			  PERF_FORMAT_TOTAL_TIME_ENABLED |
+			  PERF_FORMAT_TOTAL_TIME_RUNNING);
+      // user-mode only so that this works with perf_event_paranoid <= 2
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+
+      // pid = 0, cpu = -1: the calling thread, on whichever cpu it runs
+      int fd = syscall(__NR_perf_event_open, &attr, 0, -1, leader_fd, 0);
+      if(fd < 0) {
+	// without the cycle counter as a group leader, there's nothing to do
+	if(i == HWC_CYCLES) {
+	  log_optable.info() << "hardware counters unavailable: errno=" << errno;
+	  return false;
+	}
+	continue;
+      }
+      if(leader_fd < 0)
+	leader_fd = fd;
+      group_slot[i] = num_open++;
+    }
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  bool HardwareCounterGroup::read_counters(long long *values,
+					   long long& time_enabled,
+					   long long& time_running) const
+  {
+#ifdef __linux__
+    // read_format layout: count, time enabled, time running, then one value
+    //  per group member
+    unsigned long long buffer[3 + NUM_COUNTERS];
+    ssize_t amt = read(leader_fd, buffer, sizeof(buffer));
+    if((amt < (ssize_t)(3 * sizeof(unsigned long long))) ||
+       (buffer[0] != (unsigned long long)num_open))
+      return false;
+    time_enabled = buffer[1];
+    time_running = buffer[2];
+    for(int i = 0; i < NUM_COUNTERS; i++)
+      values[i] = ((group_slot[i] >= 0) ?
+		     (long long)buffer[3 + group_slot[i]] :
+		     ProfilingMeasurements::OperationHardwareCounters::INVALID_COUNT);
+    return true;
+#else
+    return false;
+#endif
+  }
+
+
   ////////////////////////////////////////////////////////////////////////
   //
   // class Operation
@@ -77,6 +227,7 @@ namespace Realm {
       {
 	// normal behavior
 	timeline.record_start_time();
+	start_hardware_counters();
 	return true;
       }
 
@@ -96,6 +247,7 @@ namespace Realm {
 
   void Operation::mark_finished(bool successful)
   {
+    stop_hardware_counters();
     timeline.record_end_time();
 
     // update this count first
@@ -111,6 +263,8 @@ namespace Realm {
 
   void Operation::mark_terminated(int error_code, const ByteArray& details)
   {
+    stop_hardware_counters();
+
     // attempt to switch from RUNNING -> TERMINATED_EARLY
     Status::Result prev = __sync_val_compare_and_swap(&status.result,
 						      Status::RUNNING,
@@ -220,6 +374,129 @@ namespace Realm {
     }
   }
 
+  // samples the calling thread's counters into 'values' - returns the group
+  //  that was read, or 0 if no sample could be taken
+  static HardwareCounterGroup *sample_hw_counters(ProfilingMeasurements::OperationHardwareCounters& values,
+						  long long& time_enabled,
+						  long long& time_running)
+  {
+    HardwareCounterGroup *g = HardwareCounterGroup::get_thread_group();
+    if(!g)
+      return 0;
+
+    long long raw[HardwareCounterGroup::NUM_COUNTERS];
+    if(!g->read_counters(raw, time_enabled, time_running))
+      return 0;
+
+    values.cycles = raw[HardwareCounterGroup::HWC_CYCLES];
+    values.instructions = raw[HardwareCounterGroup::HWC_INSTRUCTIONS];
+    values.llc_references = raw[HardwareCounterGroup::HWC_LLC_REFERENCES];
+    values.llc_misses = raw[HardwareCounterGroup::HWC_LLC_MISSES];
+    values.stalled_cycles = raw[HardwareCounterGroup::HWC_STALLED_CYCLES];
+    return g;
+  }
+
+  static inline void hw_counter_init(long long& total, long long start_value)
+  {
+    total = ((start_value != ProfilingMeasurements::OperationHardwareCounters::INVALID_COUNT) ?
+	       0 :
+	       ProfilingMeasurements::OperationHardwareCounters::INVALID_COUNT);
+  }
+
+  // adds the change in one counter over an interval, scaled up to account for
+  //  any time the kernel had the counters multiplexed out
+  static inline void hw_counter_accumulate(long long& total,
+					   long long start_value, long long end_value,
+					   long long d_enabled, long long d_running)
+  {
+    if((total == ProfilingMeasurements::OperationHardwareCounters::INVALID_COUNT) ||
+       (start_value == ProfilingMeasurements::OperationHardwareCounters::INVALID_COUNT) ||
+       (end_value == ProfilingMeasurements::OperationHardwareCounters::INVALID_COUNT))
+      return;
+    long long delta = end_value - start_value;
+    if((d_running > 0) && (d_running < d_enabled))
+      delta = (long long)((double)delta * d_enabled / d_running);
+    total += delta;
+  }
+
+  void Operation::start_hardware_counters(void)
+  {
+    if(!wants_hw_counters)
+      return;
+
+    HardwareCounterGroup *g = sample_hw_counters(hw_counter_start,
+						 hw_time_enabled_start,
+						 hw_time_running_start);
+    if(!g)
+      return;
+
+    // totals start at zero for every counter that is available
+    hw_counter_init(hw_counters.cycles, hw_counter_start.cycles);
+    hw_counter_init(hw_counters.instructions, hw_counter_start.instructions);
+    hw_counter_init(hw_counters.llc_references, hw_counter_start.llc_references);
+    hw_counter_init(hw_counters.llc_misses, hw_counter_start.llc_misses);
+    hw_counter_init(hw_counters.stalled_cycles, hw_counter_start.stalled_cycles);
+    hw_counters_valid = true;
+    hw_counter_owner = g;
+  }
+
+  void Operation::pause_hardware_counters(void)
+  {
+    if(!hw_counter_owner)
+      return;
+
+    // counters are per kernel thread, so an interval is only meaningful if it
+    //  ends on the same thread it started on
+    ProfilingMeasurements::OperationHardwareCounters end;
+    long long time_enabled, time_running;
+    HardwareCounterGroup *g = sample_hw_counters(end, time_enabled, time_running);
+    const void *owner = hw_counter_owner;
+    hw_counter_owner = 0;
+    if(!g || (g != owner)) {
+      hw_counters_valid = false;
+      return;
+    }
+
+    long long d_enabled = time_enabled - hw_time_enabled_start;
+    long long d_running = time_running - hw_time_running_start;
+    hw_counter_accumulate(hw_counters.cycles, hw_counter_start.cycles,
+			  end.cycles, d_enabled, d_running);
+    hw_counter_accumulate(hw_counters.instructions, hw_counter_start.instructions,
+			  end.instructions, d_enabled, d_running);
+    hw_counter_accumulate(hw_counters.llc_references, hw_counter_start.llc_references,
+			  end.llc_references, d_enabled, d_running);
+    hw_counter_accumulate(hw_counters.llc_misses, hw_counter_start.llc_misses,
+			  end.llc_misses, d_enabled, d_running);
+    hw_counter_accumulate(hw_counters.stalled_cycles, hw_counter_start.stalled_cycles,
+			  end.stalled_cycles, d_enabled, d_running);
+  }
+
+  void Operation::resume_hardware_counters(void)
+  {
+    if(!hw_counters_valid || hw_counter_owner)
+      return;
+
+    // the operation may resume on a different kernel thread - that's fine,
+    //  since each interval is sampled start to end on one thread
+    HardwareCounterGroup *g = sample_hw_counters(hw_counter_start,
+						 hw_time_enabled_start,
+						 hw_time_running_start);
+    if(!g) {
+      hw_counters_valid = false;
+      return;
+    }
+    hw_counter_owner = g;
+  }
+
+  void Operation::stop_hardware_counters(void)
+  {
+    pause_hardware_counters();
+    if(!hw_counters_valid)
+      return;
+    hw_counters_valid = false;
+    measurements.add_measurement(hw_counters);
+  }
+
   void Operation::trigger_finish_event(bool poisoned)
   {
     if(finish_event.exists())
@@ -257,17 +534,110 @@ namespace Realm {
 
   ////////////////////////////////////////////////////////////////////////
   //
-  // class OperationTable::TableEntry
+  // class OperationTable::Shard
   //
 
-#if 0
-  OperationTable::TableEntry::TableEntry(Event _finish_event)
-    : finish_event(_finish_event)
-    , local_op(0)
-    , remote_node(-1)
-    , pending_cancellation(false)
-  {}
-#endif
+  OperationTable::Shard::Shard(void)
+    : log2_buckets(LOG2_INITIAL_BUCKETS), num_entries(0), free_entries(0)
+  {
+    buckets = new TableEntry *[1 << log2_buckets];
+    for(size_t i = 0; i < ((size_t)1 << log2_buckets); i++)
+      buckets[i] = 0;
+  }
+
+  OperationTable::Shard::~Shard(void)
+  {
+    for(size_t i = 0; i < ((size_t)1 << log2_buckets); i++)
+      while(buckets[i]) {
+	TableEntry *next = buckets[i]->next;
+	delete buckets[i];
+	buckets[i] = next;
+      }
+    delete[] buckets;
+    while(free_entries) {
+      TableEntry *next = free_entries->next;
+      delete free_entries;
+      free_entries = next;
+    }
+  }
+
+  size_t OperationTable::Shard::bucket_index(Event finish_event) const
+  {
+    // the top bits of the hash picked the shard - use the ones right below
+    return (size_t)((hash_event(finish_event) << LOG2_NUM_SHARDS) >> (64 - log2_buckets));
+  }
+
+  // caller must hold the shard's mutex for all of these
+  OperationTable::TableEntry *OperationTable::Shard::lookup(Event finish_event)
+  {
+    TableEntry *e = buckets[bucket_index(finish_event)];
+    while(e && (e->finish_event != finish_event))
+      e = e->next;
+    return e;
+  }
+
+  OperationTable::TableEntry *OperationTable::Shard::insert(Event finish_event)
+  {
+    // keep the average chain length at or below 1
+    if(num_entries >= ((size_t)1 << log2_buckets))
+      grow();
+
+    TableEntry *e;
+    if(free_entries) {
+      e = free_entries;
+      free_entries = e->next;
+    } else
+      e = new TableEntry;
+
+    e->finish_event = finish_event;
+    e->local_op = 0;
+    e->remote_node = -1;
+    e->pending_cancellation = false;
+    e->reason_data = 0;
+    e->reason_size = 0;
+
+    size_t idx = bucket_index(finish_event);
+    e->next = buckets[idx];
+    buckets[idx] = e;
+    num_entries++;
+    return e;
+  }
+
+  void OperationTable::Shard::remove(TableEntry *entry)
+  {
+    TableEntry **pp = &buckets[bucket_index(entry->finish_event)];
+    while(*pp != entry) {
+      assert(*pp != 0);
+      pp = &((*pp)->next);
+    }
+    *pp = entry->next;
+    num_entries--;
+
+    entry->next = free_entries;
+    free_entries = entry;
+  }
+
+  void OperationTable::Shard::grow(void)
+  {
+    TableEntry **old_buckets = buckets;
+    size_t old_count = (size_t)1 << log2_buckets;
+
+    log2_buckets++;
+    buckets = new TableEntry *[(size_t)1 << log2_buckets];
+    for(size_t i = 0; i < ((size_t)1 << log2_buckets); i++)
+      buckets[i] = 0;
+
+    for(size_t i = 0; i < old_count; i++)
+      while(old_buckets[i]) {
+	TableEntry *e = old_buckets[i];
+	old_buckets[i] = e->next;
+	size_t idx = bucket_index(e->finish_event);
+	e->next = buckets[idx];
+	buckets[idx] = e;
+      }
+    delete[] old_buckets;
+  }
+
 
   ////////////////////////////////////////////////////////////////////////
   //
@@ -307,6 +677,13 @@ namespace Realm {
   OperationTable::~OperationTable(void)
   {}
 
+  /*static*/ unsigned long long OperationTable::hash_event(Event finish_event)
+  {
+    // multiplicative hashing - consecutive event IDs (and generations) end
+    //  up spread over the high bits
+    return (finish_event.id * 0x9E3779B97F4A7C15ULL);
+  }
+
   // Operations are 'owned' by the table - the table will free them once it
   //  gets the completion event for it
   void OperationTable::add_local_operation(Event finish_event, Operation *local_op)
@@ -314,30 +691,23 @@ namespace Realm {
     // cast local_op to void * to avoid pretty-printing
     log_optable.info() << "event " << finish_event << " added: local_op=" << (void *)local_op;
 
-    // "hash" the id to figure out which subtable to use
-    int subtable = finish_event.id % NUM_TABLES;
-    GASNetHSL& mutex = mutexes[subtable];
-    Table& table = tables[subtable];
+    Shard& shard = shards[hash_event(finish_event) >> (64 - LOG2_NUM_SHARDS)];
 
     bool cancel_immediately = false;
     void *reason_data = 0;
     size_t reason_size = 0;
     {
-      AutoHSLLock al(mutex);
+      AutoHSLLock al(shard.mutex);
 
       // see if we have any info for this event?
-      Table::iterator it = table.find(finish_event);
-      if(it == table.end()) {
+      TableEntry *it = shard.lookup(finish_event);
+      if(!it) {
 	// new entry - create one and it inherits the refcount
-	TableEntry& e = table[finish_event];
-	e.local_op = local_op;
-	e.remote_node = -1;
-	e.pending_cancellation = false;
-	e.reason_data = 0;
-	e.reason_size = 0;
+	TableEntry *e = shard.insert(finish_event);
+	e->local_op = local_op;
       } else {
 	// existing entry should only occur if there's a pending cancellation
-	TableEntry& e = it->second;
+	TableEntry& e = *it;
 	assert(e.local_op == 0);
 	assert(e.remote_node == -1);
 	assert(e.pending_cancellation);
@@ -371,24 +741,17 @@ namespace Realm {
   {
     log_optable.info() << "event " << finish_event << " added: remote_node=" << remote_node;
 
-    // "hash" the id to figure out which subtable to use
-    int subtable = finish_event.id % NUM_TABLES;
-    GASNetHSL& mutex = mutexes[subtable];
-    Table& table = tables[subtable];
+    Shard& shard = shards[hash_event(finish_event) >> (64 - LOG2_NUM_SHARDS)];
 
     {
-      AutoHSLLock al(mutex);
+      AutoHSLLock al(shard.mutex);
 
       // no duplicates allowed here - a local cancellation request cannot occur until we
       //  return
-      assert(table.find(finish_event) == table.end());
-
-      TableEntry& e = table[finish_event];
-      e.local_op = 0;
-      e.remote_node = remote_node;
-      e.pending_cancellation = false;
-      e.reason_data = 0;
-      e.reason_size = 0;
+      assert(shard.lookup(finish_event) == 0);
+
+      TableEntry *e = shard.insert(finish_event);
+      e->remote_node = remote_node;
     }
 
     // we can remove this entry once we know the operation is complete
@@ -397,23 +760,20 @@ namespace Realm {
 
   void OperationTable::event_triggered(Event finish_event)
   {
-    // "hash" the id to figure out which subtable to use
-    int subtable = finish_event.id % NUM_TABLES;
-    GASNetHSL& mutex = mutexes[subtable];
-    Table& table = tables[subtable];
+    Shard& shard = shards[hash_event(finish_event) >> (64 - LOG2_NUM_SHARDS)];
 
     Operation *local_op = 0;
     {
-      AutoHSLLock al(mutex);
+      AutoHSLLock al(shard.mutex);
 
       // get the entry - it must exist
-      Table::iterator it = table.find(finish_event);
-      assert(it != table.end());
+      TableEntry *it = shard.lookup(finish_event);
+      assert(it != 0);
 
       // if there was a local op, remember it so we can remove the reference outside of this mutex
-      local_op = it->second.local_op;
+      local_op = it->local_op;
 
-      table.erase(it);
+      shard.remove(it);
     }
 
     log_optable.info() << "event " << finish_event << " cleaned: local_op=" << (void *)local_op;
@@ -425,30 +785,27 @@ namespace Realm {
   void OperationTable::request_cancellation(Event finish_event,
 					    const void *reason_data, size_t reason_size)
   {
-    // "hash" the id to figure out which subtable to use
-    int subtable = finish_event.id % NUM_TABLES;
-    GASNetHSL& mutex = mutexes[subtable];
-    Table& table = tables[subtable];
+    Shard& shard = shards[hash_event(finish_event) >> (64 - LOG2_NUM_SHARDS)];
 
     bool found = false;
     Operation *local_op = 0;
     int remote_node = -1;
     {
-      AutoHSLLock al(mutex);
+      AutoHSLLock al(shard.mutex);
 
-      Table::iterator it = table.find(finish_event);
+      TableEntry *it = shard.lookup(finish_event);
 
-      if(it != table.end()) {
+      if(it != 0) {
 	found = true;
 
 	// if there's a local op, we need to take a reference in case it completes successfully
 	//  before we get to it below
-	if(it->second.local_op) {
-	  local_op = it->second.local_op;
+	if(it->local_op) {
+	  local_op = it->local_op;
 	  local_op->add_reference();
 	}
-	remote_node = it->second.remote_node;
-	assert(!it->second.pending_cancellation);
+	remote_node = it->remote_node;
+	assert(!it->pending_cancellation);
       }
     }
 
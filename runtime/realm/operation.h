@@ -96,6 +96,17 @@ namespace Realm {
 
     void send_profiling_data(void);
 
+    // hardware counters are sampled by the thread executing the operation
+    //  around the main work item (tasks and dma requests alike)
+    void start_hardware_counters(void);
+    void stop_hardware_counters(void);
+  public:
+    // counting is suspended while the operation is blocked in a wait so that
+    //  whatever else runs on the kernel thread isn't charged to it
+    void pause_hardware_counters(void);
+    void resume_hardware_counters(void);
+  protected:
+
     Event finish_event;
     int refcount;
   public:
@@ -106,6 +117,12 @@ namespace Realm {
     ProfilingMeasurements::OperationTimeline timeline;
     bool wants_event_waits;
     ProfilingMeasurements::OperationEventWaits waits;
+    bool wants_hw_counters;
+    bool hw_counters_valid;        // started and every interval was sampled
+    const void *hw_counter_owner;  // per-thread counter group while counting
+    ProfilingMeasurements::OperationHardwareCounters hw_counters;  // accumulated
+    ProfilingMeasurements::OperationHardwareCounters hw_counter_start;
+    long long hw_time_enabled_start, hw_time_running_start;
     ProfilingRequestSet requests; 
     ProfilingMeasurementCollection measurements;
 
@@ -145,21 +162,47 @@ namespace Realm {
     };
 
     struct TableEntry {
-      //Event finish_event;
+      Event finish_event;
       Operation *local_op;
       int remote_node;
       bool pending_cancellation;
       void *reason_data;
       size_t reason_size;
+      TableEntry *next;  // next entry in the same hash bucket (or free list)
     };
-    typedef std::map<Event, TableEntry> Table;
 
-    // event table is protected by a mutex
-    // try to avoid a serial bottleneck by splitting events over 4 different tables
-    static const int NUM_TABLES = 4;
-    
-    GASNetHSL mutexes[NUM_TABLES];
-    Table tables[NUM_TABLES];
+    // the table is split into many independently-locked shards, each of which
+    //  is a chained hash table whose entries are recycled through a per-shard
+    //  free list, so adding and removing an operation is a hash and a few
+    //  pointer updates under an (almost always uncontended) lock
+    static const int LOG2_NUM_SHARDS = 6;
+    static const int NUM_SHARDS = 1 << LOG2_NUM_SHARDS;
+    static const int LOG2_INITIAL_BUCKETS = 6;
+
+    struct Shard {
+      Shard(void);
+      ~Shard(void);
+
+      TableEntry *lookup(Event finish_event);
+      TableEntry *insert(Event finish_event);
+      void remove(TableEntry *entry);
+
+    protected:
+      size_t bucket_index(Event finish_event) const;
+      void grow(void);
+
+    public:
+      GASNetHSL mutex;
+    protected:
+      TableEntry **buckets;
+      int log2_buckets;
+      size_t num_entries;
+      TableEntry *free_entries;
+    };
+
+    static unsigned long long hash_event(Event finish_event);
+
+    Shard shards[NUM_SHARDS];
     TableCleaner cleaner;
   };
 
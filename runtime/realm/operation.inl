@@ -38,6 +38,9 @@ namespace Realm {
     measurements.import_requests(requests); 
     timeline.record_create_time();
     wants_event_waits = measurements.wants_measurement<ProfilingMeasurements::OperationEventWaits>();
+    wants_hw_counters = measurements.wants_measurement<ProfilingMeasurements::OperationHardwareCounters>();
+    hw_counters_valid = false;
+    hw_counter_owner = 0;
   }
 
   inline void Operation::add_reference(void)
@@ -52,6 +52,10 @@ namespace Realm {
     //  2) "unget" adds it to the front of the list (i.e. LIFO order)
     void put(T item, priority_t priority, bool add_to_back = true);
 
+    // adds several items (to the back of their respective priority lists) with a
+    //  single acquisition of the lock - equivalent to calling put() on each in order
+    void put_multiple(const T *items, const priority_t *priorities, size_t count);
+
     // getting an item is always from the front of the list and can be filtered to
     //  ignore things that aren't above a specified priority
     // the priority of the retrieved item (if any) is returned in *item_priority
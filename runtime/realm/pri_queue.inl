@@ -90,6 +90,50 @@ namespace Realm {
     lock.unlock();
   }
 
+  // adds several items (to the back of their respective priority lists) with a
+  //  single acquisition of the lock - equivalent to calling put() on each in order
+  template <typename T, typename LT>
+  inline void PriorityQueue<T, LT>::put_multiple(const T *items,
+						 const priority_t *priorities,
+						 size_t count)
+  {
+    if(count == 0) return;
+
+    // increase the entry count (for everything) up front, if we care
+    if(entries_in_queue)
+      (*entries_in_queue) += (int)count;
+
+    size_t consumed = 0;
+
+    lock.lock();
+
+    for(size_t i = 0; i < count; i++) {
+      priority_t priority = priorities[i];
+      if(priority > PRI_MAX_FINITE)
+	priority = PRI_MAX_FINITE;
+      else if(priority < PRI_MIN_FINITE)
+	priority = PRI_MIN_FINITE;
+
+      // same notification logic as put()
+      if(priority > highest_priority) {
+	priority_t orig_highest = highest_priority;
+	highest_priority = priority;
+	if(perform_notifications(items[i], priority)) {
+	  highest_priority = orig_highest;
+	  consumed++;
+	  continue;
+	}
+      }
+
+      queue[-priority].push_back(items[i]); // remember negation...
+    }
+
+    lock.unlock();
+
+    if(entries_in_queue && (consumed > 0))
+      (*entries_in_queue) -= (int)consumed;
+  }
+
   // getting an item is always from the front of the list and can be filtered to
   //  ignore things that aren't above a specified priority
   // the priority of the retrieved item (if any) is returned in *item_priority
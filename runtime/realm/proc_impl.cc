@@ -20,6 +20,7 @@
 #include "logging.h"
 #include "serialize.h"
 #include "profiling.h"
+#include "event_graph.h"
 #include "utils.h"
 
 #include <sys/types.h>
@@ -135,6 +136,8 @@ namespace Realm {
                             priority, args, arglen);
 #endif
 
+      EventGraphTrace::record(EventGraphTrace::Record::REC_TASK_REQUEST, e, wait_on);
+
       p->spawn_task(func_id, args, arglen, ProfilingRequestSet(),
 		    wait_on, e, priority);
       return e;
@@ -160,11 +163,40 @@ namespace Realm {
                             priority, args, arglen);
 #endif
 
+      EventGraphTrace::record(EventGraphTrace::Record::REC_TASK_REQUEST, e, wait_on);
+
       p->spawn_task(func_id, args, arglen, reqs,
 		    wait_on, e, priority);
       return e;
     }
 
+    Event Processor::spawn_multiple(TaskFuncID func_id,
+				    const std::vector<SpawnRequest>& requests,
+				    std::vector<Event> *finish_events /*= 0*/) const
+    {
+      DetailedTimer::ScopedPush sp(TIME_LOW_LEVEL);
+      if(requests.empty())
+	return Event::NO_EVENT;
+
+      ProcessorImpl *p = get_runtime()->get_processor_impl(*this);
+
+      std::vector<Event> local_events;
+      std::vector<Event>& events = (finish_events ? *finish_events : local_events);
+      events.resize(requests.size());
+      for(size_t i = 0; i < requests.size(); i++) {
+	events[i] = GenEventImpl::create_genevent()->current_event();
+	EventGraphTrace::record(EventGraphTrace::Record::REC_TASK_REQUEST,
+				events[i], requests[i].wait_on);
+      }
+
+      p->spawn_tasks(func_id, requests, &events[0]);
+
+      if(events.size() == 1)
+	return events[0];
+      std::set<Event> all_events(events.begin(), events.end());
+      return Event::merge_events(all_events);
+    }
+
     AddressSpace Processor::address_space(void) const
     {
       // this is a hack for the Legion runtime, which only calls it on processor, not proc groups
@@ -331,6 +363,32 @@ namespace Realm {
       return finish_event;
     }
 
+    /*static*/ void Processor::spawn_continuation(TaskFuncID func_id,
+						 const void *args, size_t arglen,
+						 Event wait_on, int priority /*= 0*/)
+    {
+      DetailedTimer::ScopedPush sp(TIME_LOW_LEVEL);
+      // this only makes sense from inside a task
+      Task *task = dynamic_cast<Task *>(Thread::self()->get_operation());
+      assert(task != 0);
+
+      Processor p = get_executing_processor();
+      ProcessorImpl *impl = get_runtime()->get_processor_impl(p);
+
+      GenEventImpl *finish_event = GenEventImpl::create_genevent();
+      Event e = finish_event->current_event();
+
+      EventGraphTrace::record(EventGraphTrace::Record::REC_TASK_REQUEST, e, wait_on);
+
+      Task *cont = task->create_continuation(func_id, args, arglen, wait_on, e, priority);
+      get_runtime()->optable.add_local_operation(e, cont);
+
+      if(wait_on.has_triggered())
+	impl->enqueue_task(cont);
+      else
+	EventImpl::add_waiter(wait_on, new DeferredTaskSpawn(impl, cont));
+    }
+
     // reports an execution fault in the currently running task
     /*static*/ void Processor::report_execution_fault(int reason,
 						      const void *reason_data,
@@ -402,6 +460,16 @@ namespace Realm {
     {
     }
 
+    void ProcessorImpl::spawn_tasks(Processor::TaskFuncID func_id,
+				    const std::vector<Processor::SpawnRequest>& requests,
+				    const Event *finish_events)
+    {
+      ProfilingRequestSet reqs;
+      for(size_t i = 0; i < requests.size(); i++)
+	spawn_task(func_id, requests[i].args, requests[i].arglen, reqs,
+		   requests[i].wait_on, finish_events[i], requests[i].priority);
+    }
+
     void ProcessorImpl::execute_task(Processor::TaskFuncID func_id,
 				     const ByteArrayRef& task_args)
     {
@@ -847,6 +915,48 @@ namespace Realm {
     }
   }
 
+  void LocalTaskProcessor::spawn_tasks(Processor::TaskFuncID func_id,
+				       const std::vector<Processor::SpawnRequest>& requests,
+				       const Event *finish_events)
+  {
+    assert(func_id != 0);
+    size_t count = requests.size();
+
+    // one allocation for all the Task objects and their arguments
+    size_t total_arglen = 0;
+    for(size_t i = 0; i < count; i++)
+      total_arglen += requests[i].arglen;
+    TaskSlab *slab = TaskSlab::create(count, total_arglen);
+
+    ProfilingRequestSet reqs;
+    std::vector<Task *> ready_tasks;
+    std::vector<PriorityQueue<Task *, GASNetHSL>::priority_t> ready_priorities;
+    ready_tasks.reserve(count);
+    ready_priorities.reserve(count);
+
+    for(size_t i = 0; i < count; i++) {
+      const Processor::SpawnRequest& req = requests[i];
+      ByteArrayRef task_args = slab->add_args(req.args, req.arglen);
+      Task *task = new(slab) Task(me, func_id, task_args, reqs,
+				  req.wait_on, finish_events[i], req.priority);
+      get_runtime()->optable.add_local_operation(finish_events[i], task);
+
+      if(req.wait_on.has_triggered()) {
+	if(task->mark_ready()) {
+	  ready_tasks.push_back(task);
+	  ready_priorities.push_back(task->priority);
+	} else
+	  task->mark_finished(false /*!successful*/);
+      } else
+	EventImpl::add_waiter(req.wait_on, new DeferredTaskSpawn(this, task));
+    }
+
+    // everything that is ready goes into the queue with a single lock acquisition
+    if(!ready_tasks.empty())
+      task_queue.put_multiple(&ready_tasks[0], &ready_priorities[0],
+			      ready_tasks.size());
+  }
+
   void LocalTaskProcessor::register_task(Processor::TaskFuncID func_id,
 					 CodeDescriptor& codedesc,
 					 const ByteArrayRef& user_data)
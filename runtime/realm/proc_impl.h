@@ -51,6 +51,11 @@ namespace Realm {
 			      Event start_event, Event finish_event,
                               int priority) = 0;
 
+      // spawns one task per request - the default just calls spawn_task for each
+      virtual void spawn_tasks(Processor::TaskFuncID func_id,
+			       const std::vector<Processor::SpawnRequest>& requests,
+			       const Event *finish_events);
+
       // blocks until things are cleaned up
       virtual void shutdown(void);
 
@@ -87,6 +92,10 @@ namespace Realm {
 			      Event start_event, Event finish_event,
                               int priority);
 
+      virtual void spawn_tasks(Processor::TaskFuncID func_id,
+			       const std::vector<Processor::SpawnRequest>& requests,
+			       const Event *finish_events);
+
       virtual void register_task(Processor::TaskFuncID func_id,
 				 CodeDescriptor& codedesc,
 				 const ByteArrayRef& user_data);
@@ -129,6 +138,8 @@ namespace Realm {
     public:
       LocalCPUProcessor(Processor _me, CoreReservationSet& crs, size_t _stack_size);
       virtual ~LocalCPUProcessor(void);
+
+      CoreReservation *get_core_reservation(void) { return core_rsrv; }
     protected:
       CoreReservation *core_rsrv;
     };
@@ -137,6 +148,8 @@ namespace Realm {
     public:
       LocalUtilityProcessor(Processor _me, CoreReservationSet& crs, size_t _stack_size);
       virtual ~LocalUtilityProcessor(void);
+
+      CoreReservation *get_core_reservation(void) { return core_rsrv; }
     protected:
       CoreReservation *core_rsrv;
     };
@@ -89,8 +89,34 @@ namespace Realm {
                   const ProfilingRequestSet &requests,
                   Event wait_on = Event::NO_EVENT, int priority = 0) const;
 
+      // bulk version of spawn for launching many instances of the same task
+      //  function on one processor (e.g. the point tasks of an index launch) -
+      //  the tasks (and copies of their arguments) are allocated together and
+      //  ready tasks are added to the processor's queue all at once
+      // the returned event is the merge of all the tasks' finish events - the
+      //  individual finish events are also returned if 'finish_events' is given
+      struct SpawnRequest {
+	const void *args;
+	size_t arglen;
+	Event wait_on;
+	int priority;
+      };
+
+      Event spawn_multiple(TaskFuncID func_id,
+			   const std::vector<SpawnRequest>& requests,
+			   std::vector<Event> *finish_events = 0) const;
+
       static Processor get_executing_processor(void);
 
+      // called from within a running task that would otherwise wait on 'wait_on':
+      //  'func_id' will be run on the same processor (with a copy of 'args') once
+      //  'wait_on' has triggered, and the calling task should return instead of
+      //  waiting - no thread or stack is tied up in the meantime, and the calling
+      //  task's finish event does not trigger until the continuation has finished
+      // a task may request at most one continuation (which may request its own)
+      static void spawn_continuation(TaskFuncID func_id, const void *args, size_t arglen,
+				     Event wait_on, int priority = 0);
+
       // dynamic task registration - this may be done for:
       //  1) a specific processor/group (anywhere in the system)
       //  2) for all processors of a given type, either in the local address space/process,
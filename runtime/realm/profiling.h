@@ -42,6 +42,7 @@ namespace Realm {
     PMID_OP_MEM_USAGE, // memories used by a copy
     PMID_INST_TIMELINE, // timeline for a physical instance
     PMID_INST_MEM_USAGE, // memory and size used by an instance
+    PMID_OP_HW_COUNTERS, // hardware performance counters for an operation
   };
 
   namespace ProfilingMeasurements {
@@ -137,6 +138,43 @@ namespace Realm {
       size_t size;
     };
 
+    // Hardware performance counters (cycles, instructions, cache behavior)
+    //  accumulated by the thread that executed the operation - any counter
+    //  that the platform could not provide is left as INVALID_COUNT, and the
+    //  measurement is not provided at all if counters are unavailable
+    //  (e.g. non-Linux, perf_event_paranoid) or the operation migrated
+    //  between kernel threads while running
+    // Counting is paused while the operation waits on an event, so other
+    //  tasks that run on the same kernel thread (e.g. other user threads)
+    //  during the wait are not included.  If the kernel had to multiplex the
+    //  counters, each value is scaled by time_enabled/time_running and is
+    //  therefore an estimate.
+    struct OperationHardwareCounters {
+      static const ProfilingMeasurementID ID = PMID_OP_HW_COUNTERS;
+
+      typedef long long counter_t;
+      static const counter_t INVALID_COUNT = -1;
+
+      OperationHardwareCounters() :
+        cycles(INVALID_COUNT),
+        instructions(INVALID_COUNT),
+        llc_references(INVALID_COUNT),
+        llc_misses(INVALID_COUNT),
+        stalled_cycles(INVALID_COUNT)
+      { }
+
+      counter_t cycles;          // core cycles (user mode)
+      counter_t instructions;    // instructions retired
+      counter_t llc_references;  // last-level cache references
+      counter_t llc_misses;      // last-level cache misses
+      counter_t stalled_cycles;  // cycles stalled in the backend
+
+      // derived metrics - return a negative value if the needed counters
+      //  were not available
+      inline double instructions_per_cycle(void) const;
+      inline double llc_miss_rate(void) const;
+    };
+
     // Track the timeline of an instance
     struct InstanceTimeline {
       static const ProfilingMeasurementID ID = PMID_INST_TIMELINE;
@@ -25,6 +25,7 @@ TYPE_IS_SERIALIZABLE(Realm::ProfilingMeasurements::OperationTimeline);
 TYPE_IS_SERIALIZABLE(Realm::ProfilingMeasurements::OperationEventWaits::WaitInterval);
 TYPE_IS_SERIALIZABLE(Realm::ProfilingMeasurements::OperationMemoryUsage);
 TYPE_IS_SERIALIZABLE(Realm::ProfilingMeasurements::OperationProcessorUsage);
+TYPE_IS_SERIALIZABLE(Realm::ProfilingMeasurements::OperationHardwareCounters);
 TYPE_IS_SERIALIZABLE(Realm::ProfilingMeasurements::InstanceMemoryUsage);
 TYPE_IS_SERIALIZABLE(Realm::ProfilingMeasurements::InstanceTimeline);
 
@@ -130,6 +131,26 @@ namespace Realm {
     }
 
 
+    ////////////////////////////////////////////////////////////////////////
+    //
+    // struct OperationHardwareCounters
+    //
+
+    inline double OperationHardwareCounters::instructions_per_cycle(void) const
+    {
+      if((cycles <= 0) || (instructions == INVALID_COUNT))
+	return -1.0;
+      return ((double)instructions / (double)cycles);
+    }
+
+    inline double OperationHardwareCounters::llc_miss_rate(void) const
+    {
+      if((llc_references <= 0) || (llc_misses == INVALID_COUNT))
+	return -1.0;
+      return ((double)llc_misses / (double)llc_references);
+    }
+
+
     ////////////////////////////////////////////////////////////////////////
     //
     // struct InstanceTimeLine
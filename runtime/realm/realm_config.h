@@ -46,6 +46,16 @@ namespace Realm {
     // if non-zero, eagerly checks deferred user event triggers for loops up to the
     //  specified limit
     extern int event_loop_detection_limit;
+
+    // if non-zero, barrier arrivals are combined and barrier triggers are
+    //  broadcast through a tree with the specified fan-in/fan-out instead of
+    //  every node talking directly to the barrier's owner
+    extern int barrier_tree_radix;
+
+    // how long (in microseconds) a node holds plain barrier arrivals so that
+    //  others for the same generation can be combined with them before they
+    //  go up the arrival tree - 0 sends each batch as soon as possible
+    extern int barrier_combine_window;
   };
 };
 
@@ -238,6 +238,7 @@ namespace Realm {
 	assert(!impl->in_use);
 
 	impl->in_use = true;
+	impl->enable_fast_path_if_idle();
 
 	log_reservation.info() << "reservation created: rsrv=" << impl->me;
 	return impl->me;
@@ -325,6 +326,9 @@ namespace Realm {
       log_reservation.spew("count init " IDFMT "=[%p]=%d", me.id, &count, count);
       mode = 0;
       in_use = false;
+      // the fast path starts out disabled - it's enabled once the reservation
+      //  is known to be locally owned and idle
+      fast_state = FAST_DISABLED;
       remote_waiter_mask = NodeSet(); 
       remote_sharer_mask = NodeSet();
       requested = false;
@@ -384,6 +388,9 @@ namespace Realm {
 	assert((ID(impl->me).rsrv.creator_node != gasnet_mynode()) ||
 	       impl->in_use);
 
+	// any local holders using the fast path need to be visible in count
+	impl->disable_fast_path();
+
 	// case 2: we're the owner, and nobody is holding the lock, so grant
 	//  it to the (original) requestor
 	if((impl->count == ReservationImpl::ZERO_COUNT) && 
@@ -479,6 +486,24 @@ namespace Realm {
       Message::request(target, args, data, datalen, payload_mode);
     }
 
+    // triggers the events of waiters that have been granted the reservation -
+    //  shared waiters on the same mode may share a single event (see
+    //  ReservationImpl::acquire), which then appears once per holder
+    static void trigger_granted_waiters(Reservation rsrv,
+					const ReservationImpl::WaiterList& to_wake,
+					const char *reason)
+    {
+      Event prev = Event::NO_EVENT;
+      for(ReservationImpl::WaiterList::const_iterator it = to_wake.begin();
+	  it != to_wake.end();
+	  it++) {
+	if(*it == prev) continue;
+	prev = *it;
+	log_reservation.debug() << reason << ": reservation=" << rsrv << " event=" << (*it);
+	GenEventImpl::trigger(*it, false /*!poisoned*/);
+      }
+    }
+
     /*static*/ void LockGrantMessage::handle_request(RequestArgs args,
 						     const void *data, size_t datalen)
     {
@@ -521,12 +546,7 @@ namespace Realm {
 	assert(any_local);
       }
 
-      for(ReservationImpl::WaiterList::iterator it = to_wake.begin();
-	  it != to_wake.end();
-	  it++) {
-	log_reservation.debug() << "release trigger: reservation=" << args.lock << " event=" << (*it);
-	GenEventImpl::trigger(*it, false /*!poisoned*/);
-      }
+      trigger_granted_waiters(args.lock, to_wake, "release trigger");
     }
 
     Event ReservationImpl::acquire(unsigned new_mode, bool exclusive,
@@ -542,6 +562,16 @@ namespace Realm {
       // collapse exclusivity into mode
       if(exclusive) new_mode = MODE_EXCL;
 
+      // fast path: a locally-owned reservation with no waiters can be granted
+      //  with a single atomic update and no event allocation
+      if(((acquire_type == ACQUIRE_BLOCKING) ||
+	  (acquire_type == ACQUIRE_NONBLOCKING)) &&
+	 try_fast_acquire(new_mode)) {
+	if(after_lock.exists())
+	  GenEventImpl::trigger(after_lock, false /*!poisoned*/);
+	return after_lock;
+      }
+
       bool got_lock = false;
       int lock_request_target = -1;
       WaiterList bonus_grants;
@@ -554,6 +584,10 @@ namespace Realm {
 	assert((ID(me).rsrv.creator_node != gasnet_mynode()) ||
 	       in_use);
 
+	// we're about to look at (and probably change) count/mode and the
+	//  waiter lists, so any fast path holders need to be folded in
+	disable_fast_path();
+
 	// if this is just a placeholder nonblocking acquire, update the retry_count and
 	//  return immediately
 	if(acquire_type == ACQUIRE_NONBLOCKING_PLACEHOLDER) {
@@ -653,9 +687,16 @@ namespace Realm {
 	  switch(acquire_type) {
 	  case ACQUIRE_BLOCKING:
 	    {
-	      if(!after_lock.exists())
-		after_lock = GenEventImpl::create_genevent()->current_event();
-	      local_waiters[new_mode].push_back(after_lock);
+	      WaiterList& waiters = local_waiters[new_mode];
+	      // shared waiters on a given mode are always granted together, so
+	      //  they can all wait on one event (each entry is still a holder)
+	      if(!after_lock.exists()) {
+		if((new_mode != MODE_EXCL) && !waiters.empty())
+		  after_lock = waiters.back();
+		else
+		  after_lock = GenEventImpl::create_genevent()->current_event();
+	      }
+	      waiters.push_back(after_lock);
 	      break;
 	    }
 
@@ -722,16 +763,51 @@ namespace Realm {
 	GenEventImpl::trigger(after_lock, false /*!poisoned*/);
 
       // trigger any bonus grants too
-      if(!bonus_grants.empty()) {
-	for(WaiterList::iterator it = bonus_grants.begin();
-	    it != bonus_grants.end();
-	    it++) {
-	  log_reservation.debug() << "acquire bonus grant: reservation=" << me << " event=" << (*it);
-	  GenEventImpl::trigger(*it, false /*!poisoned*/);
+      if(!bonus_grants.empty())
+	trigger_granted_waiters(me, bonus_grants, "acquire bonus grant");
+
+      return after_lock;
+    }
+
+    // folds any holders from the fast path into count/mode and prevents
+    //  further fast path grants - NOTE: ASSUMES MUTEX IS ALREADY HELD!
+    void ReservationImpl::disable_fast_path(void)
+    {
+      while(true) {
+	unsigned long long prev = fast_state;
+	if((prev & FAST_DISABLED) != 0)
+	  return;
+
+	if(__sync_bool_compare_and_swap(&fast_state, prev, FAST_DISABLED)) {
+	  assert(count == ZERO_COUNT);
+	  if((prev & FAST_EXCL) != 0) {
+	    mode = MODE_EXCL;
+	    count = ZERO_COUNT + 1;
+	  } else if((prev & FAST_COUNT_MASK) != 0) {
+	    mode = (unsigned)(prev >> 32);
+	    count = ZERO_COUNT + (unsigned)(prev & FAST_COUNT_MASK);
+	  }
+	  return;
 	}
       }
+    }
 
-      return after_lock;
+    // re-enables the fast path if this node owns the reservation and nobody
+    //  holds or is waiting for it - NOTE: ASSUMES MUTEX IS ALREADY HELD!
+    void ReservationImpl::enable_fast_path_if_idle(void)
+    {
+      if((owner == gasnet_mynode()) &&
+	 (count == ZERO_COUNT) &&
+	 !requested &&
+	 local_waiters.empty() &&
+	 retry_count.empty() &&
+	 retry_events.empty() &&
+	 remote_waiter_mask.empty() &&
+	 remote_sharer_mask.empty()) {
+	// nobody can be racing with us - all fast path operations fail while
+	//  the disabled bit is set
+	__sync_bool_compare_and_swap(&fast_state, FAST_DISABLED, 0);
+      }
     }
 
     // factored-out code to select one or more local waiters on a lock
@@ -792,6 +868,11 @@ namespace Realm {
 
     void ReservationImpl::release(void)
     {
+      // the fast path only fails if the reservation has been handed over to
+      //  the mutex-protected state (e.g. because somebody is waiting)
+      if(try_fast_release())
+	return;
+
       // make a list of events that we be woken - can't do it while holding the
       //  lock's mutex (because the event we trigger might try to take the lock)
       WaiterList to_wake;
@@ -807,6 +888,8 @@ namespace Realm {
 #endif
 	AutoHSLLock a(mutex); // hold mutex on lock for entire function
 
+	disable_fast_path();
+
 	assert(count > ZERO_COUNT);
 
 	// if this isn't the last holder of the lock, just decrement count
@@ -861,6 +944,9 @@ namespace Realm {
 	assert(local_waiters.empty());
 	assert(retry_events.empty());
 	assert(remote_waiter_mask.empty());
+
+	// and uncontended acquires can go back to the fast path
+	enable_fast_path_if_idle();
       } while(0);
 
       if(release_target != -1)
@@ -907,16 +993,8 @@ namespace Realm {
 #endif
       }
 
-      if(!to_wake.empty()) {
-	for(WaiterList::iterator it = to_wake.begin();
-	    it != to_wake.end();
-	    it++) {
-#ifdef RSRV_DEBUG_MSGS
-	  log_reservation.debug() << "release trigger: reservation=" << me << " event=" << (*it);
-#endif
-	  GenEventImpl::trigger(*it, false /*!poisoned*/);
-	}
-      }
+      if(!to_wake.empty())
+	trigger_granted_waiters(me, to_wake, "release trigger");
     }
 
     bool ReservationImpl::is_locked(unsigned check_mode, bool excl_ok)
@@ -924,6 +1002,15 @@ namespace Realm {
       // checking the owner can be done atomically, so doesn't need mutex
       if(owner != gasnet_mynode()) return false;
 
+      // holders on the fast path aren't reflected in count/mode
+      unsigned long long fast = fast_state;
+      if((fast & FAST_DISABLED) == 0) {
+	if((fast & FAST_EXCL) != 0)
+	  return excl_ok || (check_mode == MODE_EXCL);
+	return (((fast & FAST_COUNT_MASK) != 0) &&
+		((unsigned)(fast >> 32) == check_mode));
+      }
+
       // conservative check on lock count also doesn't need mutex
       if(count == ZERO_COUNT) return false;
 
@@ -945,6 +1032,9 @@ namespace Realm {
       {
 	AutoHSLLock al(mutex);
 
+	// the exclusive hold may have been granted on the fast path
+	disable_fast_path();
+
 	// should only get here if the current node holds an exclusive lock
 	assert(owner == gasnet_mynode());
 	assert(count == 1 + ZERO_COUNT);
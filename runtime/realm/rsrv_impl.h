@@ -90,6 +90,28 @@ namespace Realm {
       std::map<unsigned, Event> retry_events;
       bool requested; // do we have a request for the lock in flight?
 
+      // lock-free fast path: while a reservation is owned by this node and
+      //  nobody (local or remote) is waiting on it, holders are tracked in
+      //  this word instead of count/mode, so an uncontended acquire or
+      //  release is a single compare-and-swap - the upper 32 bits hold the
+      //  shared mode, the lower bits a disabled flag, an exclusive flag and
+      //  the number of sharers
+      // the fast path is disabled (and any fast holders folded into
+      //  count/mode) by anything that takes the mutex to change the state,
+      //  and is re-enabled only once the reservation is idle again
+      volatile unsigned long long fast_state;
+
+      static const unsigned long long FAST_DISABLED = 1ULL << 31;
+      static const unsigned long long FAST_EXCL = 1ULL << 30;
+      static const unsigned long long FAST_COUNT_MASK = FAST_EXCL - 1;
+
+      bool try_fast_acquire(unsigned new_mode);
+      bool try_fast_release(void);
+
+      // both of these must be called with the mutex held
+      void disable_fast_path(void);
+      void enable_fast_path_if_idle(void);
+
       // local data protected by lock
       void *local_data;
       size_t local_data_size;
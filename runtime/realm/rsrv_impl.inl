@@ -20,6 +20,58 @@
 
 namespace Realm {
 
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class ReservationImpl
+  //
+
+    // attempts to grant the reservation without taking the mutex - only
+    //  succeeds if the fast path is enabled and the request is compatible
+    //  with the current (fast) holders
+    inline bool ReservationImpl::try_fast_acquire(unsigned new_mode)
+    {
+      while(true) {
+	unsigned long long prev = fast_state;
+	if((prev & FAST_DISABLED) != 0)
+	  return false;
+
+	unsigned long long next;
+	if(prev == 0) {
+	  next = ((new_mode == MODE_EXCL) ?
+		    FAST_EXCL :
+		    ((((unsigned long long)new_mode) << 32) + 1));
+	} else {
+	  // only additional sharers with the same mode can join existing holders
+	  if((new_mode == MODE_EXCL) || ((prev & FAST_EXCL) != 0) ||
+	     ((prev >> 32) != new_mode))
+	    return false;
+	  next = prev + 1;
+	}
+
+	if(__sync_bool_compare_and_swap(&fast_state, prev, next))
+	  return true;
+      }
+    }
+
+    inline bool ReservationImpl::try_fast_release(void)
+    {
+      while(true) {
+	unsigned long long prev = fast_state;
+	if((prev & FAST_DISABLED) != 0)
+	  return false;
+	assert(prev != 0);
+
+	unsigned long long next = ((((prev & FAST_EXCL) != 0) ||
+				    ((prev & FAST_COUNT_MASK) == 1)) ?
+				     0 :
+				     (prev - 1));
+
+	if(__sync_bool_compare_and_swap(&fast_state, prev, next))
+	  return true;
+      }
+    }
+
+
   ////////////////////////////////////////////////////////////////////////
   //
   // class StaticAccess<T>
@@ -24,6 +24,7 @@
 #include "activemsg.h"
 
 #include "cmdline.h"
+#include "event_graph.h"
 
 #include "codedesc.h"
 
@@ -310,13 +311,17 @@ namespace Realm {
   {
     Module::create_processors(runtime);
 
+    std::vector<LocalUtilityProcessor *> util_procs;
     for(int i = 0; i < num_util_procs; i++) {
       Processor p = runtime->next_local_processor_id();
-      ProcessorImpl *pi = new LocalUtilityProcessor(p, runtime->core_reservation_set(),
-						    stack_size_in_mb << 20);
+      LocalUtilityProcessor *pi = new LocalUtilityProcessor(p, runtime->core_reservation_set(),
+							    stack_size_in_mb << 20);
       runtime->add_processor(pi);
+      util_procs.push_back(pi);
     }
 
+    const std::vector<CoreReservation *>& dma_rsrvs = LegionRuntime::LowLevel::get_dma_core_reservations();
+
     for(int i = 0; i < num_io_procs; i++) {
       Processor p = runtime->next_local_processor_id();
       ProcessorImpl *pi = new LocalIOProcessor(p, runtime->core_reservation_set(),
@@ -327,9 +332,18 @@ namespace Realm {
 
     for(int i = 0; i < num_cpu_procs; i++) {
       Processor p = runtime->next_local_processor_id();
-      ProcessorImpl *pi = new LocalCPUProcessor(p, runtime->core_reservation_set(),
-						stack_size_in_mb << 20);
+      LocalCPUProcessor *pi = new LocalCPUProcessor(p, runtime->core_reservation_set(),
+						    stack_size_in_mb << 20);
       runtime->add_processor(pi);
+
+      // utility processors mostly work on metadata produced and consumed by the
+      //  CPU processors, so try to keep each one in the same last-level cache as
+      //  some of them - the DMA workers are spread over the CPU processors the
+      //  same way, keeping each near the data its processor produces
+      for(size_t j = i; j < util_procs.size(); j += num_cpu_procs)
+	util_procs[j]->get_core_reservation()->params.add_share_llc_with(pi->get_core_reservation());
+      for(size_t j = i; j < dma_rsrvs.size(); j += num_cpu_procs)
+	dma_rsrvs[j]->params.add_share_llc_with(pi->get_core_reservation());
     }
   }
 
@@ -667,7 +681,9 @@ namespace Realm {
       cp.add_option_string("-ll:prefix", dummy_prefix);
 #endif
 
-      cp.add_option_int("-realm:eventloopcheck", Config::event_loop_detection_limit);
+      cp.add_option_int("-realm:eventloopcheck", Config::event_loop_detection_limit)
+	.add_option_int("-realm:barrier_radix", Config::barrier_tree_radix)
+	.add_option_int("-realm:barrier_window", Config::barrier_combine_window);
 
       // these are actually parsed in activemsg.cc, but consume them here for now
       size_t dummy = 0;
@@ -731,6 +747,10 @@ namespace Realm {
 
       sampling_profiler.configure_from_cmdline(cmdline, *core_reservations);
 
+      EventGraphTrace::configure_from_cmdline(cmdline);
+
+      BarrierImpl::start_arrival_flusher(*core_reservations);
+
       // initialize barrier timestamp
       BarrierImpl::barrier_adjustment_timestamp = (((Barrier::timestamp_t)(gasnet_mynode())) << BarrierImpl::BARRIER_TIMESTAMP_NODEID_SHIFT) + 1;
 
@@ -772,6 +792,8 @@ namespace Realm {
       hcount += BarrierMigrationMessage::Message::add_handler_entries(&handlers[hcount], "Barrier Migration AM");
       hcount += MetadataRequestMessage::Message::add_handler_entries(&handlers[hcount], "Metadata Request AM");
       hcount += MetadataResponseMessage::Message::add_handler_entries(&handlers[hcount], "Metadata Response AM");
+      hcount += MetadataBatchRequestMessage::Message::add_handler_entries(&handlers[hcount], "Metadata Batch Request AM");
+      hcount += MetadataBatchResponseMessage::Message::add_handler_entries(&handlers[hcount], "Metadata Batch Response AM");
       hcount += MetadataInvalidateMessage::Message::add_handler_entries(&handlers[hcount], "Metadata Invalidate AM");
       hcount += MetadataInvalidateAckMessage::Message::add_handler_entries(&handlers[hcount], "Metadata Inval Ack AM");
       hcount += RegisterTaskMessage::Message::add_handler_entries(&handlers[hcount], "Register Task AM");
@@ -1561,11 +1583,14 @@ namespace Realm {
       // Shutdown all the threads
 
       // threads that cause inter-node communication have to stop first
+      BarrierImpl::stop_arrival_flusher();
       LegionRuntime::LowLevel::stop_dma_worker_threads();
       stop_activemsg_threads();
 
       sampling_profiler.shutdown();
 
+      MetadataStats::report();
+
       {
 	std::vector<ProcessorImpl *>& local_procs = nodes[gasnet_mynode()].processors;
 	for(std::vector<ProcessorImpl *>::const_iterator it = local_procs.begin();
@@ -1574,6 +1599,8 @@ namespace Realm {
 	  (*it)->shutdown();
       }
 
+      EventGraphTrace::shutdown();
+
 #ifdef EVENT_TRACING
       if(event_trace_file) {
 	printf("writing event trace to %s\n", event_trace_file);
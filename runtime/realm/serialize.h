@@ -21,6 +21,7 @@
 #include "bytearray.h"
 
 #include <cstddef>
+#include <stdint.h>
 #include <vector>
 #include <list>
 #include <set>
@@ -83,6 +84,23 @@ char operator,(const is_copy_serializable::inner&, const T&);
 #define TYPE_IS_SERIALIZABLE(T) \
   void *operator,(const is_copy_serializable::inner&, const T&);
 
+// a second helper template identifies handle-like types (i.e. those whose entire state is an
+//  unsigned integer 'id' member) - compact streams encode these as variable-length integers and
+//  delta-encode sequences of them, since IDs in the same message tend to share their upper bits
+// (the same global-namespace trick as above is used)
+struct is_compact_id {
+public:
+  class inner { public: inner(void) {} };
+public:
+  template <typename T>
+  struct test { static const bool value = sizeof(inner(),*(T*)0) != sizeof(char); };
+};
+template <typename T>
+char operator,(const is_compact_id::inner&, const T&);
+
+#define TYPE_HAS_COMPACT_ID(T) \
+  void *operator,(const is_compact_id::inner&, const T&);
+
 namespace Realm {
   namespace Serialization {
     // there are three kinds of serializer we use and a single deserializer:
@@ -90,6 +108,11 @@ namespace Realm {
     //  b) DynamicBufferSerializer - serializes data into an automatically-regrowing buffer
     //  c) ByteCountSerializer - doesn't actually store data, just counts how big it would be
     //  d) FixedBufferDeserializer - deserializes from a fixed-size buffer
+    //
+    // each also has a Compact* variant that uses a denser (but slower to decode) encoding:
+    //  integers are written as variable-length (zigzag for signed types) integers, vectors and
+    //  sets of integers/IDs are delta-encoded, and no alignment padding is ever inserted - a
+    //  stream must be deserialized with the same flavor of (de)serializer that wrote it
 
     class FixedBufferSerializer {
     public:
@@ -173,6 +196,56 @@ namespace Realm {
       const char *limit;
     };
 
+    class CompactFixedBufferSerializer : public FixedBufferSerializer {
+    public:
+      CompactFixedBufferSerializer(void *buffer, size_t size);
+      CompactFixedBufferSerializer(ByteArray &array);
+
+      bool enforce_alignment(size_t granularity);
+      bool append_varint(uint64_t val);
+      template <typename T> bool append_serializable(const T& data);
+
+      template <typename T> bool operator<<(const T& val);
+      template <typename T> bool operator&(const T& val);
+    };
+
+    class CompactDynamicBufferSerializer : public DynamicBufferSerializer {
+    public:
+      CompactDynamicBufferSerializer(size_t initial_size);
+
+      bool enforce_alignment(size_t granularity);
+      bool append_varint(uint64_t val);
+      template <typename T> bool append_serializable(const T& data);
+
+      template <typename T> bool operator<<(const T& val);
+      template <typename T> bool operator&(const T& val);
+    };
+
+    class CompactByteCountSerializer : public ByteCountSerializer {
+    public:
+      CompactByteCountSerializer(void);
+
+      bool enforce_alignment(size_t granularity);
+      bool append_varint(uint64_t val);
+      template <typename T> bool append_serializable(const T& data);
+
+      template <typename T> bool operator<<(const T& val);
+      template <typename T> bool operator&(const T& val);
+    };
+
+    class CompactFixedBufferDeserializer : public FixedBufferDeserializer {
+    public:
+      CompactFixedBufferDeserializer(const void *buffer, size_t size);
+      CompactFixedBufferDeserializer(const ByteArrayRef& array);
+
+      bool enforce_alignment(size_t granularity);
+      bool extract_varint(uint64_t& val);
+      template <typename T> bool extract_serializable(T& data);
+
+      template <typename T> bool operator>>(T& val);
+      template <typename T> bool operator&(const T& val);
+    };
+
     // defaults if custom serializers/deserializers are not defined
     template <typename S, typename T>
       bool serdez(S&, const T&); // not implemented
@@ -211,6 +284,27 @@ namespace Realm {
       static bool deserialize_vector(S& s, std::vector<T>& v);
     };
 
+    // compact streams pick an encoding based on what kind of type is being
+    //  (de)serialized - integral types and IDs are specialized in serialize.inl
+    enum CompactEncodingKind {
+      COMPACT_CUSTOM,    // custom serialize/deserialize (or serdez) functions
+      COMPACT_BITS,      // copy-serializable, written without alignment padding
+      COMPACT_UNSIGNED,  // unsigned integer, written as a varint
+      COMPACT_SIGNED,    // signed integer, zigzag-encoded varint
+      COMPACT_ID,        // handle type, 'id' member written as a varint
+      COMPACT_VECTOR,    // vector of integers/IDs, delta-encoded
+      COMPACT_SET        // set of integers/IDs, delta-encoded
+    };
+
+    template <typename T>
+    struct CompactEncoding {
+      static const int kind = (is_compact_id::test<T>::value ? COMPACT_ID :
+			       is_copy_serializable::test<T>::value ? COMPACT_BITS :
+			                                              COMPACT_CUSTOM);
+    };
+
+    template <typename T, int KIND> struct CompactSerializationHelper;
+
     // support for some STL containers
     template <typename S, typename T>
       bool serialize(S& s, const std::vector<T>& v);
@@ -61,6 +61,42 @@ namespace Realm {
       return reinterpret_cast<T *>(i);
     }
 
+    // variable-length integers use 7 bits per byte, least significant group
+    //  first, with the high bit set on all but the last byte
+    static const size_t MAX_VARINT_BYTES = 10;
+
+    static inline size_t encode_varint(unsigned char *buffer, uint64_t val)
+    {
+      size_t len = 0;
+      while(val >= 0x80) {
+	buffer[len++] = (unsigned char)(val | 0x80);
+	val >>= 7;
+      }
+      buffer[len++] = (unsigned char)val;
+      return len;
+    }
+
+    static inline size_t varint_length(uint64_t val)
+    {
+      size_t len = 1;
+      while(val >= 0x80) {
+	len++;
+	val >>= 7;
+      }
+      return len;
+    }
+
+    // zigzag encoding keeps small negative values small: 0,-1,1,-2,... -> 0,1,2,3,...
+    static inline uint64_t zigzag_encode(int64_t val)
+    {
+      return (((uint64_t)val) << 1) ^ ((uint64_t)(val >> 63));
+    }
+
+    static inline int64_t zigzag_decode(uint64_t val)
+    {
+      return (int64_t)((val >> 1) ^ (-(val & 1)));
+    }
+
 
     ////////////////////////////////////////////////////////////////////////
     //
@@ -387,6 +423,200 @@ namespace Realm {
     }
 
 
+    ////////////////////////////////////////////////////////////////////////
+    //
+    // class CompactFixedBufferSerializer
+    //
+
+    inline CompactFixedBufferSerializer::CompactFixedBufferSerializer(void *buffer, size_t size)
+      : FixedBufferSerializer(buffer, size)
+    {}
+
+    inline CompactFixedBufferSerializer::CompactFixedBufferSerializer(ByteArray& array)
+      : FixedBufferSerializer(array)
+    {}
+
+    inline bool CompactFixedBufferSerializer::enforce_alignment(size_t granularity)
+    {
+      // compact streams are never padded
+      return true;
+    }
+
+    inline bool CompactFixedBufferSerializer::append_varint(uint64_t val)
+    {
+      // encode in place unless we're close enough to the end to need checks
+      if((limit - pos) >= (ptrdiff_t)MAX_VARINT_BYTES) {
+	pos += encode_varint((unsigned char *)pos, val);
+	return true;
+      }
+      unsigned char buffer[MAX_VARINT_BYTES];
+      return append_bytes(buffer, encode_varint(buffer, val));
+    }
+
+    template <typename T>
+    bool CompactFixedBufferSerializer::append_serializable(const T& data)
+    {
+      // no alignment guarantee, so copy bytes rather than storing a T
+      return append_bytes(&data, sizeof(T));
+    }
+
+    template <typename T>
+    bool CompactFixedBufferSerializer::operator<<(const T& data)
+    {
+      return CompactSerializationHelper<T, CompactEncoding<T>::kind>::serialize_scalar(*this, data);
+    }
+
+    template <typename T>
+    bool CompactFixedBufferSerializer::operator&(const T& data)
+    {
+      return CompactSerializationHelper<T, CompactEncoding<T>::kind>::serialize_scalar(*this, data);
+    }
+
+
+    ////////////////////////////////////////////////////////////////////////
+    //
+    // class CompactDynamicBufferSerializer
+    //
+
+    inline CompactDynamicBufferSerializer::CompactDynamicBufferSerializer(size_t initial_size)
+      : DynamicBufferSerializer(initial_size)
+    {}
+
+    inline bool CompactDynamicBufferSerializer::enforce_alignment(size_t granularity)
+    {
+      // compact streams are never padded
+      return true;
+    }
+
+    inline bool CompactDynamicBufferSerializer::append_varint(uint64_t val)
+    {
+      // encode in place unless we might need to grow the buffer
+      if((limit - pos) >= (ptrdiff_t)MAX_VARINT_BYTES) {
+	pos += encode_varint((unsigned char *)pos, val);
+	return true;
+      }
+      unsigned char buffer[MAX_VARINT_BYTES];
+      return append_bytes(buffer, encode_varint(buffer, val));
+    }
+
+    template <typename T>
+    bool CompactDynamicBufferSerializer::append_serializable(const T& data)
+    {
+      // no alignment guarantee, so copy bytes rather than storing a T
+      return append_bytes(&data, sizeof(T));
+    }
+
+    template <typename T>
+    bool CompactDynamicBufferSerializer::operator<<(const T& data)
+    {
+      return CompactSerializationHelper<T, CompactEncoding<T>::kind>::serialize_scalar(*this, data);
+    }
+
+    template <typename T>
+    bool CompactDynamicBufferSerializer::operator&(const T& data)
+    {
+      return CompactSerializationHelper<T, CompactEncoding<T>::kind>::serialize_scalar(*this, data);
+    }
+
+
+    ////////////////////////////////////////////////////////////////////////
+    //
+    // class CompactByteCountSerializer
+    //
+
+    inline CompactByteCountSerializer::CompactByteCountSerializer(void)
+    {}
+
+    inline bool CompactByteCountSerializer::enforce_alignment(size_t granularity)
+    {
+      // compact streams are never padded
+      return true;
+    }
+
+    inline bool CompactByteCountSerializer::append_varint(uint64_t val)
+    {
+      count += varint_length(val);
+      return true;
+    }
+
+    template <typename T>
+    bool CompactByteCountSerializer::append_serializable(const T& data)
+    {
+      count += sizeof(T);
+      return true;
+    }
+
+    template <typename T>
+    bool CompactByteCountSerializer::operator<<(const T& data)
+    {
+      return CompactSerializationHelper<T, CompactEncoding<T>::kind>::serialize_scalar(*this, data);
+    }
+
+    template <typename T>
+    bool CompactByteCountSerializer::operator&(const T& data)
+    {
+      return CompactSerializationHelper<T, CompactEncoding<T>::kind>::serialize_scalar(*this, data);
+    }
+
+
+    ////////////////////////////////////////////////////////////////////////
+    //
+    // class CompactFixedBufferDeserializer
+    //
+
+    inline CompactFixedBufferDeserializer::CompactFixedBufferDeserializer(const void *buffer, size_t size)
+      : FixedBufferDeserializer(buffer, size)
+    {}
+
+    inline CompactFixedBufferDeserializer::CompactFixedBufferDeserializer(const ByteArrayRef& array)
+      : FixedBufferDeserializer(array)
+    {}
+
+    inline bool CompactFixedBufferDeserializer::enforce_alignment(size_t granularity)
+    {
+      // compact streams are never padded
+      return (pos <= limit);
+    }
+
+    inline bool CompactFixedBufferDeserializer::extract_varint(uint64_t& val)
+    {
+      uint64_t v = 0;
+      unsigned shift = 0;
+      while(pos < limit) {
+	unsigned char b = *pos++;
+	v |= ((uint64_t)(b & 0x7f)) << shift;
+	if(!(b & 0x80)) {
+	  val = v;
+	  return true;
+	}
+	shift += 7;
+	// a malformed stream can't be allowed to shift past the top of the value
+	if(shift >= 64)
+	  return false;
+      }
+      return false;
+    }
+
+    template <typename T>
+    bool CompactFixedBufferDeserializer::extract_serializable(T& data)
+    {
+      // no alignment guarantee, so copy bytes rather than loading a T
+      return extract_bytes(&data, sizeof(T));
+    }
+
+    template <typename T>
+    bool CompactFixedBufferDeserializer::operator>>(T& data)
+    {
+      return CompactSerializationHelper<T, CompactEncoding<T>::kind>::deserialize_scalar(*this, data);
+    }
+
+    template <typename T>
+    bool CompactFixedBufferDeserializer::operator&(const T& data)
+    {
+      return CompactSerializationHelper<T, CompactEncoding<T>::kind>::deserialize_scalar(*this, *(T*)&data);
+    }
+
+
     ////////////////////////////////////////////////////////////////////////
     //
     // SerializationHelper<T,true>
@@ -462,7 +692,7 @@ namespace Realm {
       size_t c = v.size();
       if(!(s << c)) return false;
       for(size_t i = 0; i < c; i++)
-	if(!serialize(s, v[i])) return false;
+	if(!(s << v[i])) return false;
       return true;
     }
 
@@ -475,7 +705,7 @@ namespace Realm {
       // TODO: sanity-check size?
       v.resize(c);
       for(size_t i = 0; i < c; i++)
-	if(!deserialize(s, v[i])) return false;
+	if(!(s >> v[i])) return false;
       return true;
     }
 
@@ -602,6 +832,225 @@ namespace Realm {
     }      
 
 
+    ////////////////////////////////////////////////////////////////////////
+    //
+    // CompactEncoding<T>
+    //
+
+#define COMPACT_INTEGER_ENCODING(T, K) \
+    template <> struct CompactEncoding<T> { static const int kind = K; }
+
+    // single-byte types gain nothing from a varint
+    COMPACT_INTEGER_ENCODING(unsigned short, COMPACT_UNSIGNED);
+    COMPACT_INTEGER_ENCODING(unsigned int, COMPACT_UNSIGNED);
+    COMPACT_INTEGER_ENCODING(unsigned long, COMPACT_UNSIGNED);
+    COMPACT_INTEGER_ENCODING(unsigned long long, COMPACT_UNSIGNED);
+    COMPACT_INTEGER_ENCODING(short, COMPACT_SIGNED);
+    COMPACT_INTEGER_ENCODING(int, COMPACT_SIGNED);
+    COMPACT_INTEGER_ENCODING(long, COMPACT_SIGNED);
+    COMPACT_INTEGER_ENCODING(long long, COMPACT_SIGNED);
+
+#undef COMPACT_INTEGER_ENCODING
+
+    // vectors and sets are only delta-encoded if their elements are integers or IDs
+    template <typename T>
+    struct CompactEncoding<std::vector<T> > {
+      static const int kind = (((CompactEncoding<T>::kind == COMPACT_UNSIGNED) ||
+				(CompactEncoding<T>::kind == COMPACT_SIGNED) ||
+				(CompactEncoding<T>::kind == COMPACT_ID)) ? COMPACT_VECTOR :
+			                                                    COMPACT_CUSTOM);
+    };
+
+    template <typename T>
+    struct CompactEncoding<std::set<T> > {
+      static const int kind = (((CompactEncoding<T>::kind == COMPACT_UNSIGNED) ||
+				(CompactEncoding<T>::kind == COMPACT_SIGNED) ||
+				(CompactEncoding<T>::kind == COMPACT_ID)) ? COMPACT_SET :
+			                                                    COMPACT_CUSTOM);
+    };
+
+
+    ////////////////////////////////////////////////////////////////////////
+    //
+    // CompactSerializationHelper<T,KIND>
+    //
+
+    template <typename T>
+    struct CompactSerializationHelper<T, COMPACT_CUSTOM> {
+      template <typename S>
+      static bool serialize_scalar(S& s, const T& data)
+      {
+	return serialize(s, data);
+      }
+
+      template <typename S>
+      static bool deserialize_scalar(S& s, T& data)
+      {
+	return deserialize(s, data);
+      }
+    };
+
+    template <typename T>
+    struct CompactSerializationHelper<T, COMPACT_BITS> {
+      template <typename S>
+      static bool serialize_scalar(S& s, const T& data)
+      {
+	return s.append_serializable(data);
+      }
+
+      template <typename S>
+      static bool deserialize_scalar(S& s, T& data)
+      {
+	return s.extract_serializable(data);
+      }
+    };
+
+    // the integer and ID helpers also map values to/from a 64-bit key for
+    //  the delta encoding of vectors and sets
+
+    template <typename T>
+    struct CompactSerializationHelper<T, COMPACT_UNSIGNED> {
+      template <typename S>
+      static bool serialize_scalar(S& s, const T& data)
+      {
+	return s.append_varint(data);
+      }
+
+      template <typename S>
+      static bool deserialize_scalar(S& s, T& data)
+      {
+	uint64_t v;
+	if(!s.extract_varint(v)) return false;
+	data = static_cast<T>(v);
+	return true;
+      }
+
+      static uint64_t to_key(const T& data) { return data; }
+      static void from_key(T& data, uint64_t key) { data = static_cast<T>(key); }
+    };
+
+    template <typename T>
+    struct CompactSerializationHelper<T, COMPACT_SIGNED> {
+      template <typename S>
+      static bool serialize_scalar(S& s, const T& data)
+      {
+	return s.append_varint(zigzag_encode(data));
+      }
+
+      template <typename S>
+      static bool deserialize_scalar(S& s, T& data)
+      {
+	uint64_t v;
+	if(!s.extract_varint(v)) return false;
+	data = static_cast<T>(zigzag_decode(v));
+	return true;
+      }
+
+      static uint64_t to_key(const T& data) { return (uint64_t)(int64_t)data; }
+      static void from_key(T& data, uint64_t key) { data = static_cast<T>((int64_t)key); }
+    };
+
+    template <typename T>
+    struct CompactSerializationHelper<T, COMPACT_ID> {
+      template <typename S>
+      static bool serialize_scalar(S& s, const T& data)
+      {
+	return s.append_varint(data.id);
+      }
+
+      template <typename S>
+      static bool deserialize_scalar(S& s, T& data)
+      {
+	uint64_t v;
+	if(!s.extract_varint(v)) return false;
+	data.id = v;
+	return true;
+      }
+
+      static uint64_t to_key(const T& data) { return data.id; }
+      static void from_key(T& data, uint64_t key) { data.id = key; }
+    };
+
+    // sequences store the (zigzagged) difference from the previous element,
+    //  which is small for sorted sets and for runs of IDs from the same node
+    template <typename T>
+    struct CompactSerializationHelper<std::vector<T>, COMPACT_VECTOR> {
+      typedef CompactSerializationHelper<T, CompactEncoding<T>::kind> ElemHelper;
+
+      template <typename S>
+      static bool serialize_scalar(S& s, const std::vector<T>& v)
+      {
+	size_t c = v.size();
+	if(!s.append_varint(c)) return false;
+	uint64_t prev = 0;
+	for(size_t i = 0; i < c; i++) {
+	  uint64_t key = ElemHelper::to_key(v[i]);
+	  if(!s.append_varint(zigzag_encode((int64_t)(key - prev)))) return false;
+	  prev = key;
+	}
+	return true;
+      }
+
+      template <typename S>
+      static bool deserialize_scalar(S& s, std::vector<T>& v)
+      {
+	uint64_t c;
+	if(!s.extract_varint(c)) return false;
+	// every element takes at least one byte
+	if(c > (uint64_t)s.bytes_left()) return false;
+	v.resize(c);
+	uint64_t prev = 0;
+	for(size_t i = 0; i < c; i++) {
+	  uint64_t delta;
+	  if(!s.extract_varint(delta)) return false;
+	  prev += (uint64_t)zigzag_decode(delta);
+	  ElemHelper::from_key(v[i], prev);
+	}
+	return true;
+      }
+    };
+
+    template <typename T>
+    struct CompactSerializationHelper<std::set<T>, COMPACT_SET> {
+      typedef CompactSerializationHelper<T, CompactEncoding<T>::kind> ElemHelper;
+
+      template <typename S>
+      static bool serialize_scalar(S& s, const std::set<T>& ss)
+      {
+	if(!s.append_varint(ss.size())) return false;
+	uint64_t prev = 0;
+	for(typename std::set<T>::const_iterator it = ss.begin();
+	    it != ss.end();
+	    it++) {
+	  uint64_t key = ElemHelper::to_key(*it);
+	  if(!s.append_varint(zigzag_encode((int64_t)(key - prev)))) return false;
+	  prev = key;
+	}
+	return true;
+      }
+
+      template <typename S>
+      static bool deserialize_scalar(S& s, std::set<T>& ss)
+      {
+	uint64_t c;
+	if(!s.extract_varint(c)) return false;
+	if(c > (uint64_t)s.bytes_left()) return false;
+	ss.clear(); // start from an empty set
+	uint64_t prev = 0;
+	for(size_t i = 0; i < c; i++) {
+	  uint64_t delta;
+	  if(!s.extract_varint(delta)) return false;
+	  prev += (uint64_t)zigzag_decode(delta);
+	  T v;  // won't work if no default constructor for T
+	  ElemHelper::from_key(v, prev);
+	  // elements arrive in order, so the end is always the right hint
+	  ss.insert(ss.end(), v);
+	}
+	return true;
+      }
+    };
+
+
     ////////////////////////////////////////////////////////////////////////
     //
     // PolymorphicSerdezHelper<T>
@@ -18,6 +18,7 @@
 #include "tasks.h"
 
 #include "runtime_impl.h"
+#include "event_graph.h"
 
 namespace Realm {
 
@@ -35,18 +36,75 @@ namespace Realm {
 	     Event _before_event,
 	     Event _finish_event, int _priority)
     : Operation(_finish_event, reqs), proc(_proc), func_id(_func_id),
-      args(_args, _arglen), before_event(_before_event), priority(_priority),
-      executing_thread(0)
+      arg_storage(_args, _arglen), args(arg_storage),
+      before_event(_before_event), priority(_priority),
+      executing_thread(0), continuation_item(0), continuation_requested(false),
+      outstanding_continuation(0)
   {
     log_task.info() << "task " << (void *)this << " created: func=" << func_id
 		    << " proc=" << _proc << " arglen=" << _arglen
 		    << " before=" << _before_event << " after=" << _finish_event;
   }
 
+  Task::Task(Processor _proc, Processor::TaskFuncID _func_id,
+	     const ByteArrayRef& _shared_args,
+	     const ProfilingRequestSet &reqs,
+	     Event _before_event,
+	     Event _finish_event, int _priority)
+    : Operation(_finish_event, reqs), proc(_proc), func_id(_func_id),
+      args(_shared_args), before_event(_before_event), priority(_priority),
+      executing_thread(0), continuation_item(0), continuation_requested(false),
+      outstanding_continuation(0)
+  {
+    log_task.info() << "task " << (void *)this << " created: func=" << func_id
+		    << " proc=" << _proc << " arglen=" << args.size()
+		    << " before=" << _before_event << " after=" << _finish_event;
+  }
+
   Task::~Task(void)
   {
   }
 
+  namespace {
+    // precedes every Task allocation - padded so that the Task itself ends up
+    //  with the same alignment as the start of a malloc'd block
+    struct TaskAllocHeader {
+      TaskSlab *slab;  // 0 for individually-allocated tasks
+      size_t pad;
+    };
+  };
+
+  /*static*/ void *Task::operator new(size_t size)
+  {
+    TaskAllocHeader *hdr = (TaskAllocHeader *)malloc(sizeof(TaskAllocHeader) + size);
+    assert(hdr != 0);
+    hdr->slab = 0;
+    return (hdr + 1);
+  }
+
+  /*static*/ void *Task::operator new(size_t size, TaskSlab *slab)
+  {
+    assert(size <= (TaskSlab::task_stride() - sizeof(TaskAllocHeader)));
+    TaskAllocHeader *hdr = (TaskAllocHeader *)(slab->alloc_task());
+    hdr->slab = slab;
+    return (hdr + 1);
+  }
+
+  /*static*/ void Task::operator delete(void *ptr)
+  {
+    TaskAllocHeader *hdr = ((TaskAllocHeader *)ptr) - 1;
+    if(hdr->slab)
+      hdr->slab->task_deleted();
+    else
+      free(hdr);
+  }
+
+  /*static*/ void Task::operator delete(void *ptr, TaskSlab *slab)
+  {
+    // only used if a constructor throws
+    Task::operator delete(ptr);
+  }
+
   void Task::print(std::ostream& os) const
   {
     os << "task(proc=" << proc << ", func=" << func_id << ")";
@@ -73,7 +131,184 @@ namespace Realm {
     log_task.info() << "task " << (void *)this << " completed: func=" << func_id
 		    << " proc=" << proc << " arglen=" << args.size()
 		    << " before=" << before_event << " after=" << finish_event;
+    // if our continuation chain failed or was cancelled, so did we (unless the
+    //  body itself already terminated early)
+    if(outstanding_continuation) {
+      TaskContinuation *tc = outstanding_continuation;
+      if(tc->chain_failed) {
+	if(__sync_bool_compare_and_swap(&status.result,
+					Status::RUNNING,
+					Status::TERMINATED_EARLY)) {
+	  status.error_code = tc->chain_error_code;
+	  status.error_details = tc->chain_error_details;
+	} else
+	  __sync_bool_compare_and_swap(&status.result,
+				       Status::INTERRUPT_REQUESTED,
+				       Status::TERMINATED_EARLY);
+      } else {
+	// a cancellation that arrived too late to stop anything
+	__sync_bool_compare_and_swap(&status.result,
+				     Status::INTERRUPT_REQUESTED,
+				     Status::RUNNING);
+      }
+    }
+
+    // a continuation also finishes a work item of the task it continues, passing
+    //  along how it actually ended - grab that before our own event triggers
+    TaskContinuation *item = continuation_item;
+    if(!item) {
+      Operation::mark_completed();
+      return;
+    }
+    bool successful = ((failed_work_items == 0) &&
+		       (status.result != Status::CANCELLED) &&
+		       (status.result != Status::TERMINATED_EARLY));
+    int error_code = status.error_code;
+    ByteArray error_details(status.error_details);
     Operation::mark_completed();
+    item->continuation_completed(this, successful, error_code, error_details);
+  }
+
+  Task *Task::create_continuation(Processor::TaskFuncID _func_id,
+				  const void *_args, size_t _arglen,
+				  Event _before_event, Event _finish_event, int _priority)
+  {
+    // only one continuation per task - a continuation's own continuation takes over
+    //  its work item, so the original task only ever has one outstanding, no matter
+    //  how long the chain gets
+    assert(!continuation_requested);
+    continuation_requested = true;
+
+    TaskContinuation *item;
+    if(continuation_item) {
+      item = continuation_item;
+      continuation_item = 0;
+    } else {
+      item = new TaskContinuation(this);
+      add_async_work_item(item);
+      // publish before checking for a cancellation below - attempt_cancellation
+      //  does the same in the other order, so one of us will forward it
+      outstanding_continuation = item;
+      __sync_synchronize();
+    }
+
+    Task *cont = new Task(proc, _func_id, _args, _arglen, ProfilingRequestSet(),
+			  _before_event, _finish_event, _priority);
+    cont->continuation_item = item;
+
+    // a task that has been asked to stop doesn't get to keep going in a continuation
+    if(status.result == Status::INTERRUPT_REQUESTED)
+      item->forward_cancellation(status.error_code,
+				 status.error_details.base(),
+				 status.error_details.size());
+    item->set_current(cont);
+
+    log_task.info() << "task " << (void *)cont << " continues task " << (void *)this
+		    << ": func=" << _func_id << " before=" << _before_event;
+    return cont;
+  }
+
+
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class TaskContinuation
+  //
+
+  TaskContinuation::TaskContinuation(Task *_root)
+    : Operation::AsyncWorkItem(_root)
+    , current(0), cancel_requested(false), cancel_code(0)
+    , chain_failed(false), chain_error_code(0)
+  {
+  }
+
+  TaskContinuation::~TaskContinuation(void)
+  {
+    assert(current == 0);
+  }
+
+  void TaskContinuation::set_current(Task *cont)
+  {
+    cont->add_reference();
+    Task *prev;
+    bool cancel_now;
+    int code;
+    ByteArray details;
+    {
+      AutoHSLLock al(mutex);
+      prev = current;
+      current = cont;
+      cancel_now = cancel_requested;
+      if(cancel_now) {
+	code = cancel_code;
+	details = cancel_details;
+      }
+    }
+    if(prev)
+      prev->remove_reference();
+    // the new continuation hasn't been enqueued yet, so this just marks it
+    //  CANCELLED - it is finished (unsuccessfully) when it would have been ready
+    if(cancel_now)
+      cont->attempt_cancellation(code, details.base(), details.size());
+  }
+
+  void TaskContinuation::continuation_completed(Task *cont, bool successful,
+						int error_code, const ByteArray& details)
+  {
+    {
+      AutoHSLLock al(mutex);
+      assert(current == cont);
+      current = 0;
+    }
+
+    if(!successful) {
+      chain_failed = true;
+      chain_error_code = error_code;
+      chain_error_details = details;
+    }
+
+    // the atomic update in mark_finished orders the above before the original
+    //  task's mark_completed reads it
+    mark_finished(successful);
+
+    cont->remove_reference();
+  }
+
+  void TaskContinuation::forward_cancellation(int error_code,
+					      const void *reason_data, size_t reason_size)
+  {
+    Task *to_cancel;
+    {
+      AutoHSLLock al(mutex);
+      if(cancel_requested)
+	return;
+      cancel_requested = true;
+      cancel_code = error_code;
+      cancel_details.set(reason_data, reason_size);
+      to_cancel = current;
+      if(to_cancel)
+	to_cancel->add_reference();
+    }
+    if(to_cancel) {
+      log_task.info() << "cancellation of task " << (void *)op
+		      << " forwarded to continuation " << (void *)to_cancel;
+      to_cancel->attempt_cancellation(error_code, reason_data, reason_size);
+      to_cancel->remove_reference();
+    }
+  }
+
+  void TaskContinuation::request_cancellation(void)
+  {
+    // the original task terminated early after requesting its continuation - the
+    //  rest of its work shouldn't run
+    Task *root = static_cast<Task *>(op);
+    forward_cancellation(root->status.error_code,
+			 root->status.error_details.base(),
+			 root->status.error_details.size());
+  }
+
+  void TaskContinuation::print(std::ostream& os) const
+  {
+    os << "TaskContinuation";
   }
 
   bool Task::attempt_cancellation(int error_code, const void *reason_data, size_t reason_size)
@@ -82,12 +317,23 @@ namespace Realm {
     if(Operation::attempt_cancellation(error_code, reason_data, reason_size))
       return true;
 
+    // once a task has requested a continuation, the rest of its work happens
+    //  there - the thread that ran the body may have moved on to something else
+    __sync_synchronize();
+    if(outstanding_continuation) {
+      outstanding_continuation->forward_cancellation(error_code, reason_data, reason_size);
+      return true;
+    }
+
     // for a running task, see if we can signal it to stop
     if(__sync_bool_compare_and_swap(&status.result,
 				    Status::RUNNING,
 				    Status::INTERRUPT_REQUESTED)) {
       status.error_code = error_code;
       status.error_details.set(reason_data, reason_size);
+      // check again in case a continuation was requested in the meantime
+      if(outstanding_continuation)
+	outstanding_continuation->forward_cancellation(error_code, reason_data, reason_size);
       Thread *t = executing_thread;
       assert(t != 0);
       t->signal(Thread::TSIG_INTERRUPT, true /*async*/);
@@ -138,6 +384,8 @@ namespace Realm {
       // make sure the current processor is set during execution of the task
       ThreadLocal::current_processor = p;
 
+      EventGraphTrace::record(EventGraphTrace::Record::REC_TASK_BEGIN, finish_event, p);
+
 #ifdef REALM_USE_EXCEPTIONS
       // even if exceptions are enabled, we only install handlers if somebody is paying
       //  attention to the OperationStatus
@@ -145,6 +393,7 @@ namespace Realm {
 	try {
 	  Thread::ExceptionHandlerPresence ehp;
 	  get_runtime()->get_processor_impl(p)->execute_task(func_id, args);
+	  EventGraphTrace::record(EventGraphTrace::Record::REC_TASK_END, finish_event, p);
 	  thread->stop_operation(this);
 	  mark_finished(true /*successful*/);
 	}
@@ -158,6 +407,7 @@ namespace Realm {
       {
 	// just run the task - if it completes, we assume it was successful
 	get_runtime()->get_processor_impl(p)->execute_task(func_id, args);
+	EventGraphTrace::record(EventGraphTrace::Record::REC_TASK_END, finish_event, p);
 	thread->stop_operation(this);
 	mark_finished(true /*successful*/);
       }
@@ -303,6 +553,66 @@ namespace Realm {
   }
 
 
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class TaskSlab
+  //
+
+  static size_t round_up_16(size_t x)
+  {
+    return ((x + 15) & ~(size_t)15);
+  }
+
+  /*static*/ size_t TaskSlab::task_stride(void)
+  {
+    return round_up_16(sizeof(TaskAllocHeader) + sizeof(Task));
+  }
+
+  /*static*/ TaskSlab *TaskSlab::create(size_t _num_tasks, size_t _total_arglen)
+  {
+    assert(_num_tasks > 0);
+    size_t hdr_size = round_up_16(sizeof(TaskSlab));
+    size_t task_bytes = _num_tasks * task_stride();
+    char *base = (char *)malloc(hdr_size + task_bytes + _total_arglen);
+    assert(base != 0);
+
+    TaskSlab *slab = new(base) TaskSlab;
+    slab->num_tasks = _num_tasks;
+    slab->tasks_allocated = 0;
+    slab->tasks_remaining = _num_tasks;
+    slab->args_used = 0;
+    slab->task_base = base + hdr_size;
+    slab->arg_base = base + hdr_size + task_bytes;
+    return slab;
+  }
+
+  void *TaskSlab::alloc_task(void)
+  {
+    // only the spawning thread allocates, so no atomics needed here
+    assert(tasks_allocated < num_tasks);
+    return task_base + (tasks_allocated++ * task_stride());
+  }
+
+  ByteArrayRef TaskSlab::add_args(const void *args, size_t arglen)
+  {
+    char *dst = arg_base + args_used;
+    if(arglen > 0)
+      memcpy(dst, args, arglen);
+    args_used += arglen;
+    return ByteArrayRef(dst, arglen);
+  }
+
+  void TaskSlab::task_deleted(void)
+  {
+    // every slot must be handed out before tasks start going away
+    if(__sync_sub_and_fetch(&tasks_remaining, 1) == 0) {
+      assert(tasks_allocated == num_tasks);
+      this->~TaskSlab();
+      free(this);
+    }
+  }
+
+
   ////////////////////////////////////////////////////////////////////////
   //
   // class ThreadedTaskScheduler
@@ -999,7 +1309,8 @@ namespace Realm {
   inline void UserThreadTaskScheduler::do_user_thread_cleanup(void)
   {
     if(ThreadLocal::terminated_user_thread != 0) {
-      //delete ThreadLocal::terminated_user_thread;
+      // this returns the thread's stack to the pool for the next worker
+      delete ThreadLocal::terminated_user_thread;
       ThreadLocal::terminated_user_thread = 0;
     }
   }
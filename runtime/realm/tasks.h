@@ -30,6 +30,9 @@
 
 namespace Realm {
 
+    class TaskSlab;
+    class TaskContinuation;
+
     // information for a task launch
     class Task : public Operation {
     public:
@@ -40,6 +43,23 @@ namespace Realm {
 	   Event _before_event,
 	   Event _finish_event, int _priority);
 
+      // tasks created by a bulk spawn refer to argument data held by their slab
+      //  rather than each having their own copy
+      Task(Processor _proc,
+	   Processor::TaskFuncID _func_id,
+	   const ByteArrayRef& _shared_args,
+           const ProfilingRequestSet &reqs,
+	   Event _before_event,
+	   Event _finish_event, int _priority);
+
+      // every Task allocation carries a small header that says whether it came
+      //  from the heap or from a TaskSlab, so that the 'delete this' in
+      //  Operation::remove_reference works for both
+      static void *operator new(size_t size);
+      static void *operator new(size_t size, TaskSlab *slab);
+      static void operator delete(void *ptr);
+      static void operator delete(void *ptr, TaskSlab *slab);
+
     protected:
       // deletion performed when reference count goes to zero
       virtual ~Task(void);
@@ -54,16 +74,98 @@ namespace Realm {
       
       void execute_on_processor(Processor p);
 
+      // creates (but does not enqueue) a continuation of this (running) task - the
+      //  original task will not complete until the continuation has
+      Task *create_continuation(Processor::TaskFuncID _func_id,
+				const void *_args, size_t _arglen,
+				Event _before_event, Event _finish_event, int _priority);
+
       Processor proc;
       Processor::TaskFuncID func_id;
-      ByteArray args;
+    protected:
+      ByteArray arg_storage;  // empty for tasks whose args live in a slab
+    public:
+      ByteArrayRef args;
       Event before_event;
       int priority;
 
     protected:
+      friend class TaskContinuation;
+
       virtual void mark_completed(void);
 
       Thread *executing_thread;
+
+      // set for continuations - the work item (of the original task) to finish
+      //  when this one completes
+      TaskContinuation *continuation_item;
+      bool continuation_requested;
+      // set on the original task once it has requested a continuation - from
+      //  then on, cancellation requests are forwarded down the chain
+      TaskContinuation *outstanding_continuation;
+    };
+
+    // the async work item that holds up a task that has requested a continuation
+    class TaskContinuation : public Operation::AsyncWorkItem {
+    public:
+      TaskContinuation(Task *_root);
+      virtual ~TaskContinuation(void);
+
+      // records the continuation now carrying the chain - it is cancelled right
+      //  away if the original task already has been
+      void set_current(Task *cont);
+
+      // called when the last continuation in the chain completes - its terminal
+      //  status becomes that of the original task
+      void continuation_completed(Task *cont, bool successful,
+				  int error_code, const ByteArray& details);
+
+      // cancels whichever continuation is currently carrying the chain
+      void forward_cancellation(int error_code, const void *reason_data, size_t reason_size);
+
+      virtual void request_cancellation(void);
+
+      virtual void print(std::ostream& os) const;
+
+    protected:
+      friend class Task;
+
+      GASNetHSL mutex;
+      Task *current;
+      bool cancel_requested;
+      int cancel_code;
+      ByteArray cancel_details;
+      // filled in (before the work item is finished) if the chain failed
+      bool chain_failed;
+      int chain_error_code;
+      ByteArray chain_error_details;
+    };
+
+    // a single allocation holding the Task objects and the concatenated argument
+    //  data for a bulk spawn - it is freed when the last of its tasks is deleted
+    class TaskSlab {
+    public:
+      static TaskSlab *create(size_t _num_tasks, size_t _total_arglen);
+
+      // space for the next Task object (use with placement new)
+      void *alloc_task(void);
+
+      // copies argument data into the slab, returning a reference to the copy
+      ByteArrayRef add_args(const void *args, size_t arglen);
+
+    protected:
+      friend class Task;
+
+      TaskSlab(void) {}
+      ~TaskSlab(void) {}
+
+      void task_deleted(void);
+
+      static size_t task_stride(void);
+
+      size_t num_tasks, tasks_allocated, tasks_remaining;
+      size_t args_used;
+      char *task_base, *arg_base;
     };
 
     // a task scheduler in which one or more worker threads execute tasks from one
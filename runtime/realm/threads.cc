@@ -28,6 +28,7 @@
 #include <pthread.h>
 // for PTHREAD_STACK_MIN
 #include <limits.h>
+#include <sys/mman.h>
 #ifdef __MACH__
 // for sched_yield
 #include <sched.h>
@@ -87,8 +88,37 @@ namespace Realm {
 
   namespace ThreadLocal {
     /*extern*/ __thread Thread *current_thread = 0;
+
+    __thread ThreadLocalCache *thread_caches = 0;
   };
 
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class ThreadLocalCache
+
+  ThreadLocalCache::ThreadLocalCache(void)
+    : next_cache(0)
+  {}
+
+  ThreadLocalCache::~ThreadLocalCache(void)
+  {}
+
+  /*static*/ void ThreadLocalCache::register_cache(ThreadLocalCache *cache)
+  {
+    cache->next_cache = ThreadLocal::thread_caches;
+    ThreadLocal::thread_caches = cache;
+  }
+
+  /*static*/ void ThreadLocalCache::flush_thread_caches(void)
+  {
+    while(ThreadLocal::thread_caches) {
+      ThreadLocalCache *cache = ThreadLocal::thread_caches;
+      ThreadLocal::thread_caches = cache->next_cache;
+      cache->flush();
+      delete cache;
+    }
+  }
+
   ////////////////////////////////////////////////////////////////////////
   //
   // class CoreReservation
@@ -247,6 +277,45 @@ namespace Realm {
     }
   }
 
+  // gathers the cores that have been given to any of the reservations in 'others', either
+  //  by an existing allocation or earlier in the current allocation attempt
+  static void collect_reservation_procs(const CoreMap& cm,
+					const std::set<const CoreReservation *>& others,
+					const std::map<CoreReservation *, CoreReservation::Allocation *>& allocs,
+					const std::map<CoreReservation *, std::set<const CoreMap::Proc *> >& assigned_procs,
+					std::set<const CoreMap::Proc *>& procs)
+  {
+    for(std::set<const CoreReservation *>::const_iterator it = others.begin();
+	it != others.end();
+	it++) {
+      CoreReservation *other = const_cast<CoreReservation *>(*it);
+      std::map<CoreReservation *, CoreReservation::Allocation *>::const_iterator it2 = allocs.find(other);
+      if((it2 != allocs.end()) && it2->second) {
+	for(std::set<int>::const_iterator it3 = it2->second->proc_ids.begin();
+	    it3 != it2->second->proc_ids.end();
+	    it3++) {
+	  CoreMap::ProcMap::const_iterator it4 = cm.all_procs.find(*it3);
+	  if(it4 != cm.all_procs.end())
+	    procs.insert(it4->second);
+	}
+      }
+      std::map<CoreReservation *, std::set<const CoreMap::Proc *> >::const_iterator it5 = assigned_procs.find(other);
+      if(it5 != assigned_procs.end())
+	procs.insert(it5->second.begin(), it5->second.end());
+    }
+  }
+
+  static bool shares_llc_with_any(const CoreMap::Proc *p,
+				  const std::set<const CoreMap::Proc *>& procs)
+  {
+    if(procs.count(p) > 0) return true;
+    for(std::set<CoreMap::Proc *>::const_iterator it = p->shares_llc.begin();
+	it != p->shares_llc.end();
+	it++)
+      if(procs.count(*it) > 0) return true;
+    return false;
+  }
+
   // attempts to find an allocation satisfying all the reservation requests in 'allocs' -
   //  if any allocations are already present, those are preserved (possibly causing the
   //  allocation attempt to fail)
@@ -341,18 +410,59 @@ namespace Realm {
 	}
       }
 
+      // reservations with cache preferences go after the others, so that the reservations
+      //  they refer to are more likely to have been placed already
+      std::vector<CoreReservation *> rsrvs;
       for(std::set<CoreReservation *>::iterator it2 = it->second.begin();
 	  it2 != it->second.end();
+	  it2++)
+	if((*it2)->params.share_llc_with.empty() && (*it2)->params.avoid_llc_with.empty())
+	  rsrvs.push_back(*it2);
+      for(std::set<CoreReservation *>::iterator it2 = it->second.begin();
+	  it2 != it->second.end();
+	  it2++)
+	if(!((*it2)->params.share_llc_with.empty() && (*it2)->params.avoid_llc_with.empty()))
+	  rsrvs.push_back(*it2);
+
+      for(std::vector<CoreReservation *>::iterator it2 = rsrvs.begin();
+	  it2 != rsrvs.end();
 	  it2++) {
 	CoreReservation *rsrv = *it2;
 	std::set<const CoreMap::Proc *>& procs = assigned_procs[rsrv];
 
+	// put the processors that match any cache preferences first - a shared reservation
+	//  normally takes every compatible processor, but will stop after the preferred ones
+	//  if it has enough
+	std::vector<const CoreMap::Proc *> ordered;
+	size_t num_preferred = pm.size();
+	if(rsrv->params.share_llc_with.empty() && rsrv->params.avoid_llc_with.empty()) {
+	  ordered = pm;
+	} else {
+	  std::set<const CoreMap::Proc *> share_procs, avoid_procs;
+	  collect_reservation_procs(cm, rsrv->params.share_llc_with, allocs, assigned_procs,
+				    share_procs);
+	  collect_reservation_procs(cm, rsrv->params.avoid_llc_with, allocs, assigned_procs,
+				    avoid_procs);
+	  std::vector<const CoreMap::Proc *> others;
+	  for(std::vector<const CoreMap::Proc *>::const_iterator it3 = pm.begin();
+	      it3 != pm.end();
+	      it3++)
+	    if((share_procs.empty() || shares_llc_with_any(*it3, share_procs)) &&
+	       (avoid_procs.empty() || !shares_llc_with_any(*it3, avoid_procs)))
+	      ordered.push_back(*it3);
+	    else
+	      others.push_back(*it3);
+	  num_preferred = ordered.size();
+	  ordered.insert(ordered.end(), others.begin(), others.end());
+	}
+
 	// iterate over all the possibly available processors and see if any fit
-	for(std::vector<const CoreMap::Proc *>::iterator it3 = pm.begin();
-	    it3 != pm.end();
-	    it3++)
+	for(size_t idx = 0; idx < ordered.size(); idx++)
 	{
-	  const CoreMap::Proc *p = *it3;
+	  const CoreMap::Proc *p = ordered[idx];
+
+	  if((idx >= num_preferred) && ((int)(procs.size()) >= rsrv->params.num_cores))
+	    break;
 
 	  // is there already conflicting usage?
 	  if(!(can_add_usage(alu_usage, rsrv->params.alu_usage, p, p->shares_alu) &&
@@ -503,6 +613,23 @@ namespace Realm {
       os << rsrv->name << ": ";
       if(alloc) {
 	os << "allocated " << alloc->proc_ids;
+	// identify each last-level cache used by the lowest core id that shares it
+	std::set<int> llcs;
+	for(std::set<int>::const_iterator it2 = alloc->proc_ids.begin();
+	    it2 != alloc->proc_ids.end();
+	    it2++) {
+	  CoreMap::ProcMap::const_iterator it3 = cm->all_procs.find(*it2);
+	  if(it3 == cm->all_procs.end()) continue;
+	  int llc_id = it3->second->id;
+	  for(std::set<CoreMap::Proc *>::const_iterator it4 = it3->second->shares_llc.begin();
+	      it4 != it3->second->shares_llc.end();
+	      it4++)
+	    if((*it4)->id < llc_id)
+	      llc_id = (*it4)->id;
+	  llcs.insert(llc_id);
+	}
+	if(!llcs.empty())
+	  os << " llc=" << llcs;
       } else {
 	os << "not allocated";
       }
@@ -673,6 +800,10 @@ namespace Realm {
     // call the actual thread body
     (*thread->entry_wrapper)(thread->target);
 
+    // give back anything this thread has cached before anybody joining on
+    //  us can tear down the objects the caches belong to
+    ThreadLocalCache::flush_thread_caches();
+
     // on return, we update our status and terminate
     log_thread.info() << "thread " << thread << " finished";
     thread->update_state(STATE_FINISHED);
@@ -847,13 +978,80 @@ namespace Realm {
   {
   }
 
+  // user thread stacks are recycled rather than unmapped and mapped again for
+  //  every new worker - nearly all workers use the same size, so a free list
+  //  per size is plenty.  A pooled stack keeps its address range, but all
+  //  except the top (i.e. most recently used) part of it is handed back to
+  //  the OS, so an idle pool costs little memory
+  class UserThreadStackPool {
+  public:
+    static void *alloc_stack(size_t size);
+    static void free_stack(void *base, size_t size);
+
+  protected:
+    // beyond this, stacks really are freed
+    static const size_t MAX_POOLED_STACKS = 64;
+
+    // how much of the top of a pooled stack stays resident
+    static const size_t RESIDENT_STACK_SIZE = 64 << 10;
+
+    static GASNetHSL mutex;
+    static std::map<size_t, std::vector<void *> > free_stacks;
+  };
+
+  /*static*/ GASNetHSL UserThreadStackPool::mutex;
+  /*static*/ std::map<size_t, std::vector<void *> > UserThreadStackPool::free_stacks;
+
+  /*static*/ void *UserThreadStackPool::alloc_stack(size_t size)
+  {
+    {
+      AutoHSLLock al(mutex);
+      std::vector<void *>& stacks = free_stacks[size];
+      if(!stacks.empty()) {
+	void *base = stacks.back();
+	stacks.pop_back();
+	return base;
+      }
+    }
+
+    void *base = mmap(0, size, PROT_READ | PROT_WRITE,
+		      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    assert(base != MAP_FAILED);
+    return base;
+  }
+
+  /*static*/ void UserThreadStackPool::free_stack(void *base, size_t size)
+  {
+    // stacks grow down, so the pages at the bottom are the ones least likely
+    //  to be used again soon - 'base' is page-aligned (it came from mmap) and
+    //  madvise rounds the length up, which at worst releases a little more
+    if(size > RESIDENT_STACK_SIZE) {
+#ifndef NDEBUG
+      int ret =
+#endif
+	madvise(base, size - RESIDENT_STACK_SIZE, MADV_DONTNEED);
+      assert(ret == 0);
+    }
+
+    {
+      AutoHSLLock al(mutex);
+      std::vector<void *>& stacks = free_stacks[size];
+      if(stacks.size() < MAX_POOLED_STACKS) {
+	stacks.push_back(base);
+	return;
+      }
+    }
+
+    munmap(base, size);
+  }
+
   UserThread::~UserThread(void)
   {
     // cannot delete an active thread...
     assert(!running);
 
     if(stack_base != 0)
-      free(stack_base);
+      UserThreadStackPool::free_stack(stack_base, stack_size);
   }
 
   namespace ThreadLocal {
@@ -909,8 +1107,7 @@ namespace Realm {
       stack_size = 2 << 20; // pick something - 2MB ?
     }
 
-    stack_base = malloc(stack_size);
-    assert(stack_base != 0);
+    stack_base = UserThreadStackPool::alloc_stack(stack_size);
 
     getcontext(&ctx);
 
@@ -1117,10 +1314,21 @@ namespace Realm {
     by_domain.clear();
   }
 
+  // makes every proc in 'procs' share the given resource with every other one
+  static void share_all_pairs(const std::set<CoreMap::Proc *>& procs,
+			      std::set<CoreMap::Proc *> CoreMap::Proc::*shares)
+  {
+    for(std::set<CoreMap::Proc *>::const_iterator it1 = procs.begin(); it1 != procs.end(); it1++)
+      for(std::set<CoreMap::Proc *>::const_iterator it2 = procs.begin(); it2 != procs.end(); it2++)
+	if(it1 != it2)
+	  ((*it1)->*shares).insert(*it2);
+  }
+
   /*static*/ CoreMap *CoreMap::create_synthetic(int num_domains,
 						int cores_per_domain,
 						int hyperthreads /*= 1*/,
-						int fp_cluster_size /*= 1*/)
+						int fp_cluster_size /*= 1*/,
+						int llc_cluster_size /*= 0*/)
   {
     CoreMap *cm = new CoreMap;
 
@@ -1128,9 +1336,17 @@ namespace Realm {
     int next_id = 0;
 
     for(int d = 0; d < num_domains; d++) {
+      std::set<Proc *> llc_procs;
+
       for(int c = 0; c < cores_per_domain; c++) {
 	std::set<Proc *> fp_procs;
 
+	// start a new LLC group if requested
+	if((llc_cluster_size > 0) && ((c % llc_cluster_size) == 0)) {
+	  share_all_pairs(llc_procs, &Proc::shares_llc);
+	  llc_procs.clear();
+	}
+
 	for(int f = 0; f < fp_cluster_size; f++) {
 	  std::set<Proc *> ht_procs;
 
@@ -1150,13 +1366,16 @@ namespace Realm {
 	    fp_procs.insert(p);
 	  }
 
-	  // ALU and LD/ST shared with all other hyperthreads
+	  // ALU, LD/ST and L2 shared with all other hyperthreads
 	  for(std::set<Proc *>::iterator it1 = ht_procs.begin(); it1 != ht_procs.end(); it1++)
 	    for(std::set<Proc *>::iterator it2 = ht_procs.begin(); it2 != ht_procs.end(); it2++)
 	      if(it1 != it2) {
 		(*it1)->shares_alu.insert(*it2);
 		(*it1)->shares_ldst.insert(*it2);
+		(*it1)->shares_l2.insert(*it2);
 	      }
+
+	  llc_procs.insert(ht_procs.begin(), ht_procs.end());
 	}
 
 	// FPU shared with all other procs in cluster
@@ -1166,6 +1385,8 @@ namespace Realm {
 	      (*it1)->shares_fpu.insert(*it2);
 	    }
       }
+
+      share_all_pairs(llc_procs, &Proc::shares_llc);
     }
 
     return cm;
@@ -1195,6 +1416,99 @@ namespace Realm {
   }
 
 #ifdef __linux__
+  // parses a cpu list like "0-3,8,10-11" into a set of cpu ids
+  static bool parse_cpu_list(const char *path, std::set<int>& cpus)
+  {
+    FILE *f = fopen(path, "r");
+    if(!f) return false;
+    char buffer[1024];
+    char *s = fgets(buffer, sizeof(buffer), f);
+    fclose(f);
+    if(!s) return false;
+
+    const char *p = buffer;
+    while(isdigit(*p)) {
+      char *pos;
+      int first = strtol(p, &pos, 10);
+      int last = first;
+      if(*pos == '-')
+	last = strtol(pos + 1, &pos, 10);
+      for(int i = first; i <= last; i++)
+	cpus.insert(i);
+      p = pos;
+      if(*p == ',') p++;
+    }
+    return true;
+  }
+
+  // fills in L2 and last-level cache sharing from /sys/devices/system/cpu/cpu<N>/cache
+  static void update_cache_sharing_from_linux_sys(CoreMap *cm)
+  {
+    std::map<int, CoreMap::Proc *> by_kernel_id;
+    for(CoreMap::ProcMap::const_iterator it = cm->all_procs.begin();
+	it != cm->all_procs.end();
+	it++)
+      for(std::set<int>::const_iterator it2 = it->second->kernel_proc_ids.begin();
+	  it2 != it->second->kernel_proc_ids.end();
+	  it2++)
+	by_kernel_id[*it2] = it->second;
+
+    for(std::map<int, CoreMap::Proc *>::const_iterator it = by_kernel_id.begin();
+	it != by_kernel_id.end();
+	it++) {
+      CoreMap::Proc *p = it->second;
+      int llc_level = 0;
+      std::set<int> l2_cpus, llc_cpus;
+
+      // look at /sys/devices/system/cpu/cpu<N>/cache/index<M> until one is missing
+      for(int idx = 0; ; idx++) {
+	char path[1024];
+	sprintf(path, "/sys/devices/system/cpu/cpu%d/cache/index%d/level", it->first, idx);
+	FILE *f = fopen(path, "r");
+	if(!f) break;
+	int level;
+	int count = fscanf(f, "%d", &level);
+	fclose(f);
+	if(count != 1) break;
+
+	// instruction caches don't matter for data sharing
+	sprintf(path, "/sys/devices/system/cpu/cpu%d/cache/index%d/type", it->first, idx);
+	f = fopen(path, "r");
+	if(f) {
+	  char type[64];
+	  count = fscanf(f, "%63s", type);
+	  fclose(f);
+	  if((count == 1) && !strcmp(type, "Instruction")) continue;
+	}
+
+	std::set<int> cpus;
+	sprintf(path, "/sys/devices/system/cpu/cpu%d/cache/index%d/shared_cpu_list", it->first, idx);
+	if(!parse_cpu_list(path, cpus)) {
+	  log_thread.info() << "can't read '" << path << "' - skipping";
+	  continue;
+	}
+
+	if(level == 2)
+	  l2_cpus = cpus;
+	if(level > llc_level) {
+	  llc_level = level;
+	  llc_cpus = cpus;
+	}
+      }
+
+      for(std::set<int>::const_iterator it2 = l2_cpus.begin(); it2 != l2_cpus.end(); it2++) {
+	std::map<int, CoreMap::Proc *>::const_iterator it3 = by_kernel_id.find(*it2);
+	if((it3 != by_kernel_id.end()) && (it3->second != p))
+	  p->shares_l2.insert(it3->second);
+      }
+      for(std::set<int>::const_iterator it2 = llc_cpus.begin(); it2 != llc_cpus.end(); it2++) {
+	std::map<int, CoreMap::Proc *>::const_iterator it3 = by_kernel_id.find(*it2);
+	if((it3 != by_kernel_id.end()) && (it3->second != p))
+	  p->shares_llc.insert(it3->second);
+      }
+    }
+  }
+
   static CoreMap *extract_core_map_from_linux_sys(bool hyperthread_sharing)
   {
     cpu_set_t cset;
@@ -1276,6 +1590,7 @@ namespace Realm {
 
     if(hyperthread_sharing)
       update_ht_sharing(ht_sets);
+    update_cache_sharing_from_linux_sys(cm);
 
     // all done!
     return cm;
@@ -1391,6 +1706,9 @@ namespace Realm {
     if(hyperthread_sharing)
       update_ht_sharing(ht_sets);
     update_bd_sharing(bd_sets);
+#ifdef __linux__
+    update_cache_sharing_from_linux_sys(cm);
+#endif
 
     // all done!
     return cm;
@@ -1407,6 +1725,7 @@ namespace Realm {
       int num_cores = 1;
       int hyperthreads = 1;
       int fp_cluster_size = 1;
+      int llc_cluster_size = 0;
       while(true) {
 	if(!(p[0] && (p[1] == '=') && isdigit(p[2]))) break;
 
@@ -1417,6 +1736,7 @@ namespace Realm {
 	if(p[0] == 'c') num_cores = x; else
 	if(p[0] == 'h') hyperthreads = x; else
 	if(p[0] == 'f') fp_cluster_size = x; else
+	if(p[0] == 'l') llc_cluster_size = x; else
 	  break;
 	p = p2;
 
@@ -1426,7 +1746,8 @@ namespace Realm {
       }
       // if parsing reached the end of string, we're good
       if(*p == 0) {
-	return CoreMap::create_synthetic(num_domains, num_cores, hyperthreads, fp_cluster_size);
+	return CoreMap::create_synthetic(num_domains, num_cores, hyperthreads, fp_cluster_size,
+					 llc_cluster_size);
       } else {
 	const char *orig = getenv("REALM_SYNTHETIC_CORE_MAP");
 	log_thread.error("Error parsing REALM_SYNTHETIC_CORE_MAP: '%.*s(^)%s'",
@@ -1498,6 +1819,8 @@ namespace Realm {
 	show_share_set(os, "alu", p->shares_alu);
 	show_share_set(os, "fpu", p->shares_fpu);
 	show_share_set(os, "ldst", p->shares_ldst);
+	show_share_set(os, "l2", p->shares_l2);
+	show_share_set(os, "llc", p->shares_llc);
 
 	os << " }" << std::endl;
       }
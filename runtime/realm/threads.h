@@ -188,6 +188,28 @@ namespace Realm {
     std::deque<Signal> signal_queue;
   };
 
+  // a ThreadLocalCache holds some per-thread cached state that belongs to a
+  //  shared object (e.g. the free entries a thread has taken from a dynamic
+  //  table's free list) - caches are registered with the thread that created
+  //  them, and a Realm kernel thread flushes and deletes its caches when it exits
+  class ThreadLocalCache {
+  public:
+    ThreadLocalCache(void);
+    virtual ~ThreadLocalCache(void);
+
+    // hands anything still cached back to the shared object
+    virtual void flush(void) = 0;
+
+    // adds a cache to the calling thread's set
+    static void register_cache(ThreadLocalCache *cache);
+
+    // flushes and deletes every cache registered by the calling thread
+    static void flush_thread_caches(void);
+
+  protected:
+    ThreadLocalCache *next_cache;
+  };
+
   // Finally, a Thread may operate as a co-routine, "yielding" intermediate values and 
   //  suspending until it is "resumed" (with an optional value)
 
@@ -273,6 +295,11 @@ namespace Realm {
   //  all) it intends to use the integer, floating-point, and load/store datapaths of the core(s).
   //  A reservation with EXCLUSIVE use is compatible with those expecting MINIMAL use of the
   //  same datapath, but not with any other reservation desiring EXCLUSIVE or SHARED access.
+  // A reservation may also ask that its cores share (or not share) a last-level cache with
+  //  the cores of other reservations in the same set.  These are only preferences - cores
+  //  that don't match will still be used if the reservation can't be satisfied otherwise.
+
+  class CoreReservation;
   class CoreReservationParameters {
   public:
     enum CoreUsage { CORE_USAGE_NONE,
@@ -291,6 +318,8 @@ namespace Realm {
     WithDefault<CoreUsage, CORE_USAGE_SHARED>  ldst_usage;  // "memory" datapath usage
     WithDefault<ptrdiff_t, STACK_SIZE_DEFAULT> max_stack_size;
     WithDefault<ptrdiff_t, HEAP_SIZE_DEFAULT>  max_heap_size;
+    std::set<const CoreReservation *> share_llc_with;  // prefer cores sharing an LLC with these
+    std::set<const CoreReservation *> avoid_llc_with;  // prefer cores NOT sharing an LLC with these
 
     CoreReservationParameters(void);
 
@@ -301,6 +330,8 @@ namespace Realm {
     CoreReservationParameters& set_ldst_usage(CoreUsage new_ldst_usage);
     CoreReservationParameters& set_max_stack_size(ptrdiff_t new_max_stack_size);
     CoreReservationParameters& set_max_heap_size(ptrdiff_t new_max_heap_size);
+    CoreReservationParameters& add_share_llc_with(const CoreReservation *other);
+    CoreReservationParameters& add_avoid_llc_with(const CoreReservation *other);
   };
 
   class CoreReservationSet;
@@ -357,8 +388,11 @@ namespace Realm {
 
     // creates a simple synthetic core map - it is symmetric and hierarchical:
     //   numa domains -> cores -> fp clusters (shared fpu) -> hyperthreads (shared alu/ldst)
+    //   (cores in a domain share a last-level cache, unless 'llc_cluster_size' splits them
+    //    into smaller groups)
     static CoreMap *create_synthetic(int num_domains, int cores_per_domain,
-				     int hyperthreads = 1, int fp_cluster_size = 1);
+				     int hyperthreads = 1, int fp_cluster_size = 1,
+				     int llc_cluster_size = 0);
 
     struct Proc {
       int id;      // a unique integer id
@@ -367,6 +401,8 @@ namespace Realm {
       std::set<Proc *> shares_alu;    // which other procs does this share an ALU with
       std::set<Proc *> shares_fpu;    // which other procs does this share an FPU with
       std::set<Proc *> shares_ldst;   // which other procs does this share an LD/ST path with
+      std::set<Proc *> shares_l2;     // which other procs does this share an L2 cache with
+      std::set<Proc *> shares_llc;    // which other procs does this share a last-level cache with
     };
 
     typedef std::map<int, Proc *> ProcMap;
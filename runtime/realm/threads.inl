@@ -372,6 +372,18 @@ namespace Realm {
     return *this;
   }
 
+  inline CoreReservationParameters& CoreReservationParameters::add_share_llc_with(const CoreReservation *other)
+  {
+    this->share_llc_with.insert(other);
+    return *this;
+  }
+
+  inline CoreReservationParameters& CoreReservationParameters::add_avoid_llc_with(const CoreReservation *other)
+  {
+    this->avoid_llc_with.insert(other);
+    return *this;
+  }
+
 
 };
 
@@ -2612,6 +2612,12 @@ namespace Realm {
       return RuntimeImpl::get_runtime()->get_memory_impl(*this)->total_space();
     }
 
+    size_t Memory::largest_free_block(void) const
+    {
+      // allocations come from malloc so only the remaining space is known
+      return RuntimeImpl::get_runtime()->get_memory_impl(*this)->remaining_bytes();
+    }
+
     AddressSpace Memory::address_space(void) const
     {
       return 0;
@@ -7580,7 +7586,13 @@ namespace LegionRuntime {
   namespace Accessor {
     using namespace LegionRuntime::LowLevel;
 
-    void AccessorType::Generic::Untyped::read_untyped(ptr_t ptr, void *dst, size_t bytes, off_t offset) const
+    void AccessorType::Generic::Untyped::init_fast_path(void) const
+    {
+      // the shared lowlevel runtime always uses the slow path
+      fast_dim = 0;
+    }
+
+    void AccessorType::Generic::Untyped::read_untyped_slow(ptr_t ptr, void *dst, size_t bytes, off_t offset) const
     {
 #ifdef PRIVILEGE_CHECKS 
       check_privileges<ACCESSOR_READ>(priv, region);
@@ -7624,7 +7636,7 @@ namespace LegionRuntime {
       memcpy(dst, src, bytes);
     }
 
-    void AccessorType::Generic::Untyped::write_untyped(ptr_t ptr, const void *src, size_t bytes, off_t offset) const
+    void AccessorType::Generic::Untyped::write_untyped_slow(ptr_t ptr, const void *src, size_t bytes, off_t offset) const
     {
 #ifdef PRIVILEGE_CHECKS 
       check_privileges<ACCESSOR_WRITE>(priv, region);
@@ -0,0 +1,236 @@
+/* Copyright 2016 Stanford University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// measures the per-element read and write rates of Generic region accessors
+//  for AOS and SOA instances (by ptr_t) and for a 2-D instance (by DomainPoint)
+
+#include <cstdio>
+#include <cstdlib>
+#include <cassert>
+#include <cstring>
+#include <set>
+#include <vector>
+
+#include <time.h>
+
+#include "lowlevel.h"
+#include "realm/timers.h"
+
+using namespace LegionRuntime::LowLevel;
+using namespace LegionRuntime::Accessor;
+
+#define DEFAULT_ELEMENTS (1 << 20)
+#define DEFAULT_ITERATIONS 4
+
+// TASK IDs
+enum {
+  TOP_LEVEL_TASK = Processor::TASK_ID_FIRST_AVAILABLE+0,
+};
+
+struct InputArgs {
+  int argc;
+  char **argv;
+};
+
+InputArgs& get_input_args(void)
+{
+  static InputArgs args;
+  return args;
+}
+
+static void report(const char *name, const char *op, double elapsed, long count)
+{
+  fprintf(stdout,"%-12s %-5s: %7.3f ns/element (%.1f M elements/s)\n",
+          name, op, 1e3 * elapsed / count, count / elapsed);
+}
+
+// two 8-byte fields - the accessor is for the second one
+static void test_ptr_accessor(const char *name, Memory m, int num_elements,
+                              int iterations, size_t block_size)
+{
+  Domain dom = Domain::from_rect<1>(Rect<1>(Point<1>(0), Point<1>(num_elements - 1)));
+  std::vector<size_t> field_sizes(2, sizeof(double));
+  RegionInstance inst = dom.create_instance(m, field_sizes, block_size);
+  assert(inst.exists());
+
+  RegionAccessor<AccessorType::Generic, double> acc =
+    inst.get_accessor().get_untyped_field_accessor(sizeof(double), sizeof(double)).typeify<double>();
+
+  double start, stop;
+  start = Realm::Clock::current_time_in_microseconds();
+  for (int it = 0; it < iterations; it++)
+    for (int i = 0; i < num_elements; i++)
+      acc.write(ptr_t(i), (double)(i + it));
+  stop = Realm::Clock::current_time_in_microseconds();
+  report(name, "write", stop - start, (long)num_elements * iterations);
+
+  double sum = 0;
+  start = Realm::Clock::current_time_in_microseconds();
+  for (int it = 0; it < iterations; it++)
+    for (int i = 0; i < num_elements; i++)
+      sum += acc.read(ptr_t(i));
+  stop = Realm::Clock::current_time_in_microseconds();
+  report(name, "read", stop - start, (long)num_elements * iterations);
+
+  // last pass wrote i + (iterations - 1)
+  double expected = iterations * ((double)num_elements * (num_elements - 1) / 2 +
+                                  (double)num_elements * (iterations - 1));
+  if (sum != expected)
+  {
+    fprintf(stderr,"%s: sum mismatch: expected %g, got %g\n", name, expected, sum);
+    exit(1);
+  }
+
+  inst.destroy();
+}
+
+static void test_dp_accessor(const char *name, Memory m, int num_elements,
+                             int iterations)
+{
+  // roughly square
+  int width = 1;
+  while ((width * width) < num_elements) width *= 2;
+  int height = num_elements / width;
+  assert(height > 0);
+  Point<2> lo = Point<2>::ZEROES();
+  int hi_coords[2] = { width - 1, height - 1 };
+  Domain dom = Domain::from_rect<2>(Rect<2>(lo, Point<2>(hi_coords)));
+  RegionInstance inst = dom.create_instance(m, sizeof(double));
+  assert(inst.exists());
+
+  RegionAccessor<AccessorType::Generic, double> acc = inst.get_accessor().typeify<double>();
+  long count = (long)width * height;
+
+  double start, stop;
+  start = Realm::Clock::current_time_in_microseconds();
+  for (int it = 0; it < iterations; it++)
+    for (int y = 0; y < height; y++)
+      for (int x = 0; x < width; x++)
+      {
+        int coords[2] = { x, y };
+        acc.write(DomainPoint::from_point<2>(Point<2>(coords)), (double)(x + y));
+      }
+  stop = Realm::Clock::current_time_in_microseconds();
+  report(name, "write", stop - start, count * iterations);
+
+  double sum = 0;
+  start = Realm::Clock::current_time_in_microseconds();
+  for (int it = 0; it < iterations; it++)
+    for (int y = 0; y < height; y++)
+      for (int x = 0; x < width; x++)
+      {
+        int coords[2] = { x, y };
+        sum += acc.read(DomainPoint::from_point<2>(Point<2>(coords)));
+      }
+  stop = Realm::Clock::current_time_in_microseconds();
+  report(name, "read", stop - start, count * iterations);
+
+  double expected = iterations * ((double)height * width * (width - 1) / 2 +
+                                  (double)width * height * (height - 1) / 2);
+  if (sum != expected)
+  {
+    fprintf(stderr,"%s: sum mismatch: expected %g, got %g\n", name, expected, sum);
+    exit(1);
+  }
+
+  inst.destroy();
+}
+
+void top_level_task(const void *args, size_t arglen,
+                    const void *userdata, size_t userlen, Processor p)
+{
+  int num_elements = DEFAULT_ELEMENTS;
+  int iterations = DEFAULT_ITERATIONS;
+  // Parse the input arguments
+#define INT_ARG(argname, varname) do { \
+        if(!strcmp((argv)[i], argname)) {		\
+          varname = atoi((argv)[++i]);		\
+          continue;					\
+        } } while(0)
+  {
+    InputArgs &inputs = get_input_args();
+    char **argv = inputs.argv;
+    for (int i = 1; i < inputs.argc; i++)
+    {
+      INT_ARG("-n", num_elements);
+      INT_ARG("-i", iterations);
+    }
+    assert(num_elements > 0);
+    assert(iterations > 0);
+  }
+#undef INT_ARG
+
+  // use a system memory on this node
+  Memory m = Memory::NO_MEMORY;
+  {
+    std::set<Memory> mems;
+    Machine::get_machine().get_visible_memories(p, mems);
+    for (std::set<Memory>::const_iterator it = mems.begin();
+          it != mems.end(); it++)
+      if (it->kind() == Memory::SYSTEM_MEM)
+      {
+        m = *it;
+        break;
+      }
+  }
+  assert(m.exists());
+
+  fprintf(stdout,"Running accessor rate experiment with %d elements for %d iterations...\n",
+          num_elements, iterations);
+
+  test_ptr_accessor("aos/ptr", m, num_elements, iterations, 1);
+  test_ptr_accessor("soa/ptr", m, num_elements, iterations, num_elements);
+  test_dp_accessor("2d/point", m, num_elements, iterations);
+}
+
+int main(int argc, char **argv)
+{
+  Runtime r;
+
+  bool ok = r.init(&argc, &argv);
+  assert(ok);
+
+  r.register_task(TOP_LEVEL_TASK, top_level_task);
+
+  // Set the input args
+  get_input_args().argv = argv;
+  get_input_args().argc = argc;
+
+  // select a processor to run the top level task on
+  Processor p = Processor::NO_PROC;
+  {
+    std::set<Processor> all_procs;
+    Machine::get_machine().get_all_processors(all_procs);
+    for(std::set<Processor>::const_iterator it = all_procs.begin();
+	it != all_procs.end();
+	it++)
+      if(it->kind() == Processor::LOC_PROC) {
+	p = *it;
+	break;
+      }
+  }
+  assert(p.exists());
+
+  // collective launch of a single task - everybody gets the same finish event
+  Event e = r.collective_spawn(p, TOP_LEVEL_TASK, 0, 0);
+
+  // request shutdown once that task is complete
+  r.shutdown(e);
+
+  // now sleep this thread until that shutdown actually happens
+  r.wait_for_shutdown();
+
+  return 0;
+}
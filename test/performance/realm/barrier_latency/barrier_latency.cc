@@ -0,0 +1,238 @@
+/* Copyright 2016 Stanford University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// measures the latency of a barrier that every node arrives at and waits on,
+//  optionally with a reduction value - to look at many nodes on a single host,
+//  build with USE_GASNET=1 using the udp or smp conduit and launch with e.g.:
+//    GASNET_SPAWNFN=L amudprun -np 16 ./barrier_latency -realm:barrier_radix 4
+
+#include <cstdio>
+#include <cstdlib>
+#include <cassert>
+#include <cstring>
+#include <set>
+#include <map>
+
+#include <time.h>
+
+#include "lowlevel.h"
+#include "realm/timers.h"
+
+using namespace LegionRuntime::LowLevel;
+
+#define DEFAULT_ITERATIONS 1000
+
+// TASK IDs
+enum {
+  TOP_LEVEL_TASK   = Processor::TASK_ID_FIRST_AVAILABLE+0,
+  PARTICIPANT_TASK = Processor::TASK_ID_FIRST_AVAILABLE+1,
+};
+
+// reduction op IDs
+enum {
+  REDOP_INT_ADD = 1,
+};
+
+class ReductionOpIntAdd {
+public:
+  typedef int LHS;
+  typedef int RHS;
+
+  template <bool EXCL>
+  static void apply(LHS& lhs, RHS rhs) { lhs += rhs; }
+
+  // both of these are optional, but having fold lets arrivals be combined
+  static const RHS identity;
+
+  template <bool EXCL>
+  static void fold(RHS& rhs1, RHS rhs2) { rhs1 += rhs2; }
+};
+
+const ReductionOpIntAdd::RHS ReductionOpIntAdd::identity = 0;
+
+struct InputArgs {
+  int argc;
+  char **argv;
+};
+
+InputArgs& get_input_args(void)
+{
+  static InputArgs args;
+  return args;
+}
+
+struct ParticipantArgs {
+  Barrier barrier;
+  int iterations;
+  int num_participants;
+  bool use_reduction;
+};
+
+void top_level_task(const void *args, size_t arglen,
+                    const void *userdata, size_t userlen, Processor p)
+{
+  int iterations = DEFAULT_ITERATIONS;
+  bool all_procs = false;
+  bool use_reduction = false;
+  // Parse the input arguments
+#define INT_ARG(argname, varname) do { \
+        if(!strcmp((argv)[i], argname)) {		\
+          varname = atoi((argv)[++i]);		\
+          continue;					\
+        } } while(0)
+
+#define BOOL_ARG(argname, varname) do { \
+        if(!strcmp((argv)[i], argname)) {		\
+          varname = true;				\
+          continue;					\
+        } } while(0)
+  {
+    InputArgs &inputs = get_input_args();
+    char **argv = inputs.argv;
+    for (int i = 1; i < inputs.argc; i++)
+    {
+      INT_ARG("-i", iterations);
+      BOOL_ARG("-all", all_procs);
+      BOOL_ARG("-red", use_reduction);
+    }
+    assert(iterations > 0);
+  }
+#undef INT_ARG
+#undef BOOL_ARG
+
+  // one participant per node, unless we've been asked to use every CPU
+  std::vector<Processor> participants;
+  {
+    std::set<Processor> procs;
+    Machine::get_machine().get_all_processors(procs);
+    std::set<Realm::AddressSpace> spaces_seen;
+    for (std::set<Processor>::const_iterator it = procs.begin();
+          it != procs.end(); it++)
+    {
+      if (it->kind() != Processor::LOC_PROC)
+        continue;
+      if (!all_procs && !spaces_seen.insert(it->address_space()).second)
+        continue;
+      participants.push_back(*it);
+    }
+  }
+  assert(!participants.empty());
+
+  int initial_value = 0;
+  Barrier barrier = (use_reduction ?
+		       Barrier::create_barrier(participants.size(), REDOP_INT_ADD,
+					       &initial_value, sizeof(initial_value)) :
+		       Barrier::create_barrier(participants.size()));
+
+  fprintf(stdout,"Running barrier latency experiment with %zd participants for %d iterations%s...\n",
+          participants.size(), iterations, (use_reduction ? " (with reduction)" : ""));
+
+  ParticipantArgs pargs;
+  pargs.barrier = barrier;
+  pargs.iterations = iterations;
+  pargs.num_participants = participants.size();
+  pargs.use_reduction = use_reduction;
+
+  double start, stop;
+  start = Realm::Clock::current_time_in_microseconds();
+  std::set<Event> finished;
+  for (std::vector<Processor>::const_iterator it = participants.begin();
+        it != participants.end(); it++)
+    finished.insert(it->spawn(PARTICIPANT_TASK, &pargs, sizeof(pargs)));
+  Event::merge_events(finished).wait();
+  stop = Realm::Clock::current_time_in_microseconds();
+
+  double latency = stop - start;
+  fprintf(stdout,"Total time: %7.3f us\n", latency);
+  fprintf(stdout,"Average barrier latency: %7.3f us\n", latency/iterations);
+
+  fprintf(stdout,"Cleaning up...\n");
+  barrier.destroy_barrier();
+}
+
+void participant_task(const void *args, size_t arglen,
+                      const void *userdata, size_t userlen, Processor p)
+{
+  assert(arglen == sizeof(ParticipantArgs));
+  const ParticipantArgs &pargs = *((const ParticipantArgs*)args);
+
+  Barrier b = pargs.barrier;
+  for (int i = 0; i < pargs.iterations; i++)
+  {
+    if (pargs.use_reduction)
+    {
+      int value = i + 1;
+      b.arrive(1, Event::NO_EVENT, &value, sizeof(value));
+      b.wait();
+      int result;
+      bool ready = b.get_result(&result, sizeof(result));
+      assert(ready);
+      if (result != (pargs.num_participants * (i + 1)))
+      {
+        fprintf(stderr,"Reduction mismatch in iteration %d: expected %d, got %d\n",
+                i, pargs.num_participants * (i + 1), result);
+        exit(1);
+      }
+    }
+    else
+    {
+      b.arrive(1);
+      b.wait();
+    }
+    b = b.advance_barrier();
+  }
+}
+
+int main(int argc, char **argv)
+{
+  Runtime r;
+
+  bool ok = r.init(&argc, &argv);
+  assert(ok);
+
+  r.register_task(TOP_LEVEL_TASK, top_level_task);
+  r.register_task(PARTICIPANT_TASK, participant_task);
+  r.register_reduction(REDOP_INT_ADD, ReductionOpUntyped::create_reduction_op<ReductionOpIntAdd>());
+
+  // Set the input args
+  get_input_args().argv = argv;
+  get_input_args().argc = argc;
+
+  // select a processor to run the top level task on
+  Processor p = Processor::NO_PROC;
+  {
+    std::set<Processor> all_procs;
+    Machine::get_machine().get_all_processors(all_procs);
+    for(std::set<Processor>::const_iterator it = all_procs.begin();
+	it != all_procs.end();
+	it++)
+      if(it->kind() == Processor::LOC_PROC) {
+	p = *it;
+	break;
+      }
+  }
+  assert(p.exists());
+
+  // collective launch of a single task - everybody gets the same finish event
+  Event e = r.collective_spawn(p, TOP_LEVEL_TASK, 0, 0);
+
+  // request shutdown once that task is complete
+  r.shutdown(e);
+
+  // now sleep this thread until that shutdown actually happens
+  r.wait_for_shutdown();
+
+  return 0;
+}
@@ -0,0 +1,193 @@
+/* Copyright 2016 Stanford University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// measures the rate at which events can be created (and triggered, which
+//  returns them to the runtime for reuse) as the number of processors doing
+//  so concurrently is increased from 1 up to all the CPU processors
+
+#include <cstdio>
+#include <cstdlib>
+#include <cassert>
+#include <cstring>
+#include <set>
+#include <vector>
+
+#include <time.h>
+
+#include "lowlevel.h"
+#include "realm/timers.h"
+
+using namespace LegionRuntime::LowLevel;
+
+#define DEFAULT_EVENTS_PER_PROC 100000
+#define DEFAULT_BATCH_SIZE 64
+
+// TASK IDs
+enum {
+  TOP_LEVEL_TASK = Processor::TASK_ID_FIRST_AVAILABLE+0,
+  CREATOR_TASK   = Processor::TASK_ID_FIRST_AVAILABLE+1,
+};
+
+struct InputArgs {
+  int argc;
+  char **argv;
+};
+
+InputArgs& get_input_args(void)
+{
+  static InputArgs args;
+  return args;
+}
+
+struct CreatorArgs {
+  int num_events;
+  int batch_size;
+};
+
+void top_level_task(const void *args, size_t arglen,
+                    const void *userdata, size_t userlen, Processor p)
+{
+  int events_per_proc = DEFAULT_EVENTS_PER_PROC;
+  int batch_size = DEFAULT_BATCH_SIZE;
+  int max_procs = 0;
+  // Parse the input arguments
+#define INT_ARG(argname, varname) do { \
+        if(!strcmp((argv)[i], argname)) {		\
+          varname = atoi((argv)[++i]);		\
+          continue;					\
+        } } while(0)
+  {
+    InputArgs &inputs = get_input_args();
+    char **argv = inputs.argv;
+    for (int i = 1; i < inputs.argc; i++)
+    {
+      INT_ARG("-n", events_per_proc);
+      INT_ARG("-b", batch_size);
+      INT_ARG("-p", max_procs);
+    }
+    assert(events_per_proc > 0);
+    assert(batch_size > 0);
+    assert(max_procs >= 0);
+  }
+#undef INT_ARG
+
+  std::vector<Processor> creators;
+  {
+    std::set<Processor> procs;
+    Machine::get_machine().get_all_processors(procs);
+    for (std::set<Processor>::const_iterator it = procs.begin();
+          it != procs.end(); it++)
+      if (it->kind() == Processor::LOC_PROC)
+        creators.push_back(*it);
+  }
+  assert(!creators.empty());
+  if ((max_procs > 0) && ((size_t)max_procs < creators.size()))
+    creators.resize(max_procs);
+
+  fprintf(stdout,"Running event creation experiment with up to %zd processors, %d events per processor (batches of %d)...\n",
+          creators.size(), events_per_proc, batch_size);
+
+  CreatorArgs cargs;
+  cargs.num_events = events_per_proc;
+  cargs.batch_size = batch_size;
+
+  // 1, 2, 4, ... processors, finishing with all of them
+  size_t num_procs = 1;
+  while (true)
+  {
+    double start, stop;
+    start = Realm::Clock::current_time_in_microseconds();
+    std::set<Event> finished;
+    for (size_t i = 0; i < num_procs; i++)
+      finished.insert(creators[i].spawn(CREATOR_TASK, &cargs, sizeof(cargs)));
+    Event::merge_events(finished).wait();
+    stop = Realm::Clock::current_time_in_microseconds();
+
+    long total_events = (long)events_per_proc * num_procs;
+    fprintf(stdout,"%3zd processors: %7.3f us (%7.3f ns per event, %.0f events/s)\n",
+            num_procs, stop - start, 1e3 * (stop - start) / total_events,
+            total_events / ((stop - start) * 1e-6));
+
+    if (num_procs == creators.size())
+      break;
+    num_procs *= 2;
+    if (num_procs > creators.size())
+      num_procs = creators.size();
+  }
+}
+
+// creates events in batches - triggering a batch lets the runtime reuse
+//  those events for later batches
+void creator_task(const void *args, size_t arglen,
+                  const void *userdata, size_t userlen, Processor p)
+{
+  assert(arglen == sizeof(CreatorArgs));
+  const CreatorArgs *cargs = (const CreatorArgs *)args;
+
+  std::vector<UserEvent> batch;
+  batch.reserve(cargs->batch_size);
+  int left = cargs->num_events;
+  while (left > 0)
+  {
+    int count = ((left < cargs->batch_size) ? left : cargs->batch_size);
+    for (int i = 0; i < count; i++)
+      batch.push_back(UserEvent::create_user_event());
+    for (int i = 0; i < count; i++)
+      batch[i].trigger();
+    batch.clear();
+    left -= count;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  Runtime r;
+
+  bool ok = r.init(&argc, &argv);
+  assert(ok);
+
+  r.register_task(TOP_LEVEL_TASK, top_level_task);
+  r.register_task(CREATOR_TASK, creator_task);
+
+  // Set the input args
+  get_input_args().argv = argv;
+  get_input_args().argc = argc;
+
+  // select a processor to run the top level task on
+  Processor p = Processor::NO_PROC;
+  {
+    std::set<Processor> all_procs;
+    Machine::get_machine().get_all_processors(all_procs);
+    for(std::set<Processor>::const_iterator it = all_procs.begin();
+	it != all_procs.end();
+	it++)
+      if(it->kind() == Processor::LOC_PROC) {
+	p = *it;
+	break;
+      }
+  }
+  assert(p.exists());
+
+  // collective launch of a single task - everybody gets the same finish event
+  Event e = r.collective_spawn(p, TOP_LEVEL_TASK, 0, 0);
+
+  // request shutdown once that task is complete
+  r.shutdown(e);
+
+  // now sleep this thread until that shutdown actually happens
+  r.wait_for_shutdown();
+
+  return 0;
+}
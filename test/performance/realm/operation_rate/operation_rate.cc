@@ -0,0 +1,176 @@
+/* Copyright 2016 Stanford University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// measures the per-operation overhead of registering and retiring operations
+//  (every task spawn adds an entry to the runtime's operation table, which is
+//  removed again when the task's finish event triggers) when many processors
+//  are creating operations concurrently
+
+#include <cstdio>
+#include <cstdlib>
+#include <cassert>
+#include <cstring>
+#include <set>
+#include <vector>
+
+#include <time.h>
+
+#include "lowlevel.h"
+#include "realm/timers.h"
+
+using namespace LegionRuntime::LowLevel;
+
+#define DEFAULT_OPS_PER_PROC 100000
+
+// TASK IDs
+enum {
+  TOP_LEVEL_TASK = Processor::TASK_ID_FIRST_AVAILABLE+0,
+  LAUNCHER_TASK  = Processor::TASK_ID_FIRST_AVAILABLE+1,
+  EMPTY_TASK     = Processor::TASK_ID_FIRST_AVAILABLE+2,
+};
+
+struct InputArgs {
+  int argc;
+  char **argv;
+};
+
+InputArgs& get_input_args(void)
+{
+  static InputArgs args;
+  return args;
+}
+
+struct LauncherArgs {
+  int num_ops;
+};
+
+void top_level_task(const void *args, size_t arglen,
+                    const void *userdata, size_t userlen, Processor p)
+{
+  int ops_per_proc = DEFAULT_OPS_PER_PROC;
+  int max_procs = 0;
+  // Parse the input arguments
+#define INT_ARG(argname, varname) do { \
+        if(!strcmp((argv)[i], argname)) {		\
+          varname = atoi((argv)[++i]);		\
+          continue;					\
+        } } while(0)
+  {
+    InputArgs &inputs = get_input_args();
+    char **argv = inputs.argv;
+    for (int i = 1; i < inputs.argc; i++)
+    {
+      INT_ARG("-n", ops_per_proc);
+      INT_ARG("-p", max_procs);
+    }
+    assert(ops_per_proc > 0);
+    assert(max_procs >= 0);
+  }
+#undef INT_ARG
+
+  std::vector<Processor> launchers;
+  {
+    std::set<Processor> procs;
+    Machine::get_machine().get_all_processors(procs);
+    for (std::set<Processor>::const_iterator it = procs.begin();
+          it != procs.end(); it++)
+      if (it->kind() == Processor::LOC_PROC)
+        launchers.push_back(*it);
+  }
+  assert(!launchers.empty());
+  if ((max_procs > 0) && ((size_t)max_procs < launchers.size()))
+    launchers.resize(max_procs);
+
+  fprintf(stdout,"Running operation rate experiment with %zd processors, %d operations per processor...\n",
+          launchers.size(), ops_per_proc);
+
+  LauncherArgs largs;
+  largs.num_ops = ops_per_proc;
+
+  double start, stop;
+  start = Realm::Clock::current_time_in_microseconds();
+  std::set<Event> finished;
+  for (std::vector<Processor>::const_iterator it = launchers.begin();
+        it != launchers.end(); it++)
+    finished.insert(it->spawn(LAUNCHER_TASK, &largs, sizeof(largs)));
+  Event::merge_events(finished).wait();
+  stop = Realm::Clock::current_time_in_microseconds();
+
+  long total_ops = (long)ops_per_proc * launchers.size();
+  fprintf(stdout,"Total time: %7.3f us (%7.3f us per operation, %.0f operations/s)\n",
+          stop - start, (stop - start) / total_ops,
+          total_ops / ((stop - start) * 1e-6));
+}
+
+// each launcher creates its operations on its own processor, so all the
+//  processors are registering (and retiring) operations at the same time
+void launcher_task(const void *args, size_t arglen,
+                   const void *userdata, size_t userlen, Processor p)
+{
+  assert(arglen == sizeof(LauncherArgs));
+  const LauncherArgs *largs = (const LauncherArgs *)args;
+
+  std::set<Event> finished;
+  for (int i = 0; i < largs->num_ops; i++)
+    finished.insert(p.spawn(EMPTY_TASK, 0, 0));
+  Event::merge_events(finished).wait();
+}
+
+void empty_task(const void *args, size_t arglen,
+                const void *userdata, size_t userlen, Processor p)
+{
+}
+
+int main(int argc, char **argv)
+{
+  Runtime r;
+
+  bool ok = r.init(&argc, &argv);
+  assert(ok);
+
+  r.register_task(TOP_LEVEL_TASK, top_level_task);
+  r.register_task(LAUNCHER_TASK, launcher_task);
+  r.register_task(EMPTY_TASK, empty_task);
+
+  // Set the input args
+  get_input_args().argv = argv;
+  get_input_args().argc = argc;
+
+  // select a processor to run the top level task on
+  Processor p = Processor::NO_PROC;
+  {
+    std::set<Processor> all_procs;
+    Machine::get_machine().get_all_processors(all_procs);
+    for(std::set<Processor>::const_iterator it = all_procs.begin();
+	it != all_procs.end();
+	it++)
+      if(it->kind() == Processor::LOC_PROC) {
+	p = *it;
+	break;
+      }
+  }
+  assert(p.exists());
+
+  // collective launch of a single task - everybody gets the same finish event
+  Event e = r.collective_spawn(p, TOP_LEVEL_TASK, 0, 0);
+
+  // request shutdown once that task is complete
+  r.shutdown(e);
+
+  // now sleep this thread until that shutdown actually happens
+  r.wait_for_shutdown();
+
+  return 0;
+}
@@ -0,0 +1,153 @@
+/* Copyright 2016 Stanford University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// measures the encoded size and the serialize/deserialize rates of a
+//  message-like structure (small integers, runs of processor IDs, field IDs,
+//  a name) with the default and compact Realm serializers
+
+#include <cstdio>
+#include <cstdlib>
+#include <cassert>
+#include <cstring>
+#include <set>
+#include <vector>
+#include <string>
+
+#include "realm/processor.h"
+#include "realm/id.h"
+#include "realm/serialize.h"
+#include "realm/timers.h"
+
+using namespace Realm;
+using namespace Realm::Serialization;
+
+#define DEFAULT_PROCS 16
+#define DEFAULT_FIELDS 8
+#define DEFAULT_ITERATIONS 200000
+
+struct SampleMessage {
+  Processor target;
+  unsigned func_id;
+  int priority;
+  size_t arglen;
+  std::vector<Processor> procs;
+  std::set<unsigned> field_ids;
+  std::vector<int> offsets;
+  std::string name;
+
+  bool operator==(const SampleMessage& rhs) const
+  {
+    return ((target == rhs.target) && (func_id == rhs.func_id) &&
+	    (priority == rhs.priority) && (arglen == rhs.arglen) &&
+	    (procs == rhs.procs) && (field_ids == rhs.field_ids) &&
+	    (offsets == rhs.offsets) && (name == rhs.name));
+  }
+};
+
+template <typename S>
+bool serdez(S& s, const SampleMessage& m)
+{
+  return ((s & m.target) && (s & m.func_id) && (s & m.priority) &&
+	  (s & m.arglen) && (s & m.procs) && (s & m.field_ids) &&
+	  (s & m.offsets) && (s & m.name));
+}
+
+static void make_message(SampleMessage& m, int num_procs, int num_fields)
+{
+  // processors are spread over two nodes, as they would be for a typical
+  //  multi-node launch
+  m.target = ID::make_processor(1, 3).convert<Processor>();
+  m.func_id = 42;
+  m.priority = -1;
+  m.arglen = 96;
+  for(int i = 0; i < num_procs; i++)
+    m.procs.push_back(ID::make_processor(i / ((num_procs + 1) / 2),
+					 i % ((num_procs + 1) / 2)).convert<Processor>());
+  for(int i = 0; i < num_fields; i++) {
+    m.field_ids.insert(100 + 2 * i);
+    m.offsets.push_back(8 * i);
+  }
+  m.name = "sample_task";
+}
+
+template <typename BCS, typename FBS, typename FBD>
+static void measure(const char *label, const SampleMessage& msg, int iterations)
+{
+  BCS bcs;
+  bool ok = bcs << msg;
+  assert(ok);
+  size_t bytes = bcs.bytes_used();
+  std::vector<char> buffer(bytes);
+
+  long long start, stop;
+  start = Clock::current_time_in_microseconds();
+  for(int i = 0; i < iterations; i++) {
+    FBS fbs(&buffer[0], bytes);
+    ok = fbs << msg;
+    assert(ok);
+  }
+  stop = Clock::current_time_in_microseconds();
+  double ser_ns = 1e3 * (stop - start) / iterations;
+
+  SampleMessage out;
+  start = Clock::current_time_in_microseconds();
+  for(int i = 0; i < iterations; i++) {
+    FBD fbd(&buffer[0], bytes);
+    out = SampleMessage();
+    ok = fbd >> out;
+    assert(ok && (fbd.bytes_left() == 0));
+  }
+  stop = Clock::current_time_in_microseconds();
+  double dez_ns = 1e3 * (stop - start) / iterations;
+
+  if(!(out == msg)) {
+    fprintf(stderr, "%s: round trip mismatch\n", label);
+    exit(1);
+  }
+
+  fprintf(stdout, "%-8s: %5zd bytes, serialize %8.1f ns, deserialize %8.1f ns\n",
+	  label, bytes, ser_ns, dez_ns);
+}
+
+int main(int argc, char **argv)
+{
+  int num_procs = DEFAULT_PROCS;
+  int num_fields = DEFAULT_FIELDS;
+  int iterations = DEFAULT_ITERATIONS;
+
+  for(int i = 1; i < argc; i++) {
+    if(!strcmp(argv[i], "-p")) { num_procs = atoi(argv[++i]); continue; }
+    if(!strcmp(argv[i], "-f")) { num_fields = atoi(argv[++i]); continue; }
+    if(!strcmp(argv[i], "-i")) { iterations = atoi(argv[++i]); continue; }
+  }
+  assert(num_procs >= 0);
+  assert(num_fields >= 0);
+  assert(iterations > 0);
+
+  fprintf(stdout, "Running serialize rate experiment with %d processors, %d fields for %d iterations...\n",
+	  num_procs, num_fields, iterations);
+
+  SampleMessage msg;
+  make_message(msg, num_procs, num_fields);
+
+  measure<ByteCountSerializer,
+	  FixedBufferSerializer,
+	  FixedBufferDeserializer>("default", msg, iterations);
+  measure<CompactByteCountSerializer,
+	  CompactFixedBufferSerializer,
+	  CompactFixedBufferDeserializer>("compact", msg, iterations);
+
+  return 0;
+}
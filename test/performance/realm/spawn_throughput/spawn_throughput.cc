@@ -0,0 +1,193 @@
+/* Copyright 2016 Stanford University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// measures the rate at which (empty) tasks can be spawned onto the CPU
+//  processors, either one at a time with Processor::spawn or in bulk with
+//  Processor::spawn_multiple (-bulk)
+
+#include <cstdio>
+#include <cstdlib>
+#include <cassert>
+#include <cstring>
+#include <set>
+#include <vector>
+
+#include <time.h>
+
+#include "lowlevel.h"
+#include "realm/timers.h"
+
+using namespace LegionRuntime::LowLevel;
+
+#define DEFAULT_TASKS_PER_PROC 10000
+#define DEFAULT_ARG_SIZE 64
+
+// TASK IDs
+enum {
+  TOP_LEVEL_TASK = Processor::TASK_ID_FIRST_AVAILABLE+0,
+  EMPTY_TASK     = Processor::TASK_ID_FIRST_AVAILABLE+1,
+};
+
+struct InputArgs {
+  int argc;
+  char **argv;
+};
+
+InputArgs& get_input_args(void)
+{
+  static InputArgs args;
+  return args;
+}
+
+void top_level_task(const void *args, size_t arglen,
+                    const void *userdata, size_t userlen, Processor p)
+{
+  int tasks_per_proc = DEFAULT_TASKS_PER_PROC;
+  int arg_size = DEFAULT_ARG_SIZE;
+  bool use_bulk = false;
+  bool deferred = false;
+  // Parse the input arguments
+#define INT_ARG(argname, varname) do { \
+        if(!strcmp((argv)[i], argname)) {		\
+          varname = atoi((argv)[++i]);		\
+          continue;					\
+        } } while(0)
+
+#define BOOL_ARG(argname, varname) do { \
+        if(!strcmp((argv)[i], argname)) {		\
+          varname = true;				\
+          continue;					\
+        } } while(0)
+  {
+    InputArgs &inputs = get_input_args();
+    char **argv = inputs.argv;
+    for (int i = 1; i < inputs.argc; i++)
+    {
+      INT_ARG("-t", tasks_per_proc);
+      INT_ARG("-a", arg_size);
+      BOOL_ARG("-bulk", use_bulk);
+      BOOL_ARG("-defer", deferred);
+    }
+    assert(tasks_per_proc > 0);
+    assert(arg_size >= 0);
+  }
+#undef INT_ARG
+#undef BOOL_ARG
+
+  std::vector<Processor> targets;
+  {
+    std::set<Processor> procs;
+    Machine::get_machine().get_all_processors(procs);
+    for (std::set<Processor>::const_iterator it = procs.begin();
+          it != procs.end(); it++)
+      if (it->kind() == Processor::LOC_PROC)
+        targets.push_back(*it);
+  }
+  assert(!targets.empty());
+
+  fprintf(stdout,"Running spawn throughput experiment with %zd processors, %d tasks per processor, %d byte args (%s%s)...\n",
+          targets.size(), tasks_per_proc, arg_size,
+          (use_bulk ? "bulk" : "individual"),
+          (deferred ? ", deferred" : ""));
+
+  std::vector<char> argbuf(arg_size + 1, 0);
+
+  // with -defer, every task waits on a user event that is triggered once all
+  //  the spawns are done
+  UserEvent start_event = UserEvent::create_user_event();
+  Event precondition = (deferred ? Event(start_event) : Event::NO_EVENT);
+
+  double start, spawned, stop;
+  start = Realm::Clock::current_time_in_microseconds();
+  std::set<Event> finished;
+  for (std::vector<Processor>::const_iterator it = targets.begin();
+        it != targets.end(); it++)
+  {
+    if (use_bulk)
+    {
+      std::vector<Processor::SpawnRequest> requests(tasks_per_proc);
+      for (int i = 0; i < tasks_per_proc; i++)
+      {
+        requests[i].args = &argbuf[0];
+        requests[i].arglen = arg_size;
+        requests[i].wait_on = precondition;
+        requests[i].priority = 0;
+      }
+      finished.insert(it->spawn_multiple(EMPTY_TASK, requests));
+    }
+    else
+    {
+      for (int i = 0; i < tasks_per_proc; i++)
+        finished.insert(it->spawn(EMPTY_TASK, &argbuf[0], arg_size, precondition));
+    }
+  }
+  spawned = Realm::Clock::current_time_in_microseconds();
+  start_event.trigger();
+  Event::merge_events(finished).wait();
+  stop = Realm::Clock::current_time_in_microseconds();
+
+  long total_tasks = (long)tasks_per_proc * targets.size();
+  fprintf(stdout,"Spawn time: %7.3f us (%7.3f us per task, %.0f tasks/s)\n",
+          spawned - start, (spawned - start) / total_tasks,
+          total_tasks / ((spawned - start) * 1e-6));
+  fprintf(stdout,"Total time: %7.3f us (%.0f tasks/s)\n",
+          stop - start, total_tasks / ((stop - start) * 1e-6));
+}
+
+void empty_task(const void *args, size_t arglen,
+                const void *userdata, size_t userlen, Processor p)
+{
+}
+
+int main(int argc, char **argv)
+{
+  Runtime r;
+
+  bool ok = r.init(&argc, &argv);
+  assert(ok);
+
+  r.register_task(TOP_LEVEL_TASK, top_level_task);
+  r.register_task(EMPTY_TASK, empty_task);
+
+  // Set the input args
+  get_input_args().argv = argv;
+  get_input_args().argc = argc;
+
+  // select a processor to run the top level task on
+  Processor p = Processor::NO_PROC;
+  {
+    std::set<Processor> all_procs;
+    Machine::get_machine().get_all_processors(all_procs);
+    for(std::set<Processor>::const_iterator it = all_procs.begin();
+	it != all_procs.end();
+	it++)
+      if(it->kind() == Processor::LOC_PROC) {
+	p = *it;
+	break;
+      }
+  }
+  assert(p.exists());
+
+  // collective launch of a single task - everybody gets the same finish event
+  Event e = r.collective_spawn(p, TOP_LEVEL_TASK, 0, 0);
+
+  // request shutdown once that task is complete
+  r.shutdown(e);
+
+  // now sleep this thread until that shutdown actually happens
+  r.wait_for_shutdown();
+
+  return 0;
+}
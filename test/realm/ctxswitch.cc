@@ -17,6 +17,7 @@ enum {
   TOP_LEVEL_TASK = Processor::TASK_ID_FIRST_AVAILABLE+0,
   SWITCH_TEST_TASK,
   SLEEP_TEST_TASK,
+  SWITCH_CONT_TASK,
 };
 
 // we're going to use alarm() as a watchdog to detect deadlocks
@@ -65,6 +66,36 @@ void switch_task(const void *args, size_t arglen,
 #endif
 }
 
+// the same handoff as switch_task, but each wait is replaced by a continuation,
+//  so no task holds on to a thread (or stack) while it waits
+struct SwitchContArgs {
+  SwitchTestArgs test;
+  int remaining;
+  bool acquired;
+};
+
+void switch_cont_task(const void *args, size_t arglen, 
+		      const void *userdata, size_t userlen, Processor p)
+{
+  assert(arglen == sizeof(SwitchContArgs));
+  SwitchContArgs c_args = *(const SwitchContArgs *)args;
+
+  // finish off the previous iteration, if any
+  if(c_args.acquired && !c_args.test.release_first)
+    c_args.test.release_me.release();
+
+  if(c_args.remaining == 0)
+    return;
+
+  if(c_args.test.release_first)
+    c_args.test.release_me.release();
+
+  Event e = c_args.test.acquire_me.acquire();
+  c_args.remaining--;
+  c_args.acquired = true;
+  Processor::spawn_continuation(SWITCH_CONT_TASK, &c_args, sizeof(c_args), e);
+}
+
 struct SleepTestArgs {
   int sleep_useconds;
 };
@@ -157,6 +188,43 @@ void top_level_task(const void *args, size_t arglen,
                pp.id, k, elapsed, ns_per_switch);
       }
 
+      // the same handoff again, with continuations instead of waits
+      if(num_iterations > 0) {
+        alarm(timeout_seconds);
+
+	std::vector<Reservation> rsrvs(num_children);
+	for(int i = 0; i < num_children; i++) {
+          rsrvs[i] = Reservation::create_reservation();
+	  Event e = rsrvs[i].acquire();
+	  assert(!e.exists());
+        }
+
+        std::set<Event> finish_events;
+	for(int i = 0; i < num_children; i++) {
+	  SwitchContArgs c_args;
+	  c_args.test.iterations = num_iterations;
+	  c_args.test.release_first = (i == (num_children - 1));
+	  c_args.test.acquire_me = rsrvs[i];
+	  c_args.test.release_me = rsrvs[(i + 1) % num_children];
+	  c_args.remaining = num_iterations;
+	  c_args.acquired = false;
+
+	  finish_events.insert(pp.spawn(SWITCH_CONT_TASK, &c_args, sizeof(c_args)));
+        }
+
+	double t_start = Clock::current_time();
+	Event e = Event::merge_events(finish_events);
+	e.wait();
+	double t_end = Clock::current_time();
+
+	alarm(0);
+
+	double elapsed = t_end - t_start;
+	double ns_per_switch = 1e9 * elapsed / num_iterations / num_children;
+	printf("continuation: proc " IDFMT " (kind=%d) finished: elapsed=%5.2fs time/switch=%6.0fns\n",
+               pp.id, k, elapsed, ns_per_switch);
+      }
+
       // now the sleep (i.e. kernel-level switching, if possible) test
       if(sleep_useconds > 0) {
         double exp_time = 1e-6 * sleep_useconds;
@@ -246,6 +314,7 @@ int main(int argc, char **argv)
   rt.register_task(TOP_LEVEL_TASK, top_level_task);
   rt.register_task(SWITCH_TEST_TASK, switch_task);
   rt.register_task(SLEEP_TEST_TASK, sleep_task);
+  rt.register_task(SWITCH_CONT_TASK, switch_cont_task);
 
   signal(SIGALRM, sigalrm_handler);
 
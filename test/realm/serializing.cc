@@ -86,11 +86,26 @@ std::ostream& operator<<(std::ostream& os, const std::map<T1, T2>& m)
   return os;
 }
 
-template <typename T>
+// each test is run with both the default and the compact flavors of serializer
+struct DefaultStreams {
+  typedef Realm::Serialization::DynamicBufferSerializer Dynamic;
+  typedef Realm::Serialization::ByteCountSerializer ByteCount;
+  typedef Realm::Serialization::FixedBufferSerializer Fixed;
+  typedef Realm::Serialization::FixedBufferDeserializer Deserializer;
+};
+
+struct CompactStreams {
+  typedef Realm::Serialization::CompactDynamicBufferSerializer Dynamic;
+  typedef Realm::Serialization::CompactByteCountSerializer ByteCount;
+  typedef Realm::Serialization::CompactFixedBufferSerializer Fixed;
+  typedef Realm::Serialization::CompactFixedBufferDeserializer Deserializer;
+};
+
+template <typename STREAMS, typename T>
 size_t test_dynamic(const char *name, const T& input, size_t exp_size = 0)
 {
   // first serialize and check size
-  Realm::Serialization::DynamicBufferSerializer dbs(0);
+  typename STREAMS::Dynamic dbs(0);
 
   bool ok1 = dbs << input;
   if(!ok1) {
@@ -113,7 +128,7 @@ size_t test_dynamic(const char *name, const T& input, size_t exp_size = 0)
   void *buffer = dbs.detach_buffer();
 
   // now deserialize into a new object and test for equality
-  Realm::Serialization::FixedBufferDeserializer fbd(buffer, act_size);
+  typename STREAMS::Deserializer fbd(buffer, act_size);
   T output;
 
   bool ok2 = fbd >> output;
@@ -156,10 +171,10 @@ size_t test_dynamic(const char *name, const T& input, size_t exp_size = 0)
   return act_size;
 }
 
-template <typename T>
+template <typename STREAMS, typename T>
 void test_size(const char *name, const T& input, size_t exp_size)
 {
-  Realm::Serialization::ByteCountSerializer bcs;
+  typename STREAMS::ByteCount bcs;
 
   bool ok = bcs << input;
   if(!ok) {
@@ -177,12 +192,12 @@ void test_size(const char *name, const T& input, size_t exp_size)
   }
 }
 
-template <typename T>
+template <typename STREAMS, typename T>
 void test_fixed(const char *name, const T& input, size_t exp_size)
 {
   // first serialize and check size
   void *buffer = malloc(exp_size);
-  Realm::Serialization::FixedBufferSerializer fbs(buffer, exp_size);
+  typename STREAMS::Fixed fbs(buffer, exp_size);
 
   bool ok1 = fbs << input;
   if(!ok1) {
@@ -201,7 +216,7 @@ void test_fixed(const char *name, const T& input, size_t exp_size)
   }
 
   // now deserialize into a new object and test for equality
-  Realm::Serialization::FixedBufferDeserializer fbd(buffer, exp_size);
+  typename STREAMS::Deserializer fbd(buffer, exp_size);
   T output;
 
   bool ok2 = fbd >> output;
@@ -245,9 +260,17 @@ void test_fixed(const char *name, const T& input, size_t exp_size)
 template <typename T>
 void do_test(const char *name, const T& input, size_t exp_size = 0)
 {
-  exp_size = test_dynamic(name, input, exp_size);
-  test_size(name, input, exp_size);
-  test_fixed(name, input, exp_size);
+  exp_size = test_dynamic<DefaultStreams>(name, input, exp_size);
+  test_size<DefaultStreams>(name, input, exp_size);
+  test_fixed<DefaultStreams>(name, input, exp_size);
+}
+
+template <typename T>
+void do_compact_test(const char *name, const T& input, size_t exp_size = 0)
+{
+  exp_size = test_dynamic<CompactStreams>(name, input, exp_size);
+  test_size<CompactStreams>(name, input, exp_size);
+  test_fixed<CompactStreams>(name, input, exp_size);
 }
 
 template <typename T1, typename T2>
@@ -294,6 +317,133 @@ typedef Pair<PODPacked, int> PP2;
 template <typename S>
 bool serdez(S& s, const PP2& p) { return (s & p.x) && (s & p.y); }
 
+// a handle-like type for testing the compact encoding of IDs
+struct FakeID {
+  unsigned long long id;
+
+  FakeID(void) : id(0) {}
+  FakeID(unsigned long long _id) : id(_id) {}
+
+  bool operator==(const FakeID& rhs) const { return id == rhs.id; }
+  bool operator<(const FakeID& rhs) const { return id < rhs.id; }
+
+  friend std::ostream& operator<<(std::ostream& os, const FakeID& f)
+  {
+    return os << std::hex << f.id << std::dec;
+  }
+};
+TYPE_HAS_COMPACT_ID(FakeID);
+
+static void test_compact(void)
+{
+  // small integers shrink to a single byte, signed ones via zigzag
+  do_compact_test("compact int", int(5), 1);
+  do_compact_test("compact negative int", int(-3), 1);
+  do_compact_test("compact int min", int(-2147483647 - 1), 5);
+  do_compact_test("compact size_t", size_t(300), 2);
+  do_compact_test("compact ull max", (unsigned long long)-1, 10);
+  do_compact_test("compact char", 'q', 1);
+  do_compact_test("compact double", double(4.5), sizeof(double));
+
+  // copy-serializable structs are copied without padding
+  do_compact_test("compact pod struct", PODStruct(6.5, 7), sizeof(PODStruct));
+  do_compact_test("compact pod packed", PODPacked(8.5, 9.1), 12);
+  do_compact_test("compact pod packed2", PODPacked2(10.5, 'z'), 9);
+  do_compact_test("compact pp2", PP2(PODPacked(44.3, 1), 9), 13);
+
+  // integer sequences are delta-encoded
+  std::vector<int> a(3);
+  a[0] = 1;
+  a[1] = 2;
+  a[2] = 3;
+  do_compact_test("compact vector<int>", a, 1 + 3);
+
+  std::vector<int> a2;
+  a2.push_back(-1000000);
+  a2.push_back(1000000);
+  a2.push_back(0);
+  a2.push_back(-1);
+  do_compact_test("compact vector<int> wide", a2, 1 + 3 + 4 + 3 + 1);
+
+  std::vector<unsigned long long> a3;
+  a3.push_back(0);
+  a3.push_back((unsigned long long)-1);
+  a3.push_back(1);
+  do_compact_test("compact vector<ull> wrap", a3, 1 + 1 + 1 + 1);
+
+  std::vector<PODStruct> a4(2);
+  a4[0] = PODStruct(3, 4);
+  a4[1] = PODStruct(5, 6);
+  do_compact_test("compact vector<PODStruct>", a4, 1 + 2 * sizeof(PODStruct));
+
+  std::vector<PODPacked2> a5(1);
+  a5[0] = PODPacked2(3, 4);
+  do_compact_test("compact vector<PODPacked2>", a5, 1 + 9);
+
+  std::list<int> b;
+  b.push_back(4);
+  b.push_back(5);
+  b.push_back(6);
+  b.push_back(7);
+  do_compact_test("compact list<int>", b, 1 + 4);
+
+  std::map<int, double> c;
+  c[8] = 1.1;
+  c[9] = 2.2;
+  c[10] = 3.3;
+  do_compact_test("compact map<int,double>", c, 1 + 3 * (1 + 8));
+
+  std::vector<std::string> ss;
+  ss.push_back("Hello");
+  ss.push_back("World");
+  do_compact_test("compact vector<string>", ss, 1 + 6 + 6);
+
+  std::set<int> s;
+  s.insert(4);
+  s.insert(2);
+  s.insert(11);
+  s.insert(-5);
+  do_compact_test("compact set<int>", s, 1 + 4);
+
+  std::vector<std::vector<int> > vv(2);
+  vv[0].push_back(7);
+  vv[1].push_back(8);
+  vv[1].push_back(9);
+  do_compact_test("compact vector<vector<int> >", vv, 1 + 2 + 3);
+
+  // IDs are varints, and a run of IDs that share their upper bits costs a
+  //  full varint for the first and one or two bytes for each of the rest
+  do_compact_test("compact id", FakeID(0x1d00000000000005ULL), 9);
+
+  std::vector<FakeID> ids;
+  for(int i = 0; i < 16; i++)
+    ids.push_back(FakeID(0x1d00000000000100ULL + (i * 3)));
+  ids.push_back(FakeID(0x1d00000000000020ULL));
+  do_compact_test("compact vector<id>", ids, 1 + 9 + 15 + 2);
+
+  std::set<FakeID> idset(ids.begin(), ids.end());
+  do_compact_test("compact set<id>", idset, 1 + 9 + 2 + 15);
+
+  std::map<FakeID, std::vector<FakeID> > idmap;
+  idmap[FakeID(0x2000000000000001ULL)] = ids;
+  do_compact_test("compact map<id,vector<id>>", idmap, 1 + 9 + 1 + 9 + 15 + 2);
+
+  // truncated streams must be rejected rather than overrun
+  {
+    Realm::Serialization::CompactDynamicBufferSerializer dbs(0);
+    bool ok = dbs << ids;
+    assert(ok);
+    for(size_t len = 0; len < dbs.bytes_used(); len++) {
+      Realm::Serialization::CompactFixedBufferDeserializer fbd(dbs.get_buffer(), len);
+      std::vector<FakeID> out;
+      if(fbd >> out) {
+	std::cout << "ERROR: compact truncated (" << len << ") deserialization succeeded!" << std::endl;
+	error_count++;
+      }
+    }
+  }
+}
+
 int main(int argc, const char *argv[])
 {
   parse_args(argc, argv);
@@ -368,7 +518,9 @@ int main(int argc, const char *argv[])
   s.insert(2);
   s.insert(11);
   do_test("set<int>", s, sizeof(size_t) + s.size() * sizeof(int));
-  
+
+  test_compact();
+
   if(error_count > 0) {
     std::cout << "ERRORS FOUND" << std::endl;
     exit(1);
@@ -66,6 +66,7 @@ struct ChildTaskArgs {
   bool hang;
   int sleep_useconds;
   Event wait_on;
+  Event continue_after;
 };
 
 void child_task(const void *args, size_t arglen, 
@@ -95,6 +96,13 @@ void child_task(const void *args, size_t arglen,
     Processor::report_execution_fault(44, buffer, 4*sizeof(int));
   }
 #endif
+  if(cargs.continue_after.exists()) {
+    // finish up in a continuation instead of waiting
+    ChildTaskArgs cont_args = cargs;
+    cont_args.continue_after = Event::NO_EVENT;
+    Processor::spawn_continuation(CHILD_TASK, &cont_args, sizeof(cont_args),
+				  cargs.continue_after);
+  }
   log_app.print() << "ending task on processor " << p;
 }
 
@@ -154,6 +162,17 @@ void response_task(const void *args, size_t arglen,
   } else
     printf("no event wait data\n");
 
+  // hardware counters are optional - perf_event may not be permitted
+  if(pr.has_measurement<OperationHardwareCounters>()) {
+    OperationHardwareCounters *op_hwc = pr.get_measurement<OperationHardwareCounters>();
+    printf("op hw counters = cycles=%lld instrs=%lld llc_refs=%lld llc_misses=%lld stalls=%lld (ipc=%.2f)\n",
+	   op_hwc->cycles, op_hwc->instructions, op_hwc->llc_references,
+	   op_hwc->llc_misses, op_hwc->stalled_cycles,
+	   op_hwc->instructions_per_cycle());
+    delete op_hwc;
+  } else
+    printf("no hw counters\n");
+
   if(0&&pr.has_measurement<OperationBacktrace>()) {
     OperationBacktrace *op_backtrace = pr.get_measurement<OperationBacktrace>();
     std::cout << "op backtrace = " << op_backtrace->backtrace;
@@ -223,10 +242,11 @@ void top_level_task(const void *args, size_t arglen,
     .add_measurement<OperationStatus>()
     .add_measurement<OperationTimeline>()
     .add_measurement<OperationEventWaits>()
-    .add_measurement<OperationBacktrace>();
+    .add_measurement<OperationBacktrace>()
+    .add_measurement<OperationHardwareCounters>();
 
   // we expect (exactly) three responses
-  expected_responses_remaining = 7;
+  expected_responses_remaining = 8;
   response_counter = Barrier::create_barrier(expected_responses_remaining);
 
   // give ourselves 15 seconds for the tasks, and their profiling responses, to finish
@@ -237,6 +257,7 @@ void top_level_task(const void *args, size_t arglen,
   cargs.sleep_useconds = 100000;
   cargs.hang = false;
   cargs.wait_on = Event::NO_EVENT;
+  cargs.continue_after = Event::NO_EVENT;
   Event e1 = first_cpu.spawn(CHILD_TASK, &cargs, sizeof(cargs), prs);
 
   cargs.inject_fault = true;
@@ -286,6 +307,23 @@ void top_level_task(const void *args, size_t arglen,
     assert(poisoned);
   }
 
+  // and of a task whose body has returned, but whose continuation hasn't run yet
+  {
+    UserEvent u = UserEvent::create_user_event();
+    cargs.hang = false;
+    cargs.sleep_useconds = 0;
+    cargs.continue_after = u;
+    Event e6 = first_cpu.spawn(CHILD_TASK, &cargs, sizeof(cargs), prs);
+    cargs.continue_after = Event::NO_EVENT;
+    sleep(1);
+    int info = 113;
+    e6.cancel_operation(&info, sizeof(info));
+    u.trigger();
+    bool poisoned = false;
+    e6.wait_faultaware(poisoned);
+    assert(poisoned);
+  }
+
   printf("waiting for profiling responses...\n");
   response_counter.wait();
   printf("all profiling responses received\n");
@@ -0,0 +1,383 @@
+#!/usr/bin/env python
+
+# Copyright 2016 Stanford University, NVIDIA Corporation
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+# analyzes the binary event graph traces written by Realm when run with
+#  -realm:eventgraph <num nodes> (see runtime/realm/event_graph.h) and reports
+#  the critical path, idle time per processor, and the events with the
+#  largest fan-in
+
+import sys
+import argparse
+import struct
+from collections import defaultdict
+
+parser = argparse.ArgumentParser()
+parser.add_argument('-e', '--event', metavar='ID',
+                    help='event (in hex) to find the critical path to (default: last event triggered)')
+parser.add_argument('-n', '--count', type=int, default=10,
+                    help='number of entries to show in each top-N list')
+parser.add_argument('-m', '--max-steps', type=int, default=10000,
+                    help='maximum length of the critical path to report')
+parser.add_argument('infiles', nargs='+', help='trace files (e.g. eventgraph_0.dat)')
+
+args = parser.parse_args(sys.argv[1:])
+
+# record kinds, hopefully consistent with runtime/realm/event_graph.h
+
+class RecordKinds:
+    REC_CREATE = 1
+    REC_MERGE = 2
+    REC_TRIGGER = 3
+    REC_WAIT_BEGIN = 4
+    REC_WAIT_END = 5
+    REC_TASK_REQUEST = 6
+    REC_TASK_BEGIN = 7
+    REC_TASK_END = 8
+    REC_COPY_REQUEST = 9
+    REC_ARRIVE = 10
+
+FILE_MAGIC = 0x52474552
+FILE_VERSION = 1
+RECORD_SIZE = 40
+
+def fmt_id(x):
+    return '{:x}'.format(x)
+
+def fmt_time(ns):
+    return '{:.3f} us'.format(ns / 1000.0)
+
+class Task(object):
+    def __init__(self, event):
+        self.event = event
+        self.request = None
+        self.precondition = 0
+        self.context = 0
+        self.proc = None
+        self.begin = None
+        self.end = None
+        self.waits = []
+
+class Copy(object):
+    def __init__(self, event, request, precondition, context):
+        self.event = event
+        self.request = request
+        self.precondition = precondition
+        self.context = context
+
+class Wait(object):
+    def __init__(self, event, proc, context, begin):
+        self.event = event
+        self.proc = proc
+        self.context = context
+        self.begin = begin
+        self.end = None
+
+class EventGraph(object):
+    def __init__(self):
+        self.creates = dict()           # event -> (time, context of creator)
+        self.triggers = dict()          # event -> (time, context of triggerer)
+        self.merges = defaultdict(list) # merged event -> inputs
+        self.arrivals = defaultdict(list) # barrier event -> (time, precondition, context)
+        self.tasks = dict()
+        self.copies = dict()
+        self.waits = []
+        self.open_waits = dict()        # (node, thread, event) -> Wait
+        self.first_time = None
+        self.last_time = None
+        self.num_records = 0
+
+    def get_task(self, event):
+        t = self.tasks.get(event)
+        if t is None:
+            t = Task(event)
+            self.tasks[event] = t
+        return t
+
+    def add_record(self, timestamp, event, other, context, kind, node, thread):
+        self.num_records += 1
+        if (self.first_time is None) or (timestamp < self.first_time):
+            self.first_time = timestamp
+        if (self.last_time is None) or (timestamp > self.last_time):
+            self.last_time = timestamp
+
+        if kind == RecordKinds.REC_CREATE:
+            self.creates[event] = (timestamp, context)
+        elif kind == RecordKinds.REC_MERGE:
+            if other:
+                self.merges[event].append(other)
+        elif kind == RecordKinds.REC_TRIGGER:
+            # keep the earliest trigger if an event shows up more than once
+            if (event not in self.triggers) or (timestamp < self.triggers[event][0]):
+                self.triggers[event] = (timestamp, context)
+        elif kind == RecordKinds.REC_WAIT_BEGIN:
+            w = Wait(event, other, context, timestamp)
+            self.open_waits[(node, thread, event)] = w
+        elif kind == RecordKinds.REC_WAIT_END:
+            w = self.open_waits.pop((node, thread, event), None)
+            if w is not None:
+                w.end = timestamp
+                self.waits.append(w)
+                if w.context:
+                    self.get_task(w.context).waits.append(w)
+        elif kind == RecordKinds.REC_TASK_REQUEST:
+            t = self.get_task(event)
+            t.request = timestamp
+            t.precondition = other
+            t.context = context
+        elif kind == RecordKinds.REC_TASK_BEGIN:
+            t = self.get_task(event)
+            t.proc = other
+            t.begin = timestamp
+        elif kind == RecordKinds.REC_TASK_END:
+            t = self.get_task(event)
+            t.end = timestamp
+        elif kind == RecordKinds.REC_COPY_REQUEST:
+            self.copies[event] = Copy(event, timestamp, other, context)
+        elif kind == RecordKinds.REC_ARRIVE:
+            self.arrivals[event].append((timestamp, other, context))
+        else:
+            print 'unrecognized record kind: {:d}'.format(kind)
+
+    def read_file(self, filename):
+        with open(filename, 'rb') as f:
+            hdr = f.read(16)
+            assert len(hdr) == 16
+            # files are written in the node's native byte order
+            for order in ('<', '>'):
+                magic, version, record_size, node = struct.unpack(order + 'IIII', hdr)
+                if magic == FILE_MAGIC:
+                    break
+            else:
+                print '{}: not an event graph trace'.format(filename)
+                sys.exit(1)
+            assert version == FILE_VERSION
+            assert record_size == RECORD_SIZE
+            rec_fmt = order + 'qQQQHHI'
+            while True:
+                data = f.read(RECORD_SIZE * 4096)
+                if not data:
+                    break
+                assert (len(data) % RECORD_SIZE) == 0
+                for ofs in xrange(0, len(data), RECORD_SIZE):
+                    self.add_record(*struct.unpack_from(rec_fmt, data, ofs))
+
+    def trigger_time(self, event):
+        t = self.triggers.get(event)
+        return t[0] if t else None
+
+    # figures out what was holding up 'event' (at or before time 'bound'), returning
+    #  (description, start of this step, next event, next bound)
+    def explain(self, event, bound):
+        if event in self.tasks:
+            t = self.tasks[event]
+            if t.begin is not None:
+                # a wait inside the task that ended by our time bound means the task was
+                #  blocked on that event
+                blocking = None
+                for w in t.waits:
+                    if (w.end is not None) and (w.end <= bound) and (w.begin >= t.begin):
+                        if (blocking is None) or (w.end > blocking.end):
+                            blocking = w
+                if blocking is not None:
+                    desc = 'task {} on proc {} blocked on {}'.format(fmt_id(event), fmt_id(t.proc),
+                                                                     fmt_id(blocking.event))
+                    return (desc, blocking.end, blocking.event, blocking.end)
+
+                # otherwise the task was waiting to start - on its precondition, its
+                #  request, or just the processor being busy
+                ready = t.request
+                nxt = (t.context, t.request) if t.context else (None, None)
+                ptime = self.trigger_time(t.precondition) if t.precondition else None
+                if (ptime is not None) and ((ready is None) or (ptime >= ready)):
+                    ready = ptime
+                    nxt = (t.precondition, ptime)
+                desc = 'task {} ran on proc {} for {}'.format(fmt_id(event), fmt_id(t.proc),
+                                                              fmt_time((t.end or bound) - t.begin))
+                if ready is not None:
+                    desc += ' (queued for {})'.format(fmt_time(t.begin - ready))
+                return (desc, ready if ready is not None else t.begin, nxt[0], nxt[1])
+
+        if event in self.merges:
+            latest = None
+            for e in self.merges[event]:
+                et = self.trigger_time(e)
+                if (et is not None) and ((latest is None) or (et > latest[0])):
+                    latest = (et, e)
+            if latest is not None:
+                desc = 'merge {} of {} events, last was {}'.format(fmt_id(event),
+                                                                   len(self.merges[event]),
+                                                                   fmt_id(latest[1]))
+                return (desc, latest[0], latest[1], latest[0])
+
+        if event in self.copies:
+            c = self.copies[event]
+            ready = c.request
+            nxt = (c.context, c.request) if c.context else (None, None)
+            ptime = self.trigger_time(c.precondition) if c.precondition else None
+            if (ptime is not None) and (ptime >= ready):
+                ready = ptime
+                nxt = (c.precondition, ptime)
+            desc = 'copy/fill {} took {}'.format(fmt_id(event), fmt_time(bound - ready))
+            return (desc, ready, nxt[0], nxt[1])
+
+        if event in self.arrivals:
+            latest = None
+            for (at, pre, ctx) in self.arrivals[event]:
+                pt = self.trigger_time(pre) if pre else None
+                if (pt is not None) and (pt > at):
+                    cand = (pt, pre, pt)
+                else:
+                    cand = (at, ctx if ctx else None, at)
+                if (latest is None) or (cand[0] > latest[0]):
+                    latest = cand
+            desc = 'barrier {} with {} arrivals'.format(fmt_id(event), len(self.arrivals[event]))
+            return (desc, latest[0], latest[1], latest[2])
+
+        # anything else (e.g. a user event) was triggered by whoever triggered it
+        trig = self.triggers.get(event)
+        if trig is not None:
+            if trig[1] and (trig[1] != event):
+                desc = 'event {} triggered by task {}'.format(fmt_id(event), fmt_id(trig[1]))
+                return (desc, trig[0], trig[1], trig[0])
+            return ('event {} triggered'.format(fmt_id(event)), trig[0], None, None)
+
+        # an event that was created but never triggered - blame whoever created it
+        create = self.creates.get(event)
+        if create is not None:
+            if create[1] and (create[1] != event):
+                desc = 'event {} created by task {}, never triggered'.format(fmt_id(event),
+                                                                            fmt_id(create[1]))
+                return (desc, create[0], create[1], create[0])
+            return ('event {} created, never triggered'.format(fmt_id(event)), create[0], None, None)
+
+        return ('event {} (no trace information)'.format(fmt_id(event)), bound, None, None)
+
+    def critical_path(self, target):
+        steps = []
+        seen = set()
+        event = target
+        bound = self.trigger_time(target)
+        if bound is None:
+            bound = self.last_time
+        while (event is not None) and (len(steps) < args.max_steps):
+            # a task can show up more than once with different bounds, but an
+            #  identical step means we're going around in circles
+            key = (event, bound)
+            if key in seen:
+                break
+            seen.add(key)
+            desc, start, nxt, nxt_bound = self.explain(event, bound)
+            steps.append((start, bound, desc))
+            event, bound = nxt, nxt_bound
+        steps.reverse()
+        return steps
+
+    def processor_idle(self):
+        # a processor is busy while one of its tasks is running and not waiting
+        busy = defaultdict(list)
+        for t in self.tasks.itervalues():
+            if (t.begin is None) or (t.end is None):
+                continue
+            pos = t.begin
+            for w in sorted(t.waits, key=lambda w: w.begin):
+                if (w.end is None) or (w.begin < pos):
+                    continue
+                busy[t.proc].append((pos, w.begin))
+                pos = w.end
+            busy[t.proc].append((pos, t.end))
+
+        results = []
+        for proc, intervals in busy.iteritems():
+            intervals.sort()
+            gaps = []
+            total_busy = 0
+            cur_start, cur_end = intervals[0]
+            if cur_start > self.first_time:
+                gaps.append((self.first_time, cur_start))
+            for (s, e) in intervals[1:]:
+                if s > cur_end:
+                    total_busy += cur_end - cur_start
+                    gaps.append((cur_end, s))
+                    cur_start, cur_end = s, e
+                elif e > cur_end:
+                    cur_end = e
+            total_busy += cur_end - cur_start
+            if self.last_time > cur_end:
+                gaps.append((cur_end, self.last_time))
+            results.append((proc, total_busy, gaps))
+        return results
+
+    def blocked_on(self, proc, start, end):
+        # which events were tasks on this processor waiting for during a gap?
+        events = set()
+        for w in self.waits:
+            if (w.proc == proc) and (w.end is not None) and (w.begin <= start) and (w.end >= end):
+                events.add(w.event)
+        return events
+
+graph = EventGraph()
+for filename in args.infiles:
+    graph.read_file(filename)
+
+if graph.num_records == 0:
+    print 'no records found'
+    sys.exit(0)
+
+t0 = graph.first_time
+span = graph.last_time - graph.first_time
+print 'read {:d} records covering {}'.format(graph.num_records, fmt_time(span))
+untriggered = sum(1 for ev in graph.creates if ev not in graph.triggers)
+print '{:d} events created, {:d} never triggered'.format(len(graph.creates), untriggered)
+print
+
+# critical path
+if args.event:
+    target = int(args.event, 16)
+else:
+    target = max(graph.triggers.iteritems(), key=lambda kv: kv[1][0])[0]
+path = graph.critical_path(target)
+print 'critical path to event {} ({:d} steps):'.format(fmt_id(target), len(path))
+for (start, end, desc) in path:
+    print '  {:>14s} - {:>14s}  {:>14s}  {}'.format(fmt_time(start - t0), fmt_time(end - t0),
+                                                   fmt_time(end - start), desc)
+print
+
+# idle time per processor
+print 'processor utilization:'
+for (proc, total_busy, gaps) in sorted(graph.processor_idle()):
+    idle = span - total_busy
+    print '  proc {}: busy {}, idle {} ({:.1f}%), {:d} gaps'.format(fmt_id(proc), fmt_time(total_busy),
+                                                                   fmt_time(idle),
+                                                                   (100.0 * idle / span) if span else 0.0,
+                                                                   len(gaps))
+    for (s, e) in sorted(gaps, key=lambda g: g[0] - g[1])[:args.count]:
+        blocked = graph.blocked_on(proc, s, e)
+        extra = ''
+        if blocked:
+            extra = ' waiting on ' + ', '.join(fmt_id(b) for b in sorted(blocked))
+        print '    {:>14s} idle at {}{}'.format(fmt_time(e - s), fmt_time(s - t0), extra)
+print
+
+# largest fan-in
+fanin = [ (len(ins), ev, 'merge') for ev, ins in graph.merges.iteritems() ]
+fanin.extend((len(arrs), ev, 'barrier') for ev, arrs in graph.arrivals.iteritems())
+fanin.sort(reverse=True)
+print 'largest fan-in:'
+for (count, ev, kind) in fanin[:args.count]:
+    tt = graph.trigger_time(ev)
+    print '  {:>7s} {:>16s}: {:d} inputs{}'.format(kind, fmt_id(ev), count,
+                                                  (', triggered at ' + fmt_time(tt - t0)) if tt is not None else '')
@@ -32,6 +32,7 @@ inst_usage_pat = re.compile(prefix + r'Prof Inst Usage (?P<opid>[0-9]+) (?P<inst
 inst_timeline_pat = re.compile(prefix + r'Prof Inst Timeline (?P<opid>[0-9]+) (?P<inst>[a-f0-9]+) (?P<create>[0-9]+) (?P<destroy>[0-9]+)')
 user_info_pat = re.compile(prefix + r'Prof User Info (?P<pid>[a-f0-9]+) (?P<start>[0-9]+) (?P<stop>[0-9]+) (?P<name>[$()a-zA-Z0-9_]+)')
 task_wait_info_pat = re.compile(prefix + r'Prof Task Wait Info (?P<opid>[0-9]+) (?P<vid>[0-9]+) (?P<start>[0-9]+) (?P<ready>[0-9]+) (?P<end>[0-9]+)')
+task_hw_counters_pat = re.compile(prefix + r'Prof Task HW Counters (?P<opid>[0-9]+) (?P<vid>[0-9]+) (?P<cycles>-?[0-9]+) (?P<instrs>-?[0-9]+) (?P<llcrefs>-?[0-9]+) (?P<llcmisses>-?[0-9]+) (?P<stalls>-?[0-9]+)')
 meta_wait_info_pat = re.compile(prefix + r'Prof Meta Wait Info (?P<opid>[0-9]+) (?P<hlr>[0-9]+) (?P<start>[0-9]+) (?P<ready>[0-9]+) (?P<end>[0-9]+)')
 kind_pat = re.compile(prefix + r'Prof Task Kind (?P<tid>[0-9]+) (?P<name>[$()a-zA-Z0-9_<>.]+)')
 variant_pat = re.compile(prefix + r'Prof Task Variant (?P<tid>[0-9]+) (?P<vid>[0-9]+) (?P<name>[$()a-zA-Z0-9_<>.]+)')
@@ -51,6 +52,17 @@ mapper_call_info_pat = re.compile(prefix + r'Prof Mapper Call Info (?P<mid>[0-9]
 # Extensions for runtime calls
 runtime_call_desc_pat = re.compile(prefix + r'Prof Runtime Call Desc (?P<rid>[0-9]+) (?P<desc>[a-zA-Z0-9_ ]+)')
 runtime_call_info_pat = re.compile(prefix + r'Prof Runtime Call Info (?P<rid>[0-9]+) (?P<pid>[a-f0-9]+) (?P<start>[0-9]+) (?P<stop>[0-9]+)')
+# Extensions for memory pressure
+eviction_info_pat = re.compile(prefix + r'Prof Eviction Info (?P<mid>[a-f0-9]+) (?P<size>[0-9]+) (?P<time>[0-9]+)')
+alloc_failure_info_pat = re.compile(prefix + r'Prof Alloc Failure Info (?P<mid>[a-f0-9]+) (?P<size>[0-9]+) (?P<time>[0-9]+)')
+# Chunked logs
+chunk_info_pat = re.compile(prefix + r'Prof Chunk Info (?P<cnode>[0-9]+) (?P<start>[0-9]+) (?P<stop>[0-9]+)')
+chunk_end_pat = re.compile(prefix + r'Prof Chunk End (?P<cnode>[0-9]+)')
+# Chunk index at the end of logs written with -hl:prof_logfile
+chunk_index_pat = re.compile(r'Prof Chunk Index (?P<cnode>[0-9]+) (?P<start>[0-9]+) (?P<stop>[0-9]+) (?P<offset>[0-9]+) (?P<length>[0-9]+)')
+header_index_pat = re.compile(r'Prof Header Index (?P<cnode>[0-9]+) (?P<offset>[0-9]+) (?P<length>[0-9]+)')
+index_offset_pat = re.compile(r'Prof Index Offset (?P<offset>[0-9]+)')
+index_offset_size = len('Prof Index Offset 00000000000000000000\n')
 # Self-profiling
 proftask_info_pat = re.compile(prefix + r'Prof ProfTask Info (?P<pid>[a-f0-9]+) (?P<opid>[0-9]+) (?P<start>[0-9]+) (?P<stop>[0-9]+)')
 
@@ -576,6 +588,9 @@ class Memory(object):
         self.time_points = list()
         self.max_live_instances = None
         self.last_time = None
+        self.evictions = 0
+        self.evicted_bytes = 0
+        self.failed_allocations = 0
 
     def add_instance(self, inst):
         self.instances.add(inst)
@@ -665,6 +680,10 @@ class Memory(object):
         print "    Total Instances: %d" % len(self.instances)
         print "    Maximum Utilization: %.3f%%" % (100.0 * max_usage)
         print "    Average Utilization: %.3f%%" % (100.0 * average_usage)
+        if self.evictions > 0 or self.failed_allocations > 0:
+            print "    Evictions: %d (%d bytes)" % \
+                    (self.evictions, self.evicted_bytes)
+            print "    Failed Allocations: %d" % self.failed_allocations
         print
   
     def __repr__(self):
@@ -770,6 +789,36 @@ class WaitInterval(object):
         self.ready = ready
         self.end = end
 
+class HWCounters(object):
+    # counters the runtime could not provide are logged as -1
+    def __init__(self, cycles, instructions, llc_references, llc_misses,
+                 stalled_cycles):
+        self.cycles = cycles
+        self.instructions = instructions
+        self.llc_references = llc_references
+        self.llc_misses = llc_misses
+        self.stalled_cycles = stalled_cycles
+
+    def ipc(self):
+        if self.cycles <= 0 or self.instructions < 0:
+            return None
+        return float(self.instructions) / float(self.cycles)
+
+    def llc_miss_rate(self):
+        if self.llc_references <= 0 or self.llc_misses < 0:
+            return None
+        return float(self.llc_misses) / float(self.llc_references)
+
+    def __repr__(self):
+        result = []
+        ipc = self.ipc()
+        if ipc is not None:
+            result.append('ipc=%.2f' % ipc)
+        miss_rate = self.llc_miss_rate()
+        if miss_rate is not None:
+            result.append('llc_miss=%.1f%%' % (100.0 * miss_rate))
+        return ' '.join(result)
+
 class TaskKind(object):
     def __init__(self, task_id, name):
         self.task_id = task_id
@@ -790,6 +839,10 @@ class Variant(object):
         self.all_calls = dict()
         self.max_call = dict()
         self.min_call = dict()
+        self.hw_cycles = 0
+        self.hw_instructions = 0
+        self.hw_llc_references = 0
+        self.hw_llc_misses = 0
 
     def set_task(self, task):
         assert self.task == None
@@ -822,6 +875,14 @@ class Variant(object):
             if exec_time < self.min_call[proc]:
                 self.min_call[proc] = exec_time
 
+    def increment_hw_counters(self, hw):
+        if hw.cycles > 0 and hw.instructions >= 0:
+            self.hw_cycles += hw.cycles
+            self.hw_instructions += hw.instructions
+        if hw.llc_references > 0 and hw.llc_misses >= 0:
+            self.hw_llc_references += hw.llc_references
+            self.hw_llc_misses += hw.llc_misses
+
     def print_task_stat(self, total_calls, total_execution_time,
             max_call, max_dev, min_call, min_dev):
         avg = float(total_execution_time) / float(total_calls) \
@@ -860,6 +921,13 @@ class Variant(object):
         print '  '+self.name
         self.print_task_stat(total_calls, total_execution_time,
                 max_call, max_dev, min_call, min_dev)
+        if self.hw_cycles > 0:
+            print '       Instructions Per Cycle: %.2f' % \
+                    (float(self.hw_instructions) / float(self.hw_cycles))
+        if self.hw_llc_references > 0:
+            print '       LLC Miss Rate: %.2f%%' % \
+                    (100.0 * float(self.hw_llc_misses) /
+                     float(self.hw_llc_references))
         print
 
         if verbose and len(procs) > 1:
@@ -901,10 +969,14 @@ class Operation(object):
         self.color = None
         self.wait_intervals = list()
         self.owner = None
+        self.hw_counters = None
 
     def add_wait_interval(self, start, ready, end):
         self.wait_intervals.append(WaitInterval(start, ready, end))
 
+    def set_hw_counters(self, hw_counters):
+        self.hw_counters = hw_counters
+
     def assign_color(self, color_map):
         assert self.color is None
         if self.is_task:
@@ -937,9 +1009,11 @@ class Operation(object):
         total_wait_time = 0
         for interval in self.wait_intervals:
             total_wait_time += interval.end - interval.start
+        hw_info = repr(self.hw_counters) if self.hw_counters is not None else ''
         return 'total='+str(self.stop - self.start)+' us start='+ \
                 str(self.start)+' us stop='+str(self.stop)+' us'+ \
-                (' (wait for ' + str(total_wait_time) + ' us)' if total_wait_time > 0 else '')
+                (' (wait for ' + str(total_wait_time) + ' us)' if total_wait_time > 0 else '')+ \
+                (' ' + hw_info if hw_info else '')
 
     def __repr__(self):
         if self.is_task:
@@ -1100,11 +1174,24 @@ class MessageKind(object):
         self.message_id = message_id
         self.desc = desc
         self.color = None
+        self.count = 0
+        self.total_time = 0
 
     def assign_color(self, color):
         assert self.color is None
         self.color = color
 
+    def increment_messages(self, count, time):
+        self.count += count
+        self.total_time += time
+
+    def print_stats(self, total_messages):
+        print "  %s" % self.desc
+        print "    Messages: %d (%.3f%%)" % \
+                (self.count, 100.0*float(self.count)/float(total_messages))
+        print "    Handler time: %d us (avg %.2f us)" % \
+                (self.total_time, float(self.total_time)/float(self.count))
+
 class Message(object):
     def __init__(self, kind, start, stop):
         self.kind = kind
@@ -1308,6 +1395,8 @@ class StatGatherer(object):
             if task.variant not in self.application_tasks:
                 self.application_tasks.add(task.variant)
             task.variant.increment_calls(exec_time, proc)
+            if task.hw_counters is not None:
+                task.variant.increment_hw_counters(task.hw_counters)
 
     def print_stats(self, verbose):
         print "  -------------------------"
@@ -1323,6 +1412,527 @@ class StatGatherer(object):
                                 key=lambda v: v.total_time(),reverse=True):
             variant.print_stats(verbose)
 
+def read_index(log):
+    """Returns the chunk index at the end of a log written with
+    -hl:prof_logfile as a list of (start, stop, offset, length) tuples with
+    None for the times of the untimed records, or None for other logs"""
+    log.seek(0, os.SEEK_END)
+    size = log.tell()
+    if size < index_offset_size:
+        log.seek(0)
+        return None
+    log.seek(size - index_offset_size)
+    m = index_offset_pat.match(log.read(index_offset_size))
+    if m is None:
+        log.seek(0)
+        return None
+    log.seek(long(m.group('offset')))
+    index = list()
+    for line in log.read(size - index_offset_size - log.tell()).splitlines():
+        m = chunk_index_pat.match(line)
+        if m is not None:
+            index.append((m.group('start'), m.group('stop'),
+                          long(m.group('offset')), long(m.group('length'))))
+            continue
+        m = header_index_pat.match(line)
+        if m is not None:
+            index.append((None, None,
+                          long(m.group('offset')), long(m.group('length'))))
+    return index
+
+def read_log_lines(log, in_window):
+    """Yields the lines of a log file, seeking past the chunks outside of
+    the time window when the log has a chunk index"""
+    index = read_index(log)
+    if index is None:
+        for line in log:
+            yield line
+        return
+    for start, stop, offset, length in index:
+        if start is not None and not in_window(start, stop):
+            continue
+        log.seek(offset)
+        for line in log.read(length).splitlines(True):
+            yield line
+
+def parse_log_file(state, file_name, verbose, time_window):
+    skipped = 0
+    # With a time window all times are made relative to the start of the
+    # window and records that fall entirely outside of it are dropped
+    if time_window is not None:
+        window_start, window_stop = time_window
+    else:
+        window_start, window_stop = 0L, None
+    def read_window_time(string):
+        return max(read_time(string) - window_start, 0L)
+    def in_window(start, stop):
+        if time_window is None:
+            return True
+        return read_time(start) <= window_stop and \
+               read_time(stop) >= window_start
+    # Operations whose records were dropped so we can drop their waits too
+    dropped_tasks = set()
+    dropped_metas = set()
+    with open(file_name, 'rb') as log:  
+        matches = 0
+        # Keep track of the first and last times
+        first_time = 0L
+        last_time = 0L
+        skip_chunk = False
+        for line in read_log_lines(log, in_window):
+            if skip_chunk:
+                # Skip everything up to the next chunk boundary without
+                # having to match any of the record patterns
+                if 'Prof Chunk' not in line:
+                    continue
+                skip_chunk = False
+            matches += 1  
+            m = chunk_info_pat.match(line)
+            if m is not None:
+                skip_chunk = not in_window(m.group('start'), m.group('stop'))
+                continue
+            m = chunk_end_pat.match(line)
+            if m is not None:
+                continue
+            m = task_info_pat.match(line)
+            if m is not None:
+                if not in_window(m.group('start'), m.group('stop')):
+                    dropped_tasks.add((m.group('opid'), m.group('vid')))
+                    continue
+                state.log_task_info(long(m.group('opid')),
+                                   int(m.group('vid')),
+                                   int(m.group('pid'),16),
+                                   read_window_time(m.group('create')),
+                                   read_window_time(m.group('ready')),
+                                   read_window_time(m.group('start')),
+                                   read_window_time(m.group('stop')))
+                continue
+            m = meta_info_pat.match(line)
+            if m is not None:
+                if not in_window(m.group('start'), m.group('stop')):
+                    dropped_metas.add((m.group('opid'), m.group('hlr')))
+                    continue
+                state.log_meta_info(long(m.group('opid')),
+                                   int(m.group('hlr')),
+                                   int(m.group('pid'),16),
+                                   read_window_time(m.group('create')),
+                                   read_window_time(m.group('ready')),
+                                   read_window_time(m.group('start')),
+                                   read_window_time(m.group('stop')))
+                continue
+            m = copy_info_pat.match(line)
+            if m is not None:
+                if not in_window(m.group('start'), m.group('stop')):
+                    continue
+                state.log_copy_info(long(m.group('opid')),
+                                   int(m.group('src'),16),
+                                   int(m.group('dst'),16),
+                                   int(m.group('size')),
+                                   read_window_time(m.group('create')),
+                                   read_window_time(m.group('ready')),
+                                   read_window_time(m.group('start')),
+                                   read_window_time(m.group('stop')))
+                continue
+            m = copy_info_old_pat.match(line)
+            if m is not None:
+                if not in_window(m.group('start'), m.group('stop')):
+                    continue
+                state.log_copy_info(long(m.group('opid')),
+                                   int(m.group('src'),16),
+                                   int(m.group('dst'),16),
+                                   0,
+                                   read_window_time(m.group('create')),
+                                   read_window_time(m.group('ready')),
+                                   read_window_time(m.group('start')),
+                                   read_window_time(m.group('stop')))
+                continue
+            m = fill_info_pat.match(line)
+            if m is not None:
+                if not in_window(m.group('start'), m.group('stop')):
+                    continue
+                state.log_fill_info(long(m.group('opid')),
+                                   int(m.group('dst'),16),
+                                   read_window_time(m.group('create')),
+                                   read_window_time(m.group('ready')),
+                                   read_window_time(m.group('start')),
+                                   read_window_time(m.group('stop')))
+                continue
+            m = inst_create_pat.match(line)
+            if m is not None:
+                state.log_inst_create(long(m.group('opid')),
+                                     int(m.group('inst'),16),
+                                     read_window_time(m.group('create')))
+                continue
+            m = inst_usage_pat.match(line)
+            if m is not None:
+                state.log_inst_usage(long(m.group('opid')),
+                                    int(m.group('inst'),16),
+                                    int(m.group('mem'),16),
+                                    long(m.group('bytes')))
+                continue
+            m = inst_timeline_pat.match(line)
+            if m is not None:
+                state.log_inst_timeline(long(m.group('opid')),
+                                       int(m.group('inst'),16),
+                                       read_window_time(m.group('create')),
+                                       read_window_time(m.group('destroy')))
+                continue
+            m = user_info_pat.match(line)
+            if m is not None:
+                if not in_window(m.group('start'), m.group('stop')):
+                    continue
+                state.log_user_info(int(m.group('pid'), 16),
+                                   read_window_time(m.group('start')),
+                                   read_window_time(m.group('stop')),
+                                   m.group('name'))
+                continue
+            m = task_wait_info_pat.match(line)
+            if m is not None:
+                if (m.group('opid'), m.group('vid')) in dropped_tasks:
+                    continue
+                state.log_task_wait_info(long(m.group('opid')),
+                                        int(m.group('vid')),
+                                        read_window_time(m.group('start')),
+                                        read_window_time(m.group('ready')),
+                                        read_window_time(m.group('end')))
+                continue
+            m = task_hw_counters_pat.match(line)
+            if m is not None:
+                if (m.group('opid'), m.group('vid')) in dropped_tasks:
+                    continue
+                state.log_task_hw_counters(long(m.group('opid')),
+                                          int(m.group('vid')),
+                                          long(m.group('cycles')),
+                                          long(m.group('instrs')),
+                                          long(m.group('llcrefs')),
+                                          long(m.group('llcmisses')),
+                                          long(m.group('stalls')))
+                continue
+            m = meta_wait_info_pat.match(line)
+            if m is not None:
+                if (m.group('opid'), m.group('hlr')) in dropped_metas:
+                    continue
+                state.log_meta_wait_info(long(m.group('opid')),
+                                        int(m.group('hlr')),
+                                        read_window_time(m.group('start')),
+                                        read_window_time(m.group('ready')),
+                                        read_window_time(m.group('end')))
+                continue
+            m = kind_pat.match(line)
+            if m is not None:
+                state.log_kind(int(m.group('tid')),
+                              m.group('name'))
+                continue
+            m = variant_pat.match(line)
+            if m is not None:
+                state.log_variant(int(m.group('tid')),
+                                 int(m.group('vid')),
+                                 m.group('name'))
+                continue
+            m = operation_pat.match(line)
+            if m is not None:
+                state.log_operation(long(m.group('opid')),
+                                   int(m.group('kind')))
+                continue
+            m = multi_pat.match(line)
+            if m is not None:
+                state.log_multi(long(m.group('opid')),
+                               int(m.group('tid')))
+                continue
+            m = owner_pat.match(line)
+            if m is not None:
+                state.log_slice_owner(long(m.group('pid')),
+                                     long(m.group('opid')))
+                continue
+            m = meta_desc_pat.match(line)
+            if m is not None:
+                state.log_meta_desc(int(m.group('hlr')),
+                                   m.group('kind'))
+                continue
+            m = op_desc_pat.match(line)
+            if m is not None:
+                state.log_op_desc(int(m.group('opkind')),
+                                 m.group('kind'))
+                continue
+            m = proc_desc_pat.match(line)
+            if m is not None:
+                kind = int(m.group('kind'))
+                assert kind in processor_kinds
+                state.log_proc_desc(int(m.group('pid'),16),
+                                   processor_kinds[kind])
+                continue
+            m = mem_desc_pat.match(line)
+            if m is not None:
+                kind = int(m.group('kind'))
+                assert kind in memory_kinds
+                state.log_mem_desc(int(m.group('mid'),16),
+                                  memory_kinds[kind],
+                                  long(m.group('size')))
+                continue
+            m = message_desc_pat.match(line)
+            if m is not None:
+                state.log_message_desc(int(m.group('mid')),
+                                      m.group('desc'))
+                continue
+            m = message_info_pat.match(line)
+            if m is not None:
+                if not in_window(m.group('start'), m.group('stop')):
+                    continue
+                state.log_message_info(int(m.group('mid')),
+                                      int(m.group('pid'),16),
+                                      read_window_time(m.group('start')),
+                                      read_window_time(m.group('stop')))
+                continue
+            m = mapper_call_desc_pat.match(line)
+            if m is not None:
+                state.log_mapper_call_desc(int(m.group('mid')),
+                                          m.group('desc'))
+                continue
+            m = mapper_call_info_pat.match(line)
+            if m is not None:
+                if not in_window(m.group('start'), m.group('stop')):
+                    continue
+                state.log_mapper_call_info(int(m.group('mid')),
+                                          int(m.group('pid'),16),
+                                          int(m.group('uid')),
+                                          read_window_time(m.group('start')),
+                                          read_window_time(m.group('stop')))
+                continue
+            m = runtime_call_desc_pat.match(line)
+            if m is not None:
+                state.log_runtime_call_desc(int(m.group('rid')),
+                                           m.group('desc'))
+                continue
+            m = runtime_call_info_pat.match(line)
+            if m is not None:
+                if not in_window(m.group('start'), m.group('stop')):
+                    continue
+                state.log_runtime_call_info(int(m.group('rid')),
+                                           int(m.group('pid'),16),
+                                           read_window_time(m.group('start')),
+                                           read_window_time(m.group('stop')))
+                continue
+            m = eviction_info_pat.match(line)
+            if m is not None:
+                if not in_window(m.group('time'), m.group('time')):
+                    continue
+                state.log_eviction_info(int(m.group('mid'),16),
+                                       long(m.group('size')),
+                                       read_window_time(m.group('time')))
+                continue
+            m = alloc_failure_info_pat.match(line)
+            if m is not None:
+                if not in_window(m.group('time'), m.group('time')):
+                    continue
+                state.log_alloc_failure_info(int(m.group('mid'),16),
+                                            long(m.group('size')),
+                                            read_window_time(m.group('time')))
+                continue
+            m = proftask_info_pat.match(line)
+            if m is not None:
+                if not in_window(m.group('start'), m.group('stop')):
+                    continue
+                state.log_proftask_info(int(m.group('pid'),16),
+                                       long(m.group('opid')),
+                                       read_window_time(m.group('start')),
+                                       read_window_time(m.group('stop')))
+                continue
+            # If we made it here then we failed to match
+            matches -= 1 
+            skipped += 1
+            if verbose:
+                print 'Skipping line: %s' % line.strip()
+    if skipped > 0:
+        print 'WARNING: Skipped %d lines in %s' % (skipped, file_name)
+    return matches
+
+class LogRecorder(object):
+    """Stands in for the State when parsing log files in worker processes,
+    it records the calls to the log methods so they can be replayed on the
+    real State in the main process"""
+    def __init__(self):
+        self.records = list()
+
+    def __getattr__(self, name):
+        if not name.startswith('log_'):
+            raise AttributeError(name)
+        def record(*args):
+            self.records.append((name, args))
+        return record
+
+def parse_log_file_worker(args):
+    file_name, verbose, time_window = args
+    recorder = LogRecorder()
+    matches = parse_log_file(recorder, file_name, verbose, time_window)
+    return file_name, matches, recorder.records
+
+class SummaryRange(object):
+    """Stands in for a processor's full time range when printing statistics
+    merged from per-file summaries"""
+    def __init__(self, last_time, active, application, meta):
+        self.last_time = last_time
+        self.active = active
+        self.application = application
+        self.meta = meta
+
+    def total_time(self):
+        return self.last_time
+
+    def active_time(self):
+        return self.active
+
+    def application_time(self):
+        return self.application
+
+    def meta_time(self):
+        return self.meta
+
+def summarize_log_file_worker(args):
+    """Parses a log file into its own State and sends back only what is
+    needed to print statistics: per-variant call times, per-processor busy
+    times, and the instance and copy intervals for memories and channels"""
+    file_name, verbose, time_window = args
+    state = State()
+    matches = parse_log_file(state, file_name, verbose, time_window)
+    if time_window is not None:
+        state.filter_instances(time_window[1] - time_window[0])
+    summary = dict()
+    summary['last_time'] = state.last_time
+    # Instance and copy intervals have to be captured before building the
+    # time ranges, which fills in missing times with this file's last time
+    memories = list()
+    for mem in state.memories.itervalues():
+        instances = [(inst.inst_id, inst.size, inst.create, inst.destroy)
+                      for inst in mem.instances]
+        memories.append((mem.mem_id, mem.kind, mem.total_size, mem.evictions,
+                         mem.evicted_bytes, mem.failed_allocations,
+                         instances))
+    summary['memories'] = memories
+    channels = list()
+    for channel in state.channels.itervalues():
+        src = channel.src.mem_id if channel.src is not None else None
+        copies = [(copy.start, copy.stop) for copy in channel.copies]
+        channels.append((src, channel.dst.mem_id, copies))
+    summary['channels'] = channels
+    state.build_time_ranges()
+    summary['processors'] = [(proc.proc_id, proc.kind,
+                              proc.full_range.active_time(),
+                              proc.full_range.application_time(),
+                              proc.full_range.meta_time())
+                              for proc in state.processors.itervalues()]
+    stat = StatGatherer(state)
+    for proc in state.processors.itervalues():
+        proc.update_task_stats(stat)
+    variants = list()
+    for is_meta, group in ((False, stat.application_tasks),
+                           (True, stat.meta_tasks)):
+        for variant in group:
+            calls = dict()
+            for proc in variant.total_calls.iterkeys():
+                calls[proc.proc_id] = (variant.total_calls[proc],
+                                       variant.total_execution_time[proc],
+                                       variant.min_call[proc],
+                                       variant.max_call[proc],
+                                       variant.all_calls[proc])
+            variants.append((is_meta, variant.variant_id, variant.name, calls,
+                             (variant.hw_cycles, variant.hw_instructions,
+                              variant.hw_llc_references,
+                              variant.hw_llc_misses)))
+    summary['variants'] = variants
+    summary['messages'] = [(kind.message_id, kind.desc, kind.count,
+                            kind.total_time)
+                            for kind in state.message_kinds.itervalues()]
+    return file_name, matches, summary
+
+def merge_summaries(state, summaries):
+    """Rebuilds enough of the State from per-file summaries to print the
+    statistics, returns the StatGatherer holding the merged task statistics"""
+    for summary in summaries:
+        state.last_time = max(state.last_time, summary['last_time'])
+    for summary in summaries:
+        for mem_id, kind, size, evictions, evicted_bytes, failed, \
+                instances in summary['memories']:
+            mem = state.find_memory(mem_id)
+            # Memories referenced by remote copies only get a description
+            # in the log file of the node that owns them
+            if size is not None:
+                mem.kind = kind
+                mem.total_size = size
+            mem.evictions += evictions
+            mem.evicted_bytes += evicted_bytes
+            mem.failed_allocations += failed
+            for inst_id, inst_size, create, destroy in instances:
+                inst = Instance(inst_id, None)
+                inst.mem = mem
+                inst.size = inst_size
+                inst.create = create
+                inst.destroy = destroy
+                mem.instances.add(inst)
+    for summary in summaries:
+        for src_id, dst_id, copies in summary['channels']:
+            src = state.find_memory(src_id) if src_id is not None else None
+            channel = state.find_channel(src, state.find_memory(dst_id))
+            for start, stop in copies:
+                copy = Copy(src, channel.dst, None)
+                copy.start = start
+                copy.stop = stop
+                channel.add_copy(copy)
+    busy_times = dict()
+    for summary in summaries:
+        for proc_id, kind, active, application, meta in summary['processors']:
+            proc = state.find_processor(proc_id)
+            if kind is not None:
+                proc.kind = kind
+            prev = busy_times.get(proc_id, (0, 0, 0))
+            busy_times[proc_id] = (prev[0] + active, prev[1] + application,
+                                   prev[2] + meta)
+    for proc_id, times in busy_times.iteritems():
+        state.processors[proc_id].full_range = SummaryRange(state.last_time,
+                                                            *times)
+    for mem in state.memories.itervalues():
+        mem.init_time_range(state.last_time)
+        mem.sort_time_range()
+    for channel in state.channels.itervalues():
+        channel.init_time_range(state.last_time)
+        channel.sort_time_range()
+    for summary in summaries:
+        for message_id, desc, count, total in summary['messages']:
+            state.log_message_desc(message_id, desc)
+            state.message_kinds[message_id].increment_messages(count, total)
+    stat = StatGatherer(state)
+    for summary in summaries:
+        for is_meta, variant_id, name, calls, hw in summary['variants']:
+            if is_meta:
+                variant = state.find_meta_variant(variant_id)
+                stat.meta_tasks.add(variant)
+            else:
+                variant = state.find_variant(variant_id)
+                stat.application_tasks.add(variant)
+            if name is not None:
+                variant.name = name
+            for proc_id, (count, total, min_call, max_call, all_calls) \
+                    in calls.iteritems():
+                proc = state.find_processor(proc_id)
+                if proc not in variant.total_calls:
+                    variant.total_calls[proc] = count
+                    variant.total_execution_time[proc] = total
+                    variant.all_calls[proc] = list(all_calls)
+                    variant.max_call[proc] = max_call
+                    variant.min_call[proc] = min_call
+                else:
+                    variant.total_calls[proc] += count
+                    variant.total_execution_time[proc] += total
+                    variant.all_calls[proc].extend(all_calls)
+                    variant.max_call[proc] = max(variant.max_call[proc],
+                                                 max_call)
+                    variant.min_call[proc] = min(variant.min_call[proc],
+                                                 min_call)
+            variant.hw_cycles += hw[0]
+            variant.hw_instructions += hw[1]
+            variant.hw_llc_references += hw[2]
+            variant.hw_llc_misses += hw[3]
+    return stat
+
 class State(object):
     def __init__(self):
         self.processors = {}
@@ -1345,212 +1955,17 @@ class State(object):
         self.runtime_calls = {}
         self.instances = {}
 
-    def parse_log_file(self, file_name, verbose):
-        skipped = 0
-        with open(file_name, 'rb') as log:  
-            matches = 0
-            # Keep track of the first and last times
-            first_time = 0L
-            last_time = 0L
-            for line in log:
-                matches += 1  
-                m = task_info_pat.match(line)
-                if m is not None:
-                    self.log_task_info(long(m.group('opid')),
-                                       int(m.group('vid')),
-                                       int(m.group('pid'),16),
-                                       read_time(m.group('create')),
-                                       read_time(m.group('ready')),
-                                       read_time(m.group('start')),
-                                       read_time(m.group('stop')))
-                    continue
-                m = meta_info_pat.match(line)
-                if m is not None:
-                    self.log_meta_info(long(m.group('opid')),
-                                       int(m.group('hlr')),
-                                       int(m.group('pid'),16),
-                                       read_time(m.group('create')),
-                                       read_time(m.group('ready')),
-                                       read_time(m.group('start')),
-                                       read_time(m.group('stop')))
-                    continue
-                m = copy_info_pat.match(line)
-                if m is not None:
-                    self.log_copy_info(long(m.group('opid')),
-                                       int(m.group('src'),16),
-                                       int(m.group('dst'),16),
-                                       int(m.group('size')),
-                                       read_time(m.group('create')),
-                                       read_time(m.group('ready')),
-                                       read_time(m.group('start')),
-                                       read_time(m.group('stop')))
-                    continue
-                m = copy_info_old_pat.match(line)
-                if m is not None:
-                    self.log_copy_info(long(m.group('opid')),
-                                       int(m.group('src'),16),
-                                       int(m.group('dst'),16),
-                                       0,
-                                       read_time(m.group('create')),
-                                       read_time(m.group('ready')),
-                                       read_time(m.group('start')),
-                                       read_time(m.group('stop')))
-                    continue
-                m = fill_info_pat.match(line)
-                if m is not None:
-                    self.log_fill_info(long(m.group('opid')),
-                                       int(m.group('dst'),16),
-                                       read_time(m.group('create')),
-                                       read_time(m.group('ready')),
-                                       read_time(m.group('start')),
-                                       read_time(m.group('stop')))
-                    continue
-                m = inst_create_pat.match(line)
-                if m is not None:
-                    self.log_inst_create(long(m.group('opid')),
-                                         int(m.group('inst'),16),
-                                         read_time(m.group('create')))
-                    continue
-                m = inst_usage_pat.match(line)
-                if m is not None:
-                    self.log_inst_usage(long(m.group('opid')),
-                                        int(m.group('inst'),16),
-                                        int(m.group('mem'),16),
-                                        long(m.group('bytes')))
-                    continue
-                m = inst_timeline_pat.match(line)
-                if m is not None:
-                    self.log_inst_timeline(long(m.group('opid')),
-                                           int(m.group('inst'),16),
-                                           read_time(m.group('create')),
-                                           read_time(m.group('destroy')))
-                    continue
-                m = user_info_pat.match(line)
-                if m is not None:
-                    self.log_user_info(int(m.group('pid'), 16),
-                                       read_time(m.group('start')),
-                                       read_time(m.group('stop')),
-                                       m.group('name'))
-                    continue
-                m = task_wait_info_pat.match(line)
-                if m is not None:
-                    self.log_task_wait_info(long(m.group('opid')),
-                                            int(m.group('vid')),
-                                            read_time(m.group('start')),
-                                            read_time(m.group('ready')),
-                                            read_time(m.group('end')))
-                    continue
-                m = meta_wait_info_pat.match(line)
-                if m is not None:
-                    self.log_meta_wait_info(long(m.group('opid')),
-                                            int(m.group('hlr')),
-                                            read_time(m.group('start')),
-                                            read_time(m.group('ready')),
-                                            read_time(m.group('end')))
-                    continue
-                m = kind_pat.match(line)
-                if m is not None:
-                    self.log_kind(int(m.group('tid')),
-                                  m.group('name'))
-                    continue
-                m = variant_pat.match(line)
-                if m is not None:
-                    self.log_variant(int(m.group('tid')),
-                                     int(m.group('vid')),
-                                     m.group('name'))
-                    continue
-                m = operation_pat.match(line)
-                if m is not None:
-                    self.log_operation(long(m.group('opid')),
-                                       int(m.group('kind')))
-                    continue
-                m = multi_pat.match(line)
-                if m is not None:
-                    self.log_multi(long(m.group('opid')),
-                                   int(m.group('tid')))
-                    continue
-                m = owner_pat.match(line)
-                if m is not None:
-                    self.log_slice_owner(long(m.group('pid')),
-                                         long(m.group('opid')))
-                    continue
-                m = meta_desc_pat.match(line)
-                if m is not None:
-                    self.log_meta_desc(int(m.group('hlr')),
-                                       m.group('kind'))
-                    continue
-                m = op_desc_pat.match(line)
-                if m is not None:
-                    self.log_op_desc(int(m.group('opkind')),
-                                     m.group('kind'))
-                    continue
-                m = proc_desc_pat.match(line)
-                if m is not None:
-                    kind = int(m.group('kind'))
-                    assert kind in processor_kinds
-                    self.log_proc_desc(int(m.group('pid'),16),
-                                       processor_kinds[kind])
-                    continue
-                m = mem_desc_pat.match(line)
-                if m is not None:
-                    kind = int(m.group('kind'))
-                    assert kind in memory_kinds
-                    self.log_mem_desc(int(m.group('mid'),16),
-                                      memory_kinds[kind],
-                                      long(m.group('size')))
-                    continue
-                m = message_desc_pat.match(line)
-                if m is not None:
-                    self.log_message_desc(int(m.group('mid')),
-                                          m.group('desc'))
-                    continue
-                m = message_info_pat.match(line)
-                if m is not None:
-                    self.log_message_info(int(m.group('mid')),
-                                          int(m.group('pid'),16),
-                                          read_time(m.group('start')),
-                                          read_time(m.group('stop')))
-                    continue
-                m = mapper_call_desc_pat.match(line)
-                if m is not None:
-                    self.log_mapper_call_desc(int(m.group('mid')),
-                                              m.group('desc'))
-                    continue
-                m = mapper_call_info_pat.match(line)
-                if m is not None:
-                    self.log_mapper_call_info(int(m.group('mid')),
-                                              int(m.group('pid'),16),
-                                              int(m.group('uid')),
-                                              read_time(m.group('start')),
-                                              read_time(m.group('stop')))
-                    continue
-                m = runtime_call_desc_pat.match(line)
-                if m is not None:
-                    self.log_runtime_call_desc(int(m.group('rid')),
-                                               m.group('desc'))
-                    continue
-                m = runtime_call_info_pat.match(line)
-                if m is not None:
-                    self.log_runtime_call_info(int(m.group('rid')),
-                                               int(m.group('pid'),16),
-                                               read_time(m.group('start')),
-                                               read_time(m.group('stop')))
-                    continue
-                m = proftask_info_pat.match(line)
-                if m is not None:
-                    self.log_proftask_info(int(m.group('pid'),16),
-                                           long(m.group('opid')),
-                                           read_time(m.group('start')),
-                                           read_time(m.group('stop')))
-                    continue
-                # If we made it here then we failed to match
-                matches -= 1 
-                skipped += 1
-                if verbose:
-                    print 'Skipping line: %s' % line.strip()
-        if skipped > 0:
-            print 'WARNING: Skipped %d lines in %s' % (skipped, file_name)
-        return matches
+    def parse_log_file(self, file_name, verbose, time_window=None):
+        return parse_log_file(self, file_name, verbose, time_window)
+
+    def filter_instances(self, window_length):
+        # Drop the instances whose lifetimes fall entirely outside of the
+        # time window, their times have already been made relative to it
+        for mem in self.memories.itervalues():
+            for inst in list(mem.instances):
+                if (inst.destroy is not None and inst.destroy <= 0) or \
+                   (inst.create is not None and inst.create > window_length):
+                    mem.instances.remove(inst)
 
     def log_task_info(self, op_id, variant_id, proc_id,
                       create, ready, start, stop):
@@ -1661,6 +2076,13 @@ class State(object):
         assert end >= ready
         task.add_wait_interval(start, ready, end)
 
+    def log_task_hw_counters(self, op_id, variant_id, cycles, instructions,
+                             llc_references, llc_misses, stalled_cycles):
+        variant = self.find_variant(variant_id)
+        task = self.find_task(op_id, variant)
+        task.set_hw_counters(HWCounters(cycles, instructions, llc_references,
+                                        llc_misses, stalled_cycles))
+
     def log_meta_wait_info(self, op_id, hlr, start, ready, end):
         op = self.find_op(op_id)
         variant = self.find_meta_variant(hlr)
@@ -1737,6 +2159,7 @@ class State(object):
         if stop > self.last_time:
             self.last_time = stop
         message = Message(self.message_kinds[kind], start, stop)
+        message.kind.increment_messages(1, stop - start)
         proc = self.find_processor(proc_id)
         proc.add_message(message)
 
@@ -1770,6 +2193,15 @@ class State(object):
         proc = self.find_processor(proc_id)
         proc.add_runtime_call(call)
 
+    def log_eviction_info(self, mem_id, size, time):
+        mem = self.find_memory(mem_id)
+        mem.evictions += 1
+        mem.evicted_bytes += size
+
+    def log_alloc_failure_info(self, mem_id, size, time):
+        mem = self.find_memory(mem_id)
+        mem.failed_allocations += 1
+
     def log_proftask_info(self, proc_id, op_id, start, stop):
         assert start <= stop
         task = Operation(op_id)
@@ -1893,22 +2325,37 @@ class State(object):
             channel.print_stats()
         print
 
-    def print_task_stats(self, verbose):
+    def print_message_stats(self):
+        print '****************************************************'
+        print '   MESSAGE STATS'
+        print '****************************************************'
+        total_messages = sum(kind.count
+                             for kind in self.message_kinds.itervalues())
+        for kind in sorted(self.message_kinds.itervalues(),
+                            key=lambda k: k.count, reverse=True):
+            if kind.count > 0:
+                kind.print_stats(total_messages)
+        print "  Total messages: %d" % total_messages
+        print
+
+    def print_task_stats(self, verbose, stat=None):
         print '****************************************************'
         print '   TASK STATS'
         print '****************************************************'
-        stat = StatGatherer(self)
-        for proc in self.processors.itervalues():
-            proc.update_task_stats(stat)
+        if stat is None:
+            stat = StatGatherer(self)
+            for proc in self.processors.itervalues():
+                proc.update_task_stats(stat)
         stat.print_stats(verbose)
         print
 
-    def print_stats(self, verbose):
+    def print_stats(self, verbose, stat=None):
         if verbose:
             self.print_processor_stats()
             self.print_memory_stats()
             self.print_channel_stats()
-        self.print_task_stats(verbose)
+            self.print_message_stats()
+        self.print_task_stats(verbose, stat)
 
     def assign_colors(self):
         # Subtract out some colors for which we have special colors
@@ -2072,7 +2519,7 @@ class State(object):
         html_file.close()
 
 def usage():
-    print 'Usage: '+sys.argv[0]+' [-p] [-i] [-c] [-s] [-v] [-o out_file] [-m us_per_pixel] <file_names>+'
+    print 'Usage: '+sys.argv[0]+' [-p] [-i] [-c] [-s] [-v] [-o out_file] [-m us_per_pixel] [-w start:stop] [-j procs] <file_names>+'
     print '  -p : include processors in visualization'
     print '  -i : include instances in visualization'
     print '  -c : include channels in visualization'
@@ -2080,10 +2527,14 @@ def usage():
     print '  -v : print verbose profiling information'
     print '  -o <out_file> : give a prefix for the output file'
     print '  -m <ppm> : set the micro-seconds per pixel for images (default %d)' % (US_PER_PIXEL)
+    print '  -w <start>:<stop> : only load records in the time window (in micro-seconds)'
+    print '                      logs from -hl:prof_logfile only read the chunks in the window'
+    print '  -j <procs> : parse the log files with this many processes (default 1),'
+    print '               with -s only per-file summaries are merged'
     sys.exit(1)
 
 def main():
-    opts, args = getopt(sys.argv[1:],'pcivm:o:sCST')
+    opts, args = getopt(sys.argv[1:],'pcivm:o:sCSTw:j:')
     opts = dict(opts)
     if len(args) == 0:
       usage()
@@ -2100,6 +2551,8 @@ def main():
     print_stats = False
     verbose = False
     interactive_timeline = True
+    time_window = None
+    num_procs = 1
     if '-p' in opts:
         show_procs = True
         show_all = False
@@ -2123,6 +2576,15 @@ def main():
         show_copy_matrix = True
     if '-S' in opts:
         interactive_timeline = False
+    if '-w' in opts:
+        window = opts['-w'].split(':')
+        if len(window) != 2:
+            usage()
+        time_window = (long(window[0]), long(window[1]))
+        if time_window[0] > time_window[1]:
+            usage()
+    if '-j' in opts:
+        num_procs = int(opts['-j'])
     if show_all:
         show_procs = True
         show_channels = True
@@ -2130,15 +2592,59 @@ def main():
 
     state = State()
     has_matches = False
-    for file_name in file_names:
-        print 'Reading log file %s...' % file_name
-        total_matches = state.parse_log_file(file_name, verbose)
-        print 'Matched %s lines' % total_matches
-        if total_matches > 0:
-            has_matches = True
+    if num_procs > 1 and len(file_names) > 1 and print_stats:
+        # Statistics only need per-file summaries, so each worker builds
+        # its own State and we merge what they send back
+        import multiprocessing
+        pool = multiprocessing.Pool(min(num_procs, len(file_names)))
+        results = pool.imap(summarize_log_file_worker,
+                    [(file_name, verbose, time_window) 
+                      for file_name in file_names])
+        summaries = list()
+        for file_name, total_matches, summary in results:
+            print 'Read log file %s...' % file_name
+            print 'Matched %s lines' % total_matches
+            if total_matches > 0:
+                has_matches = True
+            summaries.append(summary)
+        pool.close()
+        pool.join()
+        if not has_matches:
+            print 'No matches found! Exiting...'
+            return
+        state.print_stats(verbose, merge_summaries(state, summaries))
+        return
+    elif num_procs > 1 and len(file_names) > 1:
+        # Parse the files (usually one per node) in parallel, the timelines
+        # draw every record so the workers send back the ones we kept and
+        # we replay them here
+        import multiprocessing
+        pool = multiprocessing.Pool(min(num_procs, len(file_names)))
+        results = pool.imap(parse_log_file_worker,
+                    [(file_name, verbose, time_window) 
+                      for file_name in file_names])
+        for file_name, total_matches, records in results:
+            print 'Read log file %s...' % file_name
+            for name, args in records:
+                getattr(state, name)(*args)
+            print 'Matched %s lines' % total_matches
+            if total_matches > 0:
+                has_matches = True
+        pool.close()
+        pool.join()
+    else:
+        for file_name in file_names:
+            print 'Reading log file %s...' % file_name
+            total_matches = state.parse_log_file(file_name, verbose, 
+                                                 time_window)
+            print 'Matched %s lines' % total_matches
+            if total_matches > 0:
+                has_matches = True
     if not has_matches:
         print 'No matches found! Exiting...'
         return
+    if time_window is not None:
+        state.filter_instances(time_window[1] - time_window[0])
 
     # Once we are done loading everything, do the sorting
     state.build_time_ranges()